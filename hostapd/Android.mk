@@ -90,6 +90,8 @@ OBJS += src/ap/ap_config.c
 OBJS += src/ap/eap_user_db.c
 OBJS += src/ap/ieee802_11_auth.c
 OBJS += src/ap/sta_info.c
+OBJS += src/ap/sta_admit.c
+OBJS += src/ap/sta_latency.c
 OBJS += src/ap/wpa_auth.c
 OBJS += src/ap/tkip_countermeasures.c
 OBJS += src/ap/ap_mlme.c
@@ -112,6 +114,8 @@ NEED_RC4=y
 NEED_AES=y
 NEED_MD5=y
 NEED_SHA1=y
+# PMKSA/FT cache snapshot (pmksa_cache_file)
+NEED_AES_SIV=y
 
 OBJS += src/drivers/drivers.c
 L_CFLAGS += -DHOSTAPD
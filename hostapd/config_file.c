@@ -623,6 +623,11 @@ static int hostapd_config_read_eap_user(const char *fname,
 	if (ret == 0) {
 		hostapd_config_free_eap_users(conf->eap_user);
 		conf->eap_user = new_user;
+		hostapd_eap_user_index_free(conf->eap_user_index);
+		conf->eap_user_index = hostapd_eap_user_index_build(new_user);
+		if (!conf->eap_user_index)
+			wpa_printf(MSG_DEBUG,
+				   "Failed to index EAP users - using list lookup");
 	} else {
 		hostapd_config_free_eap_users(new_user);
 	}
@@ -2699,6 +2704,16 @@ int hostapd_config_fill(struct hostapd_config *conf,
           MAX_STA_COUNT);
       return 1;
     }
+	} else if (os_strcmp(buf, "ap_sta_admit_headroom") == 0) {
+		conf->ap_sta_admit_headroom = atoi(pos);
+		if (conf->ap_sta_admit_headroom < 0 ||
+		    conf->ap_sta_admit_headroom > MAX_STA_COUNT) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid ap_sta_admit_headroom=%d; allowed range 0..%d",
+				   line, conf->ap_sta_admit_headroom,
+				   MAX_STA_COUNT);
+			return 1;
+		}
 	} else if (os_strcmp(buf, "testbed_mode") == 0) {
 		conf->testbed_mode = atoi(pos);
 #ifdef EAP_SERVER
@@ -3064,6 +3079,15 @@ int hostapd_config_fill(struct hostapd_config *conf,
           "0..max_num_sta", line, bss->num_res_sta);
       return 1;
     }
+	} else if (os_strcmp(buf, "sta_admit_priority") == 0) {
+		bss->sta_admit_priority = atoi(pos);
+		if (bss->sta_admit_priority < 0 ||
+		    bss->sta_admit_priority > 7) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid sta_admit_priority=%d; allowed range 0..7",
+				   line, bss->sta_admit_priority);
+			return 1;
+		}
 	} else if (os_strcmp(buf, "wpa") == 0) {
 		bss->wpa = atoi(pos);
 	} else if (os_strcmp(buf, "wpa_group_rekey") == 0) {
@@ -3099,6 +3123,26 @@ int hostapd_config_fill(struct hostapd_config *conf,
 		bss->wpa_pairwise_update_count = (u32) val;
 	} else if (os_strcmp(buf, "wpa_disable_eapol_key_retries") == 0) {
 		bss->wpa_disable_eapol_key_retries = atoi(pos);
+	} else if (os_strcmp(buf, "wpa_group_rekey_batch") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid wpa_group_rekey_batch=%d",
+				   line, val);
+			return 1;
+		}
+		bss->wpa_group_rekey_batch = val;
+	} else if (os_strcmp(buf, "wpa_group_rekey_batch_interval") == 0) {
+		int val = atoi(pos);
+
+		if (val < 1 || val > 10000) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid wpa_group_rekey_batch_interval=%d; allowed range 1..10000",
+				   line, val);
+			return 1;
+		}
+		bss->wpa_group_rekey_batch_interval = val;
 	} else if (os_strcmp(buf, "wpa_passphrase") == 0) {
 		int len = os_strlen(pos);
 		if (len < 8 || len > 63) {
@@ -3253,6 +3297,26 @@ int hostapd_config_fill(struct hostapd_config *conf,
 		}
 	} else if (os_strcmp(buf, "pmk_r1_push") == 0) {
 		bss->pmk_r1_push = atoi(pos);
+	} else if (os_strcmp(buf, "pmk_r1_push_batch_interval") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0 || val > 10000) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid pmk_r1_push_batch_interval=%d; allowed range 0..10000",
+				   line, val);
+			return 1;
+		}
+		bss->pmk_r1_push_batch_interval = val;
+	} else if (os_strcmp(buf, "pmk_r1_push_rate") == 0) {
+		int val = atoi(pos);
+
+		if (val < 0) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid pmk_r1_push_rate=%d",
+				   line, val);
+			return 1;
+		}
+		bss->pmk_r1_push_rate = val;
 	} else if (os_strcmp(buf, "ft_over_ds") == 0) {
 		bss->ft_over_ds = atoi(pos);
 	} else if (os_strcmp(buf, "ft_psk_generate_local") == 0) {
@@ -3391,6 +3455,18 @@ int hostapd_config_fill(struct hostapd_config *conf,
     os_free(conf->acs_history_file);
     conf->acs_history_file = os_strdup(pos);
   }
+  else if (os_strcmp(buf, "acs_log_ring_size") == 0) {
+    int val = atoi(pos);
+    if (val < 0 || val > 1048576) {
+      wpa_printf(MSG_ERROR, "Line %d: invalid acs_log_ring_size %d",
+                 line, val);
+      return 1;
+    }
+    conf->acs_log_ring_size = val;
+  }
+  else if (os_strcmp(buf, "acs_log_to_file") == 0) {
+    conf->acs_log_to_file = atoi(pos) ? 1 : 0;
+  }
   else if (os_strcmp(buf, "acs_use24overlapped") == 0) {
     int val = atoi(pos);
     conf->acs_use24overlapped = val;
@@ -4238,6 +4314,23 @@ int hostapd_config_fill(struct hostapd_config *conf,
 		bss->disable_pmksa_caching = atoi(pos);
 	} else if (os_strcmp(buf, "okc") == 0) {
 		bss->okc = atoi(pos);
+	} else if (os_strcmp(buf, "pmksa_cache_file") == 0) {
+		os_free(bss->pmksa_cache_file);
+		bss->pmksa_cache_file = os_strdup(pos);
+	} else if (os_strcmp(buf, "pmksa_cache_file_key") == 0) {
+		size_t len = os_strlen(pos) / 2;
+
+		if ((len != 32 && len != 48 && len != 64) ||
+		    os_strlen(pos) % 2 ||
+		    hexstr2bin(pos, bss->pmksa_cache_file_key, len) < 0) {
+			wpa_printf(MSG_ERROR,
+				   "Line %d: Invalid pmksa_cache_file_key (expected 32, 48, or 64 octets as hex)",
+				   line);
+			return 1;
+		}
+		bss->pmksa_cache_file_key_len = len;
+	} else if (os_strcmp(buf, "pmksa_cache_save_interval") == 0) {
+		bss->pmksa_cache_save_interval = atoi(pos);
 	} else if (os_strcmp(buf, "pmksa_interval") == 0) {
 		bss->pmksa_interval = atoi(pos);
 	} else if (os_strcmp(buf, "pmksa_life_time") == 0) {
@@ -5016,6 +5109,14 @@ int hostapd_config_fill(struct hostapd_config *conf,
 			hostapd_atf_read_config(&conf->atf_cfg, conf->atf_config_file);
 		else
 			hostapd_atf_clean_config(&conf->atf_cfg);
+	} else if (os_strcmp(buf, "atf_update_delay") == 0) {
+		int val = atoi(pos);
+		if (val < 0 || val > 10000) {
+			wpa_printf(MSG_ERROR, "Line %d: invalid atf_update_delay %d",
+				   line, val);
+			return 1;
+		}
+		conf->atf_update_delay = val;
 	} else if (os_strcmp(buf, "enable_bss_load_ie") == 0) {
 		bss->enable_bss_load_ie = atoi(pos);
 		if (bss->enable_bss_load_ie < 0 || bss->enable_bss_load_ie > 1) {
@@ -54,12 +54,16 @@
 #include "ap/wnm_ap.h"
 #include "ap/wpa_auth.h"
 #include "ap/acs.h"
+#include "ap/acs_log.h"
 #include "ap/bss_load.h"
 #include "ap/hw_features.h"
 #include "ap/beacon.h"
 #include "ap/neighbor_db.h"
 #include "ap/rrm.h"
 #include "ap/dpp_hostapd.h"
+#include "ap/gas_serv.h"
+#include "ap/sta_admit.h"
+#include "ap/sta_latency.h"
 #include "wps/wps_defs.h"
 #include "wps/wps.h"
 #include "fst/fst_ctrl_iface.h"
@@ -83,7 +87,7 @@ static unsigned char gcookie[COOKIE_LEN];
 #endif /* CONFIG_CTRL_IFACE_UDP */
 
 static void hostapd_ctrl_iface_send(struct hostapd_data *hapd, int level,
-				    enum wpa_msg_type type,
+				    enum wpa_msg_type type, u32 event,
 				    const char *buf, size_t len);
 static int hostapd_ctrl_iface_disable(struct hostapd_iface *iface);
 
@@ -1563,10 +1567,23 @@ static int hostapd_ctrl_iface_set(struct hostapd_data *hapd, char *cmd)
 		if (ret)
 			return ret;
 
+#ifdef CONFIG_INTERWORKING
+		if (hapd->anqp_cache && gas_serv_anqp_cache_param(cmd))
+			gas_serv_anqp_cache_update(hapd);
+#endif /* CONFIG_INTERWORKING */
+		sta_admit_config(hapd->iface);
+
 		if (os_strcasecmp(cmd, "deny_mac_file") == 0) {
 			hostapd_disassoc_deny_mac(hapd);
 		} else if (os_strcasecmp(cmd, "accept_mac_file") == 0) {
 			hostapd_disassoc_accept_mac(hapd);
+#ifdef CONFIG_IEEE80211R_AP
+		} else if (os_strcasecmp(cmd, "r0kh") == 0 ||
+			   os_strcasecmp(cmd, "r1kh") == 0) {
+			/* the new entry is not in the key holder index yet */
+			if (hapd->wpa_auth)
+				wpa_ft_rkh_index_rebuild(hapd->wpa_auth);
+#endif /* CONFIG_IEEE80211R_AP */
 		} else if (os_strncmp(cmd, "wme_ac_", 7) == 0 ||
 			   os_strncmp(cmd, "wmm_ac_", 7) == 0) {
 			hapd->parameter_set_count++;
@@ -6564,6 +6581,32 @@ int hostapd_ctrl_iface_get_sta_measurements(struct hostapd_data *hapd,
 }
 
 
+static int hostapd_ctrl_iface_gtk_rekey_status(struct hostapd_data *hapd,
+					       const char *cmd, char *buf,
+					       size_t buflen)
+{
+	hapd = get_bss_index(cmd, hapd->iface);
+	if (hapd == NULL || hapd->wpa_auth == NULL)
+		return -1;
+
+	return wpa_auth_gtk_rollout_status(hapd->wpa_auth, buf, buflen);
+}
+
+
+#ifdef CONFIG_IEEE80211R_AP
+static int hostapd_ctrl_iface_ft_push_status(struct hostapd_data *hapd,
+					     const char *cmd, char *buf,
+					     size_t buflen)
+{
+	hapd = get_bss_index(cmd, hapd->iface);
+	if (hapd == NULL || hapd->wpa_auth == NULL)
+		return -1;
+
+	return wpa_ft_push_status(hapd->wpa_auth, buf, buflen);
+}
+#endif /* CONFIG_IEEE80211R_AP */
+
+
 int hostapd_ctrl_iface_get_vap_measurements(struct hostapd_data *hapd,
   const char *cmd, char *buf, size_t buflen)
 {
@@ -7997,6 +8040,12 @@ static int hostapd_ctrl_iface_receive_process(struct hostapd_data *hapd,
 			else
 				reply_len += res;
 		}
+#ifdef EAP_TLS_FUNCS
+		if (reply_len >= 0 && hapd->ssl_ctx)
+			reply_len += tls_global_get_mib(hapd->ssl_ctx,
+							reply + reply_len,
+							reply_size - reply_len);
+#endif /* EAP_TLS_FUNCS */
 #ifndef CONFIG_NO_RADIUS
 		if (reply_len >= 0) {
 			res = radius_client_get_mib(hapd->radius,
@@ -8020,6 +8069,9 @@ static int hostapd_ctrl_iface_receive_process(struct hostapd_data *hapd,
 	} else if (os_strncmp(buf, "STA-NEXT ", 9) == 0) {
 		reply_len = hostapd_ctrl_iface_sta_next(hapd, buf + 9, reply,
 							reply_size);
+	} else if (os_strncmp(buf, "STA-ALL ", 8) == 0) {
+		reply_len = hostapd_ctrl_iface_sta_all(hapd, buf + 8, reply,
+						       reply_size);
 	} else if (os_strcmp(buf, "ATTACH") == 0) {
 		if (hostapd_ctrl_iface_attach(hapd, from, fromlen, NULL))
 			reply_len = -1;
@@ -8261,6 +8313,16 @@ static int hostapd_ctrl_iface_receive_process(struct hostapd_data *hapd,
 		wpa_printf(MSG_DEBUG, "%s; *** Received from FAPI: 'GET_VAP_MEASUREMENTS' (buf= '%s') ***\n", __FUNCTION__, buf);
 		reply_len = hostapd_ctrl_iface_get_vap_measurements(hapd, buf + 21, reply,
 					reply_size);
+	} else if (os_strncmp(buf, "GTK_REKEY_STATUS ", 17) == 0) {
+		reply_len = hostapd_ctrl_iface_gtk_rekey_status(hapd, buf + 17,
+								reply,
+								reply_size);
+#ifdef CONFIG_IEEE80211R_AP
+	} else if (os_strncmp(buf, "FT_PUSH_STATUS ", 15) == 0) {
+		reply_len = hostapd_ctrl_iface_ft_push_status(hapd, buf + 15,
+							      reply,
+							      reply_size);
+#endif /* CONFIG_IEEE80211R_AP */
 	} else if (os_strncmp(buf, "GET_RADIO_INFO", 14) == 0) {
 		wpa_printf(MSG_DEBUG, "%s; *** Received from FAPI: 'GET_RADIO_INFO' (buf= '%s') ***\n", __FUNCTION__, buf);
 		reply_len = hostapd_ctrl_iface_get_radio_info(hapd, NULL, reply,
@@ -8280,6 +8342,15 @@ static int hostapd_ctrl_iface_receive_process(struct hostapd_data *hapd,
 	} else if (os_strncmp(buf, "GET_ACS_REPORT", 14) == 0) {
 		reply_len = hostapd_ctrl_iface_acs_report(hapd->iface, NULL, reply,
 					 reply_size);
+	} else if (os_strcmp(buf, "GET_ACS_LOG") == 0) {
+		reply_len = acs_log_dump(hapd->iface, NULL, reply, reply_size);
+	} else if (os_strncmp(buf, "GET_ACS_LOG ", 12) == 0) {
+		reply_len = acs_log_dump(hapd->iface, buf + 12, reply,
+					 reply_size);
+	} else if (os_strcmp(buf, "STA_LATENCY") == 0) {
+		reply_len = sta_lat_dump(hapd, NULL, reply, reply_size);
+	} else if (os_strncmp(buf, "STA_LATENCY ", 12) == 0) {
+		reply_len = sta_lat_dump(hapd, buf + 12, reply, reply_size);
 	} else if (os_strncmp(buf, "RESTRICTED_CHANNELS", 19) == 0) {
 		if (hostapd_ctrl_iface_set_restricted_chan(hapd->iface, buf + 19))
 			reply_len = -1;
@@ -8596,6 +8667,38 @@ static int hostapd_ctrl_iface_receive_process(struct hostapd_data *hapd,
 
 
 
+/*
+ * Process a command with a reply buffer of up to WPA_CTRL_PAGED_MAX_LEN octets
+ * and return the first page of the result; the rest is fetched by the client
+ * with PAGE commands.
+ */
+static int hostapd_ctrl_iface_paged(struct hostapd_data *hapd, int sock,
+				    char *cmd, char *reply, int reply_size,
+				    struct sockaddr_storage *from,
+				    socklen_t fromlen)
+{
+	char *buf;
+	int len;
+
+	buf = os_malloc(WPA_CTRL_PAGED_MAX_LEN);
+	if (!buf)
+		return -1;
+
+	len = hostapd_ctrl_iface_receive_process(hapd, cmd, buf,
+						 WPA_CTRL_PAGED_MAX_LEN,
+						 from, fromlen);
+	if (hapd->ctrl_sock != sock) {
+		/* Control interface was closed by the command */
+		os_free(buf);
+		return -1;
+	}
+
+	return ctrl_iface_paged_store(&hapd->ctrl_paged, &hapd->ctrl_paged_id,
+				      from, fromlen, buf, len, reply,
+				      reply_size);
+}
+
+
 static void hostapd_ctrl_iface_receive(int sock, void *eloop_ctx,
 				       void *sock_ctx)
 {
@@ -8664,9 +8767,23 @@ static void hostapd_ctrl_iface_receive(int sock, void *eloop_ctx,
 		level = MSG_EXCESSIVE;
 	wpa_hexdump_ascii(level, "RX ctrl_iface", pos, res);
 
-	reply_len = hostapd_ctrl_iface_receive_process(hapd, pos,
-						       reply, reply_size,
-						       &from, fromlen);
+	if (os_strncmp(pos, WPA_CTRL_PAGE, 5) == 0)
+		reply_len = ctrl_iface_paged_next(&hapd->ctrl_paged, &from,
+						  fromlen, pos + 5, reply,
+						  reply_size);
+	else if (os_strncmp(pos, WPA_CTRL_PAGED, 6) == 0)
+		reply_len = hostapd_ctrl_iface_paged(hapd, sock, pos + 6,
+						     reply, reply_size,
+						     &from, fromlen);
+	else
+		reply_len = hostapd_ctrl_iface_receive_process(hapd, pos,
+							       reply,
+							       reply_size,
+							       &from, fromlen);
+	if (reply_len < 0) {
+		os_memcpy(reply, "FAIL\n", 5);
+		reply_len = 5;
+	}
 
 #ifdef CONFIG_CTRL_IFACE_UDP
 done:
@@ -8703,17 +8820,61 @@ static char * hostapd_ctrl_iface_path(struct hostapd_data *hapd)
 #endif /* CONFIG_CTRL_IFACE_UDP */
 
 
+static struct dl_list * hostapd_ctrl_iface_event_dst(struct hostapd_data *hapd,
+						     enum wpa_msg_type type)
+{
+	if (type != WPA_MSG_ONLY_GLOBAL)
+		return hapd->ctrl_sock < 0 ? NULL : &hapd->ctrl_dst;
+	if (hapd->iface->interfaces->global_ctrl_sock < 0)
+		return NULL;
+	return &hapd->iface->interfaces->global_ctrl_dst;
+}
+
+
+static int hostapd_ctrl_iface_msg_filter(void *ctx, int level, const char *fmt)
+{
+	struct hostapd_data *hapd = ctx;
+	u32 event;
+
+	if (hapd == NULL)
+		return 0;
+
+	/* A format string that does not start with a known event name may
+	 * still expand to one, so it cannot be classified before formatting.
+	 */
+	event = ctrl_iface_event_class(fmt);
+	if (event == WPA_EVENT_OTHER && os_strchr(fmt, '%'))
+		return 1;
+
+	/* all events are sent to the first VAP */
+	hapd = hapd->iface->bss[0];
+	if (hapd->ctrl_sock < 0)
+		return 0;
+	return !!(ctrl_iface_events_wanted(&hapd->ctrl_dst, level) & event);
+}
+
+
 static void hostapd_ctrl_iface_msg_cb(void *ctx, int level,
 				      enum wpa_msg_type type,
 				      const char *txt, size_t len)
 {
 	struct hostapd_data *hapd = ctx;
+	struct dl_list *ctrl_dst;
 	char *buf, *pos;
 	size_t total, ifacelen;
+	u32 event;
 
 	if (hapd == NULL)
 		return;
 
+	/* send all events to the first VAP */
+	ctrl_dst = hostapd_ctrl_iface_event_dst(hapd->iface->bss[0], type);
+	if (!ctrl_dst)
+		return;
+	event = ctrl_iface_event_class(txt);
+	if (!(ctrl_iface_events_wanted(ctrl_dst, level) & event))
+		return;
+
 	pos = os_strchr(txt, ' ');
 	if (pos == NULL)
 		total = len;
@@ -8738,10 +8899,10 @@ static void hostapd_ctrl_iface_msg_cb(void *ctx, int level,
 		os_memcpy(buf + total, pos, len - (pos - txt));
 	}
 
-	/* send all events to the first VAP */
 	hapd = hapd->iface->bss[0];
 
-	hostapd_ctrl_iface_send(hapd, level, type, buf, len + ifacelen + 1);
+	hostapd_ctrl_iface_send(hapd, level, type, event, buf,
+				len + ifacelen + 1);
 
 	os_free(buf);
 }
@@ -8776,6 +8937,7 @@ int hostapd_ctrl_iface_init(struct hostapd_data *hapd)
 	}
 
 	dl_list_init(&hapd->ctrl_dst);
+	dl_list_init(&hapd->ctrl_paged);
 	hapd->ctrl_sock = -1;
 	os_get_random(cookie, COOKIE_LEN);
 
@@ -8834,6 +8996,7 @@ try_again:
 
 	hapd->msg_ctx = hapd;
 	wpa_msg_register_cb(hostapd_ctrl_iface_msg_cb);
+	wpa_msg_register_filter_cb(hostapd_ctrl_iface_msg_filter);
 
 	return 0;
 
@@ -8852,6 +9015,7 @@ fail:
 	}
 
 	dl_list_init(&hapd->ctrl_dst);
+	dl_list_init(&hapd->ctrl_paged);
 
 	if (hapd->conf->ctrl_interface == NULL)
 		return 0;
@@ -8981,6 +9145,7 @@ fail:
 	}
 	hapd->msg_ctx = hapd;
 	wpa_msg_register_cb(hostapd_ctrl_iface_msg_cb);
+	wpa_msg_register_filter_cb(hostapd_ctrl_iface_msg_filter);
 
 	return 0;
 
@@ -9035,6 +9200,7 @@ void hostapd_ctrl_iface_deinit(struct hostapd_data *hapd)
 	dl_list_for_each_safe(dst, prev, &hapd->ctrl_dst, struct wpa_ctrl_dst,
 			      list)
 		os_free(dst);
+	ctrl_iface_paged_flush(&hapd->ctrl_paged);
 
 #ifdef CONFIG_TESTING_OPTIONS
 	l2_packet_deinit(hapd->l2_test);
@@ -9770,26 +9936,89 @@ void hostapd_global_ctrl_iface_deinit(struct hapd_interfaces *interfaces)
 }
 
 
-static int hostapd_ctrl_check_event_enabled(struct wpa_ctrl_dst *dst,
-					    const char *buf)
+/* Maximum number of monitors served with a single sendmmsg() call */
+#define CTRL_IFACE_SEND_BATCH 16
+
+static int hostapd_ctrl_iface_sendmmsg(int s, struct msghdr *msg,
+				       struct wpa_ctrl_dst **dsts,
+				       unsigned int num)
 {
-	/* Enable Probe Request events based on explicit request.
-	 * Other events are enabled by default.
-	 */
-	if (str_starts(buf, RX_PROBE_REQUEST))
-		return !!(dst->events & WPA_EVENT_RX_PROBE_REQUEST);
-	return 1;
+#ifdef __linux__
+	struct mmsghdr mmsg[CTRL_IFACE_SEND_BATCH];
+	unsigned int i;
+
+	for (i = 0; i < num; i++) {
+		mmsg[i].msg_hdr = *msg;
+		mmsg[i].msg_hdr.msg_name = &dsts[i]->addr;
+		mmsg[i].msg_hdr.msg_namelen = dsts[i]->addrlen;
+		mmsg[i].msg_len = 0;
+	}
+
+	return sendmmsg(s, mmsg, num, 0);
+#else /* __linux__ */
+	unsigned int i;
+
+	for (i = 0; i < num; i++) {
+		msg->msg_name = &dsts[i]->addr;
+		msg->msg_namelen = dsts[i]->addrlen;
+		if (sendmsg(s, msg, 0) < 0)
+			return i ? (int) i : -1;
+	}
+
+	return num;
+#endif /* __linux__ */
+}
+
+
+static void hostapd_ctrl_iface_send_batch(struct hostapd_data *hapd,
+					  enum wpa_msg_type type, int s,
+					  struct msghdr *msg,
+					  struct wpa_ctrl_dst **dsts,
+					  unsigned int num)
+{
+	struct wpa_ctrl_dst *dst;
+	unsigned int pos = 0;
+	int res, _errno;
+
+	while (pos < num) {
+		res = hostapd_ctrl_iface_sendmmsg(s, msg, &dsts[pos],
+						  num - pos);
+		if (res > 0) {
+			while (res-- > 0)
+				dsts[pos++]->errors = 0;
+			continue;
+		}
+
+		/* The first remaining monitor failed; skip it and retry the
+		 * rest of the batch.
+		 */
+		_errno = errno;
+		dst = dsts[pos++];
+		wpa_printf(MSG_INFO, "CTRL_IFACE monitor: %d - %s",
+			   _errno, strerror(_errno));
+		dst->errors++;
+		if (dst->errors > 10 || _errno == ENOENT) {
+			if (type != WPA_MSG_ONLY_GLOBAL)
+				hostapd_ctrl_iface_detach(hapd, &dst->addr,
+							  dst->addrlen);
+			else
+				hostapd_global_ctrl_iface_detach(
+					hapd->iface->interfaces, &dst->addr,
+					dst->addrlen);
+		}
+	}
 }
 
 
 static void hostapd_ctrl_iface_send(struct hostapd_data *hapd, int level,
-				    enum wpa_msg_type type,
+				    enum wpa_msg_type type, u32 event,
 				    const char *buf, size_t len)
 {
 	struct wpa_ctrl_dst *dst, *next;
+	struct wpa_ctrl_dst *batch[CTRL_IFACE_SEND_BATCH];
+	unsigned int num = 0;
 	struct dl_list *ctrl_dst;
 	struct msghdr msg;
-	int idx;
 	struct iovec io[2];
 	char levelstr[10];
 	int s;
@@ -9814,36 +10043,24 @@ static void hostapd_ctrl_iface_send(struct hostapd_data *hapd, int level,
 	msg.msg_iov = io;
 	msg.msg_iovlen = 2;
 
-	idx = 0;
+	/* Monitors already in the batch may be detached on send errors, which
+	 * is safe since the list iteration has moved past them.
+	 */
 	dl_list_for_each_safe(dst, next, ctrl_dst, struct wpa_ctrl_dst, list) {
-		if ((level >= dst->debug_level) &&
-		     hostapd_ctrl_check_event_enabled(dst, buf)) {
-			sockaddr_print(MSG_DEBUG, "CTRL_IFACE monitor send",
-				       &dst->addr, dst->addrlen);
-			msg.msg_name = &dst->addr;
-			msg.msg_namelen = dst->addrlen;
-			if (sendmsg(s, &msg, 0) < 0) {
-				int _errno = errno;
-				wpa_printf(MSG_INFO, "CTRL_IFACE monitor[%d]: "
-					   "%d - %s",
-					   idx, errno, strerror(errno));
-				dst->errors++;
-				if (dst->errors > 10 || _errno == ENOENT) {
-					if (type != WPA_MSG_ONLY_GLOBAL)
-						hostapd_ctrl_iface_detach(
-							hapd, &dst->addr,
-							dst->addrlen);
-					else
-						hostapd_global_ctrl_iface_detach(
-							hapd->iface->interfaces,
-							&dst->addr,
-							dst->addrlen);
-				}
-			} else
-				dst->errors = 0;
+		if (level < dst->debug_level || !(dst->events & event))
+			continue;
+		sockaddr_print(MSG_DEBUG, "CTRL_IFACE monitor send",
+			       &dst->addr, dst->addrlen);
+		batch[num++] = dst;
+		if (num == CTRL_IFACE_SEND_BATCH) {
+			hostapd_ctrl_iface_send_batch(hapd, type, s, &msg,
+						      batch, num);
+			num = 0;
 		}
-		idx++;
 	}
+
+	if (num)
+		hostapd_ctrl_iface_send_batch(hapd, type, s, &msg, batch, num);
 }
 
 #endif /* CONFIG_NATIVE_WINDOWS */
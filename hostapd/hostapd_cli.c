@@ -215,6 +215,32 @@ static int _wpa_ctrl_command(struct wpa_ctrl *ctrl, const char *cmd, int print)
 }
 
 
+/* For commands whose reply may not fit into a single message */
+static int wpa_ctrl_command_paged(struct wpa_ctrl *ctrl, const char *cmd)
+{
+	char *buf;
+	size_t len;
+	int ret;
+
+	if (ctrl_conn == NULL) {
+		printf("Not connected to hostapd - command dropped.\n");
+		return -1;
+	}
+	ret = wpa_ctrl_request_paged(ctrl, cmd, &buf, &len,
+				     hostapd_cli_msg_cb);
+	if (ret == -2) {
+		printf("'%s' command timed out.\n", cmd);
+		return -2;
+	} else if (ret < 0) {
+		printf("'%s' command failed.\n", cmd);
+		return -1;
+	}
+	printf("%s", buf);
+	os_free(buf);
+	return 0;
+}
+
+
 static inline int wpa_ctrl_command(struct wpa_ctrl *ctrl, const char *cmd)
 {
 	return _wpa_ctrl_command(ctrl, cmd, 1);
@@ -775,34 +801,65 @@ static int wpa_ctrl_command_sta(struct wpa_ctrl *ctrl, const char *cmd,
 static int hostapd_cli_cmd_all_sta(struct wpa_ctrl *ctrl, int argc,
 				   char *argv[])
 {
-	char addr[32], cmd[64];
-        int res, total;
-        char *tmp;
-
-        if (argc != 1) {
-                printf("Invalid ALL_STA command\n usage: <BSS_name>\n");
-                return -1;
-        }
-
-        res = os_snprintf(cmd, sizeof(cmd), "STA-FIRST");
-        if (res < 0 || (size_t) res >= sizeof(cmd) - 1) {
-                printf("Too long ALL_STA command.\n");
-                return -1;
-        }
-
-        total = res;
-        tmp = cmd + total;
-        res = os_snprintf(tmp, sizeof(cmd) - total, " %s", argv[0]);
-        if (res < 0 || (size_t) res >= sizeof(cmd) - total - 1) {
-                printf("Too long ALL_STA command.\n");
-                return -1;
-        }
-
-        if (wpa_ctrl_command_sta(ctrl, cmd, addr, sizeof(addr), 1))
+	char addr[32], cmd[64], *buf, *pos;
+	size_t len;
+	int res;
+
+	if (argc != 1) {
+		printf("Invalid ALL_STA command\n usage: <BSS_name>\n");
+		return -1;
+	}
+
+	if (ctrl_conn == NULL) {
+		printf("Not connected to hostapd - command dropped.\n");
+		return -1;
+	}
+
+	/* Dump in as few requests as possible, resuming from the cursor */
+	res = os_snprintf(cmd, sizeof(cmd), "STA-ALL %s", argv[0]);
+	for (;;) {
+		if (os_snprintf_error(sizeof(cmd), res)) {
+			printf("Too long ALL_STA command.\n");
+			return -1;
+		}
+		if (wpa_ctrl_request_paged(ctrl, cmd, &buf, &len,
+					   hostapd_cli_msg_cb) < 0) {
+			printf("'%s' command failed.\n", cmd);
+			return -1;
+		}
+		if (os_strncmp(buf, "UNKNOWN COMMAND", 15) == 0) {
+			os_free(buf);
+			break;
+		}
+		if (os_strncmp(buf, "FAIL", 4) == 0) {
+			os_free(buf);
+			return -1;
+		}
+		pos = os_strstr(buf, "CURSOR=");
+		if (!pos || (pos != buf && pos[-1] != '\n')) {
+			printf("%s", buf);
+			os_free(buf);
+			return 0;
+		}
+		*pos = '\0';
+		printf("%s", buf);
+		res = os_snprintf(cmd, sizeof(cmd), "STA-ALL %s %.17s",
+				  argv[0], pos + 7);
+		os_free(buf);
+	}
+
+	/* Older hostapd without STA-ALL */
+	res = os_snprintf(cmd, sizeof(cmd), "STA-FIRST %s", argv[0]);
+	if (os_snprintf_error(sizeof(cmd), res)) {
+		printf("Too long ALL_STA command.\n");
+		return -1;
+	}
+
+	if (wpa_ctrl_command_sta(ctrl, cmd, addr, sizeof(addr), 1))
 		return 0;
 
 	do {
-                snprintf(cmd, sizeof(cmd), "STA-NEXT %s %s", argv[0], addr);
+		os_snprintf(cmd, sizeof(cmd), "STA-NEXT %s %s", argv[0], addr);
 	} while (wpa_ctrl_command_sta(ctrl, cmd, addr, sizeof(addr), 1) == 0);
 
 	return -1;
@@ -1557,6 +1614,20 @@ static int hostapd_cli_cmd_req_self_beacon(struct wpa_ctrl *ctrl, int argc,
 	return hostapd_cli_cmd(ctrl, "REQ_SELF_BEACON", 3, argc, argv);
 }
 
+static int hostapd_cli_cmd_gtk_rekey_status(struct wpa_ctrl *ctrl, int argc,
+					    char *argv[])
+{
+	return hostapd_cli_cmd(ctrl, "GTK_REKEY_STATUS", 1, argc, argv);
+}
+
+
+static int hostapd_cli_cmd_ft_push_status(struct wpa_ctrl *ctrl, int argc,
+					  char *argv[])
+{
+	return hostapd_cli_cmd(ctrl, "FT_PUSH_STATUS", 1, argc, argv);
+}
+
+
 static int hostapd_cli_cmd_set_zwdfs_antenna(struct wpa_ctrl *ctrl, int argc,
 					     char *argv[])
 {
@@ -2178,6 +2249,24 @@ static int hostapd_cli_cmd_acs_report(struct wpa_ctrl *ctrl,
 }
 
 
+static int hostapd_cli_cmd_acs_log(struct wpa_ctrl *ctrl,
+               int argc, char *argv[])
+{
+  char cmd[256];
+
+  if (write_cmd(cmd, sizeof(cmd), "GET_ACS_LOG", argc, argv) < 0)
+    return -1;
+  return wpa_ctrl_command_paged(ctrl, cmd);
+}
+
+
+static int hostapd_cli_cmd_sta_latency(struct wpa_ctrl *ctrl,
+               int argc, char *argv[])
+{
+  return hostapd_cli_cmd(ctrl, "STA_LATENCY", 0, argc, argv);
+}
+
+
 static int hostapd_cli_cmd_set_restricted_chan(struct wpa_ctrl *ctrl,
                int argc, char *argv[])
 {
@@ -2744,6 +2833,10 @@ static const struct hostapd_cli_cmd hostapd_cli_commands[] = {
           "get failsafe channel" },
         { "acs_report", hostapd_cli_cmd_acs_report, NULL,
           "get ACS report" },
+        { "acs_log", hostapd_cli_cmd_acs_log, NULL,
+          "[numbss|info|history] = show in-memory ACS log records" },
+        { "sta_latency", hostapd_cli_cmd_sta_latency, NULL,
+          "[HIST|RESET] = show station onboarding latency statistics" },
         { "set_restricted_chan", hostapd_cli_cmd_set_restricted_chan, NULL,
           "[list_of_channels]"
           " set restricted channels, list_of_channels example 1 6 11-13" },
@@ -2809,6 +2902,10 @@ static const struct hostapd_cli_cmd hostapd_cli_commands[] = {
 	  "<BSS name> <1/0> = set BSS Load IE in beacon and probe resp" },
 	{ "set_zwdfs_antenna", hostapd_cli_cmd_set_zwdfs_antenna, NULL,
 	  " = Enable/Disable ZWDFS antenna"},
+	{ "gtk_rekey_status", hostapd_cli_cmd_gtk_rekey_status, NULL,
+	  "<BSS name> = show GTK rekey rollout progress and latency" },
+	{ "ft_push_status", hostapd_cli_cmd_ft_push_status, NULL,
+	  "<BSS name> = show PMK-R1 push batching and FT cache hit counters" },
 	{ NULL, NULL, NULL, NULL }
 };
 
@@ -24,6 +24,7 @@
 #include "beacon.h"
 #include <assert.h>
 #include "acs.h"
+#include "acs_log.h"
 #include "rrm.h"
 #include "ieee802_11.h"
 
@@ -254,64 +255,6 @@ void acs_push_chandef(struct hostapd_iface *iface, acs_chandef *chan);
 void acs_pop_chandef(struct hostapd_iface *iface, acs_chandef *chan);
 
 
-/* Open file for writing/appending. If opened for appending and it is bigger
- * than 10K, file is saved with filename .0 at the end and a new empty file is
- * created. */
-static FILE * acs_write_file(const char *name, Boolean append)
-{
-#define ACS_MAX_LOG_SIZE	10240 /* 10K */
-
-	FILE *fp;
-	long int sz;
-	int res;
-	char *bak_file;
-	size_t new_size;
-
-	if (!append)
-		return fopen(name, "w");
-	fp = fopen(name, "a+");
-	if (!fp) {
-		wpa_printf(MSG_ERROR, "ACS: cannot open file [%s]. %s", name,
-			strerror(errno));
-		return fp;
-	}
-	res = fseek(fp, 0L, SEEK_END);
-	if (res == -1) {
-		wpa_printf(MSG_ERROR, "ACS: cannot set file position indicator of file [%s]. %s",
-			name, strerror(errno));
-		fclose(fp);
-		return NULL;
-	}
-	sz = ftell(fp);
-	if (sz == -1) {
-		wpa_printf(MSG_ERROR, "ACS: cannot tell size of file [%s]. %s", name,
-			strerror(errno));
-		fclose(fp);
-		return NULL;
-	}
-	if (sz > ACS_MAX_LOG_SIZE) {
-		fclose(fp);
-		new_size = strlen(name) + 3;
-		bak_file = os_malloc(new_size);
-		if (bak_file == NULL)
-			return NULL;
-		os_snprintf(bak_file, new_size, "%s.0", name);
-		remove(bak_file);
-		res = rename(name, bak_file);
-		os_free(bak_file);
-		if (res == -1)
-			wpa_printf(MSG_WARNING, "ACS: making backup of file [%s] failed. %s", name,
-				strerror(errno));
-		fp = fopen(name, "w");
-		if (!fp) {
-			wpa_printf(MSG_ERROR, "ACS: cannot open file [%s]. %s", name,
-				strerror(errno));
-		}
-	}
-	return fp;
-}
-
-
 static void acs_clean_chan_surveys(struct hostapd_channel_data *chan)
 {
 	struct freq_survey *survey, *tmp;
@@ -1720,29 +1663,39 @@ static void acs_find_min_badness(struct hostapd_iface *iface, FILE *fp)
 	acs_numbss_adjust_vht_center_freq(iface, prim_chan_idx);
 }
 
-static FILE* acs_fopen(const char *fname, Boolean append, const char *name)
+static FILE* acs_fopen(struct hostapd_iface *iface, enum acs_log_sink sink,
+		       Boolean append, const char *name)
 {
-	FILE *fp = acs_write_file(fname, append);
+	FILE *fp = acs_log_open(iface, sink, append);
 
 	if (!fp) {
-		wpa_printf(MSG_ERROR, "Error opening the %s '%s': %s",
-			   name, fname, strerror(errno));
+		wpa_printf(MSG_ERROR, "Error opening the %s log", name);
 		return stderr;
 	}
 	else
 		return fp;
 }
 
-static void acs_fclose(FILE *fp, const char *name)
+static void acs_fclose(struct hostapd_iface *iface, FILE *fp)
 {
-	if (fp != stderr) {
-		if (fclose(fp))	wpa_printf(MSG_ERROR, "Error closing the %s: %s", name, strerror(errno));
-	}
+	if (fp != stderr)
+		acs_log_close(iface, fp);
+}
+
+static void acs_report_failure(struct hostapd_iface *iface, const char *proc,
+			       const char *info_file)
+{
+	if (iface->conf->acs_log_to_file)
+		wpa_printf(MSG_ERROR, "%s procedure failed. If reporting, please include your config file and info file '%s'.",
+			   proc, info_file);
+	else
+		wpa_printf(MSG_ERROR, "%s procedure failed. If reporting, please include your config file and the GET_ACS_LOG output.",
+			   proc);
 }
 
 static void acs_count_bsses(struct hostapd_iface *iface, struct wpa_scan_results *scan_res)
 {
-	FILE *fp = acs_fopen(iface->conf->acs_numbss_info_file, FALSE, "ACS NUMBSS info file");
+	FILE *fp = acs_fopen(iface, ACS_LOG_NUMBSS, FALSE, "ACS NUMBSS info file");
 
 	acs_record_bsses(iface, scan_res, fp);
 
@@ -1750,7 +1703,7 @@ static void acs_count_bsses(struct hostapd_iface *iface, struct wpa_scan_results
 
 	acs_find_min_badness(iface, fp);
 
-	acs_fclose(fp, "ACS NUMBSS info file");
+	acs_fclose(iface, fp);
 
 	/* hostapd_setup_interface_complete() will return -1 on failure and 0 on success */
 	if (hostapd_acs_completed(iface, 0) == 0) {
@@ -1759,7 +1712,7 @@ static void acs_count_bsses(struct hostapd_iface *iface, struct wpa_scan_results
 	}
 
 	/* If we're here then somehow ACS chose an invalid channel */
-	wpa_printf(MSG_ERROR, "ACS: NUMBSS procedure failed. If reporting, please include your config file and info file '%s'.", iface->conf->acs_numbss_info_file);
+	acs_report_failure(iface, "ACS: NUMBSS", iface->conf->acs_numbss_info_file);
 	acs_fail(iface);
 }
 
@@ -1982,11 +1935,11 @@ void acs_smart_record_bsses(struct hostapd_iface *iface, struct wpa_scan_results
 
 static void acs_smart_process_bsses(struct hostapd_iface *iface, struct wpa_scan_results *scan_res)
 {
-  FILE *fp = acs_fopen(iface->conf->acs_history_file, iface->conf->acs_init_done ? TRUE : FALSE, "ACS history file");
+  FILE *fp = acs_fopen(iface, ACS_LOG_HISTORY, iface->conf->acs_init_done ? TRUE : FALSE, "ACS history file");
 
   acs_smart_record_bsses(iface, scan_res, fp);
 
-  acs_fclose(fp, "ACS history file");
+  acs_fclose(iface, fp);
 
   acs_update_radar(iface);
   acs_recalc_ranks_and_set_chan(iface, SWR_INITIAL);
@@ -1999,7 +1952,7 @@ static void acs_smart_process_bsses(struct hostapd_iface *iface, struct wpa_scan
   }
 
   /* If we're here then somehow ACS chose an invalid channel */
-  wpa_printf(MSG_ERROR, "SmartACS: BSS procedure failed. If reporting, please include your config file and info file '%s'.", iface->conf->acs_smart_info_file);
+  acs_report_failure(iface, "SmartACS: BSS", iface->conf->acs_smart_info_file);
   acs_fail(iface);
 }
 
@@ -2028,12 +1981,12 @@ static void acs_bg_scan_complete(struct hostapd_iface *iface)
   acs_push_chandef(iface, &cur_chan);
 
   wpa_printf(MSG_INFO, "BSS data from BG scan received");
-  fp = acs_fopen(iface->conf->acs_history_file, TRUE, "ACS history file");
+  fp = acs_fopen(iface, ACS_LOG_HISTORY, TRUE, "ACS history file");
 
   acs_smart_record_bsses(iface, scan_res, fp);
   wpa_scan_results_free(scan_res);
 
-  acs_fclose(fp, "ACS history file");
+  acs_fclose(iface, fp);
 
   if (acs_recalc_ranks_and_set_chan(iface, SWR_BG_SCAN)) {
     if (acs_do_switch_channel(iface, 0) < 0) {
@@ -2596,10 +2549,8 @@ enum hostapd_chan_status acs_init(struct hostapd_iface *iface)
 
 	acs_cleanup(iface);
 
-#ifndef UNIT_TEST
   if (!iface->conf->acs_init_done)
     acs_init_candidate_table(iface);
-#endif
 	if (acs_request_scan(iface) < 0)
 		return HOSTAPD_CHAN_INVALID;
 
@@ -2969,65 +2920,14 @@ int acs_recalc_ranks_and_set_chan (struct hostapd_iface *iface, int switch_reaso
   int i, prio;
   int res = FALSE;
 
-#if UNIT_TEST
-  FILE *ftest = NULL;
-
-  ftest = fopen(iface->conf->smart_acs_test_vector, "r");
-  if (!ftest) {
-    wpa_printf(MSG_ERROR, "ACS: cannot open test-vector file");
-    goto end;
-  }
-
-  memset(candidates, 0, sizeof(candidates));
-  iface->num_candidates = 0;
-
-  fgets(ftest, line); /* header line */
-
-  for (i = 0; !foef(ftest), i++) {
-    fgets(ftest, line);
-    if (25 != sscanf(line, "%2d %2d %2d %4d %2d %2d %4d %3d %2d  %2d   %1d  %2d  %2d   %2d    %2d    %2d     %2d  %4d %2d     %2d    %2d   %4d %3d  %2d  %2d\n",
-                            &j,
-                            &candidates[i].primary,
-                            &candidates[i].secondary,
-                            &candidates[i].freq,
-                            &candidates[i].width,
-                            &candidates[i].rank,
-
-                            &candidates[i].noise_floor,
-                            &candidates[i].busy_time,
-                            &candidates[i].num_bss,
-                            &candidates[i].num_bss_pri,
-                            &candidates[i].calibrated,
-                            &candidates[i].radar_affected,
-                            &candidates[i].radar_detected,
-                            &candidates[i].overlap40,
-                            &candidates[i].overlap80,
-                            &candidates[i].primary_on_overlap_4080,
-                            &candidates[i].intolerant40,
-                            &candidates[i].cwi_noise,
-                            &candidates[i].dynBW20,
-                            &candidates[i].dynBW40,
-                            &candidates[i].dynBW80,
-                            &candidates[i].rssi,
-                            &candidates[i].snr,
-                            &candidates[i].not_80211_rx_evt,
-                            &candidates[i].not_my_sta_low_rssi) {
-      printf("epic fail in unit test mode");
-      fclose(ftest);
-      goto end;
-    }
-    iface->num_candidates++;
-  }
-  fclose(ftest);
-#endif
 
-  fp = fopen(iface->conf->acs_smart_info_file, "w");
+  fp = acs_log_open(iface, ACS_LOG_SMART_INFO, FALSE);
   if (!fp) {
     wpa_printf(MSG_ERROR, "ACS: cannot open info file");
     goto end;
   }
 
-  fp_hist = acs_write_file(iface->conf->acs_history_file, TRUE);
+  fp_hist = acs_log_open(iface, ACS_LOG_HISTORY, TRUE);
   if (!fp_hist) {
     wpa_printf(MSG_ERROR, "ACS: cannot open history file");
     goto end;
@@ -3307,8 +3207,8 @@ int acs_recalc_ranks_and_set_chan (struct hostapd_iface *iface, int switch_reaso
   res = TRUE;
 
 end:
-  if (fp) fclose(fp);
-  if (fp_hist) fclose(fp_hist);
+  if (fp) acs_log_close(iface, fp);
+  if (fp_hist) acs_log_close(iface, fp_hist);
   return res;
 }
 
@@ -12,9 +12,13 @@
 
 #ifdef CONFIG_ACS
 
+struct wpa_scan_results;
+
 enum hostapd_chan_status acs_init(struct hostapd_iface *iface);
 void acs_cleanup(struct hostapd_iface *iface);
 int acs_recalc_ranks_and_set_chan(struct hostapd_iface *iface, int switch_reason);
+void acs_smart_record_bsses(struct hostapd_iface *iface,
+			    struct wpa_scan_results *scan_res, FILE *fp);
 void acs_update_intolerant_channels(struct hostapd_iface *iface, u8 chan);
 void acs_update_radar(struct hostapd_iface *iface);
 void acs_radar_switch(struct hostapd_iface *iface);
@@ -0,0 +1,486 @@
+/*
+ * ACS - in-memory log of channel decisions
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+/*
+ * ACS writes its candidate tables and decisions to memory streams while the
+ * channel is being selected. When a stream is closed, the text is stored as
+ * a record in a fixed size ring (oldest records are overwritten) that can be
+ * read with the GET_ACS_LOG control interface command. Writing the records
+ * to the configured info/history files is off by default (acs_log_to_file),
+ * since the writes still run in the event loop. When enabled, they are
+ * deferred to an eloop timeout so that at least the channel decision itself
+ * does not wait for the file system.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "utils/list.h"
+#include "hostapd.h"
+#include "ap_config.h"
+#include "acs_log.h"
+
+#define ACS_MAX_LOG_SIZE	10240 /* 10K */
+
+struct acs_log_rec_hdr {
+	struct os_time time;
+	u32 len;
+	u8 sink;
+	u8 append;
+};
+
+struct acs_log_stream {
+	FILE *fp;
+	char *buf; /* allocated by open_memstream() */
+	size_t len;
+	int append;
+};
+
+struct acs_log_pending {
+	struct dl_list list;
+	enum acs_log_sink sink;
+	int append;
+	char *buf; /* allocated by open_memstream() */
+	size_t len;
+};
+
+struct acs_log {
+	u8 *ring;
+	size_t size;
+	size_t head; /* offset of the oldest record */
+	size_t used;
+	unsigned int num_recs;
+	unsigned int overwritten;
+	unsigned int file_errors;
+	struct acs_log_stream streams[ACS_LOG_NUM_SINKS];
+	struct dl_list pending; /* struct acs_log_pending */
+};
+
+static const char *acs_log_sink_names[ACS_LOG_NUM_SINKS] = {
+	"numbss", "info", "history"
+};
+
+
+static const char * acs_log_fname(struct hostapd_iface *iface,
+				  enum acs_log_sink sink)
+{
+	switch (sink) {
+	case ACS_LOG_NUMBSS:
+		return iface->conf->acs_numbss_info_file;
+	case ACS_LOG_SMART_INFO:
+		return iface->conf->acs_smart_info_file;
+	case ACS_LOG_HISTORY:
+		return iface->conf->acs_history_file;
+	default:
+		return NULL;
+	}
+}
+
+
+/* Open file for writing/appending. If opened for appending and it is bigger
+ * than 10K, file is saved with filename .0 at the end and a new empty file is
+ * created. */
+static FILE * acs_write_file(const char *name, int append)
+{
+	FILE *fp;
+	long int sz;
+	int res;
+	char *bak_file;
+	size_t new_size;
+
+	if (!append)
+		return fopen(name, "w");
+	fp = fopen(name, "a+");
+	if (!fp) {
+		wpa_printf(MSG_ERROR, "ACS: cannot open file [%s]. %s", name,
+			strerror(errno));
+		return fp;
+	}
+	res = fseek(fp, 0L, SEEK_END);
+	if (res == -1) {
+		wpa_printf(MSG_ERROR, "ACS: cannot set file position indicator of file [%s]. %s",
+			name, strerror(errno));
+		fclose(fp);
+		return NULL;
+	}
+	sz = ftell(fp);
+	if (sz == -1) {
+		wpa_printf(MSG_ERROR, "ACS: cannot tell size of file [%s]. %s", name,
+			strerror(errno));
+		fclose(fp);
+		return NULL;
+	}
+	if (sz > ACS_MAX_LOG_SIZE) {
+		fclose(fp);
+		new_size = strlen(name) + 3;
+		bak_file = os_malloc(new_size);
+		if (bak_file == NULL)
+			return NULL;
+		os_snprintf(bak_file, new_size, "%s.0", name);
+		remove(bak_file);
+		res = rename(name, bak_file);
+		os_free(bak_file);
+		if (res == -1)
+			wpa_printf(MSG_WARNING, "ACS: making backup of file [%s] failed. %s", name,
+				strerror(errno));
+		fp = fopen(name, "w");
+		if (!fp) {
+			wpa_printf(MSG_ERROR, "ACS: cannot open file [%s]. %s", name,
+				strerror(errno));
+		}
+	}
+	return fp;
+}
+
+
+static void acs_log_ring_write(struct acs_log *log, size_t pos,
+			       const void *data, size_t len)
+{
+	size_t first = log->size - pos;
+
+	if (first > len)
+		first = len;
+	os_memcpy(log->ring + pos, data, first);
+	os_memcpy(log->ring, (const u8 *) data + first, len - first);
+}
+
+
+static void acs_log_ring_read(struct acs_log *log, size_t pos, void *data,
+			      size_t len)
+{
+	size_t first = log->size - pos;
+
+	if (first > len)
+		first = len;
+	os_memcpy(data, log->ring + pos, first);
+	os_memcpy((u8 *) data + first, log->ring, len - first);
+}
+
+
+static void acs_log_ring_store(struct acs_log *log,
+			       struct acs_log_rec_hdr *hdr, const void *buf)
+{
+	struct acs_log_rec_hdr old;
+	size_t need;
+
+	if (log->size <= sizeof(*hdr))
+		return;
+	if (hdr->len > log->size - sizeof(*hdr))
+		hdr->len = log->size - sizeof(*hdr);
+	need = sizeof(*hdr) + hdr->len;
+
+	while (log->size - log->used < need) {
+		acs_log_ring_read(log, log->head, &old, sizeof(old));
+		log->head = (log->head + sizeof(old) + old.len) % log->size;
+		log->used -= sizeof(old) + old.len;
+		log->num_recs--;
+		log->overwritten++;
+	}
+
+	acs_log_ring_write(log, (log->head + log->used) % log->size, hdr,
+			   sizeof(*hdr));
+	acs_log_ring_write(log, (log->head + log->used + sizeof(*hdr)) %
+			   log->size, buf, hdr->len);
+	log->used += need;
+	log->num_recs++;
+}
+
+
+static void acs_log_ring_add(struct acs_log *log, enum acs_log_sink sink,
+			     int append, const char *buf, size_t len)
+{
+	struct acs_log_rec_hdr hdr;
+
+	os_get_time(&hdr.time);
+	hdr.len = len;
+	hdr.sink = sink;
+	hdr.append = append;
+	acs_log_ring_store(log, &hdr, buf);
+}
+
+
+/* Move the records to a ring of the new size; the oldest ones that do not
+ * fit are dropped */
+static void acs_log_ring_resize(struct acs_log *log, size_t size)
+{
+	struct acs_log old;
+	struct acs_log_rec_hdr hdr;
+	u8 *ring = NULL, *data;
+	unsigned int i;
+	size_t pos;
+
+	if (size) {
+		ring = os_malloc(size);
+		if (!ring)
+			return;
+	}
+
+	os_memset(&old, 0, sizeof(old));
+	old.ring = log->ring;
+	old.size = log->size;
+	old.head = log->head;
+	old.num_recs = log->num_recs;
+	log->ring = ring;
+	log->size = size;
+	log->head = 0;
+	log->used = 0;
+	log->num_recs = 0;
+
+	for (i = 0, pos = old.head; i < old.num_recs; i++) {
+		acs_log_ring_read(&old, pos, &hdr, sizeof(hdr));
+		data = os_malloc(hdr.len + 1);
+		if (data) {
+			acs_log_ring_read(&old, (pos + sizeof(hdr)) % old.size,
+					  data, hdr.len);
+			acs_log_ring_store(log, &hdr, data);
+			os_free(data);
+		} else {
+			log->overwritten++;
+		}
+		pos = (pos + sizeof(hdr) + hdr.len) % old.size;
+	}
+	os_free(old.ring);
+}
+
+
+static struct acs_log * acs_log_get(struct hostapd_iface *iface)
+{
+	struct acs_log *log = iface->acs_log;
+	size_t size = iface->conf->acs_log_ring_size > 0 ?
+		iface->conf->acs_log_ring_size : 0;
+
+	if (!log) {
+		log = os_zalloc(sizeof(*log));
+		if (!log)
+			return NULL;
+		dl_list_init(&log->pending);
+		iface->acs_log = log;
+	}
+	/* acs_log_ring_size may have been changed by a reload */
+	if (log->size != size)
+		acs_log_ring_resize(log, size);
+	return log;
+}
+
+
+static void acs_log_write_pending(struct hostapd_iface *iface,
+				  struct acs_log *log)
+{
+	struct acs_log_pending *p;
+	const char *fname;
+	FILE *fp;
+
+	while ((p = dl_list_first(&log->pending, struct acs_log_pending,
+				  list))) {
+		dl_list_del(&p->list);
+		fname = acs_log_fname(iface, p->sink);
+		fp = fname ? acs_write_file(fname, p->append) : NULL;
+		if (!fp) {
+			log->file_errors++;
+		} else {
+			if (fwrite(p->buf, 1, p->len, fp) != p->len)
+				log->file_errors++;
+			if (fclose(fp)) {
+				wpa_printf(MSG_ERROR, "ACS: error closing file [%s]. %s",
+					   fname, strerror(errno));
+				log->file_errors++;
+			}
+		}
+		free(p->buf);
+		os_free(p);
+	}
+}
+
+
+static void acs_log_flush_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct hostapd_iface *iface = eloop_ctx;
+
+	if (iface->acs_log)
+		acs_log_write_pending(iface, iface->acs_log);
+}
+
+
+/**
+ * acs_log_open - Start an ACS log record
+ * @iface: Pointer to interface data
+ * @sink: Log the record belongs to
+ * @append: Whether the record is appended to or replaces the file sink
+ * Returns: Memory stream for the record text or %NULL on failure
+ *
+ * The record is stored when the stream is closed with acs_log_close().
+ */
+FILE * acs_log_open(struct hostapd_iface *iface, enum acs_log_sink sink,
+		    int append)
+{
+	struct acs_log *log = acs_log_get(iface);
+	struct acs_log_stream *s;
+
+	if (!log || sink >= ACS_LOG_NUM_SINKS)
+		return NULL;
+
+	s = &log->streams[sink];
+	if (s->fp) {
+		wpa_printf(MSG_ERROR, "ACS: %s log is already open",
+			   acs_log_sink_names[sink]);
+		return NULL;
+	}
+
+	s->buf = NULL;
+	s->len = 0;
+	s->append = append;
+	s->fp = open_memstream(&s->buf, &s->len);
+	if (!s->fp)
+		wpa_printf(MSG_ERROR, "ACS: cannot open %s log stream. %s",
+			   acs_log_sink_names[sink], strerror(errno));
+	return s->fp;
+}
+
+
+/**
+ * acs_log_close - Finish an ACS log record
+ * @iface: Pointer to interface data
+ * @fp: Stream returned by acs_log_open()
+ */
+void acs_log_close(struct hostapd_iface *iface, FILE *fp)
+{
+	struct acs_log *log = iface->acs_log;
+	struct acs_log_stream *s = NULL;
+	struct acs_log_pending *p;
+	int sink;
+
+	for (sink = 0; log && sink < ACS_LOG_NUM_SINKS; sink++) {
+		if (log->streams[sink].fp == fp) {
+			s = &log->streams[sink];
+			break;
+		}
+	}
+	if (!s) {
+		fclose(fp);
+		return;
+	}
+
+	s->fp = NULL;
+	if (fclose(fp) || !s->buf) {
+		wpa_printf(MSG_ERROR, "ACS: error closing %s log stream",
+			   acs_log_sink_names[sink]);
+		free(s->buf);
+		s->buf = NULL;
+		return;
+	}
+
+	acs_log_ring_add(log, sink, s->append, s->buf, s->len);
+
+	p = iface->conf->acs_log_to_file ? os_zalloc(sizeof(*p)) : NULL;
+	if (!p) {
+		free(s->buf);
+		s->buf = NULL;
+		return;
+	}
+	p->sink = sink;
+	p->append = s->append;
+	p->buf = s->buf;
+	p->len = s->len;
+	s->buf = NULL;
+	dl_list_add_tail(&log->pending, &p->list);
+	if (!eloop_is_timeout_registered(acs_log_flush_timeout, iface, NULL))
+		eloop_register_timeout(0, 0, acs_log_flush_timeout, iface,
+				       NULL);
+}
+
+
+/**
+ * acs_log_dump - Print the ACS log ring for GET_ACS_LOG
+ * @iface: Pointer to interface data
+ * @cmd: Optional log name (numbss, info or history) to filter records
+ * @buf: Reply buffer
+ * @buflen: Size of the reply buffer
+ * Returns: Length of the reply or -1 on failure
+ *
+ * Records are printed from the oldest to the newest one until the reply
+ * buffer is full.
+ */
+int acs_log_dump(struct hostapd_iface *iface, const char *cmd, char *buf,
+		 size_t buflen)
+{
+	struct acs_log *log = iface->acs_log;
+	struct acs_log_rec_hdr hdr;
+	int filter = -1, ret, i;
+	size_t len = 0, pos, off;
+
+	if (log)
+		log = acs_log_get(iface); /* apply a reloaded ring size */
+	if (cmd && *cmd) {
+		for (i = 0; i < ACS_LOG_NUM_SINKS; i++) {
+			if (os_strcmp(cmd, acs_log_sink_names[i]) == 0)
+				filter = i;
+		}
+		if (filter < 0)
+			return -1;
+	}
+
+	ret = os_snprintf(buf, buflen,
+			  "records=%u size=%zu used=%zu overwritten=%u pending=%u file_errors=%u\n",
+			  log ? log->num_recs : 0, log ? log->size : 0,
+			  log ? log->used : 0, log ? log->overwritten : 0,
+			  log ? dl_list_len(&log->pending) : 0,
+			  log ? log->file_errors : 0);
+	if (os_snprintf_error(buflen, ret))
+		return -1;
+	len = ret;
+	if (!log)
+		return len;
+
+	for (pos = log->head, off = 0; off < log->used;
+	     off += sizeof(hdr) + hdr.len,
+		     pos = (pos + sizeof(hdr) + hdr.len) % log->size) {
+		acs_log_ring_read(log, pos, &hdr, sizeof(hdr));
+		if (filter >= 0 && hdr.sink != filter)
+			continue;
+
+		ret = os_snprintf(buf + len, buflen - len,
+				  "--- %ld.%06ld %s%s len=%u\n",
+				  (long) hdr.time.sec, (long) hdr.time.usec,
+				  acs_log_sink_names[hdr.sink],
+				  hdr.append ? "" : " (new)", hdr.len);
+		if (os_snprintf_error(buflen - len, ret) ||
+		    buflen - len - ret <= hdr.len)
+			break;
+		len += ret;
+		acs_log_ring_read(log, (pos + sizeof(hdr)) % log->size,
+				  buf + len, hdr.len);
+		len += hdr.len;
+	}
+	buf[len] = '\0';
+
+	return len;
+}
+
+
+/**
+ * acs_log_deinit - Write pending records and free the ACS log
+ * @iface: Pointer to interface data
+ */
+void acs_log_deinit(struct hostapd_iface *iface)
+{
+	struct acs_log *log = iface->acs_log;
+	int sink;
+
+	if (!log)
+		return;
+
+	for (sink = 0; sink < ACS_LOG_NUM_SINKS; sink++) {
+		if (log->streams[sink].fp)
+			acs_log_close(iface, log->streams[sink].fp);
+	}
+	eloop_cancel_timeout(acs_log_flush_timeout, iface, NULL);
+	acs_log_write_pending(iface, log);
+	os_free(log->ring);
+	os_free(log);
+	iface->acs_log = NULL;
+}
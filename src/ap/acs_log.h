@@ -0,0 +1,41 @@
+/*
+ * ACS - in-memory log of channel decisions
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef ACS_LOG_H
+#define ACS_LOG_H
+
+enum acs_log_sink {
+	ACS_LOG_NUMBSS,		/* acs_numbss_info_file */
+	ACS_LOG_SMART_INFO,	/* acs_smart_info_file */
+	ACS_LOG_HISTORY,	/* acs_history_file */
+	ACS_LOG_NUM_SINKS
+};
+
+#ifdef CONFIG_ACS
+
+FILE * acs_log_open(struct hostapd_iface *iface, enum acs_log_sink sink,
+		    int append);
+void acs_log_close(struct hostapd_iface *iface, FILE *fp);
+int acs_log_dump(struct hostapd_iface *iface, const char *cmd, char *buf,
+		 size_t buflen);
+void acs_log_deinit(struct hostapd_iface *iface);
+
+#else /* CONFIG_ACS */
+
+static inline int acs_log_dump(struct hostapd_iface *iface, const char *cmd,
+			       char *buf, size_t buflen)
+{
+	return -1;
+}
+
+static inline void acs_log_deinit(struct hostapd_iface *iface)
+{
+}
+
+#endif /* CONFIG_ACS */
+
+#endif /* ACS_LOG_H */
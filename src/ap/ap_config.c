@@ -69,6 +69,7 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss)
 	bss->wpa_gmk_rekey = 86400;
 	bss->wpa_group_update_count = 4;
 	bss->wpa_pairwise_update_count = 4;
+	bss->wpa_group_rekey_batch_interval = 100;
 	bss->wpa_disable_eapol_key_retries =
 		DEFAULT_WPA_DISABLE_EAPOL_KEY_RETRIES;
 	bss->wpa_key_mgmt = WPA_KEY_MGMT_PSK;
@@ -101,6 +102,7 @@ void hostapd_config_defaults_bss(struct hostapd_bss_config *bss)
 	bss->auth_fail_blacklist_duration = 24 * 60 * 60;
 	bss->eap_req_id_retry_interval = 0;
 	bss->pmksa_interval = 0;
+	bss->pmksa_cache_save_interval = 300;
 	bss->auth_quiet_period = 0;
 #ifdef EAP_SERVER_FAST
 	 /* both anonymous and authenticated provisioning */
@@ -257,6 +259,7 @@ struct hostapd_config * hostapd_config_defaults(void)
 	/* Set to invalid value means do not add Power Constraint IE */
 	conf->local_pwr_constraint = -1;
 	conf->ap_max_num_sta = MAX_STA_COUNT;
+	conf->atf_update_delay = 20;
 
 	conf->wmm_ac_params[0] = ac_be;
 	conf->wmm_ac_params[1] = ac_bk;
@@ -323,6 +326,8 @@ struct hostapd_config * hostapd_config_defaults(void)
 
     conf->acs_smart_info_file = strdup("/tmp/acs_smart_info.txt");
     conf->acs_history_file = strdup("/tmp/acs_history.txt");
+    conf->acs_log_ring_size = 32768;
+    conf->acs_log_to_file = 0;
     conf->acs_init_done = 0;
     conf->acs_use24overlapped = 0;
     conf->acs_bg_scan_do_switch = 0;
@@ -771,6 +776,216 @@ void hostapd_config_free_eap_users(struct hostapd_eap_user *user)
 }
 
 
+/*
+ * EAP user lookup index. The result must be the same as walking the user
+ * list in file order, so every entry carries its list position and the
+ * match with the lowest position wins. Exact entries are hashed, wildcard
+ * prefix entries are kept in a trie per phase, and the first "*" entry
+ * matches any Phase 1 identity.
+ */
+struct eap_user_hash_entry {
+	struct eap_user_hash_entry *hnext;
+	struct hostapd_eap_user *user;
+	unsigned int pos;
+};
+
+struct eap_user_trie_node {
+	struct eap_user_trie_node *child; /* first child */
+	struct eap_user_trie_node *sibling;
+	struct hostapd_eap_user *user; /* first prefix entry ending here */
+	unsigned int pos;
+	u8 c;
+};
+
+struct hostapd_eap_user_index {
+	struct eap_user_hash_entry **hash;
+	unsigned int hash_size; /* power of two */
+	struct eap_user_hash_entry *entries;
+	struct eap_user_trie_node prefix[2]; /* roots for Phase 1 and 2 */
+	struct hostapd_eap_user *any;
+	unsigned int any_pos;
+};
+
+
+static unsigned int eap_user_index_hash(const u8 *identity,
+					size_t identity_len, int phase2)
+{
+	unsigned int hash = phase2;
+	size_t i;
+
+	for (i = 0; i < identity_len; i++)
+		hash = hash * 31 + identity[i];
+	return hash;
+}
+
+
+static void eap_user_trie_free(struct eap_user_trie_node *node)
+{
+	struct eap_user_trie_node *child, *next;
+
+	for (child = node->child; child; child = next) {
+		next = child->sibling;
+		eap_user_trie_free(child);
+		os_free(child);
+	}
+}
+
+
+static struct eap_user_trie_node *
+eap_user_trie_child(struct eap_user_trie_node *node, u8 c, int add)
+{
+	struct eap_user_trie_node *child;
+
+	for (child = node->child; child; child = child->sibling) {
+		if (child->c == c)
+			return child;
+	}
+	if (!add)
+		return NULL;
+
+	child = os_zalloc(sizeof(*child));
+	if (!child)
+		return NULL;
+	child->c = c;
+	child->sibling = node->child;
+	node->child = child;
+	return child;
+}
+
+
+static const struct eap_user_hash_entry *
+eap_user_hash_find(const struct hostapd_eap_user_index *idx,
+		   const u8 *identity, size_t identity_len, int phase2)
+{
+	const struct eap_user_hash_entry *e;
+
+	e = idx->hash[eap_user_index_hash(identity, identity_len, phase2) &
+		      (idx->hash_size - 1)];
+	while (e &&
+	       (e->user->phase2 != phase2 ||
+		e->user->identity_len != identity_len ||
+		(identity_len &&
+		 os_memcmp(e->user->identity, identity, identity_len) != 0)))
+		e = e->hnext;
+	return e;
+}
+
+
+void hostapd_eap_user_index_free(struct hostapd_eap_user_index *idx)
+{
+	if (!idx)
+		return;
+	eap_user_trie_free(&idx->prefix[0]);
+	eap_user_trie_free(&idx->prefix[1]);
+	os_free(idx->hash);
+	os_free(idx->entries);
+	os_free(idx);
+}
+
+
+struct hostapd_eap_user_index *
+hostapd_eap_user_index_build(struct hostapd_eap_user *users)
+{
+	struct hostapd_eap_user_index *idx;
+	struct hostapd_eap_user *user;
+	struct eap_user_trie_node *node;
+	unsigned int num = 0, pos, h;
+	size_t i;
+
+	for (user = users; user; user = user->next)
+		num++;
+
+	idx = os_zalloc(sizeof(*idx));
+	if (!idx)
+		return NULL;
+	idx->hash_size = 16;
+	while (idx->hash_size < num)
+		idx->hash_size <<= 1;
+	idx->hash = os_calloc(idx->hash_size, sizeof(*idx->hash));
+	idx->entries = os_calloc(num ? num : 1, sizeof(*idx->entries));
+	if (!idx->hash || !idx->entries)
+		goto fail;
+
+	for (user = users, pos = 0; user; user = user->next, pos++) {
+		if (!user->identity && !idx->any) {
+			idx->any = user;
+			idx->any_pos = pos;
+		}
+
+		if (user->wildcard_prefix) {
+			node = &idx->prefix[!!user->phase2];
+			for (i = 0; node && i < user->identity_len; i++)
+				node = eap_user_trie_child(node,
+							   user->identity[i],
+							   1);
+			if (!node)
+				goto fail;
+			if (!node->user) {
+				node->user = user;
+				node->pos = pos;
+			}
+			continue;
+		}
+
+		/* Later duplicates can never be the first match */
+		if (eap_user_hash_find(idx, user->identity, user->identity_len,
+				       user->phase2))
+			continue;
+		h = eap_user_index_hash(user->identity, user->identity_len,
+					user->phase2) & (idx->hash_size - 1);
+		idx->entries[pos].user = user;
+		idx->entries[pos].pos = pos;
+		idx->entries[pos].hnext = idx->hash[h];
+		idx->hash[h] = &idx->entries[pos];
+	}
+
+	return idx;
+
+fail:
+	hostapd_eap_user_index_free(idx);
+	return NULL;
+}
+
+
+struct hostapd_eap_user *
+hostapd_eap_user_index_get(const struct hostapd_eap_user_index *idx,
+			   const u8 *identity, size_t identity_len, int phase2)
+{
+	const struct eap_user_hash_entry *e;
+	const struct eap_user_trie_node *node;
+	struct hostapd_eap_user *best = NULL;
+	unsigned int best_pos = (unsigned int) -1;
+	size_t i;
+
+	phase2 = !!phase2;
+
+	if (!phase2 && idx->any) {
+		best = idx->any;
+		best_pos = idx->any_pos;
+	}
+
+	e = eap_user_hash_find(idx, identity, identity_len, phase2);
+	if (e && e->pos < best_pos) {
+		best = e->user;
+		best_pos = e->pos;
+	}
+
+	node = &idx->prefix[phase2];
+	for (i = 0; node; i++) {
+		if (node->user && node->pos < best_pos) {
+			best = node->user;
+			best_pos = node->pos;
+		}
+		if (i == identity_len)
+			break;
+		node = eap_user_trie_child(
+			(struct eap_user_trie_node *) node, identity[i], 0);
+	}
+
+	return best;
+}
+
+
 static void hostapd_config_free_wep(struct hostapd_wep_keys *keys)
 {
 	int i;
@@ -852,6 +1067,7 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 #endif /* CONFIG_FULL_DYNAMIC_VLAN */
 
 	hostapd_config_free_eap_users(conf->eap_user);
+	hostapd_eap_user_index_free(conf->eap_user_index);
 	os_free(conf->eap_user_sqlite);
 
 	os_free(conf->eap_req_id_text);
@@ -868,6 +1084,9 @@ void hostapd_config_free_bss(struct hostapd_bss_config *conf)
 	hostapd_config_free_radius_attr(conf->radius_auth_req_attr);
 	hostapd_config_free_radius_attr(conf->radius_acct_req_attr);
 	os_free(conf->rsn_preauth_interfaces);
+	os_free(conf->pmksa_cache_file);
+	os_memset(conf->pmksa_cache_file_key, 0,
+		  sizeof(conf->pmksa_cache_file_key));
 	os_free(conf->ctrl_interface);
 	os_free(conf->ca_cert);
 	os_free(conf->server_cert);
@@ -1283,6 +1502,13 @@ static int hostapd_config_check_bss(struct hostapd_bss_config *bss,
 		}
 	}
 
+	if (full_config && bss->pmksa_cache_file &&
+	    !bss->pmksa_cache_file_key_len) {
+		wpa_printf(MSG_ERROR, "pmksa_cache_file requires "
+			   "pmksa_cache_file_key to be configured");
+		return -1;
+	}
+
 #ifdef CONFIG_IEEE80211R_AP
 	if (full_config && wpa_key_mgmt_ft(bss->wpa_key_mgmt) &&
 	    (bss->nas_identifier == NULL ||
@@ -282,6 +282,7 @@ struct hostapd_bss_config {
 
 	int max_num_sta; /* maximum number of STAs in station table */
 	int num_res_sta; /* number of reserved STAs in the BSS */
+	int sta_admit_priority; /* admission priority class, 0 = lowest */
 
 	u16 beacon_int;
 	int dtim_period;
@@ -295,6 +296,8 @@ struct hostapd_bss_config {
 	int eap_server; /* Use internal EAP server instead of external
 			 * RADIUS server */
 	struct hostapd_eap_user *eap_user;
+	struct hostapd_eap_user_index *eap_user_index; /* lookup index for
+							* eap_user */
 	char *eap_user_sqlite;
 	char *eap_sim_db;
 	unsigned int eap_sim_db_timeout;
@@ -393,6 +396,8 @@ struct hostapd_bss_config {
 	u32 wpa_group_update_count;
 	u32 wpa_pairwise_update_count;
 	int wpa_disable_eapol_key_retries;
+	int wpa_group_rekey_batch;
+	int wpa_group_rekey_batch_interval;
 	int rsn_pairwise;
 	int rsn_preauth;
 	char *rsn_preauth_interfaces;
@@ -410,6 +415,8 @@ struct hostapd_bss_config {
 	struct ft_remote_r0kh *r0kh_list;
 	struct ft_remote_r1kh *r1kh_list;
 	int pmk_r1_push;
+	int pmk_r1_push_batch_interval; /* ms, 0 = push immediately */
+	int pmk_r1_push_rate; /* push frames per second, 0 = unlimited */
 	int ft_over_ds;
 	int ft_psk_generate_local;
 	int r1_max_key_lifetime;
@@ -478,6 +485,10 @@ struct hostapd_bss_config {
 
 	int disable_pmksa_caching;
 	int okc; /* Opportunistic Key Caching */
+	char *pmksa_cache_file; /* PMKSA/FT cache snapshot across restarts */
+	u8 pmksa_cache_file_key[64];
+	size_t pmksa_cache_file_key_len;
+	int pmksa_cache_save_interval; /* seconds, 0 = only on shutdown */
 	/* Default time in seconds after which a Wi-Fi client is forced
 	 * to ReAuthenticate
 	 */
@@ -814,6 +825,8 @@ struct hostapd_config {
 	u8 channel;
 	u8 acs;
 	int ap_max_num_sta;  /*maximum number of stations per-radio */
+	int ap_sta_admit_headroom; /* radio STA slots kept for the highest
+				    * sta_admit_priority BSSs */
 	struct wpa_freq_range_list acs_ch_list;
 	int acs_exclude_dfs;
 	enum hostapd_hw_mode hw_mode; /* HOSTAPD_MODE_IEEE80211A, .. */
@@ -966,6 +979,8 @@ struct hostapd_config {
 	/* SmartACS */
 	char *acs_smart_info_file;
 	char *acs_history_file;
+	int acs_log_ring_size;
+	int acs_log_to_file;
 	struct acs_chan acs_fallback_chan;
 	int *acs_penalty_factors;
 	int acs_chan_cust_penalty[ACS_MAX_CHANNELS];
@@ -1022,6 +1037,7 @@ struct hostapd_config {
 	unsigned int ch_switch_vht_config;
 	char *atf_config_file;		/* Air Time Fairness configuration filename */
 	struct atf_config atf_cfg; /* Air Time Fairness configuration */
+	int atf_update_delay; /* ms to coalesce STA changes before sending quotas */
 
 	int testbed_mode;
 
@@ -1064,6 +1080,12 @@ struct hostapd_config * hostapd_config_defaults(void);
 void hostapd_config_defaults_bss(struct hostapd_bss_config *bss);
 void hostapd_config_free_eap_user(struct hostapd_eap_user *user);
 void hostapd_config_free_eap_users(struct hostapd_eap_user *user);
+struct hostapd_eap_user_index *
+hostapd_eap_user_index_build(struct hostapd_eap_user *users);
+void hostapd_eap_user_index_free(struct hostapd_eap_user_index *idx);
+struct hostapd_eap_user *
+hostapd_eap_user_index_get(const struct hostapd_eap_user_index *idx,
+			   const u8 *identity, size_t identity_len, int phase2);
 void hostapd_config_clear_wpa_psk(struct hostapd_wpa_psk **p);
 void hostapd_config_free_bss(struct hostapd_bss_config *conf);
 void hostapd_config_free(struct hostapd_config *conf);
@@ -422,6 +422,7 @@ int hostapd_sta_add(struct hostapd_data *hapd,
 		    const u8 *ext_capab)
 {
 	struct hostapd_sta_add_params params;
+	struct os_reltime start;
 	int ret_code;
 
 	if (hapd->driver == NULL)
@@ -454,7 +455,9 @@ int hostapd_sta_add(struct hostapd_data *hapd,
 		params.ext_capab_len = ext_capab[0];
 	}
 
+	os_get_reltime(&start);
 	ret_code = hapd->driver->sta_add(hapd->drv_priv, &params);
+	sta_lat_add_since(hapd, STA_LAT_H_DRV_STA_ADD, &start);
 	if (ret_code == 0)
 		hostapd_drv_send_atf_quotas(hapd, addr, 1, 0);
 
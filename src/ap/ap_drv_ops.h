@@ -175,8 +175,6 @@ static inline int hostapd_drv_send_atf_quotas(struct hostapd_data *hapd,
 		const u8* changed_sta, /* if NULL, ATF config changed */
 		int in_driver, int not_in_driver)
 {
-	int res = 0;
-
 	/* Do we have ATF function enabled? */
 	if (hapd->iconf->atf_config_file == NULL || hapd->iconf->atf_config_file[0] == '\0') {
 		hapd->iface->atf_enabled = 0;
@@ -184,20 +182,16 @@ static inline int hostapd_drv_send_atf_quotas(struct hostapd_data *hapd,
 	}
 
 	/* Re-read ATF configuration file */
-	if (changed_sta == NULL &&
-		hostapd_atf_read_config (&hapd->iconf->atf_cfg, hapd->iconf->atf_config_file))
-		return -EINVAL;
+	if (changed_sta == NULL) {
+		if (hostapd_atf_read_config (&hapd->iconf->atf_cfg, hapd->iconf->atf_config_file))
+			return -EINVAL;
+		return hostapd_atf_config_changed(hapd);
+	}
 
 	/* Do it even if ATF is OFF. It traces the "in driver" flags for stations. */
-	struct intel_vendor_atf_quotas* atf_quotas = hostapd_atf_calc_quotas(&hapd->iconf->atf_cfg,
-									hapd, changed_sta, in_driver, not_in_driver);
+	hostapd_atf_sta_changed(hapd, changed_sta, in_driver, not_in_driver);
 
-	if (atf_quotas != NULL) { /* Is NULL if ATF quotas are already up to date */
-		res = hapd->driver->send_atf_quotas(hapd->drv_priv, atf_quotas);
-		os_free (atf_quotas); /* allocated by os_zalloc in hostapd_atf_calc_quotas */
-	}
-
-	return res;
+	return 0;
 }
 
 static inline int hostapd_drv_sta_remove(struct hostapd_data *hapd,
@@ -360,6 +354,15 @@ static inline int hostapd_drv_br_delete_ip_neigh(struct hostapd_data *hapd,
 						ipaddr);
 }
 
+static inline int hostapd_drv_br_delete_fdb(struct hostapd_data *hapd,
+					    const u8 *addr)
+{
+	if (hapd->driver == NULL || hapd->drv_priv == NULL ||
+	    hapd->driver->br_delete_fdb == NULL)
+		return -1;
+	return hapd->driver->br_delete_fdb(hapd->drv_priv, addr);
+}
+
 static inline int hostapd_drv_br_port_set_attr(struct hostapd_data *hapd,
 					       enum drv_br_port_attr attr,
 					       unsigned int val)
@@ -1,13 +1,17 @@
 #include "includes.h"
 #include "common.h"
+#include "utils/eloop.h"
 #include "drivers/driver.h"
 #include "hostapd.h"
 #include "sta_info.h"
 #include "atf.h"
 
-static int update_atf_active_status_for_station (struct sta_info* sta,
-		int in_driver, int not_in_driver,
-		u32* sta_in_driver, u32* sta_has_quota);
+static int atf_sta_status_changed(struct hostapd_data *bss,
+		struct sta_info *sta, int in_driver, int not_in_driver);
+
+/* Unique across all configurations, so that a BSS never mistakes a stale
+ * resolved pointer for a valid one, even after the whole config is replaced */
+static unsigned int atf_cfg_generation;
 
 static struct atf_vap_config* add_vap_to_atf_config(struct atf_config* atf_cfg)
 {
@@ -67,22 +71,67 @@ void hostapd_atf_clean_config(struct atf_config* atf_cfg)
 		struct atf_vap_config* vap = &atf_cfg->vap_cfg[n_vap];
 		os_free(vap->vap_name);
 		os_free(vap->sta_grants);
+		os_free(vap->sta_hash);
 	}
 
 	os_free (atf_cfg->vap_cfg);
 	memset (atf_cfg, 0, sizeof(struct atf_config));
+	atf_cfg->generation = ++atf_cfg_generation;
+}
+
+/* Index station grants by MAC and precompute the total configured grant */
+static int atf_compile_vap_config(struct atf_vap_config* vap_cfg)
+{
+	int n_sta;
+
+	vap_cfg->total_grant = 0;
+	if (vap_cfg->n_stations == 0)
+		return 0;
+
+	vap_cfg->sta_hash = os_calloc(ATF_STA_HASH_SIZE, sizeof(struct atf_sta_grant *));
+	if (vap_cfg->sta_hash == NULL)
+		return -1;
+
+	/* Insert backwards, so that the first of duplicate entries is found */
+	for (n_sta = vap_cfg->n_stations - 1; n_sta >= 0; n_sta--) {
+		struct atf_sta_grant* sta = vap_cfg->sta_grants + n_sta;
+		int idx = ATF_STA_HASH(sta->sta_mac);
+
+		sta->hnext = vap_cfg->sta_hash[idx];
+		vap_cfg->sta_hash[idx] = sta;
+		vap_cfg->total_grant += sta->sta_grant;
+	}
+
+	return 0;
+}
+
+static struct atf_sta_grant* atf_find_sta_grant(struct atf_vap_config* vap_cfg,
+		const u8 *addr)
+{
+	struct atf_sta_grant* sta;
+
+	if (vap_cfg->sta_hash == NULL)
+		return NULL;
+
+	for (sta = vap_cfg->sta_hash[ATF_STA_HASH(addr)]; sta; sta = sta->hnext) {
+		if (os_memcmp(sta->sta_mac, addr, ETH_ALEN) == 0)
+			return sta;
+	}
+
+	return NULL;
 }
 
 /* Flush ATF data for all stations of this VAP, e.g. after recovery when
  * stations have not been removed from Driver cleanly. */
 void hostapd_atf_clean_stations(struct hostapd_data *hapd)
 {
-	struct hostapd_iface *iface = hapd->iface;
 	struct sta_info *sta;
 
+	/* Driver has lost its quotas as well, send the next update regardless */
+	hapd->iface->atf_sent_valid = 0;
+
 	for (sta = hapd->sta_list; sta; sta = sta->next) {
-		if (!update_atf_active_status_for_station (sta, 0, 1, iface->atf_sta_in_driver,
-			iface->atf_sta_has_quota))
+		if (!atf_sta_status_changed(hapd, sta, 0, 1))
 			continue;
 		if (!hapd->iface->atf_enabled && !hapd->iconf->atf_cfg.distr_type)
 			continue; /* ATF function is OFF */
@@ -151,7 +200,7 @@ static void hostapd_atf_dbg_print_config(struct atf_config* atf_cfg, const char*
 int hostapd_atf_read_config(struct atf_config* atf_cfg, const char* fname)
 {
 	char buf[256], *pos;
-	int line = 0;
+	int line = 0, n_vap;
 	struct atf_vap_config* curr_vap = NULL;
 	FILE *f = fopen(fname, "r");
 	if (f == NULL) {
@@ -306,11 +355,19 @@ int hostapd_atf_read_config(struct atf_config* atf_cfg, const char* fname)
 	if (atf_cfg->debug)
 		hostapd_atf_dbg_print_config(atf_cfg, fname);
 
+	for (n_vap = 0; n_vap < atf_cfg->n_vaps; n_vap++) {
+		if (atf_compile_vap_config(atf_cfg->vap_cfg + n_vap)) {
+			wpa_printf(MSG_ERROR, "ATF: Insufficient memory to index config file '%s'.",
+					fname);
+			hostapd_atf_clean_config(atf_cfg);
+			return -1;
+		}
+	}
+
 	/* Validate ATF configuration */
 	if (atf_cfg->per_vap)
 	{
 		int total_vap_grant = 0;
-		int n_vap;
 
 		for (n_vap = 0; n_vap < atf_cfg->n_vaps; n_vap++) {
 			struct atf_vap_config *vap_cfg = atf_cfg->vap_cfg + n_vap;
@@ -399,17 +456,126 @@ static inline int is_sta_active(struct sta_info* sta, u32* sta_has_quota)
 	return (sta_has_quota[idx] & bit) != 0;
  }
 
-static int count_active_stations_in_bss(struct hostapd_data *bss,
-		u32* sta_has_quota)
+/* Find ATF configuration for the BSS: its own section in the per-VAP mode,
+ * the per-radio station list otherwise. Resolved once per config read. */
+static struct atf_vap_config* atf_find_vap_config(struct hostapd_data *bss)
+{
+	struct atf_config* atf_cfg = &bss->iconf->atf_cfg;
+	int i;
+
+	if (bss->atf_cfg_gen == atf_cfg->generation)
+		return bss->atf_vap_cfg;
+
+	bss->atf_cfg_gen = atf_cfg->generation;
+	bss->atf_vap_cfg = NULL;
+
+	if (!atf_cfg->per_vap) {
+		bss->atf_vap_cfg = atf_cfg->vap_cfg;
+		return bss->atf_vap_cfg;
+	}
+
+	for (i = 0; i < atf_cfg->n_vaps; i++) {
+		struct atf_vap_config *cfg = atf_cfg->vap_cfg + i;
+		if (cfg->vap_name && strcmp(bss->conf->iface, cfg->vap_name) == 0) {
+			bss->atf_vap_cfg = cfg;
+			break;
+		}
+	}
+
+	return bss->atf_vap_cfg;
+}
+
+/* Configured grant of the STA as it is given to Driver, or -1 if unlisted */
+static int atf_sta_cfg_grant(struct hostapd_data *bss, const u8 *addr)
+{
+	struct atf_vap_config* vap_cfg = atf_find_vap_config(bss);
+	struct atf_sta_grant* sta_cfg;
+	int grant;
+
+	if (vap_cfg == NULL)
+		return -1;
+
+	sta_cfg = atf_find_sta_grant(vap_cfg, addr);
+	if (sta_cfg == NULL)
+		return -1;
+	if (!bss->iconf->atf_cfg.per_vap)
+		return sta_cfg->sta_grant;
+
+	/* Station grant is a share of the VAP grant */
+	grant = ((uint32_t)(vap_cfg->vap_grant) * sta_cfg->sta_grant
+			+ ATF_GRANT_SCALE / 2) / ATF_GRANT_SCALE;
+	return grant ? grant : 1; /* Ensure a positive value */
+}
+
+/* Account an activated or deactivated STA in the BSS counters. The grant
+ * counted on activation is kept in the STA so that exactly the same amount
+ * is subtracted later, even if the configuration has changed meanwhile. */
+static void atf_count_sta(struct hostapd_data *bss, struct sta_info *sta,
+		int active)
+{
+	if (active) {
+		sta->atf_listed_grant = atf_sta_cfg_grant(bss, sta->addr);
+		bss->atf_active_sta++;
+		if (sta->atf_listed_grant >= 0)
+			bss->atf_listed_grant += sta->atf_listed_grant;
+	} else {
+		bss->atf_active_sta--;
+		if (sta->atf_listed_grant >= 0)
+			bss->atf_listed_grant -= sta->atf_listed_grant;
+		sta->atf_listed_grant = -1;
+	}
+}
+
+static void atf_recount_bss(struct hostapd_data *bss)
+{
+	struct sta_info *sta;
+
+	bss->atf_active_sta = 0;
+	bss->atf_listed_grant = 0;
+	for (sta = bss->sta_list; sta != NULL; sta = sta->next) {
+		if (is_sta_active(sta, bss->iface->atf_sta_has_quota))
+			atf_count_sta(bss, sta, 1);
+	}
+}
+
+static int atf_sta_status_changed(struct hostapd_data *bss,
+		struct sta_info *sta, int in_driver, int not_in_driver)
+{
+	struct hostapd_iface *iface = bss->iface;
+
+	if (!update_atf_active_status_for_station(sta, in_driver, not_in_driver,
+			iface->atf_sta_in_driver, iface->atf_sta_has_quota))
+		return 0;
+
+	atf_count_sta(bss, sta, is_sta_active(sta, iface->atf_sta_has_quota));
+	return 1;
+}
+
+/* Grant every active STA of the BSS its configured grant plus an equal share
+ * of what is left. Unlisted STAs get no grant when nothing is left. */
+static void atf_assign_bss_grants(struct hostapd_data *bss,
+		uint16_t remaining_per_sta, uint16_t* sta_grant)
 {
-	int count = 0;
-	struct sta_info* sta;
+	struct sta_info *sta;
 
 	for (sta = bss->sta_list; sta != NULL; sta = sta->next) {
-		if (is_sta_active(sta, sta_has_quota))
-			count++;
+		u16 sid;
+		int grant;
+
+		if (!is_sta_active(sta, bss->iface->atf_sta_has_quota))
+			continue;
+
+		grant = remaining_per_sta;
+		if (sta->atf_listed_grant >= 0)
+			grant += sta->atf_listed_grant;
+		else if (grant == 0)
+			continue;
+
+		sid = sta_id_in_driver(sta, bss);
+		if (sid >= ATF_MAX_SID)
+			continue;
+		sta_grant[sid] = grant;
 	}
-	return count;
 }
 
 /*
@@ -417,202 +583,120 @@ static int count_active_stations_in_bss(struct hostapd_data *bss,
  * That is OK for the current HW, but will be a problem if SID assignment
  * is a hash from MAC or a pseudo-random number.
  */
-static void distribute_sta_quotas_per_radio(
-		struct atf_vap_config* vap_cfg, /* per radio station list */
-		size_t num_bss, struct hostapd_data **bss, /* Configured BSS-es */
-		uint16_t* sta_grant, /* per-station quotas */
-		u32* sta_has_quota)
+static void distribute_sta_quotas_per_radio(struct hostapd_iface *iface,
+		uint16_t* sta_grant /* per-station quotas */)
 {
-	int n_bss, n_sta, total_stations = 0, remaining_quota = ATF_GRANT_SCALE;
+	int n_bss, total_stations = 0, remaining_quota = ATF_GRANT_SCALE;
+	uint16_t remaining_per_sta = 0;
 
-	for (n_bss = 0; n_bss < num_bss; n_bss++)
-		total_stations += count_active_stations_in_bss(bss[n_bss], sta_has_quota);
+	for (n_bss = 0; n_bss < iface->num_bss; n_bss++) {
+		total_stations += iface->bss[n_bss]->atf_active_sta;
+		remaining_quota -= iface->bss[n_bss]->atf_listed_grant;
+	}
 	if (total_stations == 0)
 		return;
 
-	/* Distribute the configured quotas for connected stations */
-	if (vap_cfg) {
-		for (n_sta = 0; n_sta < vap_cfg->n_stations; n_sta++)
-		{
-			struct atf_sta_grant* sta_cfg = vap_cfg->sta_grants + n_sta;
-			struct sta_info* sta = NULL;
-
-			/* Find a station given in configuration. Search through all BSS */
-			for (n_bss = 0; n_bss < num_bss; n_bss++) {
-				sta = ap_get_sta(bss[n_bss], sta_cfg->sta_mac);
-				if (sta && is_sta_active(sta, sta_has_quota)) {
-					u8 sid = sta_id_in_driver(sta, bss[0]);
-					wpa_printf(MSG_DEBUG, "ATF: STA " MACSTR " (id = %d) gets grant %d",
-							MAC2STR(sta->addr), sid, sta_cfg->sta_grant);
-
-					sta_grant[sid] = sta_cfg->sta_grant;
-					remaining_quota -= (int)sta_cfg->sta_grant;
-				}
-			}
-		}
-	}
-
 	/* Distribute the remaining quota equally between stations */
-	if (remaining_quota > 0) {
-		uint16_t remaining_per_sta = remaining_quota / total_stations;
-
-		wpa_printf(MSG_DEBUG, "ATF: Distributing remaining grant equally per radio. "
-				"Each of %d stations gets %d.", total_stations, remaining_per_sta);
+	if (remaining_quota > 0)
+		remaining_per_sta = remaining_quota / total_stations;
 
-		for (n_bss = 0; n_bss < num_bss; n_bss++) {
-			struct sta_info *sta;
+	wpa_printf(MSG_DEBUG, "ATF: Calculating quotas per radio. Each of %d "
+			"stations gets %d on top of its configured grant.",
+			total_stations, remaining_per_sta);
 
-			for (sta = bss[n_bss]->sta_list; sta != NULL; sta = sta->next) {
-				if (is_sta_active(sta, sta_has_quota))
-					sta_grant[sta_id_in_driver(sta, bss[0])] += remaining_per_sta;
-			}
-		}
-	}
+	for (n_bss = 0; n_bss < iface->num_bss; n_bss++)
+		atf_assign_bss_grants(iface->bss[n_bss], remaining_per_sta, sta_grant);
 }
 
 static void distribute_sta_quotas_per_vap(
 		struct atf_vap_config* vap_cfg, /* per-vap cfg, includes station list */
 		struct hostapd_data *bss, /* BSS from hostapd config */
-		uint16_t* sta_grant, /* per-station quotas */
-		u32* sta_has_quota)
+		uint16_t* sta_grant /* per-station quotas */)
 {
-	int n_sta, remaining_in_vap = vap_cfg->vap_grant;
-	int count_in_bss = count_active_stations_in_bss(bss, sta_has_quota);
+	int remaining_in_vap = vap_cfg->vap_grant - bss->atf_listed_grant;
+	uint16_t remaining_per_sta = 0;
 
-	/* Cycle by stations in configuration and see which of them are connected */
-	for (n_sta = 0; n_sta < vap_cfg->n_stations; n_sta++)
-	{
-		struct atf_sta_grant* sta_cfg = vap_cfg->sta_grants + n_sta;
-		struct sta_info* sta = ap_get_sta(bss, sta_cfg->sta_mac);
-
-		if (sta && is_sta_active(sta, sta_has_quota)) {
-			uint16_t station_grant = ((uint32_t)(vap_cfg->vap_grant) * sta_cfg->sta_grant
-					+ ATF_GRANT_SCALE / 2) / ATF_GRANT_SCALE;
-			if (station_grant == 0)
-				station_grant = 1; /* Ensure a positive value */
-
-			wpa_printf(MSG_DEBUG, "ATF: STA %s/" MACSTR " (id = %d) gets grant %d",
-					vap_cfg->vap_name, MAC2STR(sta->addr), sta_id_in_driver(sta, bss), station_grant);
-
-			sta_grant[sta_id_in_driver(sta, bss)] = station_grant;
-			remaining_in_vap -= (int)station_grant;
-		}
-	}
+	if (bss->atf_active_sta == 0)
+		return;
 
 	/* Split the remaining VAP grant equally between stations in this VAP */
-	if (remaining_in_vap > 0 && count_in_bss) {
-		uint16_t remaining_per_sta = remaining_in_vap / count_in_bss;
-		struct sta_info *sta;
+	if (remaining_in_vap > 0)
+		remaining_per_sta = remaining_in_vap / bss->atf_active_sta;
 
-		wpa_printf(MSG_DEBUG, "ATF: Distributing remaining grant equally. Each of %d stations gets %d.",
-				count_in_bss, remaining_per_sta);
+	wpa_printf(MSG_DEBUG, "ATF: Calculating quotas for %s. Each of %d "
+			"stations gets %d on top of its configured grant.",
+			bss->conf->iface, bss->atf_active_sta, remaining_per_sta);
 
-		for (sta = bss->sta_list; sta != NULL; sta = sta->next) {
-			if (is_sta_active(sta, sta_has_quota))
-				sta_grant[sta_id_in_driver(sta, bss)] += remaining_per_sta;
-		}
-	}
+	atf_assign_bss_grants(bss, remaining_per_sta, sta_grant);
 }
 
-/* for TMP grant array supposing HW supports up to 1024 STAs */
-#define ATF_MAX_SID  1024
-#define ATF_NO_GRANT 0xffffu
-
-/* Calculate quotas and format a message to be sent to Driver */
-struct intel_vendor_atf_quotas* hostapd_atf_calc_quotas(struct atf_config* atf_cfg,
-		struct hostapd_data *hapd, /* BSS the changed station belongs to */
-		const u8* changed_sta, /* station that changes its status */
-		int in_driver, int not_in_driver)
+/* Calculate quotas and, if they differ from the ones Driver already has,
+ * send the full grant table. The message carries no delta marker, so
+ * Driver always takes it as the complete set of grants. */
+static int hostapd_atf_send_quotas(struct hostapd_iface *iface)
 {
 	uint16_t sta_grant_temp[ATF_MAX_SID]; /* intermediate STA grant per SID, keep it on stack */
-	int n_bss, data_len, i, j, nof_grants;
+	struct hostapd_data *hapd = iface->bss[0];
+	struct atf_config* atf_cfg = &iface->conf->atf_cfg;
+	int n_bss, data_len, i, j, nof_grants, nof_changed;
+	int max_stations = iface->conf->ap_max_num_sta;
+	unsigned int pending = iface->atf_pending_changes;
 	struct intel_vendor_atf_quotas* atf_quotas;
-	int max_stations = hapd->iconf->ap_max_num_sta;
+	int res;
+
+	iface->atf_pending_changes = 0;
 
 	/* Check if we have enough space for STA grant */
 	if (ATF_MAX_SID < max_stations) {
 		wpa_printf(MSG_DEBUG, "ATF: not enough space for STA grant. Need %d Have %d",
 				max_stations, ATF_MAX_SID);
-		return NULL;
-	}
-
-	/* Check if quotas need to be recalculated. */
-	if (changed_sta != NULL) { /* STA state changed */
-		struct sta_info *sta = ap_get_sta(hapd, changed_sta);
-		if (sta == NULL)
-			return NULL; /* The STA isn't (yet) under ATF control */
-
-		if (!update_atf_active_status_for_station(sta, in_driver, not_in_driver,
-				hapd->iface->atf_sta_in_driver, hapd->iface->atf_sta_has_quota))
-			return NULL; /* 'active' state for station did not change */
-
-		if (!hapd->iface->atf_enabled && !hapd->iconf->atf_cfg.distr_type)
-			return NULL; /* ATF function is OFF */
-
-		wpa_printf(MSG_DEBUG, "ATF: Recalculating quotas because STA " MACSTR
-				" (aid %d) became %s", MAC2STR(changed_sta), sta->aid,
-				is_sta_active(sta, hapd->iface->atf_sta_has_quota) ? "active" : "inactive");
-	}
-	else { /* ATF config changed */
-		if (!hapd->iface->atf_enabled && !hapd->iconf->atf_cfg.distr_type)
-			return NULL; /* ATF function is OFF and also was OFF before */
-		hapd->iface->atf_enabled = hapd->iconf->atf_cfg.distr_type;
-
-		wpa_printf(MSG_DEBUG, "ATF: Recalculating quotas because config has "
-				"changed, num_bss=%d, max_sta=%d",
-				hapd->iface->num_bss, max_stations);
+		return 0;
 	}
 
 	/* init with 11's prior to fill */
 	os_memset(sta_grant_temp, ATF_NO_GRANT, sizeof(sta_grant_temp));
 
-	if (atf_cfg->per_vap)
-	{
-		for (n_bss = 0; n_bss < hapd->iface->num_bss; n_bss++) {
-
-			/* Find and apply ATF configuration for this BSS */
-			for (i=0; i < atf_cfg->n_vaps; i++) {
-				struct atf_vap_config *vap_cfg = atf_cfg->vap_cfg + i;
-				struct hostapd_data *bss = hapd->iface->bss[n_bss];
-				if (vap_cfg->vap_name && strcmp(bss->conf->iface, vap_cfg->vap_name) == 0) {
-
-					wpa_printf(MSG_DEBUG, "ATF: Calculating quotas for %s (%d stations in DB)",
-							bss->conf->iface, bss->num_sta);
+	if (atf_cfg->per_vap) {
+		for (n_bss = 0; n_bss < iface->num_bss; n_bss++) {
+			struct hostapd_data *bss = iface->bss[n_bss];
+			struct atf_vap_config *vap_cfg = atf_find_vap_config(bss);
 
-					distribute_sta_quotas_per_vap(vap_cfg, bss, sta_grant_temp,
-							hapd->iface->atf_sta_has_quota);
-					break;
-				}
-			}
+			if (vap_cfg)
+				distribute_sta_quotas_per_vap(vap_cfg, bss, sta_grant_temp);
 		}
 	}
-	else { /* per radio */
-
-		wpa_printf(MSG_DEBUG, "ATF: Calculating quotas per radio");
-		distribute_sta_quotas_per_radio(atf_cfg->vap_cfg,
-				hapd->iface->num_bss, hapd->iface->bss,
-				sta_grant_temp, hapd->iface->atf_sta_has_quota);
-	}
-
-	/* count sta grants */
-	for (i = 0, nof_grants = 0; i < ATF_MAX_SID; i++) {
-		if (sta_grant_temp[i] == ATF_NO_GRANT)
-			continue;
-		nof_grants++;
+	else /* per radio */
+		distribute_sta_quotas_per_radio(iface, sta_grant_temp);
+
+	/* count sta grants, and the ones Driver does not have yet */
+	for (i = 0, nof_grants = 0, nof_changed = 0; i < ATF_MAX_SID; i++) {
+		if (sta_grant_temp[i] != ATF_NO_GRANT)
+			nof_grants++;
+		if (sta_grant_temp[i] != iface->atf_sent_grant[i])
+			nof_changed++;
 	}
 
 	if (nof_grants > max_stations) {
 		wpa_printf(MSG_DEBUG, "ATF: grants (%d) more than ap_max_sta (%d)",
 				nof_grants, max_stations);
-		return NULL;
+		return 0;
 	}
 
+	if (iface->atf_sent_valid && nof_changed == 0) {
+		wpa_printf(MSG_DEBUG, "ATF: Quotas unchanged after %u STA changes",
+				pending);
+		return 0;
+	}
+
+	wpa_printf(MSG_DEBUG, "ATF: Sending %d grants, %d changed "
+			"(%u STA changes)", nof_grants, nof_changed, pending);
+
 	/* Prepare "SET_ATF_QUOTAS" message */
 	data_len = sizeof(struct intel_vendor_sta_grant) * nof_grants;
 	atf_quotas = os_zalloc (sizeof(struct intel_vendor_atf_quotas) + data_len);
 	if (atf_quotas == NULL) {
 		wpa_printf(MSG_DEBUG, "ATF: failed to alloc atf_quotas");
-		return NULL;
+		return -ENOMEM;
 	}
 
 	/* Fill in per-radio parameters */
@@ -622,7 +706,7 @@ struct intel_vendor_atf_quotas* hostapd_atf_calc_quotas(struct atf_config* atf_c
 	atf_quotas->weighted_type = atf_cfg->weighted_type;
 	atf_quotas->interval      = atf_cfg->interval;
 	atf_quotas->free_time     = atf_cfg->free_time;
-	atf_quotas->nof_bss       = hapd->iface->num_bss;
+	atf_quotas->nof_bss       = iface->num_bss;
 	atf_quotas->nof_sta       = max_stations;
 	atf_quotas->nof_grants    = nof_grants;
 	atf_quotas->data_len      = data_len;
@@ -635,44 +719,129 @@ struct intel_vendor_atf_quotas* hostapd_atf_calc_quotas(struct atf_config* atf_c
 		j++;
 	}
 
-	return atf_quotas;
+	if (hapd->driver == NULL || hapd->driver->send_atf_quotas == NULL)
+		res = -ENOTSUP;
+	else
+		res = hapd->driver->send_atf_quotas(hapd->drv_priv, atf_quotas);
+	os_free (atf_quotas);
+
+	/* On failure Driver state is unknown, resend everything next time */
+	if (res == 0) {
+		os_memcpy(iface->atf_sent_grant, sta_grant_temp, sizeof(sta_grant_temp));
+		iface->atf_sent_valid = 1;
+	} else {
+		iface->atf_sent_valid = 0;
+	}
+
+	return res;
 }
 
+static void hostapd_atf_update_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct hostapd_iface *iface = eloop_ctx;
 
-/* Does ATF configuration and capacity allow the given station to connect */
-int hostapd_atf_is_sta_allowed(struct hostapd_data *bss, const u8 *address)
+	hostapd_atf_send_quotas(iface);
+}
+
+/* Coalesce STA changes arriving within atf_update_delay ms into one update */
+static void hostapd_atf_schedule_update(struct hostapd_iface *iface)
 {
-	struct atf_config* atf_cfg = &bss->iconf->atf_cfg;
-	struct atf_vap_config* vap_cfg = NULL;
-	int n_sta, total_quotas = 0;
+	int delay = iface->conf->atf_update_delay;
 
-	/* Find ATF configuration to use */
-	if (atf_cfg->per_vap) {
-		int i;
-
-		/* Find ATF configuration for this BSS */
-		for (i=0; i < atf_cfg->n_vaps; i++) {
-			struct atf_vap_config *cfg = atf_cfg->vap_cfg + i;
-			if (cfg->vap_name && strcmp(bss->conf->iface, cfg->vap_name) == 0) {
-				vap_cfg = cfg;
-				break;
-			}
-		}
+	iface->atf_pending_changes++;
+
+	if (delay <= 0) {
+		hostapd_atf_send_quotas(iface);
+		return;
 	}
-	else
-		vap_cfg = bss->iconf->atf_cfg.vap_cfg; /* use per-radio configuration */
+
+	if (eloop_is_timeout_registered(hostapd_atf_update_timeout, iface, NULL))
+		return;
+	eloop_register_timeout(delay / 1000, (delay % 1000) * 1000,
+			       hostapd_atf_update_timeout, iface, NULL);
+}
+
+/* Track a STA status change and schedule a quota update for Driver */
+void hostapd_atf_sta_changed(struct hostapd_data *hapd, /* BSS the changed station belongs to */
+		const u8* changed_sta, /* station that changes its status */
+		int in_driver, int not_in_driver)
+{
+	struct sta_info *sta = ap_get_sta(hapd, changed_sta);
+
+	if (sta == NULL)
+		return; /* The STA isn't (yet) under ATF control */
+
+	if (!atf_sta_status_changed(hapd, sta, in_driver, not_in_driver))
+		return; /* 'active' state for station did not change */
+
+	if (!hapd->iface->atf_enabled && !hapd->iconf->atf_cfg.distr_type)
+		return; /* ATF function is OFF */
+
+	wpa_printf(MSG_DEBUG, "ATF: Scheduling quotas update because STA " MACSTR
+			" (aid %d) became %s", MAC2STR(changed_sta), sta->aid,
+			is_sta_active(sta, hapd->iface->atf_sta_has_quota) ? "active" : "inactive");
+
+	hostapd_atf_schedule_update(hapd->iface);
+}
+
+/* Drop ATF state of a STA that is being freed, so that BSS counters and the
+ * per-AID bits do not outlive it if it was not removed from Driver cleanly. */
+void hostapd_atf_sta_freed(struct hostapd_data *hapd, struct sta_info *sta)
+{
+	if (!atf_sta_status_changed(hapd, sta, 0, 1))
+		return;
+
+	if (!hapd->iface->atf_enabled && !hapd->iconf->atf_cfg.distr_type)
+		return; /* ATF function is OFF */
+
+	hostapd_atf_schedule_update(hapd->iface);
+}
+
+/* Recount stations and send the full quota set after a config change */
+int hostapd_atf_config_changed(struct hostapd_data *hapd)
+{
+	struct hostapd_iface *iface = hapd->iface;
+	int n_bss;
+
+	eloop_cancel_timeout(hostapd_atf_update_timeout, iface, NULL);
+
+	/* Configured grants may have changed for the active stations */
+	for (n_bss = 0; n_bss < iface->num_bss; n_bss++)
+		atf_recount_bss(iface->bss[n_bss]);
+
+	if (!iface->atf_enabled && !hapd->iconf->atf_cfg.distr_type)
+		return 0; /* ATF function is OFF and also was OFF before */
+	iface->atf_enabled = hapd->iconf->atf_cfg.distr_type;
+	iface->atf_sent_valid = 0;
+
+	wpa_printf(MSG_DEBUG, "ATF: Recalculating quotas because config has "
+			"changed, num_bss=%d, max_sta=%d",
+			iface->num_bss, iface->conf->ap_max_num_sta);
+
+	return hostapd_atf_send_quotas(iface);
+}
+
+/* Cancel a pending quota update */
+void hostapd_atf_deinit(struct hostapd_iface *iface)
+{
+	eloop_cancel_timeout(hostapd_atf_update_timeout, iface, NULL);
+	iface->atf_pending_changes = 0;
+	iface->atf_sent_valid = 0;
+}
+
+
+/* Does ATF configuration and capacity allow the given station to connect */
+int hostapd_atf_is_sta_allowed(struct hostapd_data *bss, const u8 *address)
+{
+	struct atf_vap_config* vap_cfg = atf_find_vap_config(bss);
 
 	if (vap_cfg == NULL)
 		return 1; /* No stations nor VAPS (or an invalid ATF config) */
 
-	/* Is this STA in the list? Is the sum of assigned quotas below 100%? */
-	for (n_sta = 0; n_sta < vap_cfg->n_stations; n_sta++) {
-		struct atf_sta_grant* sta_grant = vap_cfg->sta_grants + n_sta;
-		if (memcmp(sta_grant->sta_mac, address, ETH_ALEN) == 0)
-			return 1; /* listed stations are always allowed */
-		total_quotas += sta_grant->sta_grant;
-	}
+	/* listed stations are always allowed */
+	if (atf_find_sta_grant(vap_cfg, address))
+		return 1;
 
 	/* Unlisted stations are allowed if the total configured quota is below 100% */
-	return total_quotas < ATF_GRANT_SCALE;
+	return vap_cfg->total_grant < ATF_GRANT_SCALE;
 }
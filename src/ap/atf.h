@@ -7,12 +7,22 @@
                                * to 100% of air time */
 #define ATF_MIN_VAP_GRANT 100 /* Min VAP grant in the per-VAP cfg mode */
 
+/* for grant arrays supposing HW supports up to 1024 STAs */
+#define ATF_MAX_SID  1024
+#define ATF_NO_GRANT 0xffffu
+
+#define ATF_STA_HASH_SIZE 1024
+#define ATF_STA_HASH(mac) ((((mac)[4] << 8) | (mac)[5]) & (ATF_STA_HASH_SIZE - 1))
+
 struct hostapd_data;
+struct hostapd_iface;
+struct sta_info;
 
 struct atf_sta_grant
 {
 	uint8_t    sta_mac[ETH_ALEN];
 	uint16_t   sta_grant;
+	struct     atf_sta_grant* hnext; /* next entry in sta_hash bucket */
 };
 
 struct atf_vap_config
@@ -21,6 +31,8 @@ struct atf_vap_config
 	uint16_t  vap_grant;
 	int       n_stations;    /* number of stations having grants */
 	struct    atf_sta_grant* sta_grants;
+	struct    atf_sta_grant** sta_hash; /* sta_grants by MAC, built after reading */
+	int       total_grant;   /* sum of sta_grant over sta_grants */
 };
 
 struct atf_config /* Air Time Fairness configuration */
@@ -36,6 +48,7 @@ struct atf_config /* Air Time Fairness configuration */
 
 	uint32_t  n_vaps;
 	struct atf_vap_config* vap_cfg; /* memory allocated for n_vaps VAPs */
+	unsigned int generation; /* changes whenever vap_cfg is rebuilt */
 };
 
 /* Free allocated memory and reset contents */
@@ -47,11 +60,19 @@ void hostapd_atf_clean_stations(struct hostapd_data *hapd);
 /* Read ATF configuration from file */
 int hostapd_atf_read_config(struct atf_config* atf_cfg, const char* pathname);
 
-/* Calculate quotas and format a message to be sent to Driver */
-struct intel_vendor_atf_quotas* hostapd_atf_calc_quotas(struct atf_config* atf_cfg,
-		struct hostapd_data *hapd, const u8* changed_sta,
+/* Track a STA status change and schedule a quota update for Driver */
+void hostapd_atf_sta_changed(struct hostapd_data *hapd, const u8 *changed_sta,
 		int in_driver, int not_in_driver);
 
+/* Drop ATF state of a STA that is being freed */
+void hostapd_atf_sta_freed(struct hostapd_data *hapd, struct sta_info *sta);
+
+/* Recount stations and send the full quota set after a config change */
+int hostapd_atf_config_changed(struct hostapd_data *hapd);
+
+/* Cancel a pending quota update */
+void hostapd_atf_deinit(struct hostapd_iface *iface);
+
 /* Does ATF configuration and capacity allow the given station to connect */
 int hostapd_atf_is_sta_allowed(struct hostapd_data *bss, const u8 *address);
 
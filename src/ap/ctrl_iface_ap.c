@@ -18,6 +18,8 @@
 #include "wpa_auth.h"
 #include "ieee802_11.h"
 #include "sta_info.h"
+#include "sta_admit.h"
+#include "sta_latency.h"
 #include "wps_hostapd.h"
 #include "p2p_hostapd.h"
 #include "ctrl_iface_ap.h"
@@ -272,6 +274,7 @@ static int hostapd_ctrl_iface_sta_mib(struct hostapd_data *hapd,
 
 	len += hostapd_get_sta_tx_rx(hapd, sta, buf + len, buflen - len);
 	len += hostapd_get_sta_conn_time(sta, buf + len, buflen - len);
+	len += sta_lat_get_sta(sta, buf + len, buflen - len);
 
 #ifdef CONFIG_SAE
 	if (sta->sae && sta->sae->state == SAE_ACCEPTED) {
@@ -522,6 +525,69 @@ int hostapd_ctrl_iface_sta_next(struct hostapd_data *hapd, const char *cmd,
 }
 
 
+/* Space kept free per station in STA-ALL; the old single STA reply size */
+#define STA_ALL_ENTRY_MAX 8192
+
+static int sta_all_cmp(const void *a, const void *b)
+{
+	const struct sta_info *sa = *(const struct sta_info * const *) a;
+	const struct sta_info *sb = *(const struct sta_info * const *) b;
+
+	return os_memcmp(sa->addr, sb->addr, ETH_ALEN);
+}
+
+
+/*
+ * Stations are listed in address order so that a dump can be resumed after
+ * the CURSOR address even if that station has disconnected in between.
+ */
+int hostapd_ctrl_iface_sta_all(struct hostapd_data *hapd, const char *cmd,
+			       char *buf, size_t buflen)
+{
+	u8 addr[ETH_ALEN];
+	struct sta_info *sta, **list;
+	const char *pos;
+	size_t len = 0, num = 0, i;
+	int cursor = 0, ret;
+
+	hapd = get_bss_index(cmd, hapd->iface);
+	if (hapd == NULL)
+		return -1;
+
+	pos = os_strchr(cmd, ' ');
+	if (pos) {
+		if (hwaddr_aton(pos + 1, addr))
+			return -1;
+		cursor = 1;
+	}
+
+	list = os_calloc(hapd->num_sta + 1, sizeof(*list));
+	if (!list)
+		return -1;
+	for (sta = hapd->sta_list; sta && num < (size_t) hapd->num_sta;
+	     sta = sta->next) {
+		if (!cursor || os_memcmp(sta->addr, addr, ETH_ALEN) > 0)
+			list[num++] = sta;
+	}
+	qsort(list, num, sizeof(*list), sta_all_cmp);
+
+	for (i = 0; i < num; i++) {
+		if (len > 0 && buflen - len < STA_ALL_ENTRY_MAX) {
+			ret = os_snprintf(buf + len, buflen - len,
+					  "CURSOR=" MACSTR "\n",
+					  MAC2STR(list[i - 1]->addr));
+			if (!os_snprintf_error(buflen - len, ret))
+				len += ret;
+			break;
+		}
+		len += hostapd_ctrl_iface_sta_mib(hapd, list[i], buf + len,
+						  buflen - len);
+	}
+	os_free(list);
+
+	return len;
+}
+
 #ifdef CONFIG_P2P_MANAGER
 static int p2p_manager_disconnect(struct hostapd_data *hapd, u16 stype,
 				  u8 minor_reason_code, const u8 *addr)
@@ -803,6 +869,37 @@ int hostapd_ctrl_iface_status(struct hostapd_data *hapd, char *buf,
 		return len;
 	len += ret;
 
+	ret = os_snprintf(buf + len, buflen - len,
+			  "num_sta_radio=%d\n"
+			  "sta_pool_size=%u\n"
+			  "sta_pool_used=%u\n"
+			  "sta_pool_hwm=%u\n"
+			  "sta_pool_fallback=%u\n",
+			  iface->num_sta,
+			  iface->sta_pool_size,
+			  iface->sta_pool_used,
+			  iface->sta_pool_hwm,
+			  iface->sta_pool_fallback);
+	if (os_snprintf_error(buflen - len, ret))
+		return len;
+	len += ret;
+
+	len += sta_admit_status(iface, buf + len, buflen - len);
+
+	if (iface->conf->multibss_enable) {
+		ret = os_snprintf(buf + len, buflen - len,
+				  "aid_shared_used=%u\n"
+				  "aid_shared_hwm=%u\n"
+				  "aid_shared_allocs=%u\n"
+				  "aid_shared_failures=%u\n",
+				  iface->aid_map.used, iface->aid_map.hwm,
+				  iface->aid_map.allocs,
+				  iface->aid_map.failures);
+		if (os_snprintf_error(buflen - len, ret))
+			return len;
+		len += ret;
+	}
+
 	if (!iface->cac_started || !iface->dfs_cac_ms) {
 		ret = os_snprintf(buf + len, buflen - len,
 				  "cac_time_seconds=%d\n"
@@ -925,7 +1022,14 @@ int hostapd_ctrl_iface_status(struct hostapd_data *hapd, char *buf,
 				  "ssid[%d]=%s\n"
 				  "beacon_int[%d]=%u\n"
 				  "beacon_set_done[%d]=%d\n"
-				  "num_sta[%d]=%d\n",
+				  "num_sta[%d]=%d\n"
+				  "sta_flush_last_num[%d]=%u\n"
+				  "sta_flush_last_usec[%d]=%u\n"
+				  "sta_admit_rejected[%d]=%u\n"
+				  "aid_used[%d]=%u\n"
+				  "aid_hwm[%d]=%u\n"
+				  "aid_allocs[%d]=%u\n"
+				  "aid_failures[%d]=%u\n",
 				  (int) i, bss->conf->iface,
 				  (int) i, MAC2STR(bss->own_addr),
 				  (int) i,
@@ -933,10 +1037,28 @@ int hostapd_ctrl_iface_status(struct hostapd_data *hapd, char *buf,
 					       bss->conf->ssid.ssid_len),
 				  (int) i, hostapd_get_beacon_int(bss),
 				  (int) i, bss->beacon_set_done,
-				  (int) i, bss->num_sta);
+				  (int) i, bss->num_sta,
+				  (int) i, bss->sta_flush_last_num,
+				  (int) i, bss->sta_flush_last_usec,
+				  (int) i, bss->sta_admit_rejected,
+				  (int) i, bss->aid_map.used,
+				  (int) i, bss->aid_map.hwm,
+				  (int) i, bss->aid_map.allocs,
+				  (int) i, bss->aid_map.failures);
+		if (os_snprintf_error(buflen - len, ret))
+			return len;
+		len += ret;
+
+#ifdef CONFIG_INTERWORKING
+		ret = os_snprintf(buf + len, buflen - len,
+				  "anqp_cache_hits[%d]=%u\n"
+				  "anqp_cache_misses[%d]=%u\n",
+				  (int) i, bss->anqp_cache_hits,
+				  (int) i, bss->anqp_cache_misses);
 		if (os_snprintf_error(buflen - len, ret))
 			return len;
 		len += ret;
+#endif /* CONFIG_INTERWORKING */
 	}
 
 	if (hapd->conf->chan_util_avg_period) {
@@ -8,10 +8,12 @@
 
 #include "includes.h"
 #ifdef CONFIG_SQLITE
+#include <sys/stat.h>
 #include <sqlite3.h>
 #endif /* CONFIG_SQLITE */
 
 #include "common.h"
+#include "utils/list.h"
 #include "eap_common/eap_wsc_common.h"
 #include "eap_server/eap_methods.h"
 #include "eap_server/eap.h"
@@ -76,58 +78,355 @@ static void set_user_methods(struct hostapd_eap_user *user, const char *methods)
 }
 
 
-static int get_user_cb(void *ctx, int argc, char *argv[], char *col[])
+/*
+ * The database is kept open with prepared statements and recent lookups
+ * (including misses) are cached. The cache is flushed whenever the database
+ * is modified, either through SQLite (PRAGMA data_version) or by replacing
+ * or rewriting the file.
+ */
+#define EAP_USER_CACHE_SIZE 256
+#define EAP_USER_CACHE_HASH_SIZE 64
+
+struct eap_user_cache_entry {
+	struct eap_user_cache_entry *hnext; /* next entry in hash table list */
+	struct dl_list list; /* most recently used first */
+	u8 *identity; /* lookup key */
+	size_t identity_len;
+	int phase2;
+	int found;
+	struct hostapd_eap_user user;
+};
+
+struct eap_user_sqlite {
+	char *path;
+	sqlite3 *db;
+	sqlite3_stmt *user_stmt;
+	sqlite3_stmt *wildcard_stmt;
+	sqlite3_stmt *version_stmt;
+	int data_version;
+	struct stat st;
+	struct eap_user_cache_entry *hash[EAP_USER_CACHE_HASH_SIZE];
+	struct dl_list lru;
+	unsigned int num_entries;
+};
+
+
+static unsigned int eap_user_cache_hash(const u8 *identity,
+					size_t identity_len, int phase2)
 {
-	struct hostapd_eap_user *user = ctx;
-	int i;
+	unsigned int hash = phase2;
+	size_t i;
 
-	for (i = 0; i < argc; i++) {
-		if (os_strcmp(col[i], "password") == 0 && argv[i]) {
-			bin_clear_free(user->password, user->password_len);
-			user->password_len = os_strlen(argv[i]);
-			user->password = (u8 *) os_strdup(argv[i]);
-			user->next = (void *) 1;
-		} else if (os_strcmp(col[i], "methods") == 0 && argv[i]) {
-			set_user_methods(user, argv[i]);
-		} else if (os_strcmp(col[i], "remediation") == 0 && argv[i]) {
-			user->remediation = strlen(argv[i]) > 0;
-		} else if (os_strcmp(col[i], "t_c_timestamp") == 0 && argv[i]) {
-			user->t_c_timestamp = strtol(argv[i], NULL, 10);
+	for (i = 0; i < identity_len; i++)
+		hash = hash * 31 + identity[i];
+	return hash % EAP_USER_CACHE_HASH_SIZE;
+}
+
+
+static void eap_user_cache_free_entry(struct eap_user_sqlite *data,
+				      struct eap_user_cache_entry *entry)
+{
+	struct eap_user_cache_entry **pos;
+
+	for (pos = &data->hash[eap_user_cache_hash(entry->identity,
+						   entry->identity_len,
+						   entry->phase2)];
+	     *pos; pos = &(*pos)->hnext) {
+		if (*pos == entry) {
+			*pos = entry->hnext;
+			break;
 		}
 	}
+	dl_list_del(&entry->list);
+	data->num_entries--;
 
-	return 0;
+	os_free(entry->identity);
+	os_free(entry->user.identity);
+	bin_clear_free(entry->user.password, entry->user.password_len);
+	os_free(entry);
+}
+
+
+static void eap_user_cache_flush(struct eap_user_sqlite *data)
+{
+	struct eap_user_cache_entry *entry, *tmp;
+
+	dl_list_for_each_safe(entry, tmp, &data->lru,
+			      struct eap_user_cache_entry, list)
+		eap_user_cache_free_entry(data, entry);
+}
+
+
+static struct eap_user_cache_entry *
+eap_user_cache_get(struct eap_user_sqlite *data, const u8 *identity,
+		   size_t identity_len, int phase2)
+{
+	struct eap_user_cache_entry *entry;
+
+	entry = data->hash[eap_user_cache_hash(identity, identity_len, phase2)];
+	while (entry &&
+	       (entry->phase2 != phase2 ||
+		entry->identity_len != identity_len ||
+		os_memcmp(entry->identity, identity, identity_len) != 0))
+		entry = entry->hnext;
+	if (entry) {
+		dl_list_del(&entry->list);
+		dl_list_add(&data->lru, &entry->list);
+	}
+	return entry;
+}
+
+
+static void eap_user_cache_add(struct eap_user_sqlite *data,
+			       const struct hostapd_eap_user *user,
+			       const u8 *identity, size_t identity_len,
+			       int phase2, int found)
+{
+	struct eap_user_cache_entry *entry;
+	unsigned int hash;
+
+	if (data->num_entries >= EAP_USER_CACHE_SIZE)
+		eap_user_cache_free_entry(
+			data, dl_list_last(&data->lru,
+					   struct eap_user_cache_entry, list));
+
+	entry = os_zalloc(sizeof(*entry));
+	if (!entry)
+		return;
+	entry->identity = os_zalloc(identity_len + 1);
+	if (entry->identity)
+		os_memcpy(entry->identity, identity, identity_len);
+	entry->user = *user;
+	entry->user.identity = NULL;
+	entry->user.password = NULL;
+	if (user->identity)
+		entry->user.identity = os_memdup(user->identity,
+						 user->identity_len + 1);
+	if (user->password)
+		entry->user.password = os_memdup(user->password,
+						 user->password_len + 1);
+	if (!entry->identity || (user->identity && !entry->user.identity) ||
+	    (user->password && !entry->user.password)) {
+		os_free(entry->identity);
+		os_free(entry->user.identity);
+		bin_clear_free(entry->user.password, user->password_len);
+		os_free(entry);
+		return;
+	}
+	entry->identity_len = identity_len;
+	entry->phase2 = phase2;
+	entry->found = found;
+
+	hash = eap_user_cache_hash(identity, identity_len, phase2);
+	entry->hnext = data->hash[hash];
+	data->hash[hash] = entry;
+	dl_list_add(&data->lru, &entry->list);
+	data->num_entries++;
+}
+
+
+static void eap_user_sqlite_close(struct eap_user_sqlite *data)
+{
+	sqlite3_finalize(data->user_stmt);
+	sqlite3_finalize(data->wildcard_stmt);
+	sqlite3_finalize(data->version_stmt);
+	data->user_stmt = NULL;
+	data->wildcard_stmt = NULL;
+	data->version_stmt = NULL;
+	sqlite3_close(data->db);
+	data->db = NULL;
+	eap_user_cache_flush(data);
 }
 
 
-static int get_wildcard_cb(void *ctx, int argc, char *argv[], char *col[])
+static int eap_user_sqlite_data_version(struct eap_user_sqlite *data)
 {
-	struct hostapd_eap_user *user = ctx;
-	int i, id = -1, methods = -1;
-	size_t len;
-
-	for (i = 0; i < argc; i++) {
-		if (os_strcmp(col[i], "identity") == 0 && argv[i])
-			id = i;
-		else if (os_strcmp(col[i], "methods") == 0 && argv[i])
-			methods = i;
+	int version = -1;
+
+	if (sqlite3_step(data->version_stmt) == SQLITE_ROW)
+		version = sqlite3_column_int(data->version_stmt, 0);
+	sqlite3_reset(data->version_stmt);
+	return version;
+}
+
+
+static int eap_user_sqlite_open(struct eap_user_sqlite *data)
+{
+	if (stat(data->path, &data->st) < 0)
+		os_memset(&data->st, 0, sizeof(data->st));
+
+	if (sqlite3_open(data->path, &data->db)) {
+		wpa_printf(MSG_INFO, "DB: Failed to open database %s: %s",
+			   data->path, sqlite3_errmsg(data->db));
+		goto fail;
 	}
 
-	if (id < 0 || methods < 0)
-		return 0;
-
-	len = os_strlen(argv[id]);
-	if (len <= user->identity_len &&
-	    os_memcmp(argv[id], user->identity, len) == 0 &&
-	    (user->password == NULL || len > user->password_len)) {
-		bin_clear_free(user->password, user->password_len);
-		user->password_len = os_strlen(argv[id]);
-		user->password = (u8 *) os_strdup(argv[id]);
-		user->next = (void *) 1;
-		set_user_methods(user, argv[methods]);
+	if (sqlite3_prepare_v2(data->db,
+			       "SELECT * FROM users WHERE identity=?1 AND phase2=?2;",
+			       -1, &data->user_stmt, NULL) != SQLITE_OK ||
+	    sqlite3_prepare_v2(data->db, "PRAGMA data_version;", -1,
+			       &data->version_stmt, NULL) != SQLITE_OK) {
+		wpa_printf(MSG_INFO, "DB: Failed to prepare statements: %s  db: %s",
+			   sqlite3_errmsg(data->db), data->path);
+		goto fail;
 	}
 
+	/*
+	 * Longest wildcard prefix is found through the identity index; see
+	 * eap_user_sqlite_wildcard(). The wildcards table is optional.
+	 */
+	if (sqlite3_prepare_v2(data->db,
+			       "SELECT identity,methods FROM wildcards WHERE identity<=?1 AND methods IS NOT NULL ORDER BY identity DESC LIMIT 1;",
+			       -1, &data->wildcard_stmt, NULL) != SQLITE_OK)
+		wpa_printf(MSG_DEBUG, "DB: No wildcards: %s  db: %s",
+			   sqlite3_errmsg(data->db), data->path);
+
+	data->data_version = eap_user_sqlite_data_version(data);
 	return 0;
+
+fail:
+	eap_user_sqlite_close(data);
+	return -1;
+}
+
+
+static struct eap_user_sqlite * eap_user_sqlite_get_db(struct hostapd_data *hapd)
+{
+	struct eap_user_sqlite *data = hapd->eap_user_sqlite;
+	const char *path = hapd->conf->eap_user_sqlite;
+	struct stat st;
+	int version;
+
+	if (data && os_strcmp(data->path, path) != 0) {
+		eap_user_sqlite_deinit(hapd);
+		data = NULL;
+	}
+
+	if (!data) {
+		data = os_zalloc(sizeof(*data));
+		if (!data)
+			return NULL;
+		data->path = os_strdup(path);
+		if (!data->path) {
+			os_free(data);
+			return NULL;
+		}
+		dl_list_init(&data->lru);
+		hapd->eap_user_sqlite = data;
+	}
+
+	if (data->db && stat(path, &st) == 0) {
+		if (st.st_ino != data->st.st_ino) {
+			wpa_printf(MSG_DEBUG, "DB: %s replaced - reopen", path);
+			eap_user_sqlite_close(data);
+		} else if (st.st_mtime != data->st.st_mtime ||
+			   st.st_size != data->st.st_size) {
+			data->st = st;
+			eap_user_cache_flush(data);
+		}
+	}
+
+	if (!data->db && eap_user_sqlite_open(data) < 0)
+		return NULL;
+
+	version = eap_user_sqlite_data_version(data);
+	if (version != data->data_version) {
+		data->data_version = version;
+		eap_user_cache_flush(data);
+	}
+
+	return data;
+}
+
+
+void eap_user_sqlite_deinit(struct hostapd_data *hapd)
+{
+	struct eap_user_sqlite *data = hapd->eap_user_sqlite;
+
+	if (!data)
+		return;
+	eap_user_sqlite_close(data);
+	os_free(data->path);
+	os_free(data);
+	hapd->eap_user_sqlite = NULL;
+}
+
+
+static void get_user_row(sqlite3_stmt *stmt, struct hostapd_eap_user *user)
+{
+	int i;
+
+	for (i = 0; i < sqlite3_column_count(stmt); i++) {
+		const char *col = sqlite3_column_name(stmt, i);
+		const char *val = (const char *) sqlite3_column_text(stmt, i);
+
+		if (!col || !val)
+			continue;
+		if (os_strcmp(col, "password") == 0) {
+			bin_clear_free(user->password, user->password_len);
+			user->password_len = os_strlen(val);
+			user->password = (u8 *) os_strdup(val);
+			user->next = (void *) 1;
+		} else if (os_strcmp(col, "methods") == 0) {
+			set_user_methods(user, val);
+		} else if (os_strcmp(col, "remediation") == 0) {
+			user->remediation = strlen(val) > 0;
+		} else if (os_strcmp(col, "t_c_timestamp") == 0) {
+			user->t_c_timestamp = strtol(val, NULL, 10);
+		}
+	}
+}
+
+
+/*
+ * Find the longest wildcard that is a prefix of the identity. The largest
+ * wildcard that sorts at or before the identity is either such a prefix or
+ * shares a common prefix with it that bounds the next lookup, so only a few
+ * index lookups are needed.
+ */
+static int eap_user_sqlite_wildcard(struct eap_user_sqlite *data,
+				    struct hostapd_eap_user *user)
+{
+	sqlite3_stmt *stmt = data->wildcard_stmt;
+	size_t bound = user->identity_len;
+	int found = 0;
+
+	while (stmt) {
+		const u8 *id;
+		size_t len, i;
+
+		sqlite3_bind_text(stmt, 1, (const char *) user->identity,
+				  bound, SQLITE_STATIC);
+		if (sqlite3_step(stmt) != SQLITE_ROW)
+			break;
+		id = sqlite3_column_text(stmt, 0);
+		len = sqlite3_column_bytes(stmt, 0);
+		for (i = 0; i < len && i < bound; i++) {
+			if (id[i] != user->identity[i])
+				break;
+		}
+		if (i == len) {
+			bin_clear_free(user->password, user->password_len);
+			user->password_len = len;
+			user->password = os_memdup(id, len + 1);
+			if (user->password) {
+				user->password[len] = '\0';
+				user->next = (void *) 1;
+				set_user_methods(
+					user,
+					(const char *)
+					sqlite3_column_text(stmt, 1));
+				found = 1;
+			}
+			break;
+		}
+		bound = i;
+		sqlite3_reset(stmt);
+	}
+
+	if (stmt)
+		sqlite3_reset(stmt);
+	return found;
 }
 
 
@@ -135,31 +434,30 @@ static const struct hostapd_eap_user *
 eap_user_sqlite_get(struct hostapd_data *hapd, const u8 *identity,
 		    size_t identity_len, int phase2)
 {
-	sqlite3 *db;
+	struct eap_user_sqlite *data;
+	struct eap_user_cache_entry *entry;
 	struct hostapd_eap_user *user = NULL;
-	char id_str[256], cmd[300];
 	size_t i;
 	int res;
 
-	if (identity_len >= sizeof(id_str)) {
+	if (identity_len >= 256) {
 		wpa_printf(MSG_DEBUG, "%s: identity len too big: %d >= %d",
-			   __func__, (int) identity_len,
-			   (int) (sizeof(id_str)));
+			   __func__, (int) identity_len, 256);
 		return NULL;
 	}
-	os_memcpy(id_str, identity, identity_len);
-	id_str[identity_len] = '\0';
 	for (i = 0; i < identity_len; i++) {
-		if (id_str[i] >= 'a' && id_str[i] <= 'z')
+		if (identity[i] >= 'a' && identity[i] <= 'z')
 			continue;
-		if (id_str[i] >= 'A' && id_str[i] <= 'Z')
+		if (identity[i] >= 'A' && identity[i] <= 'Z')
 			continue;
-		if (id_str[i] >= '0' && id_str[i] <= '9')
+		if (identity[i] >= '0' && identity[i] <= '9')
 			continue;
-		if (id_str[i] == '-' || id_str[i] == '_' || id_str[i] == '.' ||
-		    id_str[i] == ',' || id_str[i] == '@' || id_str[i] == '\\' ||
-		    id_str[i] == '!' || id_str[i] == '#' || id_str[i] == '%' ||
-		    id_str[i] == '=' || id_str[i] == ' ')
+		if (identity[i] == '-' || identity[i] == '_' ||
+		    identity[i] == '.' || identity[i] == ',' ||
+		    identity[i] == '@' || identity[i] == '\\' ||
+		    identity[i] == '!' || identity[i] == '#' ||
+		    identity[i] == '%' || identity[i] == '=' ||
+		    identity[i] == ' ')
 			continue;
 		wpa_printf(MSG_INFO, "DB: Unsupported character in identity");
 		return NULL;
@@ -170,6 +468,32 @@ eap_user_sqlite_get(struct hostapd_data *hapd, const u8 *identity,
 	bin_clear_free(hapd->tmp_eap_user.password,
 		       hapd->tmp_eap_user.password_len);
 	os_memset(&hapd->tmp_eap_user, 0, sizeof(hapd->tmp_eap_user));
+
+	data = eap_user_sqlite_get_db(hapd);
+	if (!data)
+		return NULL;
+
+	entry = eap_user_cache_get(data, identity, identity_len, phase2);
+	if (entry) {
+		if (!entry->found)
+			return NULL;
+		hapd->tmp_eap_user = entry->user;
+		hapd->tmp_eap_user.identity = NULL;
+		hapd->tmp_eap_user.password = NULL;
+		if (entry->user.identity)
+			hapd->tmp_eap_user.identity = os_memdup(
+				entry->user.identity,
+				entry->user.identity_len + 1);
+		if (entry->user.password)
+			hapd->tmp_eap_user.password = os_memdup(
+				entry->user.password,
+				entry->user.password_len + 1);
+		if ((entry->user.identity && !hapd->tmp_eap_user.identity) ||
+		    (entry->user.password && !hapd->tmp_eap_user.password))
+			return NULL;
+		return &hapd->tmp_eap_user;
+	}
+
 	hapd->tmp_eap_user.phase2 = phase2;
 	hapd->tmp_eap_user.identity = os_zalloc(identity_len + 1);
 	if (hapd->tmp_eap_user.identity == NULL)
@@ -177,50 +501,33 @@ eap_user_sqlite_get(struct hostapd_data *hapd, const u8 *identity,
 	os_memcpy(hapd->tmp_eap_user.identity, identity, identity_len);
 	hapd->tmp_eap_user.identity_len = identity_len;
 
-	if (sqlite3_open(hapd->conf->eap_user_sqlite, &db)) {
-		wpa_printf(MSG_INFO, "DB: Failed to open database %s: %s",
-			   hapd->conf->eap_user_sqlite, sqlite3_errmsg(db));
-		sqlite3_close(db);
-		return NULL;
-	}
-
-	res = os_snprintf(cmd, sizeof(cmd),
-			  "SELECT * FROM users WHERE identity='%s' AND phase2=%d;",
-			  id_str, phase2);
-	if (os_snprintf_error(sizeof(cmd), res))
-		goto fail;
-
-	wpa_printf(MSG_DEBUG, "DB: %s", cmd);
-	if (sqlite3_exec(db, cmd, get_user_cb, &hapd->tmp_eap_user, NULL) !=
-	    SQLITE_OK) {
+	sqlite3_bind_text(data->user_stmt, 1, (const char *) identity,
+			  identity_len, SQLITE_STATIC);
+	sqlite3_bind_int(data->user_stmt, 2, phase2);
+	while ((res = sqlite3_step(data->user_stmt)) == SQLITE_ROW)
+		get_user_row(data->user_stmt, &hapd->tmp_eap_user);
+	sqlite3_reset(data->user_stmt);
+	if (res != SQLITE_DONE) {
 		wpa_printf(MSG_DEBUG,
 			   "DB: Failed to complete SQL operation: %s  db: %s",
-			   sqlite3_errmsg(db), hapd->conf->eap_user_sqlite);
-	} else if (hapd->tmp_eap_user.next)
+			   sqlite3_errmsg(data->db), data->path);
+		return NULL;
+	}
+	if (hapd->tmp_eap_user.next)
 		user = &hapd->tmp_eap_user;
 
-	if (user == NULL && !phase2) {
-		os_snprintf(cmd, sizeof(cmd),
-			    "SELECT identity,methods FROM wildcards;");
-		wpa_printf(MSG_DEBUG, "DB: %s", cmd);
-		if (sqlite3_exec(db, cmd, get_wildcard_cb, &hapd->tmp_eap_user,
-				 NULL) != SQLITE_OK) {
-			wpa_printf(MSG_DEBUG,
-				   "DB: Failed to complete SQL operation: %s  db: %s",
-				   sqlite3_errmsg(db),
-				   hapd->conf->eap_user_sqlite);
-		} else if (hapd->tmp_eap_user.next) {
-			user = &hapd->tmp_eap_user;
-			os_free(user->identity);
-			user->identity = user->password;
-			user->identity_len = user->password_len;
-			user->password = NULL;
-			user->password_len = 0;
-		}
+	if (user == NULL && !phase2 &&
+	    eap_user_sqlite_wildcard(data, &hapd->tmp_eap_user)) {
+		user = &hapd->tmp_eap_user;
+		os_free(user->identity);
+		user->identity = user->password;
+		user->identity_len = user->password_len;
+		user->password = NULL;
+		user->password_len = 0;
 	}
 
-fail:
-	sqlite3_close(db);
+	eap_user_cache_add(data, &hapd->tmp_eap_user, identity, identity_len,
+			   phase2, user != NULL);
 
 	return user;
 }
@@ -258,6 +565,13 @@ hostapd_get_eap_user(struct hostapd_data *hapd, const u8 *identity,
 	}
 #endif /* CONFIG_WPS */
 
+	if (conf->eap_user_index) {
+		user = hostapd_eap_user_index_get(conf->eap_user_index,
+						  identity, identity_len,
+						  phase2);
+		goto done;
+	}
+
 	while (user) {
 		if (!phase2 && user->identity == NULL) {
 			/* Wildcard match */
@@ -279,6 +593,7 @@ hostapd_get_eap_user(struct hostapd_data *hapd, const u8 *identity,
 		user = user->next;
 	}
 
+done:
 #ifdef CONFIG_SQLITE
 	if (user == NULL && conf->eap_user_sqlite) {
 		return eap_user_sqlite_get(hapd, identity, identity_len,
@@ -42,59 +42,220 @@ static void convert_to_protected_dual(struct wpabuf *msg)
 }
 
 
-static struct gas_dialog_info *
-gas_dialog_create(struct hostapd_data *hapd, const u8 *addr, u8 dialog_token)
+/*
+ * GAS/ANQP state for peers that have no STA entry is kept in a separate,
+ * bounded table so that queries from passing devices do not consume
+ * station slots.
+ */
+#define GAS_PEER_HASH_SIZE 64
+#define GAS_PEER_HASH(a) ((a)[5] & (GAS_PEER_HASH_SIZE - 1))
+#define GAS_PEER_MAX 256
+
+struct gas_peer {
+	struct gas_peer *hnext; /* next entry in hash table list */
+	struct dl_list list; /* least recently used first */
+	u8 addr[ETH_ALEN];
+	struct os_reltime expire;
+	u8 dialog_next;
+	struct gas_dialog_info dialog[GAS_DIALOG_MAX];
+};
+
+struct gas_peer_table {
+	struct gas_peer *hash[GAS_PEER_HASH_SIZE];
+	struct dl_list peers; /* struct gas_peer */
+	unsigned int num_peers;
+};
+
+
+static struct gas_peer * gas_peer_get(struct hostapd_data *hapd,
+				      const u8 *addr)
 {
-	struct sta_info *sta;
-	struct gas_dialog_info *dia = NULL;
-	int i, j;
+	struct gas_peer *peer;
 
-	sta = ap_get_sta(hapd, addr);
-	if (!sta) {
-		/*
-		 * We need a STA entry to be able to maintain state for
-		 * the GAS query.
-		 */
-		wpa_printf(MSG_DEBUG, "ANQP: Add a temporary STA entry for "
-			   "GAS query");
-		sta = ap_sta_add(hapd, addr);
-		if (!sta) {
-			wpa_printf(MSG_DEBUG, "Failed to add STA " MACSTR
-				   " for GAS query", MAC2STR(addr));
-			return NULL;
+	if (!hapd->gas_peers)
+		return NULL;
+
+	peer = hapd->gas_peers->hash[GAS_PEER_HASH(addr)];
+	while (peer && os_memcmp(peer->addr, addr, ETH_ALEN) != 0)
+		peer = peer->hnext;
+	return peer;
+}
+
+
+static void gas_peer_free(struct gas_peer_table *table, struct gas_peer *peer)
+{
+	struct gas_peer **pos;
+	int i;
+
+	for (pos = &table->hash[GAS_PEER_HASH(peer->addr)]; *pos;
+	     pos = &(*pos)->hnext) {
+		if (*pos == peer) {
+			*pos = peer->hnext;
+			break;
 		}
-		sta->flags |= WLAN_STA_GAS;
-		/*
-		 * The default inactivity is 300 seconds. We don't need
-		 * it to be that long. Use five second timeout and increase this
-		 * with the comeback_delay for testing cases.
-		 */
-		ap_sta_session_timeout(hapd, sta,
-				       hapd->conf->gas_comeback_delay / 1024 +
-				       5);
-	} else {
-		ap_sta_replenish_timeout(hapd, sta, 5);
 	}
+	dl_list_del(&peer->list);
+	table->num_peers--;
+
+	for (i = 0; i < GAS_DIALOG_MAX; i++) {
+		if (peer->dialog[i].valid)
+			gas_serv_dialog_clear(&peer->dialog[i]);
+	}
+	os_free(peer);
+}
+
+
+static void gas_peer_expire(void *eloop_ctx, void *timeout_ctx)
+{
+	struct hostapd_data *hapd = eloop_ctx;
+	struct gas_peer_table *table = hapd->gas_peers;
+	struct gas_peer *peer, *tmp;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	dl_list_for_each_safe(peer, tmp, &table->peers, struct gas_peer, list) {
+		if (os_reltime_before(&now, &peer->expire))
+			continue;
+		wpa_printf(MSG_DEBUG, "GAS: Remove state for peer " MACSTR,
+			   MAC2STR(peer->addr));
+		gas_peer_free(table, peer);
+	}
+
+	if (table->num_peers)
+		eloop_register_timeout(1, 0, gas_peer_expire, hapd, NULL);
+}
+
 
-	if (sta->gas_dialog == NULL) {
-		sta->gas_dialog = os_calloc(GAS_DIALOG_MAX,
-					    sizeof(struct gas_dialog_info));
-		if (sta->gas_dialog == NULL)
+static void gas_peer_touch(struct gas_peer_table *table,
+			   struct gas_peer *peer, int timeout)
+{
+	struct os_reltime expire;
+
+	os_get_reltime(&expire);
+	expire.sec += timeout;
+	if (os_reltime_before(&peer->expire, &expire))
+		peer->expire = expire;
+
+	dl_list_del(&peer->list);
+	dl_list_add_tail(&table->peers, &peer->list);
+}
+
+
+static struct gas_peer * gas_peer_add(struct hostapd_data *hapd,
+				      const u8 *addr)
+{
+	struct gas_peer_table *table = hapd->gas_peers;
+	struct gas_peer *peer;
+
+	if (!table) {
+		table = os_zalloc(sizeof(*table));
+		if (!table)
 			return NULL;
+		dl_list_init(&table->peers);
+		hapd->gas_peers = table;
+	}
+
+	if (table->num_peers >= GAS_PEER_MAX) {
+		peer = dl_list_first(&table->peers, struct gas_peer, list);
+		wpa_printf(MSG_DEBUG, "GAS: Peer table full - drop state for "
+			   MACSTR, MAC2STR(peer->addr));
+		gas_peer_free(table, peer);
 	}
 
-	for (i = sta->gas_dialog_next, j = 0; j < GAS_DIALOG_MAX; i++, j++) {
+	peer = os_zalloc(sizeof(*peer));
+	if (!peer)
+		return NULL;
+	os_memcpy(peer->addr, addr, ETH_ALEN);
+	peer->hnext = table->hash[GAS_PEER_HASH(addr)];
+	table->hash[GAS_PEER_HASH(addr)] = peer;
+	dl_list_add_tail(&table->peers, &peer->list);
+	if (table->num_peers++ == 0)
+		eloop_register_timeout(1, 0, gas_peer_expire, hapd, NULL);
+
+	return peer;
+}
+
+
+static struct gas_dialog_info *
+gas_dialog_alloc(struct gas_dialog_info *dialogs, u8 *dialog_next,
+		 u8 dialog_token)
+{
+	struct gas_dialog_info *dia;
+	int i, j;
+
+	for (i = *dialog_next, j = 0; j < GAS_DIALOG_MAX; i++, j++) {
 		if (i == GAS_DIALOG_MAX)
 			i = 0;
-		if (sta->gas_dialog[i].valid)
+		if (dialogs[i].valid)
 			continue;
-		dia = &sta->gas_dialog[i];
+		dia = &dialogs[i];
 		dia->valid = 1;
 		dia->dialog_token = dialog_token;
-		sta->gas_dialog_next = (++i == GAS_DIALOG_MAX) ? 0 : i;
+		*dialog_next = (++i == GAS_DIALOG_MAX) ? 0 : i;
 		return dia;
 	}
 
+	return NULL;
+}
+
+
+static struct gas_dialog_info *
+gas_dialog_search(struct gas_dialog_info *dialogs, u8 dialog_token)
+{
+	int i;
+
+	for (i = 0; dialogs && i < GAS_DIALOG_MAX; i++) {
+		if (dialogs[i].dialog_token == dialog_token &&
+		    dialogs[i].valid)
+			return &dialogs[i];
+	}
+
+	return NULL;
+}
+
+
+static struct gas_dialog_info *
+gas_dialog_create(struct hostapd_data *hapd, const u8 *addr, u8 dialog_token)
+{
+	struct sta_info *sta;
+	struct gas_peer *peer;
+	struct gas_dialog_info *dia = NULL;
+
+	sta = ap_get_sta(hapd, addr);
+	if (sta) {
+		ap_sta_replenish_timeout(hapd, sta, 5);
+		if (sta->gas_dialog == NULL) {
+			sta->gas_dialog = ap_sta_gas_dialog_alloc(sta);
+			if (sta->gas_dialog == NULL)
+				return NULL;
+		}
+		dia = gas_dialog_alloc(sta->gas_dialog, &sta->gas_dialog_next,
+				       dialog_token);
+	} else {
+		peer = gas_peer_get(hapd, addr);
+		if (peer) {
+			gas_peer_touch(hapd->gas_peers, peer, 5);
+		} else {
+			peer = gas_peer_add(hapd, addr);
+			if (!peer) {
+				wpa_printf(MSG_DEBUG, "Failed to add GAS state for "
+					   MACSTR, MAC2STR(addr));
+				return NULL;
+			}
+			/*
+			 * Five seconds is enough for a query. Increase this
+			 * with the comeback_delay for testing cases.
+			 */
+			gas_peer_touch(hapd->gas_peers, peer,
+				       hapd->conf->gas_comeback_delay / 1024 +
+				       5);
+		}
+		dia = gas_dialog_alloc(peer->dialog, &peer->dialog_next,
+				       dialog_token);
+	}
+	if (dia)
+		return dia;
+
 	wpa_msg(hapd->msg_ctx, MSG_ERROR, "ANQP: Could not create dialog for "
 		MACSTR " dialog_token %u. Consider increasing "
 		"GAS_DIALOG_MAX.", MAC2STR(addr), dialog_token);
@@ -108,21 +269,33 @@ gas_serv_dialog_find(struct hostapd_data *hapd, const u8 *addr,
 		     u8 dialog_token)
 {
 	struct sta_info *sta;
-	int i;
+	struct gas_peer *peer;
+	struct gas_dialog_info *dia;
 
 	sta = ap_get_sta(hapd, addr);
-	if (!sta) {
+	if (sta) {
+		dia = gas_dialog_search(sta->gas_dialog, dialog_token);
+		if (dia) {
+			ap_sta_replenish_timeout(hapd, sta, 5);
+			return dia;
+		}
+	}
+
+	/* The peer may have associated after the query was started */
+	peer = gas_peer_get(hapd, addr);
+	if (peer) {
+		dia = gas_dialog_search(peer->dialog, dialog_token);
+		if (dia) {
+			gas_peer_touch(hapd->gas_peers, peer, 5);
+			return dia;
+		}
+	}
+
+	if (!sta && !peer) {
 		wpa_printf(MSG_DEBUG, "ANQP: could not find STA " MACSTR,
 			   MAC2STR(addr));
 		return NULL;
 	}
-	for (i = 0; sta->gas_dialog && i < GAS_DIALOG_MAX; i++) {
-		if (sta->gas_dialog[i].dialog_token != dialog_token ||
-		    !sta->gas_dialog[i].valid)
-			continue;
-		ap_sta_replenish_timeout(hapd, sta, 5);
-		return &sta->gas_dialog[i];
-	}
 	wpa_printf(MSG_DEBUG, "ANQP: Could not find dialog for "
 		   MACSTR " dialog_token %u", MAC2STR(addr), dialog_token);
 	return NULL;
@@ -140,8 +313,19 @@ static void gas_serv_free_dialogs(struct hostapd_data *hapd,
 				  const u8 *sta_addr)
 {
 	struct sta_info *sta;
+	struct gas_peer *peer;
 	int i;
 
+	peer = gas_peer_get(hapd, sta_addr);
+	if (peer) {
+		for (i = 0; i < GAS_DIALOG_MAX; i++) {
+			if (peer->dialog[i].valid)
+				break;
+		}
+		if (i == GAS_DIALOG_MAX)
+			gas_peer_free(hapd->gas_peers, peer);
+	}
+
 	sta = ap_get_sta(hapd, sta_addr);
 	if (sta == NULL || sta->gas_dialog == NULL)
 		return;
@@ -151,11 +335,108 @@ static void gas_serv_free_dialogs(struct hostapd_data *hapd,
 			return;
 	}
 
-	os_free(sta->gas_dialog);
-	sta->gas_dialog = NULL;
+	ap_sta_gas_dialog_free(sta);
 }
 
 
+/*
+ * ANQP elements that depend only on the BSS configuration are serialized
+ * once and copied into each response. The cache is rebuilt whenever the
+ * configuration changes (gas_serv_anqp_cache_update()).
+ */
+enum anqp_cache_id {
+	ANQP_CACHE_CAPABILITY_LIST,
+	ANQP_CACHE_VENUE_NAME,
+	ANQP_CACHE_VENUE_URL,
+	ANQP_CACHE_NETWORK_AUTH_TYPE,
+	ANQP_CACHE_ROAMING_CONSORTIUM,
+	ANQP_CACHE_IP_ADDR_TYPE_AVAILABILITY,
+	ANQP_CACHE_NAI_REALM,
+	ANQP_CACHE_3GPP_CELLULAR_NETWORK,
+	ANQP_CACHE_DOMAIN_NAME,
+#ifdef CONFIG_FILS
+	ANQP_CACHE_FILS_REALM_INFO,
+#endif /* CONFIG_FILS */
+#ifdef CONFIG_HS20
+	ANQP_CACHE_HS_CAPABILITY_LIST,
+	ANQP_CACHE_OPERATOR_FRIENDLY_NAME,
+	ANQP_CACHE_WAN_METRICS,
+	ANQP_CACHE_CONNECTION_CAPABILITY,
+	ANQP_CACHE_OPERATING_CLASS,
+	ANQP_CACHE_OSU_PROVIDERS_LIST,
+	ANQP_CACHE_OPERATOR_ICON_METADATA,
+	ANQP_CACHE_OSU_PROVIDERS_NAI_LIST,
+#endif /* CONFIG_HS20 */
+	ANQP_CACHE_NUM
+};
+
+/* Large enough for any single element that fits in a response */
+#define ANQP_CACHE_BUILD_LEN 4096
+
+struct gas_anqp_cache {
+	struct wpabuf *elem[ANQP_CACHE_NUM];
+#ifdef CONFIG_HS20
+	/* Icon file contents indexed like hs20_icons; NULL on read error */
+	struct wpabuf **icon;
+	size_t num_icons;
+#endif /* CONFIG_HS20 */
+};
+
+
+static void gas_anqp_cache_free(struct gas_anqp_cache *cache)
+{
+	int i;
+#ifdef CONFIG_HS20
+	size_t j;
+#endif /* CONFIG_HS20 */
+
+	if (!cache)
+		return;
+
+	for (i = 0; i < ANQP_CACHE_NUM; i++)
+		wpabuf_free(cache->elem[i]);
+#ifdef CONFIG_HS20
+	for (j = 0; j < cache->num_icons; j++)
+		wpabuf_free(cache->icon[j]);
+	os_free(cache->icon);
+#endif /* CONFIG_HS20 */
+	os_free(cache);
+}
+
+
+#ifdef CONFIG_HS20
+static struct wpabuf * anqp_icon_read(struct hs20_icon *icon)
+{
+	char *data;
+	size_t data_len;
+	struct wpabuf *buf = NULL;
+
+	data = os_readfile(icon->file, &data_len);
+	if (data && data_len <= 65535)
+		buf = wpabuf_alloc_copy(data, data_len);
+	os_free(data);
+	return buf;
+}
+
+
+static struct wpabuf * anqp_icon_get(struct hostapd_data *hapd, size_t idx,
+				     int *cached)
+{
+	struct gas_anqp_cache *cache = hapd->anqp_cache;
+
+	if (cache && idx < cache->num_icons) {
+		hapd->anqp_cache_hits++;
+		*cached = 1;
+		return cache->icon[idx];
+	}
+
+	hapd->anqp_cache_misses++;
+	*cached = 0;
+	return anqp_icon_read(&hapd->conf->hs20_icons[idx]);
+}
+#endif /* CONFIG_HS20 */
+
+
 #ifdef CONFIG_HS20
 static void anqp_add_hs_capab_list(struct hostapd_data *hapd,
 				   struct wpabuf *buf)
@@ -938,11 +1219,11 @@ static void anqp_add_icon_binary_file(struct hostapd_data *hapd,
 	wpabuf_put_u8(buf, 0); /* Reserved */
 
 	if (icon) {
-		char *data;
-		size_t data_len;
+		struct wpabuf *data;
+		int cached;
 
-		data = os_readfile(icon->file, &data_len);
-		if (data == NULL || data_len > 65535) {
+		data = anqp_icon_get(hapd, i, &cached);
+		if (data == NULL) {
 			wpabuf_put_u8(buf, 2); /* Download Status:
 						* Unspecified file error */
 			wpabuf_put_u8(buf, 0);
@@ -951,10 +1232,11 @@ static void anqp_add_icon_binary_file(struct hostapd_data *hapd,
 			wpabuf_put_u8(buf, 0); /* Download Status: Success */
 			wpabuf_put_u8(buf, os_strlen(icon->type));
 			wpabuf_put_str(buf, icon->type);
-			wpabuf_put_le16(buf, data_len);
-			wpabuf_put_data(buf, data, data_len);
+			wpabuf_put_le16(buf, wpabuf_len(data));
+			wpabuf_put_buf(buf, data);
 		}
-		os_free(data);
+		if (!cached)
+			wpabuf_free(data);
 	} else {
 		wpabuf_put_u8(buf, 1); /* Download Status: File not found */
 		wpabuf_put_u8(buf, 0);
@@ -990,6 +1272,151 @@ static void anqp_add_operator_icon_metadata(struct hostapd_data *hapd,
 
 #endif /* CONFIG_HS20 */
 
+static void anqp_add_nai_realm_list(struct hostapd_data *hapd,
+				    struct wpabuf *buf)
+{
+	anqp_add_nai_realm(hapd, buf, NULL, 0, 1, 0);
+}
+
+
+static void (* const anqp_cache_build[ANQP_CACHE_NUM])(
+	struct hostapd_data *hapd, struct wpabuf *buf) = {
+	[ANQP_CACHE_CAPABILITY_LIST] = anqp_add_capab_list,
+	[ANQP_CACHE_VENUE_NAME] = anqp_add_venue_name,
+	[ANQP_CACHE_VENUE_URL] = anqp_add_venue_url,
+	[ANQP_CACHE_NETWORK_AUTH_TYPE] = anqp_add_network_auth_type,
+	[ANQP_CACHE_ROAMING_CONSORTIUM] = anqp_add_roaming_consortium,
+	[ANQP_CACHE_IP_ADDR_TYPE_AVAILABILITY] =
+	anqp_add_ip_addr_type_availability,
+	[ANQP_CACHE_NAI_REALM] = anqp_add_nai_realm_list,
+	[ANQP_CACHE_3GPP_CELLULAR_NETWORK] = anqp_add_3gpp_cellular_network,
+	[ANQP_CACHE_DOMAIN_NAME] = anqp_add_domain_name,
+#ifdef CONFIG_FILS
+	[ANQP_CACHE_FILS_REALM_INFO] = anqp_add_fils_realm_info,
+#endif /* CONFIG_FILS */
+#ifdef CONFIG_HS20
+	[ANQP_CACHE_HS_CAPABILITY_LIST] = anqp_add_hs_capab_list,
+	[ANQP_CACHE_OPERATOR_FRIENDLY_NAME] = anqp_add_operator_friendly_name,
+	[ANQP_CACHE_WAN_METRICS] = anqp_add_wan_metrics,
+	[ANQP_CACHE_CONNECTION_CAPABILITY] = anqp_add_connection_capability,
+	[ANQP_CACHE_OPERATING_CLASS] = anqp_add_operating_class,
+	[ANQP_CACHE_OSU_PROVIDERS_LIST] = anqp_add_osu_providers_list,
+	[ANQP_CACHE_OPERATOR_ICON_METADATA] = anqp_add_operator_icon_metadata,
+	[ANQP_CACHE_OSU_PROVIDERS_NAI_LIST] = anqp_add_osu_providers_nai_list,
+#endif /* CONFIG_HS20 */
+};
+
+
+static struct wpabuf * anqp_cache_serialize(struct hostapd_data *hapd,
+					    enum anqp_cache_id id)
+{
+	struct wpabuf *tmp, *elem;
+
+	tmp = wpabuf_alloc(ANQP_CACHE_BUILD_LEN);
+	if (!tmp)
+		return NULL;
+	anqp_cache_build[id](hapd, tmp);
+	elem = wpabuf_dup(tmp);
+	wpabuf_free(tmp);
+	return elem;
+}
+
+
+void gas_serv_anqp_cache_update(struct hostapd_data *hapd)
+{
+	struct gas_anqp_cache *cache;
+	int i;
+
+	gas_anqp_cache_free(hapd->anqp_cache);
+	hapd->anqp_cache = NULL;
+
+	cache = os_zalloc(sizeof(*cache));
+	if (!cache)
+		return;
+	for (i = 0; i < ANQP_CACHE_NUM; i++)
+		cache->elem[i] = anqp_cache_serialize(hapd, i);
+
+#ifdef CONFIG_HS20
+	if (hapd->conf->hs20_icons_count) {
+		size_t j;
+
+		cache->icon = os_calloc(hapd->conf->hs20_icons_count,
+					sizeof(struct wpabuf *));
+		if (cache->icon) {
+			cache->num_icons = hapd->conf->hs20_icons_count;
+			for (j = 0; j < cache->num_icons; j++)
+				cache->icon[j] = anqp_icon_read(
+					&hapd->conf->hs20_icons[j]);
+		}
+	}
+#endif /* CONFIG_HS20 */
+
+	hapd->anqp_cache = cache;
+}
+
+
+/*
+ * Whether setting the named configuration parameter can change the cache.
+ * This lists the configuration read by the anqp_cache_build[] functions.
+ */
+int gas_serv_anqp_cache_param(const char *name)
+{
+	static const char * const prefix[] = {
+		"anqp_", /* anqp_elem overrides, anqp_3gpp_cell_net */
+		"hs20", /* all HS 2.0 elements and icons */
+		"osu_", /* OSU Providers (NAI) List */
+		"venue_", /* Venue Name, Venue URL */
+	};
+	static const char * const param[] = {
+		"interworking",
+		"network_auth_type",
+		"roaming_consortium",
+		"ipaddr_type_availability",
+		"nai_realm",
+		"domain_name",
+		"fils_realm",
+		"operator_icon",
+		/* Capability List */
+		"rrm_neighbor_report",
+		"radio_measurements",
+		"mbo",
+	};
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(prefix); i++) {
+		if (os_strncmp(name, prefix[i], os_strlen(prefix[i])) == 0)
+			return 1;
+	}
+	for (i = 0; i < ARRAY_SIZE(param); i++) {
+		if (os_strcmp(name, param[i]) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+
+static void anqp_add_cached(struct hostapd_data *hapd, struct wpabuf *buf,
+			    enum anqp_cache_id id)
+{
+	struct wpabuf *elem;
+
+	elem = hapd->anqp_cache ? hapd->anqp_cache->elem[id] : NULL;
+	if (!elem) {
+		hapd->anqp_cache_misses++;
+		anqp_cache_build[id](hapd, buf);
+		return;
+	}
+
+	hapd->anqp_cache_hits++;
+	if (wpabuf_tailroom(buf) < wpabuf_len(elem)) {
+		wpa_printf(MSG_DEBUG, "ANQP: No room for cached element %d",
+			   id);
+		return;
+	}
+	wpabuf_put_buf(buf, elem);
+}
+
+
 static size_t anqp_get_required_len(struct hostapd_data *hapd,
 				    const u16 *infoid,
 				    unsigned int num_infoid)
@@ -1036,23 +1463,27 @@ gas_serv_build_gas_resp_payload(struct hostapd_data *hapd,
 		return NULL;
 
 	if (request & ANQP_REQ_CAPABILITY_LIST)
-		anqp_add_capab_list(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_CAPABILITY_LIST);
 	if (request & ANQP_REQ_VENUE_NAME)
-		anqp_add_venue_name(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_VENUE_NAME);
 	if (request & ANQP_REQ_EMERGENCY_CALL_NUMBER)
 		anqp_add_elem(hapd, buf, ANQP_EMERGENCY_CALL_NUMBER);
 	if (request & ANQP_REQ_NETWORK_AUTH_TYPE)
-		anqp_add_network_auth_type(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_NETWORK_AUTH_TYPE);
 	if (request & ANQP_REQ_ROAMING_CONSORTIUM)
-		anqp_add_roaming_consortium(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_ROAMING_CONSORTIUM);
 	if (request & ANQP_REQ_IP_ADDR_TYPE_AVAILABILITY)
-		anqp_add_ip_addr_type_availability(hapd, buf);
-	if (request & (ANQP_REQ_NAI_REALM | ANQP_REQ_NAI_HOME_REALM))
+		anqp_add_cached(hapd, buf,
+				ANQP_CACHE_IP_ADDR_TYPE_AVAILABILITY);
+	if ((request & ANQP_REQ_NAI_REALM) &&
+	    !(request & ANQP_REQ_NAI_HOME_REALM))
+		anqp_add_cached(hapd, buf, ANQP_CACHE_NAI_REALM);
+	else if (request & ANQP_REQ_NAI_HOME_REALM)
 		anqp_add_nai_realm(hapd, buf, home_realm, home_realm_len,
 				   request & ANQP_REQ_NAI_REALM,
 				   request & ANQP_REQ_NAI_HOME_REALM);
 	if (request & ANQP_REQ_3GPP_CELLULAR_NETWORK)
-		anqp_add_3gpp_cellular_network(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_3GPP_CELLULAR_NETWORK);
 	if (request & ANQP_REQ_AP_GEOSPATIAL_LOCATION)
 		anqp_add_elem(hapd, buf, ANQP_AP_GEOSPATIAL_LOCATION);
 	if (request & ANQP_REQ_AP_CIVIC_LOCATION)
@@ -1060,7 +1491,7 @@ gas_serv_build_gas_resp_payload(struct hostapd_data *hapd,
 	if (request & ANQP_REQ_AP_LOCATION_PUBLIC_URI)
 		anqp_add_elem(hapd, buf, ANQP_AP_LOCATION_PUBLIC_URI);
 	if (request & ANQP_REQ_DOMAIN_NAME)
-		anqp_add_domain_name(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_DOMAIN_NAME);
 	if (request & ANQP_REQ_EMERGENCY_ALERT_URI)
 		anqp_add_elem(hapd, buf, ANQP_EMERGENCY_ALERT_URI);
 	if (request & ANQP_REQ_TDLS_CAPABILITY)
@@ -1073,12 +1504,12 @@ gas_serv_build_gas_resp_payload(struct hostapd_data *hapd,
 	for (i = 0; i < num_extra_req; i++) {
 #ifdef CONFIG_FILS
 		if (extra_req[i] == ANQP_FILS_REALM_INFO) {
-			anqp_add_fils_realm_info(hapd, buf);
+			anqp_add_cached(hapd, buf, ANQP_CACHE_FILS_REALM_INFO);
 			continue;
 		}
 #endif /* CONFIG_FILS */
 		if (extra_req[i] == ANQP_VENUE_URL) {
-			anqp_add_venue_url(hapd, buf);
+			anqp_add_cached(hapd, buf, ANQP_CACHE_VENUE_URL);
 			continue;
 		}
 		anqp_add_elem(hapd, buf, extra_req[i]);
@@ -1086,23 +1517,23 @@ gas_serv_build_gas_resp_payload(struct hostapd_data *hapd,
 
 #ifdef CONFIG_HS20
 	if (request & ANQP_REQ_HS_CAPABILITY_LIST)
-		anqp_add_hs_capab_list(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_HS_CAPABILITY_LIST);
 	if (request & ANQP_REQ_OPERATOR_FRIENDLY_NAME)
-		anqp_add_operator_friendly_name(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_OPERATOR_FRIENDLY_NAME);
 	if (request & ANQP_REQ_WAN_METRICS)
-		anqp_add_wan_metrics(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_WAN_METRICS);
 	if (request & ANQP_REQ_CONNECTION_CAPABILITY)
-		anqp_add_connection_capability(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_CONNECTION_CAPABILITY);
 	if (request & ANQP_REQ_OPERATING_CLASS)
-		anqp_add_operating_class(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_OPERATING_CLASS);
 	if (request & ANQP_REQ_OSU_PROVIDERS_LIST)
-		anqp_add_osu_providers_list(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_OSU_PROVIDERS_LIST);
 	if (request & ANQP_REQ_ICON_REQUEST)
 		anqp_add_icon_binary_file(hapd, buf, icon_name, icon_name_len);
 	if (request & ANQP_REQ_OPERATOR_ICON_METADATA)
-		anqp_add_operator_icon_metadata(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_OPERATOR_ICON_METADATA);
 	if (request & ANQP_REQ_OSU_PROVIDERS_NAI_LIST)
-		anqp_add_osu_providers_nai_list(hapd, buf);
+		anqp_add_cached(hapd, buf, ANQP_CACHE_OSU_PROVIDERS_NAI_LIST);
 #endif /* CONFIG_HS20 */
 
 #ifdef CONFIG_MBO
@@ -1925,10 +2356,25 @@ int gas_serv_init(struct hostapd_data *hapd)
 {
 	hapd->public_action_cb2 = gas_serv_rx_public_action;
 	hapd->public_action_cb2_ctx = hapd;
+	gas_serv_anqp_cache_update(hapd);
 	return 0;
 }
 
 
 void gas_serv_deinit(struct hostapd_data *hapd)
 {
+	struct gas_peer_table *table = hapd->gas_peers;
+	struct gas_peer *peer, *tmp;
+
+	gas_anqp_cache_free(hapd->anqp_cache);
+	hapd->anqp_cache = NULL;
+
+	if (!table)
+		return;
+
+	eloop_cancel_timeout(gas_peer_expire, hapd, NULL);
+	dl_list_for_each_safe(peer, tmp, &table->peers, struct gas_peer, list)
+		gas_peer_free(table, peer);
+	os_free(table);
+	hapd->gas_peers = NULL;
 }
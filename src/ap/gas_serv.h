@@ -89,5 +89,7 @@ void gas_serv_dialog_clear(struct gas_dialog_info *dialog);
 
 int gas_serv_init(struct hostapd_data *hapd);
 void gas_serv_deinit(struct hostapd_data *hapd);
+void gas_serv_anqp_cache_update(struct hostapd_data *hapd);
+int gas_serv_anqp_cache_param(const char *name);
 
 #endif /* GAS_SERV_H */
@@ -25,6 +25,7 @@
 #include "hostapd.h"
 #include "authsrv.h"
 #include "sta_info.h"
+#include "sta_admit.h"
 #include "accounting.h"
 #include "ap_list.h"
 #include "beacon.h"
@@ -55,6 +56,7 @@
 #include "rrm.h"
 #include "fils_hlp.h"
 #include "acs.h"
+#include "acs_log.h"
 #include "hs20.h"
 
 
@@ -99,6 +101,12 @@ static void hostapd_reload_bss(struct hostapd_data *hapd)
 {
 	struct hostapd_ssid *ssid;
 
+#ifdef CONFIG_INTERWORKING
+	if (hapd->anqp_cache)
+		gas_serv_anqp_cache_update(hapd);
+#endif /* CONFIG_INTERWORKING */
+	sta_admit_config(hapd->iface);
+
 	if (!hapd->started)
 		return;
 
@@ -456,6 +464,7 @@ static void hostapd_free_hapd_data(struct hostapd_data *hapd)
 	x_snoop_deinit(hapd);
 
 #ifdef CONFIG_SQLITE
+	eap_user_sqlite_deinit(hapd);
 	bin_clear_free(hapd->tmp_eap_user.identity,
 		       hapd->tmp_eap_user.identity_len);
 	bin_clear_free(hapd->tmp_eap_user.password,
@@ -576,6 +585,9 @@ static void hostapd_cleanup_iface(struct hostapd_iface *iface)
 			     NULL);
 
 	hostapd_cleanup_iface_partial(iface);
+	acs_log_deinit(iface);
+	hostapd_atf_deinit(iface);
+	ap_sta_pool_deinit(iface);
 	hostapd_config_free(iface->conf);
 	iface->conf = NULL;
 
@@ -1255,6 +1267,8 @@ int hostapd_setup_bss(struct hostapd_data *hapd, int first)
 	u8 if_addr[ETH_ALEN] = {0};
 	int flush_old_stations = 1;
 
+	sta_admit_config(hapd->iface);
+
 	/*
 	 * when mem_only_cred configuration is set we will halt init of bss and request
 	 * credentials from the UI
@@ -2803,6 +2817,7 @@ hostapd_alloc_bss_data(struct hostapd_iface *hapd_iface,
 		hapd->driver = conf->driver;
 	hapd->ctrl_sock = -1;
 	dl_list_init(&hapd->ctrl_dst);
+	dl_list_init(&hapd->ctrl_paged);
 	dl_list_init(&hapd->nr_db);
 	dl_list_init(&hapd->multi_ap_blacklist);
 	dl_list_init(&hapd->auth_fail_list);
@@ -3729,6 +3744,8 @@ static int hostapd_remove_bss(struct hostapd_iface *iface, unsigned int idx)
 	for (i = idx; i < iface->conf->num_bss; i++)
 		iface->conf->bss[i] = iface->conf->bss[i + 1];
 
+	sta_admit_config(iface);
+
 	return 0;
 }
 
@@ -3794,6 +3811,7 @@ void hostapd_new_assoc_sta(struct hostapd_data *hapd, struct sta_info *sta,
 
 	hostapd_prune_associations(hapd, sta->addr);
 	ap_sta_clear_disconnect_timeouts(hapd, sta);
+	sta_lat_event(hapd, sta, STA_LAT_ASSOC);
 
 	/* IEEE 802.11F (IAPP) */
 	if (hapd->conf->ieee802_11f)
@@ -12,6 +12,8 @@
 #include "common/defs.h"
 #include "utils/list.h"
 #include "ap_config.h"
+#include "sta_admit.h"
+#include "sta_latency.h"
 #include "drivers/driver.h"
 
 #define OCE_STA_CFON_ENABLED(hapd) \
@@ -44,6 +46,7 @@ struct radius_server_data;
 struct upnp_wps_device_sm;
 struct hostapd_data;
 struct sta_info;
+struct sta_pool_slab;
 struct ieee80211_ht_capabilities;
 struct full_dynamic_vlan;
 enum wps_event;
@@ -149,6 +152,23 @@ struct hostapd_neighbor_entry {
 	int stationary;
 };
 
+/*
+ * Bitfield for indicating which AIDs are allocated. Only AID values 1-2007
+ * are used and as such, the bit at index 0 corresponds to AID 1. Bit n of
+ * full is set when words[n] has no free AID left, so the lowest free AID is
+ * found with two find-first-zero operations.
+ */
+#define AID_WORDS ((2008 + 31) / 32)
+struct hostapd_aid_map {
+	u32 words[AID_WORDS];
+	u32 full[(AID_WORDS + 31) / 32];
+	u16 min_aid; /* lowest AID handed out; 0 = map not initialized */
+	unsigned int used;
+	unsigned int hwm; /* high-water mark of used */
+	unsigned int allocs;
+	unsigned int failures;
+};
+
 struct hostapd_sae_commit_queue {
 	struct dl_list list;
 	int rssi;
@@ -173,17 +193,21 @@ struct hostapd_data {
 
 	int num_sta; /* number of entries in sta_list */
 	struct sta_info *sta_list; /* STA info list head */
+	unsigned int sta_flush_batch:1; /* driver entries already flushed */
+	unsigned int sta_flush_set_beacon:1; /* beacon update deferred */
+	unsigned int sta_flush_last_num; /* STAs removed by last flush */
+	unsigned int sta_flush_last_usec; /* duration of last flush */
+	unsigned int sta_admit_rejected; /* new STAs refused by sta_admit */
+	struct sta_lat_stats sta_lat; /* STA onboarding latency histograms */
+	int atf_active_sta; /* STAs holding an ATF quota */
+	int atf_listed_grant; /* Sum of configured grants of those STAs */
+	struct atf_vap_config *atf_vap_cfg; /* ATF config resolved for this BSS */
+	unsigned int atf_cfg_gen; /* atf_cfg generation atf_vap_cfg belongs to */
 #define STA_HASH_SIZE 256
 #define STA_HASH(sta) (sta[5])
 	struct sta_info *sta_hash[STA_HASH_SIZE];
 
-	/*
-	 * Bitfield for indicating which AIDs are allocated. Only AID values
-	 * 1-2007 are used and as such, the bit at index 0 corresponds to AID
-	 * 1.
-	 */
-#define AID_WORDS ((2008 + 31) / 32)
-	u32 sta_aid[AID_WORDS];
+	struct hostapd_aid_map aid_map; /* AIDs of this BSS (no MBSSID) */
 
 	const struct wpa_driver_ops *driver;
 	void *drv_priv;
@@ -213,6 +237,8 @@ struct hostapd_data {
 
 	int ctrl_sock;
 	struct dl_list ctrl_dst;
+	struct dl_list ctrl_paged; /* struct ctrl_iface_paged_reply */
+	unsigned int ctrl_paged_id;
 
 	void *ssl_ctx;
 	void *eap_sim_db_priv;
@@ -264,6 +290,10 @@ struct hostapd_data {
 	void (*public_action_cb2)(void *ctx, const u8 *buf, size_t len,
 				  int freq);
 	void *public_action_cb2_ctx;
+	struct gas_peer_table *gas_peers; /* GAS state of unassociated peers */
+	struct gas_anqp_cache *anqp_cache; /* serialized ANQP elements */
+	unsigned int anqp_cache_hits;
+	unsigned int anqp_cache_misses;
 
 	int (*vendor_action_cb)(void *ctx, const u8 *buf, size_t len,
 				int freq);
@@ -329,6 +359,7 @@ struct hostapd_data {
 
 #ifdef CONFIG_SQLITE
 	struct hostapd_eap_user tmp_eap_user;
+	struct eap_user_sqlite *eap_user_sqlite; /* open eap_user_file DB */
 #endif /* CONFIG_SQLITE */
 
 #ifdef CONFIG_SAE
@@ -514,6 +545,19 @@ struct hostapd_iface {
 	struct ap_info *ap_list; /* AP info list head */
 	struct ap_info *ap_hash[STA_HASH_SIZE];
 
+	int num_sta; /* number of STAs over all BSSs of this radio */
+	struct sta_info *sta_hash[STA_HASH_SIZE]; /* STAs of all BSSs */
+	struct sta_admit admit; /* admission counters, see sta_admit.c */
+	struct hostapd_aid_map aid_map; /* AIDs shared by MBSSID BSSs */
+
+	/* struct sta_info pool, grown in slabs up to ap_max_num_sta entries */
+	struct sta_pool_slab *sta_pool_slabs;
+	struct sta_info *sta_pool_free; /* unused entries linked via next */
+	unsigned int sta_pool_size; /* entries in sta_pool_slabs */
+	unsigned int sta_pool_used;
+	unsigned int sta_pool_hwm; /* high-water mark of sta_pool_used */
+	unsigned int sta_pool_fallback; /* entries taken from the heap */
+
 	u64 drv_flags;
 
 	/* SMPS modes supported by the driver (WPA_DRIVER_SMPS_MODE_*) */
@@ -610,6 +654,7 @@ struct hostapd_iface {
 	u32 min_noise;
 	u32 acs_num_bss; /* over the whole band */
 	u32 max_tx_power; /* over the whole band */
+	struct acs_log *acs_log;
 #endif /* CONFIG_ACS */
 
 	void (*scan_cb)(struct hostapd_iface *iface);
@@ -630,6 +675,9 @@ struct hostapd_iface {
 	int atf_enabled; /* If ATF is currently enabled in FW */
 	u32 atf_sta_in_driver[2048 / 32]; /* One bit per aid */
 	u32 atf_sta_has_quota[2048 / 32]; /* One bit per aid */
+	u16 atf_sent_grant[ATF_MAX_SID]; /* Grants last sent to FW, per SID */
+	int atf_sent_valid; /* atf_sent_grant matches FW state */
+	unsigned int atf_pending_changes; /* STA changes not yet sent */
 
 	int block_tx; /* Is TX block on or off */
 	int sb_dfs_cntr;
@@ -725,6 +773,7 @@ void hostapd_acs_channel_selected(struct hostapd_data *hapd,
 const struct hostapd_eap_user *
 hostapd_get_eap_user(struct hostapd_data *hapd, const u8 *identity,
 		     size_t identity_len, int phase2);
+void eap_user_sqlite_deinit(struct hostapd_data *hapd);
 
 struct hostapd_data * hostapd_get_iface(struct hapd_interfaces *interfaces,
 					const char *ifname);
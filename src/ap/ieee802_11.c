@@ -1039,7 +1039,7 @@ static void handle_auth_sae(struct hostapd_data *hapd, struct sta_info *sta,
 			resp = -1;
 			goto remove_sta;
 		}
-		sta->sae = os_zalloc(sizeof(*sta->sae));
+		sta->sae = ap_sta_sae_alloc(sta);
 		if (!sta->sae) {
 			resp = -1;
 			goto remove_sta;
@@ -2550,34 +2550,132 @@ static void handle_auth(struct hostapd_data *hapd,
 
 static void ap_sta_remove_in_other_bss_now(struct hostapd_data *hapd, struct sta_info *sta)
 {
-	struct hostapd_iface *iface = hapd->iface;
-	size_t i;
-
-	for (i = 0; i < iface->num_bss; i++) {
-		struct hostapd_data *bss = iface->bss[i];
-		struct sta_info *sta2;
-		/* bss should always be set during operation, but it may be
-		 * NULL during reconfiguration. Assume the STA is not
-		 * associated to another BSS in that case to avoid NULL pointer
-		 * dereferences. */
-		if (bss == hapd || bss == NULL)
-			continue;
-
-		sta2 = ap_get_sta(bss, sta->addr);
-		if (!sta2)
-			continue;
+	struct sta_info *sta2, *next;
 
+	for (sta2 = ap_get_sta_other_bss(hapd, sta->addr, NULL); sta2;
+	     sta2 = next) {
+		next = ap_get_sta_other_bss(hapd, sta->addr, sta2);
 		wpa_printf(MSG_DEBUG, "Removing station " MACSTR
 				   " with AID=%d from kernel driver.", MAC2STR(sta2->addr), sta2->aid);
 
-		ap_free_sta(bss, sta2);
+		ap_free_sta(sta2->bss, sta2);
+	}
+}
+
+static int aid_first_zero(u32 word)
+{
+#ifdef __GNUC__
+	return __builtin_ctz(~word);
+#else /* __GNUC__ */
+	int i;
+
+	for (i = 0; word & BIT(i); i++)
+		;
+	return i;
+#endif /* __GNUC__ */
+}
+
+
+static void aid_map_set(struct hostapd_aid_map *map, int aid)
+{
+	int w = (aid - 1) / 32;
+
+	map->words[w] |= BIT((aid - 1) % 32);
+	if (map->words[w] == (u32) -1)
+		map->full[w / 32] |= BIT(w % 32);
+}
+
+
+static void aid_map_init(struct hostapd_aid_map *map, u16 min_aid)
+{
+	int aid;
+
+	os_memset(map->words, 0, sizeof(map->words));
+	os_memset(map->full, 0, sizeof(map->full));
+	map->min_aid = min_aid;
+
+	/* Reserved AIDs and the tail of the last word are never handed out */
+	for (aid = 1; aid < min_aid; aid++)
+		aid_map_set(map, aid);
+	for (aid = 2008; aid <= AID_WORDS * 32; aid++)
+		aid_map_set(map, aid);
+	for (aid = AID_WORDS; aid < (int) ARRAY_SIZE(map->full) * 32; aid++)
+		map->full[aid / 32] |= BIT(aid % 32);
+}
+
+
+/*
+ * With multibss_enable all BSSs of the radio share one AID space above the
+ * AIDs reserved for the BSSID indexes; otherwise each BSS has its own.
+ */
+static struct hostapd_aid_map * hostapd_aid_map(struct hostapd_data *hapd,
+						int shared)
+{
+	struct hostapd_aid_map *map;
+	u16 min_aid = 1;
+
+	if (shared) {
+		map = &hapd->iface->aid_map;
+		min_aid += hapd->iconf->mbssid_aid_offset;
+	} else {
+		map = &hapd->aid_map;
+	}
+
+	if (map->min_aid != min_aid && map->used == 0)
+		aid_map_init(map, min_aid);
+	return map;
+}
+
+
+static int aid_map_alloc(struct hostapd_aid_map *map)
+{
+	size_t i;
+	int w, b;
+
+	for (i = 0; i < ARRAY_SIZE(map->full); i++) {
+		if (map->full[i] != (u32) -1)
+			break;
+	}
+	if (i == ARRAY_SIZE(map->full)) {
+		map->failures++;
+		return -1;
 	}
+
+	w = i * 32 + aid_first_zero(map->full[i]);
+	b = aid_first_zero(map->words[w]);
+	map->used++;
+	if (map->used > map->hwm)
+		map->hwm = map->used;
+	map->allocs++;
+
+	aid_map_set(map, w * 32 + b + 1);
+	return w * 32 + b + 1;
 }
 
+
+void hostapd_free_aid(struct hostapd_data *hapd, struct sta_info *sta)
+{
+	struct hostapd_aid_map *map;
+	int w;
+
+	map = sta->aid_shared ? &hapd->iface->aid_map : &hapd->aid_map;
+	if (sta->aid < map->min_aid || sta->aid > 2007)
+		return;
+
+	w = (sta->aid - 1) / 32;
+	if (!(map->words[w] & BIT((sta->aid - 1) % 32)))
+		return;
+	map->words[w] &= ~BIT((sta->aid - 1) % 32);
+	map->full[w / 32] &= ~BIT(w % 32);
+	map->used--;
+}
+
+
 int hostapd_get_aid(struct hostapd_data *hapd, struct sta_info *sta)
 {
-	int i, j = 32, aid;
-  int res;
+	struct hostapd_aid_map *map;
+	int aid;
+	int res;
 
 	if (hapd->driver->get_aid) {
 		ap_sta_remove_in_other_bss_now(hapd, sta);
@@ -2600,24 +2698,13 @@ int hostapd_get_aid(struct hostapd_data *hapd, struct sta_info *sta)
 	if (TEST_FAIL())
 		return -1;
 
-	for (i = 0; i < AID_WORDS; i++) {
-		if (hapd->sta_aid[i] == (u32) -1)
-			continue;
-		for (j = 0; j < 32; j++) {
-			if (!(hapd->sta_aid[i] & BIT(j)))
-				break;
-		}
-		if (j < 32)
-			break;
-	}
-	if (j == 32)
-		return -1;
-	aid = i * 32 + j + 1;
-	if (aid > 2007)
+	map = hostapd_aid_map(hapd, hapd->iconf->multibss_enable);
+	aid = aid_map_alloc(map);
+	if (aid < 0)
 		return -1;
 
 	sta->aid = aid;
-	hapd->sta_aid[i] |= BIT(j);
+	sta->aid_shared = !!hapd->iconf->multibss_enable;
 	wpa_printf(MSG_DEBUG, "  new AID %d", sta->aid);
 	return 0;
 }
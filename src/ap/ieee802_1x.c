@@ -758,6 +758,7 @@ void ieee802_1x_encapsulate_radius(struct hostapd_data *hapd,
 
 	if (radius_client_send(hapd->radius, msg, RADIUS_AUTH, sta->addr) < 0)
 		goto fail;
+	sta_lat_radius_tx(sta);
 
 	return;
 
@@ -1846,6 +1847,7 @@ ieee802_1x_receive_auth(struct radius_msg *msg, struct radius_msg *req,
 	}
 
 	sm->radius_identifier = -1;
+	sta_lat_radius_rx(hapd, sta);
 	wpa_printf(MSG_DEBUG, "RADIUS packet matching with station " MACSTR,
 		   MAC2STR(sta->addr));
 
@@ -2136,10 +2138,13 @@ static void _ieee802_1x_finished(void *ctx, void *sta_ctx, int success,
 {
 	struct hostapd_data *hapd = ctx;
 	struct sta_info *sta = sta_ctx;
-	if (preauth)
+	if (preauth) {
 		rsn_preauth_finished(hapd, sta, success);
-	else
+	} else {
+		if (success)
+			sta_lat_event(hapd, sta, STA_LAT_EAP);
 		ieee802_1x_finished(hapd, sta, success, remediation);
+	}
 }
 
 
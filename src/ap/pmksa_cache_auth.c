@@ -22,9 +22,12 @@ static const int pmksa_cache_max_entries = 1024;
 static const int dot11RSNAConfigPMKLifetime = 43200;
 
 struct rsn_pmksa_cache {
-#define PMKID_HASH_SIZE 128
-#define PMKID_HASH(pmkid) (unsigned int) ((pmkid)[0] & 0x7f)
+#define PMKID_HASH_SIZE 1024
+#define PMKID_HASH(pmkid) pmksa_cache_hash((pmkid), PMKID_LEN, PMKID_HASH_SIZE)
 	struct rsn_pmksa_cache_entry *pmkid[PMKID_HASH_SIZE];
+#define SPA_HASH_SIZE 256
+#define SPA_HASH(spa) pmksa_cache_hash((spa), ETH_ALEN, SPA_HASH_SIZE)
+	struct rsn_pmksa_cache_entry *spa[SPA_HASH_SIZE]; /* by expiration */
 	struct rsn_pmksa_cache_entry *pmksa;
 	int pmksa_count;
 
@@ -36,6 +39,18 @@ struct rsn_pmksa_cache {
 static void pmksa_cache_set_expiration(struct rsn_pmksa_cache *pmksa);
 
 
+static unsigned int pmksa_cache_hash(const u8 *key, size_t len,
+				     unsigned int size)
+{
+	unsigned int hash = 0;
+
+	while (len--)
+		hash = hash * 31 + *key++;
+
+	return hash % size;
+}
+
+
 static void _pmksa_cache_free_entry(struct rsn_pmksa_cache_entry *entry)
 {
 	os_free(entry->vlan_desc);
@@ -73,6 +88,22 @@ void pmksa_cache_free_entry(struct rsn_pmksa_cache *pmksa,
 		pos = pos->hnext;
 	}
 
+	/* unlink from SPA hash list */
+	hash = SPA_HASH(entry->spa);
+	pos = pmksa->spa[hash];
+	prev = NULL;
+	while (pos) {
+		if (pos == entry) {
+			if (prev != NULL)
+				prev->shnext = entry->shnext;
+			else
+				pmksa->spa[hash] = entry->shnext;
+			break;
+		}
+		prev = pos;
+		pos = pos->shnext;
+	}
+
 	/* unlink from entry list */
 	pos = pmksa->pmksa;
 	prev = NULL;
@@ -222,7 +253,7 @@ void pmksa_cache_to_eapol_data(struct hostapd_data *hapd,
 static void pmksa_cache_link_entry(struct rsn_pmksa_cache *pmksa,
 				   struct rsn_pmksa_cache_entry *entry)
 {
-	struct rsn_pmksa_cache_entry *pos, *prev;
+	struct rsn_pmksa_cache_entry *pos, *prev, **spos;
 	int hash;
 
 	/* Add the new entry; order by expiration time */
@@ -246,6 +277,15 @@ static void pmksa_cache_link_entry(struct rsn_pmksa_cache *pmksa,
 	entry->hnext = pmksa->pmkid[hash];
 	pmksa->pmkid[hash] = entry;
 
+	/* Keep the SPA hash list in the same order as the entry list */
+	for (spos = &pmksa->spa[SPA_HASH(entry->spa)]; *spos;
+	     spos = &(*spos)->shnext) {
+		if ((*spos)->expiration > entry->expiration)
+			break;
+	}
+	entry->shnext = *spos;
+	*spos = entry;
+
 	pmksa->pmksa_count++;
 	if (prev == NULL)
 		pmksa_cache_set_expiration(pmksa);
@@ -459,6 +499,8 @@ void pmksa_cache_auth_deinit(struct rsn_pmksa_cache *pmksa)
 	pmksa->pmksa = NULL;
 	for (i = 0; i < PMKID_HASH_SIZE; i++)
 		pmksa->pmkid[i] = NULL;
+	for (i = 0; i < SPA_HASH_SIZE; i++)
+		pmksa->spa[i] = NULL;
 	os_free(pmksa);
 }
 
@@ -484,18 +526,43 @@ pmksa_cache_auth_get(struct rsn_pmksa_cache *pmksa,
 			    os_memcmp(entry->pmkid, pmkid, PMKID_LEN) == 0)
 				return entry;
 		}
-	} else {
-		for (entry = pmksa->pmksa; entry; entry = entry->next) {
-			if (spa == NULL ||
-			    os_memcmp(entry->spa, spa, ETH_ALEN) == 0)
+	} else if (spa) {
+		for (entry = pmksa->spa[SPA_HASH(spa)]; entry;
+		     entry = entry->shnext) {
+			if (os_memcmp(entry->spa, spa, ETH_ALEN) == 0)
 				return entry;
 		}
+	} else {
+		return pmksa->pmksa;
 	}
 
 	return NULL;
 }
 
 
+/* PMKID the entry would have for the given AA; derived once per AA and kept
+ * with the entry since OKC asks for the same local BSSIDs over and over. */
+static const u8 * pmksa_cache_okc_pmkid(struct rsn_pmksa_cache_entry *entry,
+					const u8 *aa)
+{
+	unsigned int i, n;
+
+	n = entry->okc_memo_count < PMKSA_OKC_MEMO_SIZE ?
+		entry->okc_memo_count : PMKSA_OKC_MEMO_SIZE;
+	for (i = 0; i < n; i++) {
+		if (os_memcmp(entry->okc_memo[i].aa, aa, ETH_ALEN) == 0)
+			return entry->okc_memo[i].pmkid;
+	}
+
+	/* Replace the oldest one when all slots are taken */
+	i = entry->okc_memo_count++ % PMKSA_OKC_MEMO_SIZE;
+	os_memcpy(entry->okc_memo[i].aa, aa, ETH_ALEN);
+	rsn_pmkid(entry->pmk, entry->pmk_len, aa, entry->spa,
+		  entry->okc_memo[i].pmkid, entry->akmp);
+	return entry->okc_memo[i].pmkid;
+}
+
+
 /**
  * pmksa_cache_get_okc - Fetch a PMKSA cache entry using OKC
  * @pmksa: Pointer to PMKSA cache data from pmksa_cache_auth_init()
@@ -511,14 +578,13 @@ struct rsn_pmksa_cache_entry * pmksa_cache_get_okc(
 	const u8 *pmkid)
 {
 	struct rsn_pmksa_cache_entry *entry;
-	u8 new_pmkid[PMKID_LEN];
 
-	for (entry = pmksa->pmksa; entry; entry = entry->next) {
+	for (entry = pmksa->spa[SPA_HASH(spa)]; entry;
+	     entry = entry->shnext) {
 		if (os_memcmp(entry->spa, spa, ETH_ALEN) != 0)
 			continue;
-		rsn_pmkid(entry->pmk, entry->pmk_len, aa, spa, new_pmkid,
-			  entry->akmp);
-		if (os_memcmp(new_pmkid, pmkid, PMKID_LEN) == 0)
+		if (os_memcmp(pmksa_cache_okc_pmkid(entry, aa), pmkid,
+			      PMKID_LEN) == 0)
 			return entry;
 	}
 	return NULL;
@@ -727,3 +793,240 @@ int pmksa_cache_auth_list_mesh(struct rsn_pmksa_cache *pmksa, const u8 *addr,
 
 #endif /* CONFIG_MESH */
 #endif /* CONFIG_PMKSA_CACHE_EXTERNAL */
+
+
+/*
+ * Cache snapshot encoding, shared with the FT PMK-R0/R1 caches. Expiration
+ * times are stored as absolute wall clock seconds (0 = no expiration) so that
+ * they remain meaningful after a restart.
+ */
+
+u64 pmksa_cache_snapshot_expiry(os_time_t expiration)
+{
+	struct os_reltime now;
+	struct os_time wall;
+
+	if (!expiration)
+		return 0;
+	os_get_reltime(&now);
+	os_get_time(&wall);
+	if (expiration <= now.sec)
+		return wall.sec;
+	return wall.sec + (expiration - now.sec);
+}
+
+
+int pmksa_cache_snapshot_remaining(u64 expiry)
+{
+	struct os_time wall;
+
+	if (!expiry)
+		return 0;
+	os_get_time(&wall);
+	if (expiry <= (u64) wall.sec)
+		return -1;
+	if (expiry - wall.sec > 0x7fffffff)
+		return 0x7fffffff;
+	return expiry - wall.sec;
+}
+
+
+void pmksa_cache_snapshot_put_blob(struct wpabuf *buf, const u8 *data,
+				   size_t len)
+{
+	wpabuf_put_be16(buf, len);
+	if (len)
+		wpabuf_put_data(buf, data, len);
+}
+
+
+const u8 * pmksa_cache_snapshot_get_blob(const u8 **pos, const u8 *end,
+					 size_t *len)
+{
+	const u8 *data;
+
+	if (end - *pos < 2)
+		return NULL;
+	*len = WPA_GET_BE16(*pos);
+	if ((size_t) (end - *pos) - 2 < *len)
+		return NULL;
+	data = *pos + 2;
+	*pos += 2 + *len;
+	return data;
+}
+
+
+void pmksa_cache_snapshot_put_vlan(struct wpabuf *buf,
+				   const struct vlan_description *vlan)
+{
+	int i, num = 0;
+
+	if (!vlan || !vlan->notempty) {
+		wpabuf_put_u8(buf, 0);
+		return;
+	}
+	while (num < MAX_NUM_TAGGED_VLAN && vlan->tagged[num])
+		num++;
+	wpabuf_put_u8(buf, 1 + num);
+	wpabuf_put_be32(buf, vlan->untagged);
+	for (i = 0; i < num; i++)
+		wpabuf_put_be32(buf, vlan->tagged[i]);
+}
+
+
+int pmksa_cache_snapshot_get_vlan(const u8 **pos, const u8 *end,
+				  struct vlan_description *vlan)
+{
+	int i, num;
+
+	os_memset(vlan, 0, sizeof(*vlan));
+	if (end - *pos < 1)
+		return -1;
+	num = *(*pos)++;
+	if (num == 0)
+		return 0;
+	if (num - 1 > MAX_NUM_TAGGED_VLAN || end - *pos < 4 * num)
+		return -1;
+	vlan->notempty = 1;
+	vlan->untagged = WPA_GET_BE32(*pos);
+	*pos += 4;
+	for (i = 0; i < num - 1; i++) {
+		vlan->tagged[i] = WPA_GET_BE32(*pos);
+		*pos += 4;
+	}
+	return 0;
+}
+
+
+/*
+ * Entry format:
+ * SPA(6) PMKID(16) AKMP(4) expiration(8) opportunistic(1) EAP type(1)
+ * Acct-Multi-Session-Id(8) PMK identity CUI VLAN
+ */
+#define PMKSA_SNAPSHOT_FIXED_LEN (ETH_ALEN + PMKID_LEN + 4 + 8 + 1 + 1 + 8)
+#define PMKSA_SNAPSHOT_VLAN_LEN (1 + 4 + 4 * MAX_NUM_TAGGED_VLAN)
+
+/**
+ * pmksa_cache_auth_export - Serialize PMKSA cache entries for a snapshot
+ * @pmksa: Pointer to PMKSA cache data from pmksa_cache_auth_init()
+ * Returns: Buffer with the entries (to be freed with wpabuf_clear_free()) or
+ * %NULL on failure
+ */
+struct wpabuf * pmksa_cache_auth_export(struct rsn_pmksa_cache *pmksa)
+{
+	struct rsn_pmksa_cache_entry *entry;
+	struct wpabuf *buf;
+	size_t len = 0;
+
+	for (entry = pmksa->pmksa; entry; entry = entry->next)
+		len += PMKSA_SNAPSHOT_FIXED_LEN + 3 * 2 + entry->pmk_len +
+			entry->identity_len +
+			(entry->cui ? wpabuf_len(entry->cui) : 0) +
+			PMKSA_SNAPSHOT_VLAN_LEN;
+
+	buf = wpabuf_alloc(len);
+	if (!buf)
+		return NULL;
+
+	for (entry = pmksa->pmksa; entry; entry = entry->next) {
+		wpabuf_put_data(buf, entry->spa, ETH_ALEN);
+		wpabuf_put_data(buf, entry->pmkid, PMKID_LEN);
+		wpabuf_put_be32(buf, entry->akmp);
+		wpabuf_put_be64(buf,
+				pmksa_cache_snapshot_expiry(entry->expiration));
+		wpabuf_put_u8(buf, entry->opportunistic);
+		wpabuf_put_u8(buf, entry->eap_type_authsrv);
+		wpabuf_put_be64(buf, entry->acct_multi_session_id);
+		pmksa_cache_snapshot_put_blob(buf, entry->pmk, entry->pmk_len);
+		pmksa_cache_snapshot_put_blob(buf, entry->identity,
+					      entry->identity_len);
+		pmksa_cache_snapshot_put_blob(
+			buf, entry->cui ? wpabuf_head(entry->cui) : NULL,
+			entry->cui ? wpabuf_len(entry->cui) : 0);
+		pmksa_cache_snapshot_put_vlan(buf, entry->vlan_desc);
+	}
+
+	return buf;
+}
+
+
+/**
+ * pmksa_cache_auth_import - Add PMKSA cache entries from a snapshot
+ * @pmksa: Pointer to PMKSA cache data from pmksa_cache_auth_init()
+ * @data: Entries from pmksa_cache_auth_export()
+ * @len: Length of data
+ * Returns: Number of entries added or -1 if the data is malformed
+ *
+ * Entries that have expired since the snapshot was taken are skipped.
+ */
+int pmksa_cache_auth_import(struct rsn_pmksa_cache *pmksa, const u8 *data,
+			    size_t len)
+{
+	struct rsn_pmksa_cache_entry *entry;
+	const u8 *pos = data, *end = data + len, *pmk, *identity, *cui;
+	size_t pmk_len, identity_len, cui_len;
+	struct vlan_description vlan;
+	struct os_reltime now;
+	int remaining, count = 0;
+
+	os_get_reltime(&now);
+
+	while (end - pos > 0) {
+		if (end - pos < PMKSA_SNAPSHOT_FIXED_LEN)
+			return -1;
+		entry = os_zalloc(sizeof(*entry));
+		if (!entry)
+			return -1;
+		os_memcpy(entry->spa, pos, ETH_ALEN);
+		pos += ETH_ALEN;
+		os_memcpy(entry->pmkid, pos, PMKID_LEN);
+		pos += PMKID_LEN;
+		entry->akmp = WPA_GET_BE32(pos);
+		pos += 4;
+		remaining = pmksa_cache_snapshot_remaining(WPA_GET_BE64(pos));
+		pos += 8;
+		entry->opportunistic = *pos++;
+		entry->eap_type_authsrv = *pos++;
+		entry->acct_multi_session_id = WPA_GET_BE64(pos);
+		pos += 8;
+
+		pmk = pmksa_cache_snapshot_get_blob(&pos, end, &pmk_len);
+		identity = pmksa_cache_snapshot_get_blob(&pos, end,
+							 &identity_len);
+		cui = pmksa_cache_snapshot_get_blob(&pos, end, &cui_len);
+		if (!pmk || !identity || !cui || pmk_len > PMK_LEN_MAX ||
+		    pmksa_cache_snapshot_get_vlan(&pos, end, &vlan) < 0) {
+			bin_clear_free(entry, sizeof(*entry));
+			return -1;
+		}
+
+		if (remaining <= 0 ||
+		    pmksa->pmksa_count >= pmksa_cache_max_entries) {
+			bin_clear_free(entry, sizeof(*entry));
+			continue;
+		}
+
+		os_memcpy(entry->pmk, pmk, pmk_len);
+		entry->pmk_len = pmk_len;
+		entry->expiration = now.sec + remaining;
+		if (identity_len) {
+			entry->identity = os_memdup(identity, identity_len);
+			if (entry->identity)
+				entry->identity_len = identity_len;
+		}
+		if (cui_len)
+			entry->cui = wpabuf_alloc_copy(cui, cui_len);
+		if (vlan.notempty) {
+			entry->vlan_desc = os_memdup(&vlan, sizeof(vlan));
+			if (!entry->vlan_desc) {
+				_pmksa_cache_free_entry(entry);
+				continue;
+			}
+		}
+
+		pmksa_cache_link_entry(pmksa, entry);
+		count++;
+	}
+
+	return count;
+}
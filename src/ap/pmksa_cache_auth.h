@@ -11,11 +11,13 @@
 
 #include "radius/radius.h"
 
+#define PMKSA_OKC_MEMO_SIZE 4
+
 /**
  * struct rsn_pmksa_cache_entry - PMKSA cache entry
  */
 struct rsn_pmksa_cache_entry {
-	struct rsn_pmksa_cache_entry *next, *hnext;
+	struct rsn_pmksa_cache_entry *next, *hnext, *shnext;
 	u8 pmkid[PMKID_LEN];
 	u8 pmk[PMK_LEN_MAX];
 	size_t pmk_len;
@@ -32,6 +34,13 @@ struct rsn_pmksa_cache_entry {
 	int opportunistic;
 
 	u64 acct_multi_session_id;
+
+	/* PMKIDs derived for OKC, one per local BSSID (AA) it was asked for */
+	struct {
+		u8 aa[ETH_ALEN];
+		u8 pmkid[PMKID_LEN];
+	} okc_memo[PMKSA_OKC_MEMO_SIZE];
+	unsigned int okc_memo_count;
 };
 
 struct rsn_pmksa_cache;
@@ -75,5 +84,19 @@ int pmksa_cache_auth_list(struct rsn_pmksa_cache *pmksa, char *buf, size_t len);
 void pmksa_cache_auth_flush(struct rsn_pmksa_cache *pmksa);
 int pmksa_cache_auth_list_mesh(struct rsn_pmksa_cache *pmksa, const u8 *addr,
 			       char *buf, size_t len);
+struct wpabuf * pmksa_cache_auth_export(struct rsn_pmksa_cache *pmksa);
+int pmksa_cache_auth_import(struct rsn_pmksa_cache *pmksa, const u8 *data,
+			    size_t len);
+
+u64 pmksa_cache_snapshot_expiry(os_time_t expiration);
+int pmksa_cache_snapshot_remaining(u64 expiry);
+void pmksa_cache_snapshot_put_blob(struct wpabuf *buf, const u8 *data,
+				   size_t len);
+const u8 * pmksa_cache_snapshot_get_blob(const u8 **pos, const u8 *end,
+					 size_t *len);
+void pmksa_cache_snapshot_put_vlan(struct wpabuf *buf,
+				   const struct vlan_description *vlan);
+int pmksa_cache_snapshot_get_vlan(const u8 **pos, const u8 *end,
+				  struct vlan_description *vlan);
 
 #endif /* PMKSA_CACHE_H */
@@ -0,0 +1,164 @@
+/*
+ * hostapd / Station admission control
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "hostapd.h"
+#include "atf.h"
+#include "sta_admit.h"
+
+
+static const char * const sta_admit_txt[NUM_STA_ADMIT_RESULT] = {
+	"ok", "bss_full", "reserved", "radio_full", "priority", "atf"
+};
+
+
+/**
+ * sta_admit_config - Update the admission state after a configuration change
+ * @iface: Pointer to interface data
+ *
+ * The per-radio sums over the BSS configurations are kept here so that
+ * sta_admit_check() does not need to walk the BSSs. This needs to be called
+ * whenever a BSS is added or removed, or num_res_sta or sta_admit_priority
+ * of a BSS may have changed.
+ */
+void sta_admit_config(struct hostapd_iface *iface)
+{
+	struct sta_admit *admit = &iface->admit;
+	size_t i;
+
+	admit->num_res_sta = 0;
+	admit->max_priority = 0;
+	for (i = 0; i < iface->num_bss; i++) {
+		struct hostapd_bss_config *conf;
+
+		if (!iface->bss[i] || !iface->bss[i]->conf)
+			continue;
+		conf = iface->bss[i]->conf;
+		admit->num_res_sta += conf->num_res_sta;
+		if (conf->sta_admit_priority > admit->max_priority)
+			admit->max_priority = conf->sta_admit_priority;
+	}
+}
+
+
+static enum sta_admit_result sta_admit_limits(struct hostapd_data *hapd)
+{
+	struct hostapd_iface *iface = hapd->iface;
+	struct sta_admit *admit = &iface->admit;
+	int limit;
+
+	if (hapd->conf->num_res_sta) {
+		/* Reserved STAs are set for this BSS */
+		if (hapd->num_sta >= hapd->conf->max_num_sta) {
+			/* FIX: might try to remove some old STAs first? */
+			wpa_printf(MSG_ERROR, "no more room for new STAs (%d/%d)",
+				   hapd->num_sta, hapd->conf->max_num_sta);
+			return STA_ADMIT_BSS_FULL;
+		}
+	} else {
+		limit = hapd->conf->max_num_sta - admit->num_res_sta;
+		if (hapd->num_sta >= limit) {
+			wpa_printf(MSG_ERROR, "no more room for new STAs, "
+				   "reserved STAs limit is reached for BSS(%d/%d)",
+				   hapd->num_sta, limit);
+			return STA_ADMIT_RESERVED;
+		}
+	}
+
+	if (iface->num_sta >= hapd->iconf->ap_max_num_sta) {
+		wpa_printf(MSG_ERROR, "no more room for new STAs, Radio limit reached (%d/%d)",
+			   iface->num_sta, hapd->iconf->ap_max_num_sta);
+		return STA_ADMIT_RADIO_FULL;
+	}
+
+	if (hapd->conf->sta_admit_priority < admit->max_priority) {
+		limit = hapd->iconf->ap_max_num_sta -
+			hapd->iconf->ap_sta_admit_headroom;
+		if (iface->num_sta >= limit) {
+			wpa_printf(MSG_DEBUG, "no more room for new STAs, "
+				   "radio headroom is kept for higher priority BSSs (%d/%d)",
+				   iface->num_sta, limit);
+			return STA_ADMIT_PRIORITY;
+		}
+	}
+
+	return STA_ADMIT_OK;
+}
+
+
+/**
+ * sta_admit_check - Check whether a new station can be added to a BSS
+ * @hapd: Pointer to BSS data
+ * @addr: Address of the new station
+ * Returns: STA_ADMIT_OK if the station may be added, or the reason of the
+ * rejection
+ *
+ * This is O(1) apart from the optional ATF check; the result is counted in
+ * the per-radio and per-BSS statistics.
+ */
+enum sta_admit_result sta_admit_check(struct hostapd_data *hapd,
+				      const u8 *addr)
+{
+	struct sta_admit *admit = &hapd->iface->admit;
+	enum sta_admit_result res;
+
+	res = sta_admit_limits(hapd);
+	if (res == STA_ADMIT_OK && hapd->iconf->atf_cfg.distr_type &&
+	    hostapd_atf_is_sta_allowed(hapd, addr) == 0) {
+		wpa_printf(MSG_INFO, "ATF: Configuration/capacity doesn't allow station "
+			   MACSTR " to connect", MAC2STR(addr));
+		res = STA_ADMIT_ATF;
+	}
+
+	if (res == STA_ADMIT_OK) {
+		admit->admitted++;
+	} else {
+		admit->rejected[res]++;
+		hapd->sta_admit_rejected++;
+	}
+
+	return res;
+}
+
+
+const char * sta_admit_result_txt(enum sta_admit_result res)
+{
+	if (res >= NUM_STA_ADMIT_RESULT)
+		return "unknown";
+	return sta_admit_txt[res];
+}
+
+
+int sta_admit_status(struct hostapd_iface *iface, char *buf, size_t buflen)
+{
+	struct sta_admit *admit = &iface->admit;
+	int ret, len = 0;
+	int i;
+
+	ret = os_snprintf(buf, buflen,
+			  "sta_admit_res_sta=%d\n"
+			  "sta_admit_max_priority=%d\n"
+			  "sta_admit_admitted=%u\n",
+			  admit->num_res_sta, admit->max_priority,
+			  admit->admitted);
+	if (os_snprintf_error(buflen, ret))
+		return 0;
+	len += ret;
+
+	for (i = STA_ADMIT_OK + 1; i < NUM_STA_ADMIT_RESULT; i++) {
+		ret = os_snprintf(buf + len, buflen - len,
+				  "sta_admit_reject_%s=%u\n",
+				  sta_admit_txt[i], admit->rejected[i]);
+		if (os_snprintf_error(buflen - len, ret))
+			return len;
+		len += ret;
+	}
+
+	return len;
+}
@@ -0,0 +1,38 @@
+/*
+ * hostapd / Station admission control
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef STA_ADMIT_H
+#define STA_ADMIT_H
+
+struct hostapd_data;
+struct hostapd_iface;
+
+enum sta_admit_result {
+	STA_ADMIT_OK,
+	STA_ADMIT_BSS_FULL, /* max_num_sta of a BSS with reserved STAs */
+	STA_ADMIT_RESERVED, /* unreserved share of max_num_sta used up */
+	STA_ADMIT_RADIO_FULL, /* ap_max_num_sta */
+	STA_ADMIT_PRIORITY, /* headroom kept for higher priority BSSs */
+	STA_ADMIT_ATF, /* ATF configuration/capacity */
+	NUM_STA_ADMIT_RESULT
+};
+
+/* Per-radio admission state, kept in struct hostapd_iface */
+struct sta_admit {
+	int num_res_sta; /* sum of num_res_sta over the BSSs */
+	int max_priority; /* highest sta_admit_priority over the BSSs */
+	unsigned int admitted;
+	unsigned int rejected[NUM_STA_ADMIT_RESULT];
+};
+
+void sta_admit_config(struct hostapd_iface *iface);
+enum sta_admit_result sta_admit_check(struct hostapd_data *hapd,
+				      const u8 *addr);
+const char * sta_admit_result_txt(enum sta_admit_result res);
+int sta_admit_status(struct hostapd_iface *iface, char *buf, size_t buflen);
+
+#endif /* STA_ADMIT_H */
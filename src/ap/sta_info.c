@@ -37,12 +37,14 @@
 #include "mbo_ap.h"
 #include "ndisc_snoop.h"
 #include "sta_info.h"
+#include "sta_admit.h"
 #ifdef CONFIG_WDS_WPA
 #include "rsn_supp/wpa.h"
 #endif
 #include "vlan.h"
 #include "wps_hostapd.h"
 
+#define STA_POOL_SLAB_SIZE	16
 #define STA_EVENT_MAX_BUF_LEN	1024
 #define STA_EXTRA_CAP_LEN	300
 #define UPPER_24G_FREQ_VALUE	2500
@@ -85,6 +87,146 @@ int ap_for_each_sta(struct hostapd_data *hapd,
 }
 
 
+/* Pooled sta_info with the per-station state that sta_info.c frees */
+struct sta_pool_entry {
+	struct sta_info sta; /* must be first */
+#ifdef CONFIG_SAE
+	struct sae_data sae;
+#endif /* CONFIG_SAE */
+#if defined(CONFIG_INTERWORKING) || defined(CONFIG_DPP)
+	struct gas_dialog_info gas_dialog[GAS_DIALOG_MAX];
+#endif /* CONFIG_INTERWORKING || CONFIG_DPP */
+};
+
+struct sta_pool_slab {
+	struct sta_pool_slab *next;
+	struct sta_pool_entry entry[STA_POOL_SLAB_SIZE];
+};
+
+
+static struct sta_info * ap_sta_pool_alloc(struct hostapd_iface *iface)
+{
+	struct sta_pool_slab *slab;
+	struct sta_info *sta;
+	int i;
+
+	if (!iface->sta_pool_free &&
+	    iface->sta_pool_size < (unsigned int) iface->conf->ap_max_num_sta) {
+		slab = os_malloc(sizeof(*slab));
+		if (slab) {
+			slab->next = iface->sta_pool_slabs;
+			iface->sta_pool_slabs = slab;
+			for (i = STA_POOL_SLAB_SIZE - 1; i >= 0; i--) {
+				slab->entry[i].sta.next = iface->sta_pool_free;
+				iface->sta_pool_free = &slab->entry[i].sta;
+			}
+			iface->sta_pool_size += STA_POOL_SLAB_SIZE;
+		}
+	}
+
+	sta = iface->sta_pool_free;
+	if (!sta) {
+		/* Pool exhausted (e.g., ap_max_num_sta raised at runtime) */
+		iface->sta_pool_fallback++;
+		return os_zalloc(sizeof(struct sta_info));
+	}
+
+	iface->sta_pool_free = sta->next;
+	os_memset(sta, 0, sizeof(*sta));
+	sta->pooled = 1;
+	iface->sta_pool_used++;
+	if (iface->sta_pool_used > iface->sta_pool_hwm)
+		iface->sta_pool_hwm = iface->sta_pool_used;
+	return sta;
+}
+
+
+static void ap_sta_pool_release(struct hostapd_iface *iface,
+				struct sta_info *sta)
+{
+	if (!sta->pooled) {
+		os_free(sta);
+		return;
+	}
+
+	sta->next = iface->sta_pool_free;
+	iface->sta_pool_free = sta;
+	iface->sta_pool_used--;
+}
+
+
+#ifdef CONFIG_SAE
+struct sae_data * ap_sta_sae_alloc(struct sta_info *sta)
+{
+	struct sae_data *sae;
+
+	if (!sta->pooled)
+		return os_zalloc(sizeof(struct sae_data));
+
+	sae = &((struct sta_pool_entry *) sta)->sae;
+	os_memset(sae, 0, sizeof(*sae));
+	return sae;
+}
+
+
+static void ap_sta_sae_free(struct sta_info *sta)
+{
+	sae_clear_data(sta->sae);
+	if (!sta->pooled)
+		os_free(sta->sae);
+	sta->sae = NULL;
+}
+#endif /* CONFIG_SAE */
+
+
+#if defined(CONFIG_INTERWORKING) || defined(CONFIG_DPP)
+struct gas_dialog_info * ap_sta_gas_dialog_alloc(struct sta_info *sta)
+{
+	struct gas_dialog_info *dialog;
+
+	if (!sta->pooled)
+		return os_calloc(GAS_DIALOG_MAX,
+				 sizeof(struct gas_dialog_info));
+
+	dialog = ((struct sta_pool_entry *) sta)->gas_dialog;
+	os_memset(dialog, 0, GAS_DIALOG_MAX * sizeof(*dialog));
+	return dialog;
+}
+
+
+void ap_sta_gas_dialog_free(struct sta_info *sta)
+{
+	if (!sta->pooled)
+		os_free(sta->gas_dialog);
+	sta->gas_dialog = NULL;
+}
+#endif /* CONFIG_INTERWORKING || CONFIG_DPP */
+
+
+void ap_sta_pool_deinit(struct hostapd_iface *iface)
+{
+	struct sta_pool_slab *slab, *prev;
+
+	if (iface->sta_pool_used) {
+		/* Leak the slabs rather than free entries still referenced */
+		wpa_printf(MSG_ERROR, "AP: %u STA entries still in use on pool deinit",
+			   iface->sta_pool_used);
+		return;
+	}
+
+	slab = iface->sta_pool_slabs;
+	while (slab) {
+		prev = slab;
+		slab = slab->next;
+		os_free(prev);
+	}
+	iface->sta_pool_slabs = NULL;
+	iface->sta_pool_free = NULL;
+	iface->sta_pool_size = 0;
+	iface->sta_pool_used = 0;
+}
+
+
 struct sta_info * ap_get_sta(struct hostapd_data *hapd, const u8 *sta)
 {
 	struct sta_info *s;
@@ -96,6 +238,30 @@ struct sta_info * ap_get_sta(struct hostapd_data *hapd, const u8 *sta)
 }
 
 
+/**
+ * ap_get_sta_other_bss - Find a STA entry with the same address on another BSS
+ * @hapd: BSS the caller is operating on
+ * @addr: STA address
+ * @prev: Previously returned entry or %NULL to start the search
+ * Returns: Next entry for @addr owned by a BSS other than @hapd on the same
+ * radio or %NULL if there are no more
+ *
+ * The entry owner is available in sta->bss. The next entry can be fetched
+ * before the current one is freed.
+ */
+struct sta_info * ap_get_sta_other_bss(struct hostapd_data *hapd,
+				       const u8 *addr, struct sta_info *prev)
+{
+	struct sta_info *s;
+
+	s = prev ? prev->iface_hnext : hapd->iface->sta_hash[STA_HASH(addr)];
+	while (s != NULL &&
+	       (s->bss == hapd || os_memcmp(s->addr, addr, ETH_ALEN) != 0))
+		s = s->iface_hnext;
+	return s;
+}
+
+
 #ifdef CONFIG_P2P
 struct sta_info * ap_get_sta_p2p(struct hostapd_data *hapd, const u8 *addr)
 {
@@ -142,8 +308,34 @@ static void ap_sta_list_del(struct hostapd_data *hapd, struct sta_info *sta)
 
 void ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta)
 {
+	struct hostapd_iface *iface = hapd->iface;
+
 	sta->hnext = hapd->sta_hash[STA_HASH(sta->addr)];
 	hapd->sta_hash[STA_HASH(sta->addr)] = sta;
+
+	sta->bss = hapd;
+	sta->iface_hnext = iface->sta_hash[STA_HASH(sta->addr)];
+	iface->sta_hash[STA_HASH(sta->addr)] = sta;
+	iface->num_sta++;
+}
+
+
+static void ap_sta_iface_hash_del(struct hostapd_data *hapd,
+				  struct sta_info *sta)
+{
+	struct hostapd_iface *iface = hapd->iface;
+	struct sta_info **pos;
+
+	for (pos = &iface->sta_hash[STA_HASH(sta->addr)]; *pos;
+	     pos = &(*pos)->iface_hnext) {
+		if (*pos == sta) {
+			*pos = sta->iface_hnext;
+			iface->num_sta--;
+			return;
+		}
+	}
+	wpa_printf(MSG_DEBUG, "AP: could not remove STA " MACSTR
+		   " from radio hash table", MAC2STR(sta->addr));
 }
 
 
@@ -175,6 +367,19 @@ void ap_sta_ip6addr_del(struct hostapd_data *hapd, struct sta_info *sta)
 }
 
 
+/*
+ * During hostapd_free_stas() the driver flush has already removed the
+ * stations of the BSS netdev; stations moved to AP_VLAN or WDS interfaces
+ * still need their own removal. Unlike sta_remove(), the flush leaves the
+ * bridge FDB entries in place, so those are removed per station.
+ */
+static int ap_sta_drv_flushed(struct hostapd_data *hapd, struct sta_info *sta)
+{
+	return hapd->sta_flush_batch && !sta->vlan_id && !sta->vlan_id_bound &&
+		!(sta->flags & WLAN_STA_WDS);
+}
+
+
 void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 {
 	int set_beacon = 0;
@@ -206,12 +411,16 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 #else
 	if (!(sta->flags & WLAN_STA_PREAUTH)) {
 #endif
-		if (!is_recovery)
+		if (!is_recovery && !ap_sta_drv_flushed(hapd, sta))
 			hostapd_drv_sta_remove(hapd, sta->addr);
+		else if (!is_recovery)
+			hostapd_drv_br_delete_fdb(hapd, sta->addr);
 		sta->added_unassoc = 0;
 	}
 
+	hostapd_atf_sta_freed(hapd, sta);
 	ap_sta_hash_del(hapd, sta);
+	ap_sta_iface_hash_del(hapd, sta);
 	ap_sta_list_del(hapd, sta);
 
 	if (sta->aid > 0) {
@@ -222,8 +431,7 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 			}
 		}
 		else
-			hapd->sta_aid[(sta->aid - 1) / 32]
-				&= ~BIT((sta->aid - 1) % 32);
+			hostapd_free_aid(hapd, sta);
 	}
 
 	hapd->num_sta--;
@@ -288,7 +496,8 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 #endif /* CONFIG_P2P */
 
 #if defined(NEED_AP_MLME) && defined(CONFIG_IEEE80211N)
-	if (hostapd_ht_operation_update(hapd->iface) > 0)
+	if (!hapd->sta_flush_batch &&
+	    hostapd_ht_operation_update(hapd->iface) > 0)
 		set_beacon++;
 #endif /* NEED_AP_MLME && CONFIG_IEEE80211N */
 
@@ -297,7 +506,9 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 		hapd->mesh_sta_free_cb(hapd, sta);
 #endif /* CONFIG_MESH */
 
-	if (set_beacon)
+	if (set_beacon && hapd->sta_flush_batch)
+		hapd->sta_flush_set_beacon = 1;
+	else if (set_beacon)
 		ieee802_11_set_beacons(hapd->iface);
 
 	wpa_printf(MSG_DEBUG, "%s: cancel ap_handle_timer for " MACSTR,
@@ -359,7 +570,7 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 		int i;
 		for (i = 0; i < GAS_DIALOG_MAX; i++)
 			gas_serv_dialog_clear(&sta->gas_dialog[i]);
-		os_free(sta->gas_dialog);
+		ap_sta_gas_dialog_free(sta);
 	}
 #endif /* CONFIG_INTERWORKING */
 
@@ -386,8 +597,7 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 	os_free(sta->hs20_session_info_url);
 
 #ifdef CONFIG_SAE
-	sae_clear_data(sta->sae);
-	os_free(sta->sae);
+	ap_sta_sae_free(sta);
 #endif /* CONFIG_SAE */
 
 	mbo_ap_sta_free(sta);
@@ -423,15 +633,33 @@ void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta)
 
 	os_free(sta->ifname_wds);
 
-	os_free(sta);
+	ap_sta_pool_release(hapd->iface, sta);
 }
 
 
+/**
+ * hostapd_free_stas - Remove all stations of a BSS
+ * @hapd: Pointer to BSS data
+ *
+ * The driver entries are dropped with a single flush request when the driver
+ * supports it instead of one sta_remove call per station, and the beacon and
+ * HT operation updates are done once after the last station is gone.
+ */
 void hostapd_free_stas(struct hostapd_data *hapd)
 {
 	struct sta_info *sta, *prev;
+	struct os_reltime start, end, diff;
+	unsigned int num = 0;
 
 	sta = hapd->sta_list;
+	if (!sta)
+		return;
+
+	os_get_reltime(&start);
+	if (hapd->iface->stas_free_reason != WLAN_STA_FREE_REASON_RECOVERY &&
+	    hapd->driver && hapd->driver->flush && hapd->drv_priv &&
+	    hostapd_flush(hapd) == 0)
+		hapd->sta_flush_batch = 1;
 
 	while (sta) {
 		prev = sta;
@@ -443,7 +671,27 @@ void hostapd_free_stas(struct hostapd_data *hapd)
 		wpa_printf(MSG_DEBUG, "Removing station " MACSTR,
 			   MAC2STR(prev->addr));
 		ap_free_sta(hapd, prev);
+		num++;
 	}
+
+	if (hapd->sta_flush_batch) {
+		hapd->sta_flush_batch = 0;
+#if defined(NEED_AP_MLME) && defined(CONFIG_IEEE80211N)
+		if (hostapd_ht_operation_update(hapd->iface) > 0)
+			hapd->sta_flush_set_beacon = 1;
+#endif /* NEED_AP_MLME && CONFIG_IEEE80211N */
+		if (hapd->sta_flush_set_beacon) {
+			hapd->sta_flush_set_beacon = 0;
+			ieee802_11_set_beacons(hapd->iface);
+		}
+	}
+
+	os_get_reltime(&end);
+	os_reltime_sub(&end, &start, &diff);
+	hapd->sta_flush_last_num = num;
+	hapd->sta_flush_last_usec = diff.sec * 1000000 + diff.usec;
+	wpa_printf(MSG_DEBUG, "%s: Removed %u stations in %u usec",
+		   hapd->conf->iface, num, hapd->sta_flush_last_usec);
 }
 
 
@@ -715,37 +963,10 @@ void ap_sta_session_warning_timeout(struct hostapd_data *hapd,
 			       hapd, sta);
 }
 
-static int num_sta_get_total(struct hostapd_data *hapd)
-{
-	struct hostapd_iface *iface = hapd->iface;
-	size_t i;
-	int num_of_sta;
-
-	for (i = 0, num_of_sta = 0; i < iface->num_bss; i++) {
-		struct hostapd_data *bss = iface->bss[i];
-		num_of_sta += bss->num_sta;
-	}
-	return num_of_sta;
-}
-
-static int num_res_sta_get_total(struct hostapd_data *hapd)
-{
-	struct hostapd_iface *iface = hapd->iface;
-	size_t i;
-	int num_res_sta;
-
-	for (i = 0, num_res_sta = 0; i < iface->num_bss; i++) {
-		struct hostapd_data *bss = iface->bss[i];
-		num_res_sta += bss->conf->num_res_sta;
-	}
-	return num_res_sta;
-}
-
 struct sta_info * ap_sta_add_ex(struct hostapd_data *hapd, const u8 *addr, u8 *out_limit_reached)
 {
 	struct sta_info *sta;
-	int num_sta_total = num_sta_get_total(hapd);
-	int num_res_sta_total = num_res_sta_get_total(hapd);
+	enum sta_admit_result admit;
 	*out_limit_reached = 0;
 
 	sta = ap_get_sta(hapd, addr);
@@ -754,42 +975,22 @@ struct sta_info * ap_sta_add_ex(struct hostapd_data *hapd, const u8 *addr, u8 *o
 
 	wpa_printf(MSG_DEBUG, "  New STA");
 
-	if (hapd->conf->num_res_sta) { /* Number of reserved STAs is set for this BSS */
-		if (hapd->num_sta >= hapd->conf->max_num_sta) {
-			/* FIX: might try to remove some old STAs first? */
-			wpa_printf(MSG_ERROR, "no more room for new STAs (%d/%d)",
-				   hapd->num_sta, hapd->conf->max_num_sta);
+	admit = sta_admit_check(hapd, addr);
+	if (admit != STA_ADMIT_OK) {
+		wpa_printf(MSG_DEBUG, "  STA " MACSTR " not admitted (%s)",
+			   MAC2STR(addr), sta_admit_result_txt(admit));
+		if (admit != STA_ADMIT_ATF)
 			*out_limit_reached = 1;
-			return NULL;
-		}
-	} else { /* Number of reserved STAs is not set for this BSS */
-		if (hapd->num_sta >= (hapd->conf->max_num_sta - num_res_sta_total)) {
-			wpa_printf(MSG_ERROR, "no more room for new STAs, "
-				   "reserved STAs limit is reached for BSS(%d/%d)",
-				   hapd->num_sta, hapd->conf->max_num_sta - num_res_sta_total);
-			*out_limit_reached = 1;
-			return NULL;
-		}
-	}
-	if (num_sta_total >= hapd->iconf->ap_max_num_sta) {
-		wpa_printf(MSG_ERROR, "no more room for new STAs, Radio limit reached (%d/%d)",
-			   num_sta_total, hapd->iconf->ap_max_num_sta);
-		*out_limit_reached = 1;
 		return NULL;
 	}
-	if (hapd->iconf->atf_cfg.distr_type && hostapd_atf_is_sta_allowed(hapd, addr) == 0) {
-		wpa_printf(MSG_INFO, "ATF: Configuration/capacity doesn't allow station "
-				MACSTR " to connect", MAC2STR(addr));
-		return NULL;
-	}
-	sta = os_zalloc(sizeof(struct sta_info));
+	sta = ap_sta_pool_alloc(hapd->iface);
 	if (sta == NULL) {
 		wpa_printf(MSG_ERROR, "malloc failed");
 		return NULL;
 	}
 	sta->acct_interim_interval = hapd->conf->acct_interim_interval;
 	if (accounting_sta_get_id(hapd, sta) < 0) {
-		os_free(sta);
+		ap_sta_pool_release(hapd->iface, sta);
 		return NULL;
 	}
 
@@ -811,6 +1012,7 @@ struct sta_info * ap_sta_add_ex(struct hostapd_data *hapd, const u8 *addr, u8 *o
 	ap_sta_remove_in_other_bss(hapd, sta);
 	sta->last_seq_ctrl = WLAN_INVALID_MGMT_SEQ;
 	dl_list_init(&sta->ip6addr);
+	sta_lat_event(hapd, sta, STA_LAT_START);
 
 #ifdef CONFIG_TAXONOMY
 	sta_track_claim_taxonomy_info(hapd->iface, addr,
@@ -851,22 +1053,13 @@ static int ap_sta_remove(struct hostapd_data *hapd, struct sta_info *sta)
 static void ap_sta_remove_in_other_bss(struct hostapd_data *hapd,
 				       struct sta_info *sta)
 {
-	struct hostapd_iface *iface = hapd->iface;
-	size_t i;
-
-	for (i = 0; i < iface->num_bss; i++) {
-		struct hostapd_data *bss = iface->bss[i];
-		struct sta_info *sta2;
-		/* bss should always be set during operation, but it may be
-		 * NULL during reconfiguration. Assume the STA is not
-		 * associated to another BSS in that case to avoid NULL pointer
-		 * dereferences. */
-		if (bss == hapd || bss == NULL)
-			continue;
-		sta2 = ap_get_sta(bss, sta->addr);
-		if (!sta2)
-			continue;
+	struct sta_info *sta2, *next;
 
+	for (sta2 = ap_get_sta_other_bss(hapd, sta->addr, NULL); sta2;
+	     sta2 = next) {
+		struct hostapd_data *bss = sta2->bss;
+
+		next = ap_get_sta_other_bss(hapd, sta->addr, sta2);
 		wpa_printf(MSG_DEBUG, "%s: disconnect old STA " MACSTR
 			   " association from another BSS %s",
 			   hapd->conf->iface, MAC2STR(sta2->addr),
@@ -1607,10 +1800,12 @@ void ap_sta_set_authorized(struct hostapd_data *hapd, struct sta_info *sta,
 	pos = buf;
 	end = buf + buflen;
 
-	if (authorized)
+	if (authorized) {
 		sta->flags |= WLAN_STA_AUTHORIZED;
-	else
+		sta_lat_event(hapd, sta, STA_LAT_AUTHORIZED);
+	} else {
 		sta->flags &= ~WLAN_STA_AUTHORIZED;
+	}
 
 #ifdef CONFIG_P2P
 	if (hapd->p2p_group == NULL) {
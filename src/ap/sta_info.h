@@ -12,6 +12,7 @@
 #include "common/defs.h"
 #include "list.h"
 #include "vlan.h"
+#include "sta_latency.h"
 #include "common/wpa_common.h"
 #include "common/ieee802_11_defs.h"
 
@@ -52,6 +53,7 @@
 #define WLAN_SUPP_CHANNELS_COUNT 50
 
 struct hostapd_data;
+struct hostapd_iface;
 
 struct mbo_non_pref_chan_info {
 	struct mbo_non_pref_chan_info *next;
@@ -82,10 +84,15 @@ enum sta_disconnect_type {
 struct sta_info {
 	struct sta_info *next; /* next entry in sta list */
 	struct sta_info *hnext; /* next entry in hash table list */
+	struct sta_info *iface_hnext; /* next entry in radio-wide hash list */
+	struct hostapd_data *bss; /* BSS this entry belongs to */
+	unsigned int pooled:1; /* entry belongs to hostapd_iface::sta_pool */
+	unsigned int aid_shared:1; /* AID taken from hostapd_iface::aid_map */
 	u8 addr[6];
 	be32 ipaddr;
 	struct dl_list ip6addr; /* list head for struct ip6addr */
 	u16 aid; /* STA's unique AID (1 .. 2007) or 0 if not yet assigned */
+	int atf_listed_grant; /* Configured ATF grant counted in BSS, -1 if unlisted */
 	u16 disconnect_reason_code; /* RADIUS server override */
 	u32 flags; /* Bitfield of WLAN_STA_* */
 	u16 capability;
@@ -230,6 +237,7 @@ struct sta_info {
 #endif /* CONFIG_FST */
 
 	struct os_reltime connected_time;
+	struct sta_lat lat; /* lifecycle timestamps, see sta_latency.c */
 
 #ifdef CONFIG_SAE
 	struct sae_data *sae;
@@ -338,10 +346,16 @@ int ap_for_each_sta(struct hostapd_data *hapd,
 		    void *ctx);
 struct sta_info * ap_get_sta(struct hostapd_data *hapd, const u8 *sta);
 struct sta_info * ap_get_sta_p2p(struct hostapd_data *hapd, const u8 *addr);
+struct sta_info * ap_get_sta_other_bss(struct hostapd_data *hapd,
+				       const u8 *addr, struct sta_info *prev);
 void ap_sta_hash_add(struct hostapd_data *hapd, struct sta_info *sta);
 void ap_free_sta(struct hostapd_data *hapd, struct sta_info *sta);
 void ap_sta_ip6addr_del(struct hostapd_data *hapd, struct sta_info *sta);
 void hostapd_free_stas(struct hostapd_data *hapd);
+void ap_sta_pool_deinit(struct hostapd_iface *iface);
+struct sae_data * ap_sta_sae_alloc(struct sta_info *sta);
+struct gas_dialog_info * ap_sta_gas_dialog_alloc(struct sta_info *sta);
+void ap_sta_gas_dialog_free(struct sta_info *sta);
 void ap_handle_timer(void *eloop_ctx, void *timeout_ctx);
 void ap_sta_replenish_timeout(struct hostapd_data *hapd, struct sta_info *sta,
 			      u32 session_timeout);
@@ -0,0 +1,261 @@
+/*
+ * hostapd / Station lifecycle latency statistics
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+
+#include "utils/common.h"
+#include "hostapd.h"
+#include "sta_info.h"
+#include "sta_latency.h"
+
+
+static const char * const sta_lat_hist_txt[NUM_STA_LAT_HIST] = {
+	"auth", "eap", "keys", "total", "radius", "drv_sta_add",
+	"drv_set_key"
+};
+
+
+static unsigned int sta_lat_usec(const struct os_reltime *start,
+				 const struct os_reltime *end)
+{
+	struct os_reltime diff;
+
+	os_reltime_sub((struct os_reltime *) end,
+		       (struct os_reltime *) start, &diff);
+	if (diff.sec < 0)
+		return 0;
+	if (diff.sec >= 4000)
+		return 4000000000U;
+	return diff.sec * 1000000 + diff.usec;
+}
+
+
+static void sta_lat_hist_add(struct sta_lat_hist *hist, unsigned int usec)
+{
+	unsigned int b = 0;
+
+	while (b < STA_LAT_BUCKETS - 1 && (usec >> (b + 1)))
+		b++;
+	hist->bucket[b]++;
+	hist->count++;
+	hist->sum_usec += usec;
+	if (usec > hist->max_usec)
+		hist->max_usec = usec;
+}
+
+
+static void sta_lat_sample(struct hostapd_data *hapd,
+			   enum sta_lat_hist_id id,
+			   const struct os_reltime *start,
+			   const struct os_reltime *end)
+{
+	if (!os_reltime_initialized((struct os_reltime *) start))
+		return;
+	sta_lat_hist_add(&hapd->sta_lat.hist[id], sta_lat_usec(start, end));
+}
+
+
+/**
+ * sta_lat_event - Record a station lifecycle event
+ * @hapd: BSS the station belongs to
+ * @sta: The station
+ * @ev: Lifecycle event that was reached
+ *
+ * The time spent since the previous stage is added to the per-BSS
+ * histograms. A station that associates again after it was authorized
+ * starts a new cycle at the association.
+ */
+void sta_lat_event(struct hostapd_data *hapd, struct sta_info *sta,
+		   enum sta_lat_event ev)
+{
+	struct sta_lat *lat = &sta->lat;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+
+	switch (ev) {
+	case STA_LAT_START:
+		os_memset(lat->t, 0, sizeof(lat->t));
+		break;
+	case STA_LAT_ASSOC:
+		if (os_reltime_initialized(&lat->t[STA_LAT_AUTHORIZED]))
+			os_memset(lat->t, 0, sizeof(lat->t));
+		sta_lat_sample(hapd, STA_LAT_H_AUTH, &lat->t[STA_LAT_START],
+			       &now);
+		lat->t[STA_LAT_EAP].sec = lat->t[STA_LAT_EAP].usec = 0;
+		break;
+	case STA_LAT_EAP:
+		sta_lat_sample(hapd, STA_LAT_H_EAP, &lat->t[STA_LAT_ASSOC],
+			       &now);
+		break;
+	case STA_LAT_AUTHORIZED:
+		if (os_reltime_initialized(&lat->t[STA_LAT_AUTHORIZED]))
+			return; /* already counted for this cycle */
+		if (os_reltime_initialized(&lat->t[STA_LAT_EAP]))
+			sta_lat_sample(hapd, STA_LAT_H_KEYS,
+				       &lat->t[STA_LAT_EAP], &now);
+		else
+			sta_lat_sample(hapd, STA_LAT_H_KEYS,
+				       &lat->t[STA_LAT_ASSOC], &now);
+		sta_lat_sample(hapd, STA_LAT_H_TOTAL, &lat->t[STA_LAT_START],
+			       &now);
+		break;
+	default:
+		return;
+	}
+
+	lat->t[ev] = now;
+}
+
+
+void sta_lat_radius_tx(struct sta_info *sta)
+{
+	os_get_reltime(&sta->lat.radius_tx);
+}
+
+
+void sta_lat_radius_rx(struct hostapd_data *hapd, struct sta_info *sta)
+{
+	struct os_reltime now;
+
+	if (!os_reltime_initialized(&sta->lat.radius_tx))
+		return;
+	os_get_reltime(&now);
+	sta_lat_sample(hapd, STA_LAT_H_RADIUS, &sta->lat.radius_tx, &now);
+	sta->lat.radius_tx.sec = sta->lat.radius_tx.usec = 0;
+}
+
+
+/* Record the duration of an operation, e.g. a driver call, started at @start */
+void sta_lat_add_since(struct hostapd_data *hapd, enum sta_lat_hist_id id,
+		       const struct os_reltime *start)
+{
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	sta_lat_sample(hapd, id, start, &now);
+}
+
+
+int sta_lat_get_sta(struct sta_info *sta, char *buf, size_t buflen)
+{
+	static const char * const txt[NUM_STA_LAT_EVENT] = {
+		NULL, "lat_assoc_usec", "lat_eap_usec", "lat_authorized_usec"
+	};
+	struct os_reltime *start = &sta->lat.t[STA_LAT_START];
+	int i, ret, len = 0;
+
+	/* A cycle restarted by reassociation has no START timestamp */
+	i = STA_LAT_ASSOC;
+	if (!os_reltime_initialized(start)) {
+		start = &sta->lat.t[STA_LAT_ASSOC];
+		i = STA_LAT_EAP;
+	}
+	if (!os_reltime_initialized(start))
+		return 0;
+
+	/* Offsets of the reached stages from the start of the cycle */
+	for (; i < NUM_STA_LAT_EVENT; i++) {
+		if (!os_reltime_initialized(&sta->lat.t[i]))
+			continue;
+		ret = os_snprintf(buf + len, buflen - len, "%s=%u\n", txt[i],
+				  sta_lat_usec(start, &sta->lat.t[i]));
+		if (os_snprintf_error(buflen - len, ret))
+			return len;
+		len += ret;
+	}
+
+	return len;
+}
+
+
+static unsigned int sta_lat_percentile(const struct sta_lat_hist *hist,
+				       unsigned int pct)
+{
+	unsigned int b;
+	u64 seen = 0;
+	/* count * pct overflows 32 bits after ~43 million samples */
+	u64 target = ((u64) hist->count * pct + 99) / 100;
+
+	for (b = 0; b < STA_LAT_BUCKETS; b++) {
+		seen += hist->bucket[b];
+		if (seen >= target)
+			break;
+	}
+	if (b >= STA_LAT_BUCKETS - 1)
+		return hist->max_usec;
+	/* Upper bound of the bucket, but never above the largest sample */
+	return MIN((2U << b) - 1, hist->max_usec);
+}
+
+
+/**
+ * sta_lat_dump - STA_LATENCY control interface command
+ * @hapd: BSS to report
+ * @cmd: NULL, "RESET" to clear the histograms, or "HIST" to include buckets
+ * @buf: Buffer for the reply
+ * @buflen: Length of buf
+ * Returns: Length of the reply, or -1 for an unknown argument
+ */
+int sta_lat_dump(struct hostapd_data *hapd, const char *cmd, char *buf,
+		 size_t buflen)
+{
+	int i, b, last, ret, len = 0;
+	int show_hist = 0;
+
+	if (cmd && os_strcmp(cmd, "RESET") == 0) {
+		os_memset(&hapd->sta_lat, 0, sizeof(hapd->sta_lat));
+		return os_snprintf(buf, buflen, "OK\n");
+	}
+	if (cmd && os_strcmp(cmd, "HIST") == 0)
+		show_hist = 1;
+	else if (cmd)
+		return -1;
+
+	for (i = 0; i < NUM_STA_LAT_HIST; i++) {
+		const struct sta_lat_hist *hist = &hapd->sta_lat.hist[i];
+
+		ret = os_snprintf(buf + len, buflen - len,
+				  "%s count=%u mean_usec=%llu p50_usec=%u "
+				  "p90_usec=%u p99_usec=%u max_usec=%u\n",
+				  sta_lat_hist_txt[i], hist->count,
+				  hist->count ?
+				  (unsigned long long) (hist->sum_usec /
+							hist->count) : 0ULL,
+				  sta_lat_percentile(hist, 50),
+				  sta_lat_percentile(hist, 90),
+				  sta_lat_percentile(hist, 99),
+				  hist->max_usec);
+		if (os_snprintf_error(buflen - len, ret))
+			return len;
+		len += ret;
+
+		if (!show_hist || !hist->count)
+			continue;
+
+		/* Buckets up to the last non-empty one, 1 usec first */
+		for (last = STA_LAT_BUCKETS - 1; last > 0; last--) {
+			if (hist->bucket[last])
+				break;
+		}
+		ret = os_snprintf(buf + len, buflen - len, "%s_hist=",
+				  sta_lat_hist_txt[i]);
+		if (os_snprintf_error(buflen - len, ret))
+			return len;
+		len += ret;
+		for (b = 0; b <= last; b++) {
+			ret = os_snprintf(buf + len, buflen - len, "%u%s",
+					  hist->bucket[b],
+					  b < last ? "," : "\n");
+			if (os_snprintf_error(buflen - len, ret))
+				return len;
+			len += ret;
+		}
+	}
+
+	return len;
+}
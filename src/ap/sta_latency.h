@@ -0,0 +1,66 @@
+/*
+ * hostapd / Station lifecycle latency statistics
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef STA_LATENCY_H
+#define STA_LATENCY_H
+
+#include "utils/os.h"
+
+struct hostapd_data;
+struct sta_info;
+
+/* Lifecycle events timestamped in struct sta_info */
+enum sta_lat_event {
+	STA_LAT_START, /* STA entry created on the first frame/event */
+	STA_LAT_ASSOC, /* (re)association completed */
+	STA_LAT_EAP, /* IEEE 802.1X/EAP authentication succeeded */
+	STA_LAT_AUTHORIZED, /* keys installed, port authorized */
+	NUM_STA_LAT_EVENT
+};
+
+/* Per-BSS latency histograms */
+enum sta_lat_hist_id {
+	STA_LAT_H_AUTH, /* START -> ASSOC */
+	STA_LAT_H_EAP, /* ASSOC -> EAP */
+	STA_LAT_H_KEYS, /* EAP (or ASSOC) -> AUTHORIZED */
+	STA_LAT_H_TOTAL, /* START -> AUTHORIZED */
+	STA_LAT_H_RADIUS, /* Access-Request -> RADIUS response */
+	STA_LAT_H_DRV_STA_ADD, /* driver sta_add call */
+	STA_LAT_H_DRV_SET_KEY, /* driver set_key call for the STA */
+	NUM_STA_LAT_HIST
+};
+
+/* Bucket n counts samples of [2^n, 2^(n+1)) usec, the last one the rest */
+#define STA_LAT_BUCKETS 24
+
+struct sta_lat_hist {
+	unsigned int count;
+	unsigned int max_usec;
+	u64 sum_usec;
+	unsigned int bucket[STA_LAT_BUCKETS];
+};
+
+struct sta_lat {
+	struct os_reltime t[NUM_STA_LAT_EVENT]; /* 0 = not reached */
+	struct os_reltime radius_tx; /* pending Access-Request */
+};
+
+struct sta_lat_stats {
+	struct sta_lat_hist hist[NUM_STA_LAT_HIST];
+};
+
+void sta_lat_event(struct hostapd_data *hapd, struct sta_info *sta,
+		   enum sta_lat_event ev);
+void sta_lat_radius_tx(struct sta_info *sta);
+void sta_lat_radius_rx(struct hostapd_data *hapd, struct sta_info *sta);
+void sta_lat_add_since(struct hostapd_data *hapd, enum sta_lat_hist_id id,
+		       const struct os_reltime *start);
+int sta_lat_get_sta(struct sta_info *sta, char *buf, size_t buflen);
+int sta_lat_dump(struct hostapd_data *hapd, const char *cmd, char *buf,
+		 size_t buflen);
+
+#endif /* STA_LATENCY_H */
@@ -63,6 +63,8 @@ static void wpa_group_get(struct wpa_authenticator *wpa_auth,
 			  struct wpa_group *group);
 static void wpa_group_put(struct wpa_authenticator *wpa_auth,
 			  struct wpa_group *group);
+static void wpa_group_rollout_timeout(void *eloop_ctx, void *timeout_ctx);
+static void wpa_group_cancel_pending(struct wpa_state_machine *sm);
 static u8 * ieee80211w_kde_add(struct wpa_state_machine *sm, u8 *pos);
 
 static const u32 eapol_key_timeout_first = 100; /* ms */
@@ -111,6 +113,15 @@ static inline int wpa_auth_get_eapol(struct wpa_authenticator *wpa_auth,
 }
 
 
+static inline int wpa_auth_sta_dozing(struct wpa_authenticator *wpa_auth,
+				      const u8 *addr)
+{
+	if (wpa_auth->cb->sta_dozing == NULL)
+		return -1;
+	return wpa_auth->cb->sta_dozing(wpa_auth->cb_ctx, addr);
+}
+
+
 static inline const u8 * wpa_auth_get_psk(struct wpa_authenticator *wpa_auth,
 					  const u8 *addr,
 					  const u8 *p2p_dev_addr,
@@ -432,6 +443,244 @@ static struct wpa_group * wpa_group_init(struct wpa_authenticator *wpa_auth,
 }
 
 
+/*
+ * PMKSA/FT cache snapshot file:
+ * magic(8) version(1) AES-SIV(key, plaintext) with the magic, version, and
+ * own address as associated data. The plaintext is a sequence of sections:
+ * type(1) length(4) entries.
+ */
+#define WPA_AUTH_CACHE_MAGIC "HAPDPMKC"
+#define WPA_AUTH_CACHE_MAGIC_LEN 8
+#define WPA_AUTH_CACHE_VERSION 1
+#define WPA_AUTH_CACHE_PMKSA 1
+#define WPA_AUTH_CACHE_FT 2
+
+static int wpa_auth_cache_enabled(struct wpa_authenticator *wpa_auth)
+{
+	return wpa_auth->conf.pmksa_cache_file &&
+		wpa_auth->conf.pmksa_cache_file_key_len;
+}
+
+
+static void wpa_auth_cache_put_section(struct wpabuf *buf, u8 type,
+				       const struct wpabuf *section)
+{
+	wpabuf_put_u8(buf, type);
+	wpabuf_put_be32(buf, wpabuf_len(section));
+	wpabuf_put_buf(buf, section);
+}
+
+
+/**
+ * wpa_auth_cache_save - Write PMKSA and FT caches to the snapshot file
+ * @wpa_auth: Pointer to WPA authenticator data from wpa_init()
+ * Returns: 0 on success, -1 on failure
+ */
+int wpa_auth_cache_save(struct wpa_authenticator *wpa_auth)
+{
+	struct wpabuf *pmksa, *ft = NULL, *plain = NULL, *out = NULL;
+	const char *fname = wpa_auth->conf.pmksa_cache_file;
+	u8 hdr[WPA_AUTH_CACHE_MAGIC_LEN + 1];
+	const u8 *addr[2];
+	size_t len[2];
+	char *tmp = NULL;
+	FILE *f;
+	int ret = -1;
+
+	if (!wpa_auth_cache_enabled(wpa_auth))
+		return 0;
+
+	pmksa = pmksa_cache_auth_export(wpa_auth->pmksa);
+#ifdef CONFIG_IEEE80211R_AP
+	ft = wpa_ft_pmk_cache_export(wpa_auth);
+	if (!ft)
+		goto fail;
+#endif /* CONFIG_IEEE80211R_AP */
+	if (!pmksa)
+		goto fail;
+
+	plain = wpabuf_alloc(2 * 5 + wpabuf_len(pmksa) +
+			     (ft ? wpabuf_len(ft) : 0));
+	if (!plain)
+		goto fail;
+	wpa_auth_cache_put_section(plain, WPA_AUTH_CACHE_PMKSA, pmksa);
+	if (ft)
+		wpa_auth_cache_put_section(plain, WPA_AUTH_CACHE_FT, ft);
+
+	os_memcpy(hdr, WPA_AUTH_CACHE_MAGIC, WPA_AUTH_CACHE_MAGIC_LEN);
+	hdr[WPA_AUTH_CACHE_MAGIC_LEN] = WPA_AUTH_CACHE_VERSION;
+	addr[0] = hdr;
+	len[0] = sizeof(hdr);
+	addr[1] = wpa_auth->addr;
+	len[1] = ETH_ALEN;
+
+	out = wpabuf_alloc(sizeof(hdr) + AES_BLOCK_SIZE + wpabuf_len(plain));
+	if (!out)
+		goto fail;
+	wpabuf_put_data(out, hdr, sizeof(hdr));
+	if (aes_siv_encrypt(wpa_auth->conf.pmksa_cache_file_key,
+			    wpa_auth->conf.pmksa_cache_file_key_len,
+			    wpabuf_head(plain), wpabuf_len(plain), 2, addr, len,
+			    wpabuf_put(out, AES_BLOCK_SIZE +
+				       wpabuf_len(plain))) < 0)
+		goto fail;
+
+	/* Replace the old snapshot only once the new one is complete */
+	tmp = os_malloc(os_strlen(fname) + 5);
+	if (!tmp)
+		goto fail;
+	os_snprintf(tmp, os_strlen(fname) + 5, "%s.tmp", fname);
+	f = fopen(tmp, "wb");
+	if (!f) {
+		wpa_printf(MSG_ERROR, "WPA: Could not open '%s' for writing: %s",
+			   tmp, strerror(errno));
+		goto fail;
+	}
+	if (fwrite(wpabuf_head(out), wpabuf_len(out), 1, f) != 1) {
+		wpa_printf(MSG_ERROR, "WPA: Could not write '%s': %s",
+			   tmp, strerror(errno));
+		fclose(f);
+		unlink(tmp);
+		goto fail;
+	}
+	fclose(f);
+	if (rename(tmp, fname) < 0) {
+		wpa_printf(MSG_ERROR, "WPA: Could not rename '%s' to '%s': %s",
+			   tmp, fname, strerror(errno));
+		unlink(tmp);
+		goto fail;
+	}
+
+	wpa_printf(MSG_DEBUG, "WPA: Saved PMKSA/FT cache snapshot to '%s'",
+		   fname);
+	ret = 0;
+fail:
+	os_free(tmp);
+	wpabuf_free(out);
+	wpabuf_clear_free(plain);
+	wpabuf_clear_free(ft);
+	wpabuf_clear_free(pmksa);
+	return ret;
+}
+
+
+/**
+ * wpa_auth_cache_load - Restore PMKSA and FT caches from the snapshot file
+ * @wpa_auth: Pointer to WPA authenticator data from wpa_init()
+ * Returns: 0 on success or if there is no snapshot, -1 on failure
+ */
+int wpa_auth_cache_load(struct wpa_authenticator *wpa_auth)
+{
+	const char *fname = wpa_auth->conf.pmksa_cache_file;
+	u8 *data, *plain = NULL;
+	size_t data_len, plain_len = 0, sect_len;
+	const u8 *pos, *end;
+	const u8 *addr[2];
+	size_t len[2];
+	int res, pmksa_count = 0, ft_count = 0, ret = -1;
+	u8 type;
+
+	if (!wpa_auth_cache_enabled(wpa_auth))
+		return 0;
+
+	data = (u8 *) os_readfile(fname, &data_len);
+	if (!data) {
+		wpa_printf(MSG_DEBUG, "WPA: No PMKSA/FT cache snapshot in '%s'",
+			   fname);
+		return 0;
+	}
+
+	if (data_len < WPA_AUTH_CACHE_MAGIC_LEN + 1 + AES_BLOCK_SIZE ||
+	    os_memcmp(data, WPA_AUTH_CACHE_MAGIC,
+		      WPA_AUTH_CACHE_MAGIC_LEN) != 0 ||
+	    data[WPA_AUTH_CACHE_MAGIC_LEN] != WPA_AUTH_CACHE_VERSION) {
+		wpa_printf(MSG_INFO,
+			   "WPA: Ignoring unrecognized cache snapshot '%s'",
+			   fname);
+		goto out;
+	}
+
+	addr[0] = data;
+	len[0] = WPA_AUTH_CACHE_MAGIC_LEN + 1;
+	addr[1] = wpa_auth->addr;
+	len[1] = ETH_ALEN;
+	plain_len = data_len - len[0] - AES_BLOCK_SIZE;
+	plain = os_malloc(plain_len + 1);
+	if (!plain)
+		goto out;
+	if (aes_siv_decrypt(wpa_auth->conf.pmksa_cache_file_key,
+			    wpa_auth->conf.pmksa_cache_file_key_len,
+			    data + len[0], data_len - len[0], 2, addr, len,
+			    plain) < 0) {
+		wpa_printf(MSG_INFO,
+			   "WPA: Could not decrypt cache snapshot '%s' (wrong key or BSSID?)",
+			   fname);
+		goto out;
+	}
+
+	pos = plain;
+	end = plain + plain_len;
+	while (end - pos > 0) {
+		if (end - pos < 5)
+			goto malformed;
+		type = *pos++;
+		sect_len = WPA_GET_BE32(pos);
+		pos += 4;
+		if ((size_t) (end - pos) < sect_len)
+			goto malformed;
+		if (type == WPA_AUTH_CACHE_PMKSA) {
+			res = pmksa_cache_auth_import(wpa_auth->pmksa, pos,
+						      sect_len);
+			if (res < 0)
+				goto malformed;
+			pmksa_count += res;
+#ifdef CONFIG_IEEE80211R_AP
+		} else if (type == WPA_AUTH_CACHE_FT) {
+			res = wpa_ft_pmk_cache_import(wpa_auth, pos, sect_len);
+			if (res < 0)
+				goto malformed;
+			ft_count += res;
+#endif /* CONFIG_IEEE80211R_AP */
+		}
+		pos += sect_len;
+	}
+
+	wpa_printf(MSG_INFO,
+		   "WPA: Restored %d PMKSA and %d FT PMK cache entries from '%s'",
+		   pmksa_count, ft_count, fname);
+	ret = 0;
+	goto out;
+
+malformed:
+	wpa_printf(MSG_INFO, "WPA: Malformed cache snapshot '%s'", fname);
+out:
+	bin_clear_free(plain, plain_len);
+	bin_clear_free(data, data_len);
+	return ret;
+}
+
+
+static void wpa_auth_cache_save_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct wpa_authenticator *wpa_auth = eloop_ctx;
+
+	wpa_auth_cache_save(wpa_auth);
+	eloop_register_timeout(wpa_auth->conf.pmksa_cache_save_interval, 0,
+			       wpa_auth_cache_save_timeout, wpa_auth, NULL);
+}
+
+
+static void wpa_auth_cache_schedule_save(struct wpa_authenticator *wpa_auth)
+{
+	eloop_cancel_timeout(wpa_auth_cache_save_timeout, wpa_auth, NULL);
+	if (wpa_auth_cache_enabled(wpa_auth) &&
+	    wpa_auth->conf.pmksa_cache_save_interval > 0)
+		eloop_register_timeout(wpa_auth->conf.pmksa_cache_save_interval,
+				       0, wpa_auth_cache_save_timeout,
+				       wpa_auth, NULL);
+}
+
+
 /**
  * wpa_init - Initialize WPA authenticator
  * @addr: Authenticator address
@@ -487,8 +736,12 @@ struct wpa_authenticator * wpa_init(const u8 *addr,
 		os_free(wpa_auth);
 		return NULL;
 	}
+	wpa_ft_rkh_index_rebuild(wpa_auth);
 #endif /* CONFIG_IEEE80211R_AP */
 
+	wpa_auth_cache_load(wpa_auth);
+	wpa_auth_cache_schedule_save(wpa_auth);
+
 	if (wpa_auth->conf.wpa_gmk_rekey) {
 		eloop_register_timeout(wpa_auth->conf.wpa_gmk_rekey, 0,
 				       wpa_rekey_gmk, wpa_auth, NULL);
@@ -539,7 +792,11 @@ void wpa_deinit(struct wpa_authenticator *wpa_auth)
 
 	eloop_cancel_timeout(wpa_rekey_gmk, wpa_auth, NULL);
 	eloop_cancel_timeout(wpa_rekey_gtk, wpa_auth, NULL);
+	eloop_cancel_timeout(wpa_group_rollout_timeout, wpa_auth,
+			     ELOOP_ALL_CTX);
+	eloop_cancel_timeout(wpa_auth_cache_save_timeout, wpa_auth, NULL);
 
+	wpa_auth_cache_save(wpa_auth);
 	pmksa_cache_auth_deinit(wpa_auth->pmksa);
 
 #ifdef CONFIG_IEEE80211R_AP
@@ -579,6 +836,10 @@ int wpa_reconfig(struct wpa_authenticator *wpa_auth,
 		return 0;
 
 	os_memcpy(&wpa_auth->conf, conf, sizeof(*conf));
+#ifdef CONFIG_IEEE80211R_AP
+	wpa_ft_rkh_index_rebuild(wpa_auth);
+#endif /* CONFIG_IEEE80211R_AP */
+	wpa_auth_cache_schedule_save(wpa_auth);
 	if (wpa_auth_gen_wpa_ie(wpa_auth)) {
 		wpa_printf(MSG_ERROR, "Could not generate WPA IE.");
 		return -1;
@@ -702,6 +963,7 @@ static void wpa_free_sta_sm(struct wpa_state_machine *sm)
 		sm->group->GKeyDoneStations--;
 		sm->GUpdateStationKeys = FALSE;
 	}
+	wpa_group_cancel_pending(sm);
 #ifdef CONFIG_IEEE80211R_AP
 	os_free(sm->assoc_resp_ftie);
 	wpabuf_free(sm->ft_pending_req_ies);
@@ -1776,6 +2038,7 @@ int wpa_auth_sm_event(struct wpa_state_machine *sm, enum wpa_event event)
 			sm->GUpdateStationKeys = FALSE;
 			sm->PtkGroupInit = TRUE;
 		}
+		wpa_group_cancel_pending(sm);
 		sm->ReAuthenticationRequest = TRUE;
 		break;
 	case WPA_ASSOC_FT:
@@ -1853,6 +2116,7 @@ SM_STATE(WPA_PTK, INITIALIZE)
 	if (sm->GUpdateStationKeys)
 		sm->group->GKeyDoneStations--;
 	sm->GUpdateStationKeys = FALSE;
+	wpa_group_cancel_pending(sm);
 	if (sm->wpa == WPA_VERSION_WPA)
 		sm->PInitAKeys = FALSE;
 	if (1 /* Unicast cipher supported AND (ESS OR ((IBSS or WDS) and
@@ -3685,8 +3949,10 @@ SM_STATE(WPA_PTK_GROUP, REKEYESTABLISHED)
 SM_STATE(WPA_PTK_GROUP, KEYERROR)
 {
 	SM_ENTRY_MA(WPA_PTK_GROUP, KEYERROR, wpa_ptk_group);
-	if (sm->GUpdateStationKeys)
+	if (sm->GUpdateStationKeys) {
 		sm->group->GKeyDoneStations--;
+		sm->group->rollout_failures++;
+	}
 	sm->GUpdateStationKeys = FALSE;
 	sm->Disconnect = TRUE;
 	wpa_auth_vlogger(sm->wpa_auth, sm->addr, LOGGER_INFO,
@@ -3786,11 +4052,28 @@ static void wpa_group_gtk_init(struct wpa_authenticator *wpa_auth,
 }
 
 
+static void wpa_group_cancel_pending(struct wpa_state_machine *sm)
+{
+	if (!sm->GUpdatePending)
+		return;
+	sm->GUpdatePending = FALSE;
+	sm->group->GKeyPendingStations--;
+	sm->group->GKeyDoneStations--;
+}
+
+
 static int wpa_group_update_sta(struct wpa_state_machine *sm, void *ctx)
 {
 	if (ctx != NULL && ctx != sm->group)
 		return 0;
 
+	if (ctx) {
+		/* Counters were reset by wpa_group_setkeys() */
+		sm->GUpdatePending = FALSE;
+	} else {
+		wpa_group_cancel_pending(sm);
+	}
+
 	if (sm->wpa_ptk_state != WPA_PTK_PTKINITDONE) {
 		wpa_auth_logger(sm->wpa_auth, sm->addr, LOGGER_DEBUG,
 				"Not in PTKINITDONE; skip Group Key update");
@@ -3813,6 +4096,15 @@ static int wpa_group_update_sta(struct wpa_state_machine *sm, void *ctx)
 		return 0;
 
 	sm->group->GKeyDoneStations++;
+
+	if (ctx && sm->wpa_auth->conf.wpa_group_rekey_batch > 0 &&
+	    !sm->GUpdateStationKeys) {
+		/* Paced rollout: wpa_group_rollout_timeout() starts it */
+		sm->GUpdatePending = TRUE;
+		sm->group->GKeyPendingStations++;
+		return 0;
+	}
+
 	sm->GUpdateStationKeys = TRUE;
 
 	wpa_sm_step(sm);
@@ -3820,6 +4112,92 @@ static int wpa_group_update_sta(struct wpa_state_machine *sm, void *ctx)
 }
 
 
+struct wpa_group_rollout_data {
+	struct wpa_group *group;
+	int budget;
+	int include_dozing;
+};
+
+
+static int wpa_group_rollout_sta(struct wpa_state_machine *sm, void *ctx)
+{
+	struct wpa_group_rollout_data *data = ctx;
+
+	if (sm->group != data->group || !sm->GUpdatePending)
+		return 0;
+	if (data->budget <= 0)
+		return 1;
+
+	if (sm->is_wnmsleep) {
+		/* Will get the new GTK on WNM-Sleep Mode exit */
+		wpa_group_cancel_pending(sm);
+		return 0;
+	}
+
+	if (!data->include_dozing &&
+	    wpa_auth_sta_dozing(sm->wpa_auth, sm->addr) > 0)
+		return 0;
+
+	sm->GUpdatePending = FALSE;
+	sm->group->GKeyPendingStations--;
+	sm->GUpdateStationKeys = TRUE;
+	data->budget--;
+
+	wpa_sm_step(sm);
+	return 0;
+}
+
+
+static void wpa_group_rollout_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct wpa_authenticator *wpa_auth = eloop_ctx;
+	struct wpa_group *group = timeout_ctx;
+	struct wpa_group_rollout_data data;
+	int interval = wpa_auth->conf.wpa_group_rekey_batch_interval;
+
+	if (group->wpa_group_state != WPA_GROUP_SETKEYS ||
+	    group->GKeyPendingStations <= 0)
+		return;
+
+	wpa_group_get(wpa_auth, group);
+
+	/*
+	 * Keep at most wpa_group_rekey_batch group key handshakes in flight.
+	 * Stations that are known to be dozing are started only after all
+	 * awake stations have been served.
+	 */
+	os_memset(&data, 0, sizeof(data));
+	data.group = group;
+	data.budget = wpa_auth->conf.wpa_group_rekey_batch -
+		(group->GKeyDoneStations - group->GKeyPendingStations);
+	wpa_auth_for_each_sta(wpa_auth, wpa_group_rollout_sta, &data);
+	if (data.budget > 0 && group->GKeyPendingStations > 0) {
+		data.include_dozing = 1;
+		wpa_auth_for_each_sta(wpa_auth, wpa_group_rollout_sta, &data);
+	}
+
+	wpa_printf(MSG_DEBUG,
+		   "WPA: GTK rollout (VLAN-ID %d): GKeyDoneStations=%d pending=%d",
+		   group->vlan_id, group->GKeyDoneStations,
+		   group->GKeyPendingStations);
+
+	if (group->GKeyPendingStations > 0) {
+		eloop_register_timeout(interval / 1000,
+				       (interval % 1000) * 1000,
+				       wpa_group_rollout_timeout,
+				       wpa_auth, group);
+	} else if (group->GKeyDoneStations == 0) {
+		/* Everyone left while queued; complete the rekey now */
+		do {
+			group->changed = FALSE;
+			wpa_group_sm_step(wpa_auth, group);
+		} while (group->changed);
+	}
+
+	wpa_group_put(wpa_auth, group);
+}
+
+
 #ifdef CONFIG_WNM_AP
 /* update GTK when exiting WNM-Sleep Mode */
 void wpa_wnmsleep_rekey_gtk(struct wpa_state_machine *sm)
@@ -3931,9 +4309,18 @@ static void wpa_group_setkeys(struct wpa_authenticator *wpa_auth,
 			   group->GKeyDoneStations);
 		group->GKeyDoneStations = 0;
 	}
+	group->GKeyPendingStations = 0;
+	os_get_reltime(&group->rollout_start);
+	group->rollout_failures = 0;
 	wpa_auth_for_each_sta(wpa_auth, wpa_group_update_sta, group);
+	group->rollout_stations = group->GKeyDoneStations;
 	wpa_printf(MSG_DEBUG, "wpa_group_setkeys: GKeyDoneStations=%d",
 		   group->GKeyDoneStations);
+
+	eloop_cancel_timeout(wpa_group_rollout_timeout, wpa_auth, group);
+	if (group->GKeyPendingStations > 0)
+		eloop_register_timeout(0, 0, wpa_group_rollout_timeout,
+				       wpa_auth, group);
 }
 
 
@@ -3991,11 +4378,36 @@ static void wpa_group_fatal_failure(struct wpa_authenticator *wpa_auth,
 }
 
 
+static void wpa_group_rollout_done(struct wpa_authenticator *wpa_auth,
+				   struct wpa_group *group)
+{
+	struct os_reltime now, age;
+	unsigned int ms;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &group->rollout_start, &age);
+	ms = age.sec * 1000 + age.usec / 1000;
+
+	group->rollouts++;
+	group->rollout_last_ms = ms;
+	if (ms > group->rollout_max_ms)
+		group->rollout_max_ms = ms;
+	eloop_cancel_timeout(wpa_group_rollout_timeout, wpa_auth, group);
+
+	wpa_printf(MSG_DEBUG,
+		   "WPA: GTK rollout (VLAN-ID %d) completed in %u ms (%u stations, %u failed)",
+		   group->vlan_id, ms, group->rollout_stations,
+		   group->rollout_failures);
+}
+
+
 static int wpa_group_setkeysdone(struct wpa_authenticator *wpa_auth,
 				 struct wpa_group *group)
 {
 	wpa_printf(MSG_DEBUG, "WPA: group state machine entering state "
 		   "SETKEYSDONE (VLAN-ID %d)", group->vlan_id);
+	if (group->wpa_group_state == WPA_GROUP_SETKEYS)
+		wpa_group_rollout_done(wpa_auth, group);
 	group->changed = TRUE;
 	group->wpa_group_state = WPA_GROUP_SETKEYSDONE;
 
@@ -4262,6 +4674,58 @@ int wpa_get_mib_sta(struct wpa_state_machine *sm, char *buf, size_t buflen)
 }
 
 
+int wpa_auth_gtk_rollout_status(struct wpa_authenticator *wpa_auth,
+				char *buf, size_t buflen)
+{
+	struct wpa_group *group;
+	struct os_reltime now, age;
+	int len = 0, ret;
+
+	if (wpa_auth == NULL)
+		return 0;
+
+	ret = os_snprintf(buf + len, buflen - len,
+			  "batch=%d\n"
+			  "batch_interval=%d\n",
+			  wpa_auth->conf.wpa_group_rekey_batch,
+			  wpa_auth->conf.wpa_group_rekey_batch_interval);
+	if (os_snprintf_error(buflen - len, ret))
+		return len;
+	len += ret;
+
+	os_get_reltime(&now);
+	for (group = wpa_auth->group; group; group = group->next) {
+		int active = group->wpa_group_state == WPA_GROUP_SETKEYS;
+		unsigned int elapsed = 0;
+
+		if (active) {
+			os_reltime_sub(&now, &group->rollout_start, &age);
+			elapsed = age.sec * 1000 + age.usec / 1000;
+		}
+
+		ret = os_snprintf(buf + len, buflen - len,
+				  "vlan_id=%d active=%d stations=%u "
+				  "remaining=%d pending=%d in_progress=%d "
+				  "failed=%u elapsed_ms=%u rollouts=%u "
+				  "last_ms=%u max_ms=%u\n",
+				  group->vlan_id, active,
+				  group->rollout_stations,
+				  active ? group->GKeyDoneStations : 0,
+				  active ? group->GKeyPendingStations : 0,
+				  active ? group->GKeyDoneStations -
+				  group->GKeyPendingStations : 0,
+				  group->rollout_failures, elapsed,
+				  group->rollouts, group->rollout_last_ms,
+				  group->rollout_max_ms);
+		if (os_snprintf_error(buflen - len, ret))
+			return len;
+		len += ret;
+	}
+
+	return len;
+}
+
+
 void wpa_auth_countermeasures_start(struct wpa_authenticator *wpa_auth)
 {
 	if (wpa_auth)
@@ -4559,6 +5023,7 @@ static void wpa_group_free(struct wpa_authenticator *wpa_auth,
 
 	wpa_printf(MSG_DEBUG, "WPA: Remove group state machine for VLAN-ID %d",
 		   group->vlan_id);
+	eloop_cancel_timeout(wpa_group_rollout_timeout, wpa_auth, group);
 
 	while (prev) {
 		if (prev->next == group) {
@@ -4746,6 +5211,7 @@ int wpa_auth_sta_set_vlan(struct wpa_state_machine *sm, int vlan_id)
 	wpa_printf(MSG_DEBUG, "WPA: Moving STA " MACSTR " to use group state "
 		   "machine for VLAN ID %d", MAC2STR(sm->addr), vlan_id);
 
+	wpa_group_cancel_pending(sm);
 	wpa_group_get(sm->wpa_auth, group);
 	wpa_group_put(sm->wpa_auth, sm->group);
 	sm->group = group;
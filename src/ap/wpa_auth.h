@@ -163,6 +163,7 @@ struct wpa_channel_info;
 
 struct ft_remote_r0kh {
 	struct ft_remote_r0kh *next;
+	struct ft_remote_r0kh *hnext; /* next entry in wpa_auth->r0kh_hash */
 	u8 addr[ETH_ALEN];
 	u8 id[FT_R0KH_ID_MAX_LEN];
 	size_t id_len;
@@ -173,6 +174,7 @@ struct ft_remote_r0kh {
 
 struct ft_remote_r1kh {
 	struct ft_remote_r1kh *next;
+	struct ft_remote_r1kh *hnext; /* next entry in wpa_auth->r1kh_hash */
 	u8 addr[ETH_ALEN];
 	u8 id[FT_R1KH_ID_LEN];
 	u8 key[32];
@@ -192,6 +194,8 @@ struct wpa_auth_config {
 	u32 wpa_group_update_count;
 	u32 wpa_pairwise_update_count;
 	int wpa_disable_eapol_key_retries;
+	int wpa_group_rekey_batch;
+	int wpa_group_rekey_batch_interval; /* ms */
 	int rsn_pairwise;
 	int rsn_preauth;
 	int eapol_version;
@@ -199,6 +203,10 @@ struct wpa_auth_config {
 	int wmm_uapsd;
 	int disable_pmksa_caching;
 	int okc;
+	const char *pmksa_cache_file;
+	u8 pmksa_cache_file_key[64];
+	size_t pmksa_cache_file_key_len;
+	int pmksa_cache_save_interval; /* seconds */
 	int tx_status;
 #ifdef CONFIG_IEEE80211W
 	enum mfp_options ieee80211w;
@@ -225,6 +233,8 @@ struct wpa_auth_config {
 	struct ft_remote_r0kh **r0kh_list;
 	struct ft_remote_r1kh **r1kh_list;
 	int pmk_r1_push;
+	int pmk_r1_push_batch_interval; /* ms */
+	int pmk_r1_push_rate; /* frames per second */
 	int ft_over_ds;
 	int ft_psk_generate_local;
 #endif /* CONFIG_IEEE80211R_AP */
@@ -288,6 +298,7 @@ struct wpa_auth_callbacks {
 	int (*get_sta_tx_params)(void *ctx, const u8 *addr,
 				 int ap_max_chanwidth, int ap_seg1_idx,
 				 int *bandwidth, int *seg1_idx);
+	int (*sta_dozing)(void *ctx, const u8 *addr);
 #ifdef CONFIG_IEEE80211R_AP
 	struct wpa_state_machine * (*add_sta)(void *ctx, const u8 *sta_addr);
 	int (*set_vlan)(void *ctx, const u8 *sta_addr,
@@ -322,6 +333,8 @@ int wpa_init_keys(struct wpa_authenticator *wpa_auth);
 void wpa_deinit(struct wpa_authenticator *wpa_auth);
 int wpa_reconfig(struct wpa_authenticator *wpa_auth,
 		 struct wpa_auth_config *conf);
+int wpa_auth_cache_save(struct wpa_authenticator *wpa_auth);
+int wpa_auth_cache_load(struct wpa_authenticator *wpa_auth);
 
 enum {
 	WPA_IE_OK, WPA_INVALID_IE, WPA_INVALID_GROUP, WPA_INVALID_PAIRWISE,
@@ -361,6 +374,8 @@ void wpa_auth_sm_notify(struct wpa_state_machine *sm);
 void wpa_gtk_rekey(struct wpa_authenticator *wpa_auth);
 int wpa_get_mib(struct wpa_authenticator *wpa_auth, char *buf, size_t buflen);
 int wpa_get_mib_sta(struct wpa_state_machine *sm, char *buf, size_t buflen);
+int wpa_auth_gtk_rollout_status(struct wpa_authenticator *wpa_auth,
+				char *buf, size_t buflen);
 void wpa_auth_countermeasures_start(struct wpa_authenticator *wpa_auth);
 int wpa_auth_pairwise_set(struct wpa_state_machine *sm);
 int wpa_auth_get_pairwise(struct wpa_state_machine *sm);
@@ -434,7 +449,10 @@ void wpa_ft_rrb_oui_rx(struct wpa_authenticator *wpa_auth, const u8 *src_addr,
 		       const u8 *dst_addr, u8 oui_suffix, const u8 *data,
 		       size_t data_len);
 void wpa_ft_push_pmk_r1(struct wpa_authenticator *wpa_auth, const u8 *addr);
+int wpa_ft_push_status(struct wpa_authenticator *wpa_auth, char *buf,
+		       size_t buflen);
 void wpa_ft_deinit(struct wpa_authenticator *wpa_auth);
+void wpa_ft_rkh_index_rebuild(struct wpa_authenticator *wpa_auth);
 void wpa_ft_sta_deinit(struct wpa_state_machine *sm);
 #endif /* CONFIG_IEEE80211R_AP */
 
@@ -25,6 +25,7 @@
 #include "wmm.h"
 #include "wpa_auth.h"
 #include "wpa_auth_i.h"
+#include "pmksa_cache_auth.h"
 
 
 #ifdef CONFIG_IEEE80211R_AP
@@ -40,6 +41,7 @@ static int wpa_ft_send_rrb_auth_resp(struct wpa_state_machine *sm,
 static void ft_finish_pull(struct wpa_state_machine *sm);
 static void wpa_ft_expire_pull(void *eloop_ctx, void *timeout_ctx);
 static void wpa_ft_rrb_seq_timeout(void *eloop_ctx, void *timeout_ctx);
+static void wpa_ft_push_batch_timeout(void *eloop_ctx, void *timeout_ctx);
 
 struct tlv_list {
 	u16 type;
@@ -1163,8 +1165,21 @@ static int wpa_ft_new_seq(struct ft_remote_seq *rkh_seq,
 }
 
 
+/* PMK-R0/R1 cache entries are indexed by PMKName (a hash output, so its first
+ * byte is evenly spread) and compared on both SPA and PMKName. */
+#define FT_PMK_HASH_SIZE 256
+#define FT_PMK_HASH(name) ((name)[0])
+
+/* Expiry is driven by a one second timer wheel instead of a timeout per entry.
+ * Entries expiring further out than a full turn stay in their slot and are
+ * checked again on the next turn. */
+#define FT_PMK_WHEEL_SIZE 256
+
 struct wpa_ft_pmk_r0_sa {
 	struct dl_list list;
+	struct wpa_ft_pmk_r0_sa *hnext; /* next entry in r0_hash bucket */
+	struct dl_list wheel; /* r0_wheel slot, if wheel_expiry is set */
+	os_time_t wheel_expiry; /* time to remove the entry, 0 for never */
 	u8 pmk_r0[PMK_LEN_MAX];
 	size_t pmk_r0_len;
 	u8 pmk_r0_name[WPA_PMK_NAME_LEN];
@@ -1179,10 +1194,15 @@ struct wpa_ft_pmk_r0_sa {
 	os_time_t session_timeout; /* 0 for no expiration */
 	/* TODO: radius_class, EAP type */
 	int pmk_r1_pushed;
+	struct dl_list push_list; /* push_queue, if push_queued */
+	int push_queued;
 };
 
 struct wpa_ft_pmk_r1_sa {
 	struct dl_list list;
+	struct wpa_ft_pmk_r1_sa *hnext; /* next entry in r1_hash bucket */
+	struct dl_list wheel; /* r1_wheel slot, if wheel_expiry is set */
+	os_time_t wheel_expiry; /* time to remove the entry, 0 for never */
 	u8 pmk_r1[PMK_LEN_MAX];
 	size_t pmk_r1_len;
 	u8 pmk_r1_name[WPA_PMK_NAME_LEN];
@@ -1200,74 +1220,97 @@ struct wpa_ft_pmk_r1_sa {
 struct wpa_ft_pmk_cache {
 	struct dl_list pmk_r0; /* struct wpa_ft_pmk_r0_sa */
 	struct dl_list pmk_r1; /* struct wpa_ft_pmk_r1_sa */
+	struct wpa_ft_pmk_r0_sa *r0_hash[FT_PMK_HASH_SIZE];
+	struct wpa_ft_pmk_r1_sa *r1_hash[FT_PMK_HASH_SIZE];
+	struct dl_list r0_wheel[FT_PMK_WHEEL_SIZE];
+	struct dl_list r1_wheel[FT_PMK_WHEEL_SIZE];
+	os_time_t wheel_time; /* last second processed by the wheel */
+	unsigned int wheel_entries; /* entries with wheel_expiry set */
+	struct dl_list push_queue; /* PMK-R0 entries waiting for PMK-R1 push */
+	unsigned int push_queue_len;
+	u64 push_credit; /* pmk_r1_push_rate tokens, in 1/1000 frames */
+	struct os_reltime push_refill; /* last push_credit update */
 };
 
 
-static void wpa_ft_expire_pmk_r0(void *eloop_ctx, void *timeout_ctx);
-static void wpa_ft_expire_pmk_r1(void *eloop_ctx, void *timeout_ctx);
+static void wpa_ft_pmk_cache_tick(void *eloop_ctx, void *timeout_ctx);
 
 
-static void wpa_ft_free_pmk_r0(struct wpa_ft_pmk_r0_sa *r0)
+static void wpa_ft_pmk_wheel_add(struct wpa_ft_pmk_cache *cache,
+				 struct dl_list *wheel, struct dl_list *entry,
+				 os_time_t expiry)
 {
-	if (!r0)
-		return;
-
-	dl_list_del(&r0->list);
-	eloop_cancel_timeout(wpa_ft_expire_pmk_r0, r0, NULL);
+	struct os_reltime now;
 
-	os_memset(r0->pmk_r0, 0, PMK_LEN_MAX);
-	os_free(r0->vlan);
-	os_free(r0->identity);
-	os_free(r0->radius_cui);
-	os_free(r0);
+	if (!cache->wheel_entries) {
+		os_get_reltime(&now);
+		cache->wheel_time = now.sec;
+		eloop_register_timeout(1, 0, wpa_ft_pmk_cache_tick, cache,
+				       NULL);
+	}
+	cache->wheel_entries++;
+	dl_list_add_tail(&wheel[expiry % FT_PMK_WHEEL_SIZE], entry);
 }
 
 
-static void wpa_ft_expire_pmk_r0(void *eloop_ctx, void *timeout_ctx)
+static void wpa_ft_pmk_wheel_del(struct wpa_ft_pmk_cache *cache,
+				 struct dl_list *entry)
 {
-	struct wpa_ft_pmk_r0_sa *r0 = eloop_ctx;
-	struct os_reltime now;
-	int expires_in;
-	int session_timeout;
+	dl_list_del(entry);
+	if (--cache->wheel_entries == 0)
+		eloop_cancel_timeout(wpa_ft_pmk_cache_tick, cache, NULL);
+}
 
-	os_get_reltime(&now);
+
+static void wpa_ft_free_pmk_r0(struct wpa_ft_pmk_cache *cache,
+			       struct wpa_ft_pmk_r0_sa *r0)
+{
+	struct wpa_ft_pmk_r0_sa **pos;
 
 	if (!r0)
 		return;
 
-	expires_in = r0->expiration - now.sec;
-	session_timeout = r0->session_timeout - now.sec;
-	/* conditions to remove from cache:
-	 * a) r0->expiration is set and hit
-	 * -or-
-	 * b) r0->session_timeout is set and hit
-	 */
-	if ((!r0->expiration || expires_in > 0) &&
-	    (!r0->session_timeout || session_timeout > 0)) {
-		wpa_printf(MSG_ERROR,
-			   "FT: %s() called for non-expired entry %p",
-			   __func__, r0);
-		eloop_cancel_timeout(wpa_ft_expire_pmk_r0, r0, NULL);
-		if (r0->expiration && expires_in > 0)
-			eloop_register_timeout(expires_in + 1, 0,
-					       wpa_ft_expire_pmk_r0, r0, NULL);
-		if (r0->session_timeout && session_timeout > 0)
-			eloop_register_timeout(session_timeout + 1, 0,
-					       wpa_ft_expire_pmk_r0, r0, NULL);
-		return;
+	dl_list_del(&r0->list);
+	for (pos = &cache->r0_hash[FT_PMK_HASH(r0->pmk_r0_name)]; *pos;
+	     pos = &(*pos)->hnext) {
+		if (*pos == r0) {
+			*pos = r0->hnext;
+			break;
+		}
+	}
+	if (r0->wheel_expiry)
+		wpa_ft_pmk_wheel_del(cache, &r0->wheel);
+	if (r0->push_queued) {
+		dl_list_del(&r0->push_list);
+		cache->push_queue_len--;
 	}
 
-	wpa_ft_free_pmk_r0(r0);
+	os_memset(r0->pmk_r0, 0, PMK_LEN_MAX);
+	os_free(r0->vlan);
+	os_free(r0->identity);
+	os_free(r0->radius_cui);
+	os_free(r0);
 }
 
 
-static void wpa_ft_free_pmk_r1(struct wpa_ft_pmk_r1_sa *r1)
+static void wpa_ft_free_pmk_r1(struct wpa_ft_pmk_cache *cache,
+			       struct wpa_ft_pmk_r1_sa *r1)
 {
+	struct wpa_ft_pmk_r1_sa **pos;
+
 	if (!r1)
 		return;
 
 	dl_list_del(&r1->list);
-	eloop_cancel_timeout(wpa_ft_expire_pmk_r1, r1, NULL);
+	for (pos = &cache->r1_hash[FT_PMK_HASH(r1->pmk_r1_name)]; *pos;
+	     pos = &(*pos)->hnext) {
+		if (*pos == r1) {
+			*pos = r1->hnext;
+			break;
+		}
+	}
+	if (r1->wheel_expiry)
+		wpa_ft_pmk_wheel_del(cache, &r1->wheel);
 
 	os_memset(r1->pmk_r1, 0, PMK_LEN_MAX);
 	os_free(r1->vlan);
@@ -1277,22 +1320,58 @@ static void wpa_ft_free_pmk_r1(struct wpa_ft_pmk_r1_sa *r1)
 }
 
 
-static void wpa_ft_expire_pmk_r1(void *eloop_ctx, void *timeout_ctx)
+static void wpa_ft_pmk_cache_tick(void *eloop_ctx, void *timeout_ctx)
 {
-	struct wpa_ft_pmk_r1_sa *r1 = eloop_ctx;
+	struct wpa_ft_pmk_cache *cache = eloop_ctx;
+	struct wpa_ft_pmk_r0_sa *r0, *r0prev;
+	struct wpa_ft_pmk_r1_sa *r1, *r1prev;
+	struct os_reltime now;
+	os_time_t t;
+
+	os_get_reltime(&now);
 
-	wpa_ft_free_pmk_r1(r1);
+	/* Visit every slot at most once even if the loop was stalled */
+	t = cache->wheel_time;
+	if (now.sec - t > FT_PMK_WHEEL_SIZE)
+		t = now.sec - FT_PMK_WHEEL_SIZE;
+
+	while (t < now.sec && cache->wheel_entries) {
+		t++;
+		dl_list_for_each_safe(r0, r0prev,
+				      &cache->r0_wheel[t % FT_PMK_WHEEL_SIZE],
+				      struct wpa_ft_pmk_r0_sa, wheel) {
+			if (r0->wheel_expiry <= now.sec)
+				wpa_ft_free_pmk_r0(cache, r0);
+		}
+		dl_list_for_each_safe(r1, r1prev,
+				      &cache->r1_wheel[t % FT_PMK_WHEEL_SIZE],
+				      struct wpa_ft_pmk_r1_sa, wheel) {
+			if (r1->wheel_expiry <= now.sec)
+				wpa_ft_free_pmk_r1(cache, r1);
+		}
+	}
+	cache->wheel_time = now.sec;
+
+	if (cache->wheel_entries)
+		eloop_register_timeout(1, 0, wpa_ft_pmk_cache_tick, cache,
+				       NULL);
 }
 
 
 struct wpa_ft_pmk_cache * wpa_ft_pmk_cache_init(void)
 {
 	struct wpa_ft_pmk_cache *cache;
+	int i;
 
 	cache = os_zalloc(sizeof(*cache));
 	if (cache) {
 		dl_list_init(&cache->pmk_r0);
 		dl_list_init(&cache->pmk_r1);
+		dl_list_init(&cache->push_queue);
+		for (i = 0; i < FT_PMK_WHEEL_SIZE; i++) {
+			dl_list_init(&cache->r0_wheel[i]);
+			dl_list_init(&cache->r1_wheel[i]);
+		}
 	}
 
 	return cache;
@@ -1306,12 +1385,13 @@ void wpa_ft_pmk_cache_deinit(struct wpa_ft_pmk_cache *cache)
 
 	dl_list_for_each_safe(r0, r0prev, &cache->pmk_r0,
 			      struct wpa_ft_pmk_r0_sa, list)
-		wpa_ft_free_pmk_r0(r0);
+		wpa_ft_free_pmk_r0(cache, r0);
 
 	dl_list_for_each_safe(r1, r1prev, &cache->pmk_r1,
 			      struct wpa_ft_pmk_r1_sa, list)
-		wpa_ft_free_pmk_r1(r1);
+		wpa_ft_free_pmk_r1(cache, r1);
 
+	eloop_cancel_timeout(wpa_ft_pmk_cache_tick, cache, NULL);
 	os_free(cache);
 }
 
@@ -1369,12 +1449,18 @@ static int wpa_ft_store_pmk_r0(struct wpa_authenticator *wpa_auth,
 		r0->session_timeout = now.sec + session_timeout;
 
 	DL_LIST_ADD(&cache->pmk_r0, r0, list);
-	if (expires_in > 0)
-		eloop_register_timeout(expires_in + 1, 0, wpa_ft_expire_pmk_r0,
-				       r0, NULL);
-	if (session_timeout > 0)
-		eloop_register_timeout(session_timeout + 1, 0,
-				       wpa_ft_expire_pmk_r0, r0, NULL);
+	r0->hnext = cache->r0_hash[FT_PMK_HASH(r0->pmk_r0_name)];
+	cache->r0_hash[FT_PMK_HASH(r0->pmk_r0_name)] = r0;
+
+	/* Remove when either the key lifetime or the session timeout is hit */
+	if (r0->expiration)
+		r0->wheel_expiry = r0->expiration + 1;
+	if (r0->session_timeout &&
+	    (!r0->wheel_expiry || r0->session_timeout + 1 < r0->wheel_expiry))
+		r0->wheel_expiry = r0->session_timeout + 1;
+	if (r0->wheel_expiry)
+		wpa_ft_pmk_wheel_add(cache, cache->r0_wheel, &r0->wheel,
+				     r0->wheel_expiry);
 
 	return 0;
 }
@@ -1389,7 +1475,7 @@ static int wpa_ft_fetch_pmk_r0(struct wpa_authenticator *wpa_auth,
 	struct os_reltime now;
 
 	os_get_reltime(&now);
-	dl_list_for_each(r0, &cache->pmk_r0, struct wpa_ft_pmk_r0_sa, list) {
+	for (r0 = cache->r0_hash[FT_PMK_HASH(pmk_r0_name)]; r0; r0 = r0->hnext) {
 		if (os_memcmp(r0->spa, spa, ETH_ALEN) == 0 &&
 		    os_memcmp_const(r0->pmk_r0_name, pmk_r0_name,
 				    WPA_PMK_NAME_LEN) == 0) {
@@ -1458,13 +1544,17 @@ static int wpa_ft_store_pmk_r1(struct wpa_authenticator *wpa_auth,
 		r1->session_timeout = now.sec + session_timeout;
 
 	DL_LIST_ADD(&cache->pmk_r1, r1, list);
+	r1->hnext = cache->r1_hash[FT_PMK_HASH(r1->pmk_r1_name)];
+	cache->r1_hash[FT_PMK_HASH(r1->pmk_r1_name)] = r1;
 
 	if (expires_in > 0)
-		eloop_register_timeout(expires_in + 1, 0, wpa_ft_expire_pmk_r1,
-				       r1, NULL);
-	if (session_timeout > 0)
-		eloop_register_timeout(session_timeout + 1, 0,
-				       wpa_ft_expire_pmk_r1, r1, NULL);
+		r1->wheel_expiry = now.sec + expires_in + 1;
+	if (r1->session_timeout &&
+	    (!r1->wheel_expiry || r1->session_timeout + 1 < r1->wheel_expiry))
+		r1->wheel_expiry = r1->session_timeout + 1;
+	if (r1->wheel_expiry)
+		wpa_ft_pmk_wheel_add(cache, cache->r1_wheel, &r1->wheel,
+				     r1->wheel_expiry);
 
 	return 0;
 }
@@ -1484,7 +1574,7 @@ static int wpa_ft_fetch_pmk_r1(struct wpa_authenticator *wpa_auth,
 
 	os_get_reltime(&now);
 
-	dl_list_for_each(r1, &cache->pmk_r1, struct wpa_ft_pmk_r1_sa, list) {
+	for (r1 = cache->r1_hash[FT_PMK_HASH(pmk_r1_name)]; r1; r1 = r1->hnext) {
 		if (os_memcmp(r1->spa, spa, ETH_ALEN) == 0 &&
 		    os_memcmp_const(r1->pmk_r1_name, pmk_r1_name,
 				    WPA_PMK_NAME_LEN) == 0) {
@@ -1519,6 +1609,162 @@ static int wpa_ft_fetch_pmk_r1(struct wpa_authenticator *wpa_auth,
 }
 
 
+/*
+ * Snapshot entry format:
+ * type(1: 0 = PMK-R0, 1 = PMK-R1) PMKName(16) SPA(6) pairwise(4)
+ * expiration(8) session timeout(8) PMK identity CUI VLAN
+ */
+#define FT_SNAPSHOT_FIXED_LEN (1 + WPA_PMK_NAME_LEN + ETH_ALEN + 4 + 8 + 8)
+#define FT_SNAPSHOT_VLAN_LEN (1 + 4 + 4 * MAX_NUM_TAGGED_VLAN)
+
+static void wpa_ft_pmk_snapshot_put(struct wpabuf *buf, u8 type,
+				    const u8 *name, const u8 *spa,
+				    int pairwise, os_time_t expiration,
+				    os_time_t session_timeout,
+				    const u8 *pmk, size_t pmk_len,
+				    const struct vlan_description *vlan,
+				    const u8 *identity, size_t identity_len,
+				    const u8 *radius_cui, size_t radius_cui_len)
+{
+	wpabuf_put_u8(buf, type);
+	wpabuf_put_data(buf, name, WPA_PMK_NAME_LEN);
+	wpabuf_put_data(buf, spa, ETH_ALEN);
+	wpabuf_put_be32(buf, pairwise);
+	wpabuf_put_be64(buf, pmksa_cache_snapshot_expiry(expiration));
+	wpabuf_put_be64(buf, pmksa_cache_snapshot_expiry(session_timeout));
+	pmksa_cache_snapshot_put_blob(buf, pmk, pmk_len);
+	pmksa_cache_snapshot_put_blob(buf, identity, identity_len);
+	pmksa_cache_snapshot_put_blob(buf, radius_cui, radius_cui_len);
+	pmksa_cache_snapshot_put_vlan(buf, vlan);
+}
+
+
+/**
+ * wpa_ft_pmk_cache_export - Serialize FT PMK-R0/R1 caches for a snapshot
+ * @wpa_auth: Pointer to WPA authenticator data from wpa_init()
+ * Returns: Buffer with the entries (to be freed with wpabuf_clear_free()) or
+ * %NULL on failure
+ */
+struct wpabuf * wpa_ft_pmk_cache_export(struct wpa_authenticator *wpa_auth)
+{
+	struct wpa_ft_pmk_cache *cache = wpa_auth->ft_pmk_cache;
+	struct wpa_ft_pmk_r0_sa *r0;
+	struct wpa_ft_pmk_r1_sa *r1;
+	struct wpabuf *buf;
+	size_t len = 0;
+
+	dl_list_for_each(r0, &cache->pmk_r0, struct wpa_ft_pmk_r0_sa, list)
+		len += FT_SNAPSHOT_FIXED_LEN + 3 * 2 + r0->pmk_r0_len +
+			r0->identity_len + r0->radius_cui_len +
+			FT_SNAPSHOT_VLAN_LEN;
+	dl_list_for_each(r1, &cache->pmk_r1, struct wpa_ft_pmk_r1_sa, list)
+		len += FT_SNAPSHOT_FIXED_LEN + 3 * 2 + r1->pmk_r1_len +
+			r1->identity_len + r1->radius_cui_len +
+			FT_SNAPSHOT_VLAN_LEN;
+
+	buf = wpabuf_alloc(len);
+	if (!buf)
+		return NULL;
+
+	/* Oldest first so that the restored lists keep their order */
+	dl_list_for_each_reverse(r0, &cache->pmk_r0, struct wpa_ft_pmk_r0_sa,
+				 list)
+		wpa_ft_pmk_snapshot_put(buf, 0, r0->pmk_r0_name, r0->spa,
+					r0->pairwise, r0->expiration,
+					r0->session_timeout, r0->pmk_r0,
+					r0->pmk_r0_len, r0->vlan,
+					r0->identity, r0->identity_len,
+					r0->radius_cui, r0->radius_cui_len);
+	/* PMK-R1 only keeps the earlier of its two deadlines; wheel_expiry is
+	 * one second past it. */
+	dl_list_for_each_reverse(r1, &cache->pmk_r1, struct wpa_ft_pmk_r1_sa,
+				 list)
+		wpa_ft_pmk_snapshot_put(buf, 1, r1->pmk_r1_name, r1->spa,
+					r1->pairwise,
+					r1->wheel_expiry ?
+					r1->wheel_expiry - 1 : 0,
+					r1->session_timeout, r1->pmk_r1,
+					r1->pmk_r1_len, r1->vlan,
+					r1->identity, r1->identity_len,
+					r1->radius_cui, r1->radius_cui_len);
+
+	return buf;
+}
+
+
+/**
+ * wpa_ft_pmk_cache_import - Add FT PMK-R0/R1 cache entries from a snapshot
+ * @wpa_auth: Pointer to WPA authenticator data from wpa_init()
+ * @data: Entries from wpa_ft_pmk_cache_export()
+ * @len: Length of data
+ * Returns: Number of entries added or -1 if the data is malformed
+ *
+ * Entries that have expired since the snapshot was taken are skipped.
+ */
+int wpa_ft_pmk_cache_import(struct wpa_authenticator *wpa_auth,
+			    const u8 *data, size_t len)
+{
+	const u8 *pos = data, *end = data + len;
+	const u8 *name, *spa, *pmk, *identity, *radius_cui;
+	size_t pmk_len, identity_len, radius_cui_len;
+	struct vlan_description vlan;
+	int type, pairwise, expires_in, session_timeout, res, count = 0;
+
+	while (end - pos > 0) {
+		if (end - pos < FT_SNAPSHOT_FIXED_LEN)
+			return -1;
+		type = *pos++;
+		name = pos;
+		pos += WPA_PMK_NAME_LEN;
+		spa = pos;
+		pos += ETH_ALEN;
+		pairwise = WPA_GET_BE32(pos);
+		pos += 4;
+		expires_in = pmksa_cache_snapshot_remaining(WPA_GET_BE64(pos));
+		pos += 8;
+		session_timeout =
+			pmksa_cache_snapshot_remaining(WPA_GET_BE64(pos));
+		pos += 8;
+
+		pmk = pmksa_cache_snapshot_get_blob(&pos, end, &pmk_len);
+		identity = pmksa_cache_snapshot_get_blob(&pos, end,
+							 &identity_len);
+		radius_cui = pmksa_cache_snapshot_get_blob(&pos, end,
+							   &radius_cui_len);
+		if (!pmk || !identity || !radius_cui || type > 1 ||
+		    pmk_len > PMK_LEN_MAX ||
+		    pmksa_cache_snapshot_get_vlan(&pos, end, &vlan) < 0)
+			return -1;
+
+		if (expires_in < 0 || session_timeout < 0)
+			continue;
+
+		if (type == 0)
+			res = wpa_ft_store_pmk_r0(wpa_auth, spa, pmk, pmk_len,
+						  name, pairwise, &vlan,
+						  expires_in, session_timeout,
+						  identity_len ? identity : NULL,
+						  identity_len,
+						  radius_cui_len ?
+						  radius_cui : NULL,
+						  radius_cui_len);
+		else
+			res = wpa_ft_store_pmk_r1(wpa_auth, spa, pmk, pmk_len,
+						  name, pairwise, &vlan,
+						  expires_in, session_timeout,
+						  identity_len ? identity : NULL,
+						  identity_len,
+						  radius_cui_len ?
+						  radius_cui : NULL,
+						  radius_cui_len);
+		if (res == 0)
+			count++;
+	}
+
+	return count;
+}
+
+
 static int wpa_ft_rrb_init_r0kh_seq(struct ft_remote_r0kh *r0kh)
 {
 	if (r0kh->seq)
@@ -1536,6 +1782,61 @@ static int wpa_ft_rrb_init_r0kh_seq(struct ft_remote_r0kh *r0kh)
 }
 
 
+static unsigned int wpa_ft_rkh_hash(const u8 *id, size_t id_len)
+{
+	unsigned int hash = 0;
+
+	while (id_len--)
+		hash = hash * 31 + *id++;
+
+	return hash % FT_RKH_HASH_SIZE;
+}
+
+
+/*
+ * Index the R0KH/R1KH lists by key holder ID. The list lookup used to pick the
+ * last matching entry, so buckets are kept in reverse list order and the first
+ * match in a bucket is the one to use. Must be called again whenever entries
+ * are added to the configured lists, e.g. by SET r0kh/r1kh.
+ */
+void wpa_ft_rkh_index_rebuild(struct wpa_authenticator *wpa_auth)
+{
+	struct ft_remote_r0kh *r0kh;
+	struct ft_remote_r1kh *r1kh;
+	unsigned int idx;
+
+	os_memset(wpa_auth->r0kh_hash, 0, sizeof(wpa_auth->r0kh_hash));
+	os_memset(wpa_auth->r1kh_hash, 0, sizeof(wpa_auth->r1kh_hash));
+	wpa_auth->r0kh_wildcard = NULL;
+	wpa_auth->r1kh_wildcard = NULL;
+
+	if (wpa_auth->conf.r0kh_list)
+		r0kh = *wpa_auth->conf.r0kh_list;
+	else
+		r0kh = NULL;
+	for (; r0kh; r0kh = r0kh->next) {
+		if (r0kh->id_len == 1 && r0kh->id[0] == '*')
+			wpa_auth->r0kh_wildcard = r0kh;
+		idx = wpa_ft_rkh_hash(r0kh->id, r0kh->id_len);
+		r0kh->hnext = wpa_auth->r0kh_hash[idx];
+		wpa_auth->r0kh_hash[idx] = r0kh;
+	}
+
+	if (wpa_auth->conf.r1kh_list)
+		r1kh = *wpa_auth->conf.r1kh_list;
+	else
+		r1kh = NULL;
+	for (; r1kh; r1kh = r1kh->next) {
+		if (is_zero_ether_addr(r1kh->addr) &&
+		    is_zero_ether_addr(r1kh->id))
+			wpa_auth->r1kh_wildcard = r1kh;
+		idx = wpa_ft_rkh_hash(r1kh->id, FT_R1KH_ID_LEN);
+		r1kh->hnext = wpa_auth->r1kh_hash[idx];
+		wpa_auth->r1kh_hash[idx] = r1kh;
+	}
+}
+
+
 static void wpa_ft_rrb_lookup_r0kh(struct wpa_authenticator *wpa_auth,
 				   const u8 *f_r0kh_id, size_t f_r0kh_id_len,
 				   struct ft_remote_r0kh **r0kh_out,
@@ -1543,19 +1844,20 @@ static void wpa_ft_rrb_lookup_r0kh(struct wpa_authenticator *wpa_auth,
 {
 	struct ft_remote_r0kh *r0kh;
 
-	*r0kh_wildcard = NULL;
+	*r0kh_wildcard = wpa_auth->r0kh_wildcard;
 	*r0kh_out = NULL;
 
-	if (wpa_auth->conf.r0kh_list)
-		r0kh = *wpa_auth->conf.r0kh_list;
+	if (f_r0kh_id)
+		r0kh = wpa_auth->r0kh_hash[wpa_ft_rkh_hash(f_r0kh_id,
+							   f_r0kh_id_len)];
 	else
 		r0kh = NULL;
-	for (; r0kh; r0kh = r0kh->next) {
-		if (r0kh->id_len == 1 && r0kh->id[0] == '*')
-			*r0kh_wildcard = r0kh;
-		if (f_r0kh_id && r0kh->id_len == f_r0kh_id_len &&
-		    os_memcmp_const(f_r0kh_id, r0kh->id, f_r0kh_id_len) == 0)
+	for (; r0kh; r0kh = r0kh->hnext) {
+		if (r0kh->id_len == f_r0kh_id_len &&
+		    os_memcmp_const(f_r0kh_id, r0kh->id, f_r0kh_id_len) == 0) {
 			*r0kh_out = r0kh;
+			break;
+		}
 	}
 
 	if (!*r0kh_out && !*r0kh_wildcard)
@@ -1590,20 +1892,19 @@ static void wpa_ft_rrb_lookup_r1kh(struct wpa_authenticator *wpa_auth,
 {
 	struct ft_remote_r1kh *r1kh;
 
-	*r1kh_wildcard = NULL;
+	*r1kh_wildcard = wpa_auth->r1kh_wildcard;
 	*r1kh_out = NULL;
 
-	if (wpa_auth->conf.r1kh_list)
-		r1kh = *wpa_auth->conf.r1kh_list;
+	if (f_r1kh_id)
+		r1kh = wpa_auth->r1kh_hash[wpa_ft_rkh_hash(f_r1kh_id,
+							   FT_R1KH_ID_LEN)];
 	else
 		r1kh = NULL;
-	for (; r1kh; r1kh = r1kh->next) {
-		if (is_zero_ether_addr(r1kh->addr) &&
-		    is_zero_ether_addr(r1kh->id))
-			*r1kh_wildcard = r1kh;
-		if (f_r1kh_id &&
-		    os_memcmp_const(r1kh->id, f_r1kh_id, FT_R1KH_ID_LEN) == 0)
+	for (; r1kh; r1kh = r1kh->hnext) {
+		if (os_memcmp_const(r1kh->id, f_r1kh_id, FT_R1KH_ID_LEN) == 0) {
 			*r1kh_out = r1kh;
+			break;
+		}
 	}
 
 	if (!*r1kh_out && !*r1kh_wildcard)
@@ -1640,7 +1941,7 @@ static int wpa_ft_rrb_check_r1kh(struct wpa_authenticator *wpa_auth,
 static void wpa_ft_rrb_del_r0kh(void *eloop_ctx, void *timeout_ctx)
 {
 	struct wpa_authenticator *wpa_auth = eloop_ctx;
-	struct ft_remote_r0kh *r0kh, *prev = NULL;
+	struct ft_remote_r0kh *r0kh, *prev = NULL, **pos;
 
 	if (!wpa_auth->conf.r0kh_list)
 		return;
@@ -1656,6 +1957,14 @@ static void wpa_ft_rrb_del_r0kh(void *eloop_ctx, void *timeout_ctx)
 		prev->next = r0kh->next;
 	else
 		*wpa_auth->conf.r0kh_list = r0kh->next;
+	for (pos = &wpa_auth->r0kh_hash[wpa_ft_rkh_hash(r0kh->id,
+							r0kh->id_len)];
+	     *pos; pos = &(*pos)->hnext) {
+		if (*pos == r0kh) {
+			*pos = r0kh->hnext;
+			break;
+		}
+	}
 	if (r0kh->seq)
 		wpa_ft_rrb_seq_flush(wpa_auth, r0kh->seq, 0);
 	os_free(r0kh->seq);
@@ -1689,7 +1998,7 @@ wpa_ft_rrb_add_r0kh(struct wpa_authenticator *wpa_auth,
 		    const u8 *src_addr, const u8 *r0kh_id, size_t id_len,
 		    int timeout)
 {
-	struct ft_remote_r0kh *r0kh;
+	struct ft_remote_r0kh *r0kh, **pos;
 
 	if (!wpa_auth->conf.r0kh_list)
 		return NULL;
@@ -1710,6 +2019,12 @@ wpa_ft_rrb_add_r0kh(struct wpa_authenticator *wpa_auth,
 
 	r0kh->next = *wpa_auth->conf.r0kh_list;
 	*wpa_auth->conf.r0kh_list = r0kh;
+	/* New list head is the last one to match, add it to the bucket tail */
+	for (pos = &wpa_auth->r0kh_hash[wpa_ft_rkh_hash(r0kh->id,
+							r0kh->id_len)];
+	     *pos; pos = &(*pos)->hnext)
+		;
+	*pos = r0kh;
 
 	if (timeout > 0)
 		eloop_register_timeout(timeout, 0, wpa_ft_rrb_del_r0kh,
@@ -1725,7 +2040,7 @@ wpa_ft_rrb_add_r0kh(struct wpa_authenticator *wpa_auth,
 static void wpa_ft_rrb_del_r1kh(void *eloop_ctx, void *timeout_ctx)
 {
 	struct wpa_authenticator *wpa_auth = eloop_ctx;
-	struct ft_remote_r1kh *r1kh, *prev = NULL;
+	struct ft_remote_r1kh *r1kh, *prev = NULL, **pos;
 
 	if (!wpa_auth->conf.r1kh_list)
 		return;
@@ -1741,6 +2056,14 @@ static void wpa_ft_rrb_del_r1kh(void *eloop_ctx, void *timeout_ctx)
 		prev->next = r1kh->next;
 	else
 		*wpa_auth->conf.r1kh_list = r1kh->next;
+	for (pos = &wpa_auth->r1kh_hash[wpa_ft_rkh_hash(r1kh->id,
+							FT_R1KH_ID_LEN)];
+	     *pos; pos = &(*pos)->hnext) {
+		if (*pos == r1kh) {
+			*pos = r1kh->hnext;
+			break;
+		}
+	}
 	if (r1kh->seq)
 		wpa_ft_rrb_seq_flush(wpa_auth, r1kh->seq, 0);
 	os_free(r1kh->seq);
@@ -1762,7 +2085,7 @@ wpa_ft_rrb_add_r1kh(struct wpa_authenticator *wpa_auth,
 		    struct ft_remote_r1kh *r1kh_wildcard,
 		    const u8 *src_addr, const u8 *r1kh_id, int timeout)
 {
-	struct ft_remote_r1kh *r1kh;
+	struct ft_remote_r1kh *r1kh, **pos;
 
 	if (!wpa_auth->conf.r1kh_list)
 		return NULL;
@@ -1776,6 +2099,12 @@ wpa_ft_rrb_add_r1kh(struct wpa_authenticator *wpa_auth,
 	os_memcpy(r1kh->key, r1kh_wildcard->key, sizeof(r1kh->key));
 	r1kh->next = *wpa_auth->conf.r1kh_list;
 	*wpa_auth->conf.r1kh_list = r1kh;
+	/* New list head is the last one to match, add it to the bucket tail */
+	for (pos = &wpa_auth->r1kh_hash[wpa_ft_rkh_hash(r1kh->id,
+							FT_R1KH_ID_LEN)];
+	     *pos; pos = &(*pos)->hnext)
+		;
+	*pos = r1kh;
 
 	if (timeout > 0)
 		eloop_register_timeout(timeout, 0, wpa_ft_rrb_del_r1kh,
@@ -1869,11 +2198,14 @@ static void wpa_ft_deinit_rkh_tmp(struct wpa_authenticator *wpa_auth)
 		}
 		r1kh = r1kh_next;
 	}
+
+	wpa_ft_rkh_index_rebuild(wpa_auth);
 }
 
 
 void wpa_ft_deinit(struct wpa_authenticator *wpa_auth)
 {
+	eloop_cancel_timeout(wpa_ft_push_batch_timeout, wpa_auth, NULL);
 	wpa_ft_deinit_seq(wpa_auth);
 	wpa_ft_deinit_rkh_tmp(wpa_auth);
 }
@@ -2965,9 +3297,12 @@ static int wpa_ft_process_auth_req(struct wpa_state_machine *sm,
 					       &session_timeout) == 0) {
 			wpa_printf(MSG_DEBUG,
 				   "FT: Generated PMK-R1 based on local PMK-R0");
+			sm->wpa_auth->ft_r1_local++;
 			goto pmk_r1_derived;
 		}
 
+		sm->wpa_auth->ft_r1_misses++;
+
 		if (wpa_ft_pull_pmk_r1(sm, ies, ies_len, parse.rsn_pmkid) < 0) {
 			wpa_printf(MSG_DEBUG,
 				   "FT: Did not have matching PMK-R1 and either unknown or blocked R0KH-ID or NAK from R0KH");
@@ -2977,6 +3312,7 @@ static int wpa_ft_process_auth_req(struct wpa_state_machine *sm,
 		return -1; /* Status pending */
 	} else {
 		wpa_printf(MSG_DEBUG, "FT: Found PMKR1Name from local cache");
+		sm->wpa_auth->ft_r1_hits++;
 	}
 
 pmk_r1_derived:
@@ -3879,6 +4215,8 @@ static int wpa_ft_rrb_rx_r1(struct wpa_authenticator *wpa_auth,
 				f_identity, f_identity_len, f_radius_cui,
 				f_radius_cui_len) < 0)
 		goto out;
+	if (type == FT_PACKET_R0KH_R1KH_PUSH)
+		wpa_auth->ft_push_rx++;
 
 	ret = 0;
 out:
@@ -4537,11 +4875,141 @@ static int wpa_ft_generate_pmk_r1(struct wpa_authenticator *wpa_auth,
 }
 
 
+static int wpa_ft_push_r1kh_usable(struct ft_remote_r1kh *r1kh)
+{
+	if (is_zero_ether_addr(r1kh->addr) ||
+	    is_zero_ether_addr(r1kh->id))
+		return 0;
+	return wpa_ft_rrb_init_r1kh_seq(r1kh) == 0;
+}
+
+
+/* Add the push frames earned since the last refill, in 1/1000 frames */
+static void wpa_ft_push_refill(struct wpa_authenticator *wpa_auth,
+			       unsigned int num_r1kh)
+{
+	struct wpa_ft_pmk_cache *cache = wpa_auth->ft_pmk_cache;
+	u64 rate = wpa_auth->conf.pmk_r1_push_rate;
+	u64 max_credit;
+	struct os_reltime now, age;
+
+	/*
+	 * Do not build up a burst while idle beyond one batch interval, but
+	 * always allow enough for the pushes of a single station.
+	 */
+	max_credit = rate * wpa_auth->conf.pmk_r1_push_batch_interval;
+	if (max_credit < (u64) num_r1kh * 1000)
+		max_credit = (u64) num_r1kh * 1000;
+
+	os_get_reltime(&now);
+	if (os_reltime_initialized(&cache->push_refill)) {
+		os_reltime_sub(&now, &cache->push_refill, &age);
+		cache->push_credit += rate * (age.sec * 1000 +
+					      age.usec / 1000);
+	} else {
+		cache->push_credit = max_credit;
+	}
+	cache->push_refill = now;
+
+	if (cache->push_credit > max_credit)
+		cache->push_credit = max_credit;
+}
+
+
+static void wpa_ft_push_batch_timeout(void *eloop_ctx, void *timeout_ctx)
+{
+	struct wpa_authenticator *wpa_auth = eloop_ctx;
+	struct wpa_ft_pmk_cache *cache = wpa_auth->ft_pmk_cache;
+	struct wpa_ft_pmk_r0_sa *r0, *r0prev;
+	struct ft_remote_r1kh *r1kh;
+	struct dl_list batch;
+	unsigned int num_r1kh = 0, num_sta = 0;
+	int rate = wpa_auth->conf.pmk_r1_push_rate;
+	int interval = wpa_auth->conf.pmk_r1_push_batch_interval;
+	u64 cost;
+
+	if (wpa_auth->conf.r1kh_list) {
+		for (r1kh = *wpa_auth->conf.r1kh_list; r1kh; r1kh = r1kh->next)
+			if (wpa_ft_push_r1kh_usable(r1kh))
+				num_r1kh++;
+	}
+
+	/*
+	 * pmk_r1_push_rate is a frame budget: a station costs one frame per
+	 * R1KH and only goes once the credit covers all of them.
+	 */
+	cost = (u64) num_r1kh * 1000;
+	if (rate && cost)
+		wpa_ft_push_refill(wpa_auth, num_r1kh);
+
+	dl_list_init(&batch);
+	dl_list_for_each_safe(r0, r0prev, &cache->push_queue,
+			      struct wpa_ft_pmk_r0_sa, push_list) {
+		if (rate && cost) {
+			if (cache->push_credit < cost)
+				break;
+			cache->push_credit -= cost;
+		}
+		dl_list_del(&r0->push_list);
+		dl_list_add_tail(&batch, &r0->push_list);
+		num_sta++;
+	}
+
+	wpa_printf(MSG_DEBUG,
+		   "FT: Pushing PMK-R1 keys for %u STAs to %u R1KHs (%u STAs left queued)",
+		   num_sta, num_r1kh, cache->push_queue_len - num_sta);
+
+	/* Keep the frames to the same R1KH back to back */
+	if (num_r1kh) {
+		for (r1kh = *wpa_auth->conf.r1kh_list; r1kh; r1kh = r1kh->next) {
+			if (!r1kh->seq || is_zero_ether_addr(r1kh->addr) ||
+			    is_zero_ether_addr(r1kh->id))
+				continue;
+			dl_list_for_each(r0, &batch, struct wpa_ft_pmk_r0_sa,
+					 push_list) {
+				if (wpa_ft_generate_pmk_r1(wpa_auth, r0, r1kh,
+							   r0->spa) == 0)
+					wpa_auth->ft_push_tx++;
+			}
+		}
+	}
+
+	dl_list_for_each_safe(r0, r0prev, &batch, struct wpa_ft_pmk_r0_sa,
+			      push_list) {
+		dl_list_del(&r0->push_list);
+		r0->push_queued = 0;
+		cache->push_queue_len--;
+	}
+	if (num_sta)
+		wpa_auth->ft_push_batches++;
+
+	if (dl_list_empty(&cache->push_queue))
+		return;
+
+	if (num_sta)
+		wpa_auth->ft_push_deferred++;
+
+	/*
+	 * When one station needs more frames than a batch interval earns,
+	 * wait until the credit for it has built up instead.
+	 */
+	if (rate && cost > (u64) rate * interval) {
+		u64 wait = (cost - cache->push_credit + rate - 1) / rate;
+
+		if (wait > (u64) interval)
+			interval = wait;
+	}
+	eloop_register_timeout(interval / 1000, (interval % 1000) * 1000,
+			       wpa_ft_push_batch_timeout, wpa_auth, NULL);
+}
+
+
 void wpa_ft_push_pmk_r1(struct wpa_authenticator *wpa_auth, const u8 *addr)
 {
 	struct wpa_ft_pmk_cache *cache = wpa_auth->ft_pmk_cache;
 	struct wpa_ft_pmk_r0_sa *r0, *r0found = NULL;
 	struct ft_remote_r1kh *r1kh;
+	int interval = wpa_auth->conf.pmk_r1_push_batch_interval;
 
 	if (!wpa_auth->conf.pmk_r1_push)
 		return;
@@ -4560,17 +5028,68 @@ void wpa_ft_push_pmk_r1(struct wpa_authenticator *wpa_auth, const u8 *addr)
 		return;
 	r0->pmk_r1_pushed = 1;
 
+	if (interval > 0) {
+		wpa_printf(MSG_DEBUG, "FT: Queueing PMK-R1 push for STA " MACSTR,
+			   MAC2STR(addr));
+		dl_list_add_tail(&cache->push_queue, &r0->push_list);
+		r0->push_queued = 1;
+		cache->push_queue_len++;
+		if (!eloop_is_timeout_registered(wpa_ft_push_batch_timeout,
+						 wpa_auth, NULL))
+			eloop_register_timeout(interval / 1000,
+					       (interval % 1000) * 1000,
+					       wpa_ft_push_batch_timeout,
+					       wpa_auth, NULL);
+		return;
+	}
+
 	wpa_printf(MSG_DEBUG, "FT: Deriving and pushing PMK-R1 keys to R1KHs "
 		   "for STA " MACSTR, MAC2STR(addr));
 
 	for (r1kh = *wpa_auth->conf.r1kh_list; r1kh; r1kh = r1kh->next) {
-		if (is_zero_ether_addr(r1kh->addr) ||
-		    is_zero_ether_addr(r1kh->id))
+		if (!wpa_ft_push_r1kh_usable(r1kh))
 			continue;
-		if (wpa_ft_rrb_init_r1kh_seq(r1kh) < 0)
-			continue;
-		wpa_ft_generate_pmk_r1(wpa_auth, r0, r1kh, addr);
+		if (wpa_ft_generate_pmk_r1(wpa_auth, r0, r1kh, addr) == 0)
+			wpa_auth->ft_push_tx++;
 	}
 }
 
+
+int wpa_ft_push_status(struct wpa_authenticator *wpa_auth, char *buf,
+		       size_t buflen)
+{
+	int ret;
+
+	if (wpa_auth == NULL || wpa_auth->ft_pmk_cache == NULL)
+		return 0;
+
+	ret = os_snprintf(buf, buflen,
+			  "push=%d\n"
+			  "batch_interval=%d\n"
+			  "rate=%d\n"
+			  "queued=%u\n"
+			  "batches=%u\n"
+			  "deferred=%u\n"
+			  "push_tx=%u\n"
+			  "push_rx=%u\n"
+			  "r1_hits=%u\n"
+			  "r1_local=%u\n"
+			  "r1_misses=%u\n",
+			  wpa_auth->conf.pmk_r1_push,
+			  wpa_auth->conf.pmk_r1_push_batch_interval,
+			  wpa_auth->conf.pmk_r1_push_rate,
+			  wpa_auth->ft_pmk_cache->push_queue_len,
+			  wpa_auth->ft_push_batches,
+			  wpa_auth->ft_push_deferred,
+			  wpa_auth->ft_push_tx,
+			  wpa_auth->ft_push_rx,
+			  wpa_auth->ft_r1_hits,
+			  wpa_auth->ft_r1_local,
+			  wpa_auth->ft_r1_misses);
+	if (os_snprintf_error(buflen, ret))
+		return 0;
+
+	return ret;
+}
+
 #endif /* CONFIG_IEEE80211R_AP */
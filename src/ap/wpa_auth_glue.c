@@ -50,6 +50,9 @@ static void hostapd_wpa_auth_conf(struct hostapd_bss_config *conf,
 	wconf->wpa_disable_eapol_key_retries =
 		conf->wpa_disable_eapol_key_retries;
 	wconf->wpa_pairwise_update_count = conf->wpa_pairwise_update_count;
+	wconf->wpa_group_rekey_batch = conf->wpa_group_rekey_batch;
+	wconf->wpa_group_rekey_batch_interval =
+		conf->wpa_group_rekey_batch_interval;
 	wconf->rsn_pairwise = conf->rsn_pairwise;
 	wconf->rsn_preauth = conf->rsn_preauth;
 	wconf->eapol_version = conf->eapol_version;
@@ -60,6 +63,11 @@ static void hostapd_wpa_auth_conf(struct hostapd_bss_config *conf,
 	wconf->ocv = conf->ocv;
 #endif /* CONFIG_OCV */
 	wconf->okc = conf->okc;
+	wconf->pmksa_cache_file = conf->pmksa_cache_file;
+	os_memcpy(wconf->pmksa_cache_file_key, conf->pmksa_cache_file_key,
+		  conf->pmksa_cache_file_key_len);
+	wconf->pmksa_cache_file_key_len = conf->pmksa_cache_file_key_len;
+	wconf->pmksa_cache_save_interval = conf->pmksa_cache_save_interval;
 #ifdef CONFIG_IEEE80211W
 	wconf->ieee80211w = conf->ieee80211w;
 	wconf->group_mgmt_cipher = conf->group_mgmt_cipher;
@@ -89,6 +97,8 @@ static void hostapd_wpa_auth_conf(struct hostapd_bss_config *conf,
 	wconf->r0kh_list = &conf->r0kh_list;
 	wconf->r1kh_list = &conf->r1kh_list;
 	wconf->pmk_r1_push = conf->pmk_r1_push;
+	wconf->pmk_r1_push_batch_interval = conf->pmk_r1_push_batch_interval;
+	wconf->pmk_r1_push_rate = conf->pmk_r1_push_rate;
 	wconf->ft_over_ds = conf->ft_over_ds;
 	wconf->ft_psk_generate_local = conf->ft_psk_generate_local;
 #endif /* CONFIG_IEEE80211R_AP */
@@ -357,6 +367,8 @@ static int hostapd_wpa_auth_set_key(void *ctx, int vlan_id, enum wpa_alg alg,
 {
 	struct hostapd_data *hapd = ctx;
 	const char *ifname = hapd->conf->iface;
+	struct os_reltime start;
+	int ret;
 
 	if (vlan_id > 0) {
 		ifname = hostapd_get_vlan_id_ifname(hapd->conf->vlan, vlan_id);
@@ -395,8 +407,13 @@ static int hostapd_wpa_auth_set_key(void *ctx, int vlan_id, enum wpa_alg alg,
 		hapd->last_gtk_len = key_len;
 	}
 #endif /* CONFIG_TESTING_OPTIONS */
-	return hostapd_drv_set_key(ifname, hapd, alg, addr, idx, 1, NULL, 0,
-				   key, key_len);
+	os_get_reltime(&start);
+	ret = hostapd_drv_set_key(ifname, hapd, alg, addr, idx, 1, NULL, 0,
+				  key, key_len);
+	/* Only the pairwise keys are on the station onboarding path */
+	if (addr && !is_broadcast_ether_addr(addr) && alg != WPA_ALG_NONE)
+		sta_lat_add_since(hapd, STA_LAT_H_DRV_SET_KEY, &start);
+	return ret;
 }
 
 
@@ -455,6 +472,18 @@ static int hostapd_wpa_auth_for_each_sta(
 }
 
 
+static int hostapd_wpa_auth_sta_dozing(void *ctx, const u8 *addr)
+{
+	struct hostapd_data *hapd = ctx;
+	struct sta_info *sta = ap_get_sta(hapd, addr);
+
+	if (sta == NULL)
+		return -1;
+	/* Unacknowledged inactivity poll: likely in power save */
+	return !!(sta->flags & WLAN_STA_PENDING_POLL);
+}
+
+
 struct wpa_auth_iface_iter_data {
 	int (*cb)(struct wpa_authenticator *sm, void *ctx);
 	void *cb_ctx;
@@ -1276,6 +1305,7 @@ int hostapd_setup_wpa(struct hostapd_data *hapd)
 		.send_oui = hostapd_wpa_auth_send_oui,
 		.channel_info = hostapd_channel_info,
 		.update_vlan = hostapd_wpa_auth_update_vlan,
+		.sta_dozing = hostapd_wpa_auth_sta_dozing,
 #ifdef CONFIG_OCV
 		.get_sta_tx_params = hostapd_get_sta_tx_params,
 #endif /* CONFIG_OCV */
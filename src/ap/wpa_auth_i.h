@@ -92,6 +92,7 @@ struct wpa_state_machine {
 	unsigned int pmk_r1_name_valid:1;
 #endif /* CONFIG_IEEE80211R_AP */
 	unsigned int is_wnmsleep:1;
+	unsigned int GUpdatePending:1; /* queued for paced GTK rollout */
 	unsigned int pmkid_set:1;
 #ifdef CONFIG_OCV
 	unsigned int ocv_enabled:1;
@@ -172,6 +173,7 @@ struct wpa_group {
 
 	Boolean GInit;
 	int GKeyDoneStations;
+	int GKeyPendingStations; /* queued, group handshake not yet started */
 	Boolean GTKReKey;
 	int GTK_len;
 	int GN, GM;
@@ -198,11 +200,21 @@ struct wpa_group {
 	/* Number of references except those in struct wpa_group->next */
 	unsigned int references;
 	unsigned int num_setup_iface;
+
+	/* GTK rollout progress (see wpa_group_rekey_batch) */
+	struct os_reltime rollout_start;
+	unsigned int rollout_stations;
+	unsigned int rollout_failures;
+	unsigned int rollouts;
+	unsigned int rollout_last_ms;
+	unsigned int rollout_max_ms;
 };
 
 
 struct wpa_ft_pmk_cache;
 
+#define FT_RKH_HASH_SIZE 64
+
 /* per authenticator data */
 struct wpa_authenticator {
 	struct wpa_group *group;
@@ -229,6 +241,21 @@ struct wpa_authenticator {
 
 	struct rsn_pmksa_cache *pmksa;
 	struct wpa_ft_pmk_cache *ft_pmk_cache;
+#ifdef CONFIG_IEEE80211R_AP
+	/* conf.r0kh_list and conf.r1kh_list indexed by key holder ID */
+	struct ft_remote_r0kh *r0kh_hash[FT_RKH_HASH_SIZE];
+	struct ft_remote_r0kh *r0kh_wildcard;
+	struct ft_remote_r1kh *r1kh_hash[FT_RKH_HASH_SIZE];
+	struct ft_remote_r1kh *r1kh_wildcard;
+
+	unsigned int ft_r1_hits; /* FT auth served from PMK-R1 cache */
+	unsigned int ft_r1_local; /* FT auth served from local PMK-R0 */
+	unsigned int ft_r1_misses; /* FT auth that needed a pull */
+	unsigned int ft_push_tx; /* PMK-R1 push frames sent */
+	unsigned int ft_push_rx; /* PMK-R1 pushes received and stored */
+	unsigned int ft_push_batches;
+	unsigned int ft_push_deferred; /* batches cut short by push rate */
+#endif /* CONFIG_IEEE80211R_AP */
 
 #ifdef CONFIG_P2P
 	struct bitfield *ip_pool;
@@ -296,6 +323,9 @@ int wpa_write_ftie(struct wpa_auth_config *conf, int use_sha384,
 int wpa_auth_derive_ptk_ft(struct wpa_state_machine *sm, struct wpa_ptk *ptk);
 struct wpa_ft_pmk_cache * wpa_ft_pmk_cache_init(void);
 void wpa_ft_pmk_cache_deinit(struct wpa_ft_pmk_cache *cache);
+struct wpabuf * wpa_ft_pmk_cache_export(struct wpa_authenticator *wpa_auth);
+int wpa_ft_pmk_cache_import(struct wpa_authenticator *wpa_auth,
+			    const u8 *data, size_t len);
 void wpa_ft_install_ptk(struct wpa_state_machine *sm);
 int wpa_ft_store_pmk_fils(struct wpa_state_machine *sm, const u8 *pmk_r0,
 			  const u8 *pmk_r0_name);
@@ -12,6 +12,7 @@
 #include <sys/un.h>
 
 #include "utils/common.h"
+#include "wpa_ctrl.h"
 #include "ctrl_iface_common.h"
 
 static int sockaddr_compare(struct sockaddr_storage *a, socklen_t a_len,
@@ -113,13 +114,133 @@ void sockaddr_print(int level, const char *msg, struct sockaddr_storage *sock,
 }
 
 
-static int ctrl_set_events(struct wpa_ctrl_dst *dst, const char *input)
+/*
+ * Event classes are selected by the event name prefix. The first matching
+ * entry wins, so more specific prefixes must come before the generic ones.
+ */
+static const struct ctrl_event_prefix {
+	const char *prefix;
+	size_t len;
+	u32 class;
+} ctrl_event_prefixes[] = {
+#define CTRL_EVENT_PREFIX(p, c) { p, sizeof(p) - 1, c }
+	CTRL_EVENT_PREFIX(RX_PROBE_REQUEST, WPA_EVENT_RX_PROBE_REQUEST),
+	CTRL_EVENT_PREFIX("AP-STA-", WPA_EVENT_STA),
+	CTRL_EVENT_PREFIX("AP-REJECTED-", WPA_EVENT_STA),
+	CTRL_EVENT_PREFIX("STA-OPMODE-", WPA_EVENT_STA),
+	CTRL_EVENT_PREFIX("UNCONNECTED-STA-", WPA_EVENT_STA),
+	CTRL_EVENT_PREFIX("WDS-STA-", WPA_EVENT_STA),
+	CTRL_EVENT_PREFIX("CTRL-EVENT-EAP-", WPA_EVENT_STA),
+	CTRL_EVENT_PREFIX("AP-", WPA_EVENT_RADIO),
+	CTRL_EVENT_PREFIX("INTERFACE-", WPA_EVENT_RADIO),
+	CTRL_EVENT_PREFIX("ACS-", WPA_EVENT_RADIO),
+	CTRL_EVENT_PREFIX("DFS-", WPA_EVENT_RADIO),
+	CTRL_EVENT_PREFIX("LTQ-DFS-", WPA_EVENT_RADIO),
+	CTRL_EVENT_PREFIX("ZWDFS-", WPA_EVENT_RADIO),
+	CTRL_EVENT_PREFIX("CTRL-EVENT-CHANNEL-SWITCH", WPA_EVENT_RADIO),
+	CTRL_EVENT_PREFIX("RRM-", WPA_EVENT_MGMT),
+	CTRL_EVENT_PREFIX("BSS-TM-", WPA_EVENT_MGMT),
+	CTRL_EVENT_PREFIX("BEACON-", WPA_EVENT_MGMT),
+	CTRL_EVENT_PREFIX("RX-", WPA_EVENT_MGMT),
+	CTRL_EVENT_PREFIX("GAS-", WPA_EVENT_MGMT),
+	CTRL_EVENT_PREFIX("MBO-", WPA_EVENT_MGMT),
+	CTRL_EVENT_PREFIX("COLOC-INTF-", WPA_EVENT_MGMT),
+	CTRL_EVENT_PREFIX("WPS-", WPA_EVENT_WPS),
+	CTRL_EVENT_PREFIX("DPP-", WPA_EVENT_WPS),
+	CTRL_EVENT_PREFIX("LTQ-", WPA_EVENT_VENDOR),
+#undef CTRL_EVENT_PREFIX
+};
+
+static const struct ctrl_event_name {
+	const char *name;
+	u32 class;
+} ctrl_event_names[] = {
+	{ "probe_rx", WPA_EVENT_RX_PROBE_REQUEST },
+	{ "sta", WPA_EVENT_STA },
+	{ "radio", WPA_EVENT_RADIO },
+	{ "mgmt", WPA_EVENT_MGMT },
+	{ "wps", WPA_EVENT_WPS },
+	{ "vendor", WPA_EVENT_VENDOR },
+	{ "other", WPA_EVENT_OTHER },
+	{ "all", WPA_EVENT_ALL },
+};
+
+
+/**
+ * ctrl_iface_event_class - Map an event to its WPA_EVENT_* class bit
+ * @txt: Event text (or a printf format string starting with the event name)
+ * Returns: WPA_EVENT_* bit; WPA_EVENT_OTHER if no class prefix matches
+ */
+u32 ctrl_iface_event_class(const char *txt)
+{
+	const struct ctrl_event_prefix *p;
+	size_t i;
+
+	for (i = 0; i < ARRAY_SIZE(ctrl_event_prefixes); i++) {
+		p = &ctrl_event_prefixes[i];
+		if (txt[0] == p->prefix[0] &&
+		    os_strncmp(txt, p->prefix, p->len) == 0)
+			return p->class;
+	}
+
+	return WPA_EVENT_OTHER;
+}
+
+
+/**
+ * ctrl_iface_events_wanted - Union of event classes of interested monitors
+ * @ctrl_dst: List of attached monitors
+ * @level: Priority level (MSG_*) of the event
+ * Returns: WPA_EVENT_* bitmap; 0 if no monitor would receive the event
+ */
+u32 ctrl_iface_events_wanted(struct dl_list *ctrl_dst, int level)
+{
+	struct wpa_ctrl_dst *dst;
+	u32 events = 0;
+
+	dl_list_for_each(dst, ctrl_dst, struct wpa_ctrl_dst, list) {
+		if (level >= dst->debug_level)
+			events |= dst->events;
+	}
+
+	return events;
+}
+
+
+static int ctrl_parse_event_names(const char *names, u32 *events)
+{
+	const char *pos = names, *end;
+	size_t i, len;
+	u32 val = 0;
+
+	while (*pos && *pos != ' ') {
+		end = pos;
+		while (*end && *end != ',' && *end != ' ')
+			end++;
+		len = end - pos;
+		for (i = 0; i < ARRAY_SIZE(ctrl_event_names); i++) {
+			if (os_strlen(ctrl_event_names[i].name) == len &&
+			    os_strncmp(pos, ctrl_event_names[i].name, len) == 0)
+				break;
+		}
+		if (i == ARRAY_SIZE(ctrl_event_names))
+			return -1;
+		val |= ctrl_event_names[i].class;
+		pos = *end == ',' ? end + 1 : end;
+	}
+
+	*events = val;
+	return 0;
+}
+
+
+static int ctrl_set_event(struct wpa_ctrl_dst *dst, const char *input)
 {
 	const char *value;
 	int val;
 
-	if (!input)
-		return 0;
+	if (str_starts(input, "events="))
+		return ctrl_parse_event_names(input + 7, &dst->events);
 
 	value = os_strchr(input, '=');
 	if (!value)
@@ -140,6 +261,30 @@ static int ctrl_set_events(struct wpa_ctrl_dst *dst, const char *input)
 }
 
 
+static int ctrl_set_events(struct wpa_ctrl_dst *dst, const char *input)
+{
+	const char *pos = input;
+	u32 events = dst->events;
+
+	if (!input)
+		return 0;
+
+	while (pos) {
+		while (*pos == ' ')
+			pos++;
+		if (*pos == '\0')
+			break;
+		if (ctrl_set_event(dst, pos) < 0) {
+			dst->events = events;
+			return -1;
+		}
+		pos = os_strchr(pos, ' ');
+	}
+
+	return 0;
+}
+
+
 int ctrl_iface_attach(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 		      socklen_t fromlen, const char *input)
 {
@@ -159,6 +304,7 @@ int ctrl_iface_attach(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 	os_memcpy(&dst->addr, from, fromlen);
 	dst->addrlen = fromlen;
 	dst->debug_level = MSG_INFO;
+	dst->events = WPA_EVENT_DEFAULT;
 	ctrl_set_events(dst, input);
 	DL_LIST_ADD(ctrl_dst, dst, list);
 
@@ -207,3 +353,158 @@ int ctrl_iface_level(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 
 	return -1;
 }
+
+
+/* Paged replies that have not been fully fetched are dropped after this */
+#define CTRL_IFACE_PAGED_TIMEOUT 10
+/* Maximum number of pending paged replies per control socket */
+#define CTRL_IFACE_PAGED_MAX_PENDING 8
+
+
+static void ctrl_iface_paged_free(struct ctrl_iface_paged_reply *p)
+{
+	dl_list_del(&p->list);
+	os_free(p->buf);
+	os_free(p);
+}
+
+
+static int ctrl_iface_paged_page(struct ctrl_iface_paged_reply *p,
+				 size_t offset, char *reply, size_t reply_size)
+{
+	size_t plen;
+	int res;
+
+	res = os_snprintf(reply, reply_size, WPA_CTRL_PAGE "%u %zu %zu\n",
+			  p->id, offset, p->len);
+	if (os_snprintf_error(reply_size, res))
+		return -1;
+
+	plen = p->len - offset;
+	if (plen > WPA_CTRL_PAGE_SIZE)
+		plen = WPA_CTRL_PAGE_SIZE;
+	if (plen > reply_size - res)
+		plen = reply_size - res;
+	os_memcpy(reply + res, p->buf + offset, plen);
+
+	return res + plen;
+}
+
+
+/**
+ * ctrl_iface_paged_store - Store a paged reply and return its first page
+ * @paged: List of pending paged replies of the control socket
+ * @next_id: Page identifier counter of the control socket
+ * @from: Address of the requester
+ * @fromlen: Length of from
+ * @buf: Full reply; ownership is passed to this function
+ * @len: Length of the full reply
+ * @reply: Buffer for the first page
+ * @reply_size: Size of the reply buffer
+ * Returns: Length of the first page or -1 on failure
+ */
+int ctrl_iface_paged_store(struct dl_list *paged, unsigned int *next_id,
+			   struct sockaddr_storage *from, socklen_t fromlen,
+			   char *buf, size_t len, char *reply,
+			   size_t reply_size)
+{
+	struct ctrl_iface_paged_reply *p, *tmp;
+	struct os_reltime now;
+	unsigned int count = 0;
+	int res;
+
+	os_get_reltime(&now);
+	dl_list_for_each_safe(p, tmp, paged, struct ctrl_iface_paged_reply,
+			      list) {
+		if (os_reltime_expired(&now, &p->created,
+				       CTRL_IFACE_PAGED_TIMEOUT))
+			ctrl_iface_paged_free(p);
+		else
+			count++;
+	}
+	if (count >= CTRL_IFACE_PAGED_MAX_PENDING) {
+		/* The list is kept in creation order */
+		p = dl_list_first(paged, struct ctrl_iface_paged_reply, list);
+		wpa_printf(MSG_DEBUG,
+			   "CTRL: Drop pending paged reply %u (%zu bytes)",
+			   p->id, p->len);
+		ctrl_iface_paged_free(p);
+	}
+
+	p = os_zalloc(sizeof(*p));
+	if (!p) {
+		os_free(buf);
+		return -1;
+	}
+	os_memcpy(&p->addr, from, fromlen);
+	p->addrlen = fromlen;
+	p->id = ++(*next_id);
+	p->created = now;
+	p->buf = buf;
+	p->len = len;
+
+	res = ctrl_iface_paged_page(p, 0, reply, reply_size);
+	if (res < 0 || len <= WPA_CTRL_PAGE_SIZE) {
+		/* Everything fit into the first page */
+		os_free(buf);
+		os_free(p);
+		return res;
+	}
+
+	dl_list_add_tail(paged, &p->list);
+	return res;
+}
+
+
+/**
+ * ctrl_iface_paged_next - Return a page of a pending paged reply
+ * @paged: List of pending paged replies of the control socket
+ * @from: Address of the requester
+ * @fromlen: Length of from
+ * @cmd: "<id> <offset>" from the PAGE command
+ * @reply: Buffer for the page
+ * @reply_size: Size of the reply buffer
+ * Returns: Length of the page or -1 on failure
+ *
+ * The pending reply is released once its last page has been returned.
+ */
+int ctrl_iface_paged_next(struct dl_list *paged, struct sockaddr_storage *from,
+			  socklen_t fromlen, const char *cmd, char *reply,
+			  size_t reply_size)
+{
+	struct ctrl_iface_paged_reply *p;
+	unsigned int id;
+	size_t offset;
+	char *pos;
+	int res;
+
+	id = strtoul(cmd, &pos, 10);
+	if (*pos != ' ')
+		return -1;
+	offset = strtoul(pos + 1, NULL, 10);
+
+	dl_list_for_each(p, paged, struct ctrl_iface_paged_reply, list) {
+		if (p->id != id ||
+		    sockaddr_compare(from, fromlen, &p->addr, p->addrlen))
+			continue;
+		if (offset >= p->len)
+			return -1;
+		res = ctrl_iface_paged_page(p, offset, reply, reply_size);
+		if (res > 0 && offset + WPA_CTRL_PAGE_SIZE >= p->len)
+			ctrl_iface_paged_free(p);
+		return res;
+	}
+
+	wpa_printf(MSG_DEBUG, "CTRL: Unknown or expired paged reply %u", id);
+	return -1;
+}
+
+
+void ctrl_iface_paged_flush(struct dl_list *paged)
+{
+	struct ctrl_iface_paged_reply *p, *tmp;
+
+	dl_list_for_each_safe(p, tmp, paged, struct ctrl_iface_paged_reply,
+			      list)
+		ctrl_iface_paged_free(p);
+}
@@ -13,6 +13,15 @@
 
 /* Events enable bits (wpa_ctrl_dst::events) */
 #define WPA_EVENT_RX_PROBE_REQUEST BIT(0)
+#define WPA_EVENT_STA BIT(1) /* station state changes */
+#define WPA_EVENT_RADIO BIT(2) /* AP/interface state, channel, ACS, DFS */
+#define WPA_EVENT_MGMT BIT(3) /* RRM, WNM, GAS/ANQP, MBO */
+#define WPA_EVENT_WPS BIT(4) /* WPS and DPP */
+#define WPA_EVENT_VENDOR BIT(5) /* LTQ-* reports */
+#define WPA_EVENT_OTHER BIT(31) /* everything not classified above */
+#define WPA_EVENT_ALL 0xffffffff
+/* Probe Request events are enabled only on explicit request */
+#define WPA_EVENT_DEFAULT (WPA_EVENT_ALL & ~WPA_EVENT_RX_PROBE_REQUEST)
 
 /**
  * struct wpa_ctrl_dst - Data structure of control interface monitors
@@ -29,14 +38,41 @@ struct wpa_ctrl_dst {
 	u32 events; /* WPA_EVENT_* bitmap */
 };
 
+/**
+ * struct ctrl_iface_paged_reply - Pending reply of a paged request
+ *
+ * A "PAGED <cmd>" request is processed with a large reply buffer and the
+ * result is kept here until the client has fetched all pages with
+ * "PAGE <id> <offset>".
+ */
+struct ctrl_iface_paged_reply {
+	struct dl_list list;
+	struct sockaddr_storage addr;
+	socklen_t addrlen;
+	unsigned int id;
+	struct os_reltime created;
+	char *buf;
+	size_t len;
+};
+
 void sockaddr_print(int level, const char *msg, struct sockaddr_storage *sock,
 		    socklen_t socklen);
 
 int ctrl_iface_attach(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 		       socklen_t fromlen, const char *input);
+u32 ctrl_iface_event_class(const char *txt);
+u32 ctrl_iface_events_wanted(struct dl_list *ctrl_dst, int level);
 int ctrl_iface_detach(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 		      socklen_t fromlen);
 int ctrl_iface_level(struct dl_list *ctrl_dst, struct sockaddr_storage *from,
 		     socklen_t fromlen, const char *level);
+int ctrl_iface_paged_store(struct dl_list *paged, unsigned int *next_id,
+			   struct sockaddr_storage *from, socklen_t fromlen,
+			   char *buf, size_t len, char *reply,
+			   size_t reply_size);
+int ctrl_iface_paged_next(struct dl_list *paged, struct sockaddr_storage *from,
+			  socklen_t fromlen, const char *cmd, char *reply,
+			  size_t reply_size);
+void ctrl_iface_paged_flush(struct dl_list *paged);
 
 #endif /* CONTROL_IFACE_COMMON_H */
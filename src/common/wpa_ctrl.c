@@ -70,6 +70,7 @@ struct wpa_ctrl {
 #ifdef CONFIG_CTRL_IFACE_NAMED_PIPE
 	HANDLE pipe;
 #endif /* CONFIG_CTRL_IFACE_NAMED_PIPE */
+	int no_paging; /* server did not understand a PAGED request */
 };
 
 
@@ -566,6 +567,131 @@ retry_send:
 #endif /* CTRL_IFACE_SOCKET */
 
 
+static int wpa_ctrl_parse_page(const char *page, size_t page_len,
+			       unsigned int *id, size_t *offset, size_t *total,
+			       const char **data)
+{
+	const char *pos, *end;
+	char *tmp;
+
+	if (page_len < 5 || os_strncmp(page, WPA_CTRL_PAGE, 5) != 0)
+		return -1;
+	end = os_strchr(page, '\n');
+	if (!end)
+		return -1;
+	pos = page + 5;
+	*id = strtoul(pos, &tmp, 10);
+	if (*tmp != ' ')
+		return -1;
+	*offset = strtoul(tmp + 1, &tmp, 10);
+	if (*tmp != ' ')
+		return -1;
+	*total = strtoul(tmp + 1, &tmp, 10);
+	if (tmp != end || *offset > *total)
+		return -1;
+	*data = end + 1;
+	if ((size_t) (page + page_len - *data) > *total - *offset)
+		return -1;
+	return page + page_len - *data;
+}
+
+
+static int wpa_ctrl_request_alloc(struct wpa_ctrl *ctrl, const char *cmd,
+				  char **reply, size_t *reply_len,
+				  void (*msg_cb)(char *msg, size_t len))
+{
+	char buf[8192];
+	size_t len = sizeof(buf) - 1;
+	int ret;
+
+	ret = wpa_ctrl_request(ctrl, cmd, os_strlen(cmd), buf, &len, msg_cb);
+	if (ret < 0)
+		return ret;
+	*reply = os_malloc(len + 1);
+	if (!*reply)
+		return -1;
+	os_memcpy(*reply, buf, len);
+	(*reply)[len] = '\0';
+	*reply_len = len;
+	return 0;
+}
+
+
+int wpa_ctrl_request_paged(struct wpa_ctrl *ctrl, const char *cmd,
+			   char **reply, size_t *reply_len,
+			   void (*msg_cb)(char *msg, size_t len))
+{
+	char page[WPA_CTRL_PAGE_SIZE + 64], req[64], *cmd_buf, *buf = NULL;
+	size_t len, cmd_len, offset, total, pos, page_off, page_total;
+	unsigned int id, page_id;
+	const char *data;
+	int ret, dlen;
+
+	*reply = NULL;
+	*reply_len = 0;
+	if (ctrl->no_paging)
+		return wpa_ctrl_request_alloc(ctrl, cmd, reply, reply_len,
+					      msg_cb);
+
+	cmd_len = os_strlen(WPA_CTRL_PAGED) + os_strlen(cmd);
+	cmd_buf = os_malloc(cmd_len + 1);
+	if (!cmd_buf)
+		return -1;
+	os_snprintf(cmd_buf, cmd_len + 1, WPA_CTRL_PAGED "%s", cmd);
+	len = sizeof(page) - 1;
+	ret = wpa_ctrl_request(ctrl, cmd_buf, cmd_len, page, &len, msg_cb);
+	os_free(cmd_buf);
+	if (ret < 0)
+		return ret;
+	page[len] = '\0';
+
+	dlen = wpa_ctrl_parse_page(page, len, &id, &offset, &total, &data);
+	if (dlen < 0 || offset != 0) {
+		if (os_strncmp(page, "UNKNOWN COMMAND", 15) != 0)
+			return -1;
+		/* Older server; do not try paging again on this connection */
+		ctrl->no_paging = 1;
+		return wpa_ctrl_request_alloc(ctrl, cmd, reply, reply_len,
+					      msg_cb);
+	}
+
+	if (total > WPA_CTRL_PAGED_MAX_LEN)
+		return -1;
+	buf = os_malloc(total + 1);
+	if (!buf)
+		return -1;
+	os_memcpy(buf, data, dlen);
+	pos = dlen;
+
+	while (pos < total) {
+		os_snprintf(req, sizeof(req), WPA_CTRL_PAGE "%u %zu", id, pos);
+		len = sizeof(page) - 1;
+		ret = wpa_ctrl_request(ctrl, req, os_strlen(req), page, &len,
+				       msg_cb);
+		if (ret < 0)
+			goto fail;
+		page[len] = '\0';
+		dlen = wpa_ctrl_parse_page(page, len, &page_id, &page_off,
+					   &page_total, &data);
+		if (dlen <= 0 || page_id != id || page_off != pos ||
+		    page_total != total) {
+			ret = -1;
+			goto fail;
+		}
+		os_memcpy(buf + pos, data, dlen);
+		pos += dlen;
+	}
+
+	buf[total] = '\0';
+	*reply = buf;
+	*reply_len = total;
+	return 0;
+
+fail:
+	os_free(buf);
+	return ret;
+}
+
 static int wpa_ctrl_attach_helper(struct wpa_ctrl *ctrl, int attach)
 {
 	char buf[10];
@@ -538,6 +538,37 @@ int wpa_ctrl_request(struct wpa_ctrl *ctrl, const char *cmd, size_t cmd_len,
 		     void (*msg_cb)(char *msg, size_t len));
 
 
+/* Paged replies: request prefix and page fetch command / page header */
+#define WPA_CTRL_PAGED "PAGED "
+#define WPA_CTRL_PAGE "PAGE "
+/* Maximum reply payload per page; fits a 4096 octet receive buffer */
+#define WPA_CTRL_PAGE_SIZE 4000
+/* Maximum total length of a paged reply */
+#define WPA_CTRL_PAGED_MAX_LEN (256 * 1024)
+
+
+/**
+ * wpa_ctrl_request_paged - Send a command and reassemble a paged reply
+ * @ctrl: Control interface data from wpa_ctrl_open()
+ * @cmd: Command; usually, ASCII text, e.g., "STA-ALL wlan0"
+ * @reply: Pointer for returning the allocated, nul terminated reply
+ * @reply_len: Pointer for returning the reply length (without the nul)
+ * @msg_cb: Callback function for unsolicited messages or %NULL if not used
+ * Returns: 0 on success, -1 on error, -2 on timeout
+ *
+ * This function sends the command as "PAGED <cmd>", which allows hostapd to
+ * return replies larger than a single datagram. The reply is split into
+ * pages of at most WPA_CTRL_PAGE_SIZE octets, each starting with a
+ * "PAGE <id> <offset> <total>" header line, and the remaining pages are
+ * fetched with "PAGE <id> <offset>". If the server does not support paged
+ * replies, the command is sent as a normal request instead. The caller is
+ * responsible for freeing the returned reply with os_free().
+ */
+int wpa_ctrl_request_paged(struct wpa_ctrl *ctrl, const char *cmd,
+			   char **reply, size_t *reply_len,
+			   void (*msg_cb)(char *msg, size_t len));
+
+
 /**
  * wpa_ctrl_attach - Register as an event monitor for the control interface
  * @ctrl: Control interface data from wpa_ctrl_open()
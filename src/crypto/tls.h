@@ -633,6 +633,15 @@ void tls_connection_set_test_flags(struct tls_connection *conn, u32 flags);
 
 int tls_get_library_version(char *buf, size_t buf_len);
 
+/**
+ * tls_global_get_mib - Get TLS library MIB information
+ * @tls_ctx: TLS context data from tls_init()
+ * @buf: Buffer for the MIB text
+ * @buflen: Size of the buffer
+ * Returns: Number of bytes written to buf
+ */
+int tls_global_get_mib(void *tls_ctx, char *buf, size_t buflen);
+
 void tls_connection_set_success_data(struct tls_connection *conn,
 				     struct wpabuf *data);
 
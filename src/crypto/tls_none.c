@@ -209,6 +209,12 @@ int tls_get_library_version(char *buf, size_t buf_len)
 }
 
 
+int tls_global_get_mib(void *tls_ctx, char *buf, size_t buflen)
+{
+	return 0;
+}
+
+
 void tls_connection_set_success_data(struct tls_connection *conn,
 				     struct wpabuf *data)
 {
@@ -7,6 +7,7 @@
  */
 
 #include "includes.h"
+#include <sys/stat.h>
 
 #ifndef CONFIG_SMARTCARD
 #ifndef OPENSSL_NO_ENGINE
@@ -38,6 +39,19 @@
 #include "tls.h"
 #include "tls_openssl.h"
 
+/*
+ * The CRL reload thread uses OpenSSL concurrently with the main thread. That
+ * is safe without application provided locking callbacks only with OpenSSL
+ * 1.1.0 and newer; older versions reload in place.
+ */
+#if !defined(CONFIG_NATIVE_WINDOWS) && \
+    OPENSSL_VERSION_NUMBER >= 0x10100000L && \
+    (!defined(LIBRESSL_VERSION_NUMBER) || \
+     LIBRESSL_VERSION_NUMBER >= 0x20700000L)
+#include <pthread.h>
+#define TLS_CRL_RELOAD_THREAD
+#endif
+
 #if !defined(CONFIG_FIPS) &&                             \
     (defined(EAP_FAST) || defined(EAP_FAST_DYNAMIC) ||   \
      defined(EAP_SERVER_FAST))
@@ -206,6 +220,16 @@ struct tls_context {
 	void *cb_ctx;
 	int cert_in_cb;
 	char *ocsp_stapling_response;
+	/* ocsp_stapling_response file contents, re-read when the file changes */
+	char *ocsp_staple;
+	size_t ocsp_staple_len;
+	os_time_t ocsp_staple_next_update; /* 0 = not known */
+	struct stat ocsp_staple_stat;
+	struct os_reltime ocsp_staple_checked;
+	unsigned int ocsp_staple_loads;
+	unsigned int ocsp_staples_served;
+	unsigned int ocsp_staples_stale;
+	unsigned int ocsp_staples_missing;
 };
 
 static struct tls_context *tls_global = NULL;
@@ -219,6 +243,16 @@ struct tls_data {
 	char *ca_cert;
 	unsigned int crl_reload_interval;
 	struct os_reltime crl_last_reload;
+	struct tls_crl_reload *crl_reload; /* reload in progress */
+#ifdef TLS_CRL_RELOAD_THREAD
+	struct stat crl_ca_stat; /* ca_cert file as last loaded */
+	int crl_ca_stat_valid;
+#endif /* TLS_CRL_RELOAD_THREAD */
+	unsigned int crl_reloads;
+	unsigned int crl_reload_failures;
+	unsigned int crl_reload_skipped;
+	unsigned int crl_reload_last_ms;
+	unsigned int crl_reload_max_ms;
 	char *check_cert_subject;
 };
 
@@ -311,22 +345,22 @@ static void tls_show_errors(int level, const char *func, const char *txt)
 #endif /* CONFIG_NO_STDOUT_DEBUG */
 
 
-static X509_STORE * tls_crl_cert_reload(const char *ca_cert, int check_crl)
+/* Does not log since it may be called from the CRL reload thread */
+static X509_STORE * tls_crl_cert_reload(const char *ca_cert, int check_crl,
+					unsigned long *err)
 {
 	int flags;
 	X509_STORE *store;
 
 	store = X509_STORE_new();
 	if (!store) {
-		wpa_printf(MSG_DEBUG,
-			   "OpenSSL: %s - failed to allocate new certificate store",
-			   __func__);
+		*err = ERR_get_error();
 		return NULL;
 	}
 
 	if (ca_cert && X509_STORE_load_locations(store, ca_cert, NULL) != 1) {
-		tls_show_errors(MSG_WARNING, __func__,
-				"Failed to load root certificates");
+		*err = ERR_get_error();
+		ERR_clear_error();
 		X509_STORE_free(store);
 		return NULL;
 	}
@@ -341,6 +375,196 @@ static X509_STORE * tls_crl_cert_reload(const char *ca_cert, int check_crl)
 }
 
 
+/*
+ * Rebuilding the X509 store re-parses the whole ca_cert file including the
+ * CRLs, which can take a long time with large CRLs. It is done in a separate
+ * thread and the new store is swapped into the SSL_CTX from the next
+ * tls_connection_init() call after the thread has finished.
+ */
+struct tls_crl_reload {
+	char *ca_cert;
+	int check_crl;
+	struct os_reltime start;
+#ifdef TLS_CRL_RELOAD_THREAD
+	pthread_t thread;
+	int thread_started;
+	pthread_mutex_t lock;
+	struct stat ca_stat;
+	int ca_stat_valid;
+#endif /* TLS_CRL_RELOAD_THREAD */
+	/* Set when done */
+	int done;
+	X509_STORE *store;
+	unsigned long err;
+	struct os_reltime end;
+};
+
+
+static void * tls_crl_reload_run(void *ctx)
+{
+	struct tls_crl_reload *reload = ctx;
+	X509_STORE *store;
+	unsigned long err = 0;
+
+#ifdef TLS_CRL_RELOAD_THREAD
+	reload->ca_stat_valid = reload->ca_cert &&
+		stat(reload->ca_cert, &reload->ca_stat) == 0;
+#endif /* TLS_CRL_RELOAD_THREAD */
+	store = tls_crl_cert_reload(reload->ca_cert, reload->check_crl, &err);
+
+#ifdef TLS_CRL_RELOAD_THREAD
+	pthread_mutex_lock(&reload->lock);
+#endif /* TLS_CRL_RELOAD_THREAD */
+	reload->store = store;
+	reload->err = err;
+	os_get_reltime(&reload->end);
+	reload->done = 1;
+#ifdef TLS_CRL_RELOAD_THREAD
+	pthread_mutex_unlock(&reload->lock);
+#endif /* TLS_CRL_RELOAD_THREAD */
+
+	return NULL;
+}
+
+
+static void tls_crl_reload_free(struct tls_crl_reload *reload)
+{
+#ifdef TLS_CRL_RELOAD_THREAD
+	if (reload->thread_started)
+		pthread_join(reload->thread, NULL);
+	pthread_mutex_destroy(&reload->lock);
+#endif /* TLS_CRL_RELOAD_THREAD */
+	if (reload->store)
+		X509_STORE_free(reload->store);
+	os_free(reload->ca_cert);
+	os_free(reload);
+}
+
+
+static void tls_crl_reload_start(struct tls_data *data,
+				 struct os_reltime *now)
+{
+	struct tls_crl_reload *reload;
+
+	reload = os_zalloc(sizeof(*reload));
+	if (!reload)
+		return;
+	if (data->ca_cert) {
+		reload->ca_cert = os_strdup(data->ca_cert);
+		if (!reload->ca_cert) {
+			os_free(reload);
+			return;
+		}
+	}
+	reload->check_crl = data->check_crl;
+	reload->start = *now;
+	data->crl_reload = reload;
+
+	wpa_printf(MSG_INFO, "OpenSSL: Reloading X509 store from ca_cert file");
+#ifdef TLS_CRL_RELOAD_THREAD
+	pthread_mutex_init(&reload->lock, NULL);
+	if (pthread_create(&reload->thread, NULL, tls_crl_reload_run,
+			   reload) == 0) {
+		reload->thread_started = 1;
+		return;
+	}
+	wpa_printf(MSG_INFO,
+		   "OpenSSL: Could not start CRL reload thread - reloading in place");
+#endif /* TLS_CRL_RELOAD_THREAD */
+	tls_crl_reload_run(reload);
+}
+
+
+static void tls_crl_reload_finish(struct tls_data *data)
+{
+	struct tls_crl_reload *reload = data->crl_reload;
+	struct os_reltime diff;
+	unsigned int ms;
+	int done;
+
+#ifdef TLS_CRL_RELOAD_THREAD
+	pthread_mutex_lock(&reload->lock);
+#endif /* TLS_CRL_RELOAD_THREAD */
+	done = reload->done;
+#ifdef TLS_CRL_RELOAD_THREAD
+	pthread_mutex_unlock(&reload->lock);
+#endif /* TLS_CRL_RELOAD_THREAD */
+	if (!done)
+		return;
+	data->crl_reload = NULL;
+
+	os_reltime_sub(&reload->end, &reload->start, &diff);
+	ms = diff.sec * 1000 + diff.usec / 1000;
+	data->crl_reload_last_ms = ms;
+	if (ms > data->crl_reload_max_ms)
+		data->crl_reload_max_ms = ms;
+
+	if (!reload->store) {
+		wpa_printf(MSG_ERROR,
+			   "OpenSSL: Error replacing X509 store with ca_cert file: %s",
+			   ERR_error_string(reload->err, NULL));
+		data->crl_reload_failures++;
+	} else {
+		wpa_printf(MSG_INFO,
+			   "OpenSSL: Replaced X509 store with ca_cert file (loaded in %u ms)",
+			   ms);
+		SSL_CTX_set_cert_store(data->ssl, reload->store);
+		reload->store = NULL;
+		data->crl_last_reload = reload->end;
+		data->crl_reloads++;
+#ifdef TLS_CRL_RELOAD_THREAD
+		data->crl_ca_stat = reload->ca_stat;
+		data->crl_ca_stat_valid = reload->ca_stat_valid;
+#endif /* TLS_CRL_RELOAD_THREAD */
+	}
+
+	tls_crl_reload_free(reload);
+}
+
+
+#ifdef TLS_CRL_RELOAD_THREAD
+static int tls_crl_ca_unchanged(struct tls_data *data)
+{
+	struct stat st;
+
+	return data->crl_ca_stat_valid && data->ca_cert &&
+		stat(data->ca_cert, &st) == 0 &&
+		st.st_dev == data->crl_ca_stat.st_dev &&
+		st.st_ino == data->crl_ca_stat.st_ino &&
+		st.st_size == data->crl_ca_stat.st_size &&
+		st.st_mtime == data->crl_ca_stat.st_mtime &&
+		st.st_ctime == data->crl_ca_stat.st_ctime;
+}
+#endif /* TLS_CRL_RELOAD_THREAD */
+
+
+static void tls_crl_reload_check(struct tls_data *data)
+{
+	struct os_reltime now;
+
+	if (data->crl_reload)
+		tls_crl_reload_finish(data);
+	if (data->crl_reload || data->crl_reload_interval == 0 ||
+	    os_get_reltime(&now) < 0 ||
+	    !os_reltime_expired(&now, &data->crl_last_reload,
+				data->crl_reload_interval))
+		return;
+
+#ifdef TLS_CRL_RELOAD_THREAD
+	/* Nothing to reparse if the file has not been touched */
+	if (tls_crl_ca_unchanged(data)) {
+		data->crl_last_reload = now;
+		data->crl_reload_skipped++;
+		return;
+	}
+#endif /* TLS_CRL_RELOAD_THREAD */
+
+	tls_crl_reload_start(data, &now);
+	if (data->crl_reload)
+		tls_crl_reload_finish(data);
+}
+
+
 #ifdef CONFIG_NATIVE_WINDOWS
 
 /* Windows CryptoAPI and access to certificate stores */
@@ -1114,6 +1338,8 @@ void tls_deinit(void *ssl_ctx)
 		os_free(context);
 	if (data->tls_session_lifetime > 0)
 		SSL_CTX_flush_sessions(ssl, 0);
+	if (data->crl_reload)
+		tls_crl_reload_free(data->crl_reload);
 	os_free(data->ca_cert);
 	SSL_CTX_free(ssl);
 
@@ -1132,6 +1358,7 @@ void tls_deinit(void *ssl_ctx)
 #endif /* < 1.1.0 */
 		os_free(tls_global->ocsp_stapling_response);
 		tls_global->ocsp_stapling_response = NULL;
+		os_free(tls_global->ocsp_staple);
 		os_free(tls_global);
 		tls_global = NULL;
 	}
@@ -1525,27 +1752,10 @@ struct tls_connection * tls_connection_init(void *ssl_ctx)
 	SSL_CTX *ssl = data->ssl;
 	struct tls_connection *conn;
 	long options;
-	X509_STORE *new_cert_store;
-	struct os_reltime now;
 	struct tls_context *context = SSL_CTX_get_app_data(ssl);
 
 	/* Replace X509 store if it is time to update CRL. */
-	if (data->crl_reload_interval > 0 && os_get_reltime(&now) == 0 &&
-	    os_reltime_expired(&now, &data->crl_last_reload,
-			       data->crl_reload_interval)) {
-		wpa_printf(MSG_INFO,
-			   "OpenSSL: Flushing X509 store with ca_cert file");
-		new_cert_store = tls_crl_cert_reload(data->ca_cert,
-						     data->check_crl);
-		if (!new_cert_store) {
-			wpa_printf(MSG_ERROR,
-				   "OpenSSL: Error replacing X509 store with ca_cert file");
-		} else {
-			/* Replace old store */
-			SSL_CTX_set_cert_store(ssl, new_cert_store);
-			data->crl_last_reload = now;
-		}
-	}
+	tls_crl_reload_check(data);
 
 	conn = os_zalloc(sizeof(*conn));
 	if (conn == NULL)
@@ -2740,6 +2950,10 @@ int tls_global_set_verify(void *ssl_ctx, int check_crl, int strict)
 		data->check_crl = check_crl;
 		data->check_crl_strict = strict;
 		os_get_reltime(&data->crl_last_reload);
+#ifdef TLS_CRL_RELOAD_THREAD
+		data->crl_ca_stat_valid = data->ca_cert &&
+			stat(data->ca_cert, &data->crl_ca_stat) == 0;
+#endif /* TLS_CRL_RELOAD_THREAD */
 	}
 	return 0;
 }
@@ -4721,34 +4935,146 @@ static int ocsp_resp_cb(SSL *s, void *arg)
 }
 
 
+/* How often to check the ocsp_stapling_response file for changes */
+#define OCSP_STAPLE_CHECK_INTERVAL 10
+
+/* ASN1_TIME_diff() is needed to convert the nextUpdate time */
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L && \
+	(!defined(LIBRESSL_VERSION_NUMBER) || \
+	 LIBRESSL_VERSION_NUMBER >= 0x3060000fL)
+#define OCSP_STAPLE_NEXT_UPDATE
+#endif
+
+/*
+ * Returns the nextUpdate time of the first SingleResponse, 0 if the response
+ * does not include one or it cannot be converted with this library, or -1 if
+ * the response cannot be used.
+ */
+static os_time_t ocsp_staple_next_update(const char *resp, size_t len)
+{
+	const unsigned char *pos = (const unsigned char *) resp;
+	OCSP_RESPONSE *ocsp;
+	OCSP_BASICRESP *basic;
+	OCSP_SINGLERESP *single;
+	ASN1_GENERALIZEDTIME *this_update, *next_update;
+#ifdef OCSP_STAPLE_NEXT_UPDATE
+	struct os_time now;
+	int day, sec;
+#endif /* OCSP_STAPLE_NEXT_UPDATE */
+	int reason;
+	os_time_t ret = -1;
+
+	ocsp = d2i_OCSP_RESPONSE(NULL, &pos, len);
+	if (!ocsp)
+		return -1;
+	if (OCSP_response_status(ocsp) != OCSP_RESPONSE_STATUS_SUCCESSFUL)
+		goto out;
+	basic = OCSP_response_get1_basic(ocsp);
+	if (!basic)
+		goto out;
+	single = OCSP_resp_get0(basic, 0);
+	if (single &&
+	    OCSP_single_get0_status(single, &reason, NULL, &this_update,
+				    &next_update) >= 0) {
+		if (!next_update)
+			ret = 0;
+#ifdef OCSP_STAPLE_NEXT_UPDATE
+		else if (os_get_time(&now) == 0 &&
+			 ASN1_TIME_diff(&day, &sec, NULL, next_update))
+			ret = now.sec + day * 86400 + sec;
+#else /* OCSP_STAPLE_NEXT_UPDATE */
+		else
+			ret = 0; /* nextUpdate cannot be converted */
+#endif /* OCSP_STAPLE_NEXT_UPDATE */
+	}
+	OCSP_BASICRESP_free(basic);
+out:
+	OCSP_RESPONSE_free(ocsp);
+	return ret;
+}
+
+
+static void ocsp_staple_refresh(struct tls_context *context)
+{
+	struct os_reltime now;
+	struct stat st;
+	os_time_t next_update;
+
+	os_get_reltime(&now);
+	if (context->ocsp_staple_checked.sec &&
+	    !os_reltime_expired(&now, &context->ocsp_staple_checked,
+				OCSP_STAPLE_CHECK_INTERVAL))
+		return;
+	context->ocsp_staple_checked = now;
+
+	if (stat(context->ocsp_stapling_response, &st) < 0) {
+		os_free(context->ocsp_staple);
+		context->ocsp_staple = NULL;
+		return;
+	}
+	if (context->ocsp_staple &&
+	    st.st_ino == context->ocsp_staple_stat.st_ino &&
+	    st.st_size == context->ocsp_staple_stat.st_size &&
+	    st.st_mtime == context->ocsp_staple_stat.st_mtime)
+		return;
+
+	os_free(context->ocsp_staple);
+	context->ocsp_staple = os_readfile(context->ocsp_stapling_response,
+					   &context->ocsp_staple_len);
+	if (!context->ocsp_staple)
+		return;
+	context->ocsp_staple_stat = st;
+	context->ocsp_staple_loads++;
+
+	next_update = ocsp_staple_next_update(context->ocsp_staple,
+					      context->ocsp_staple_len);
+	if (next_update < 0) {
+		/* Still sent as before; the peer gets to decide */
+		wpa_printf(MSG_INFO,
+			   "OpenSSL: Could not parse OCSP response from '%s'",
+			   context->ocsp_stapling_response);
+		next_update = 0;
+	}
+	context->ocsp_staple_next_update = next_update;
+	wpa_printf(MSG_DEBUG,
+		   "OpenSSL: Loaded OCSP response from '%s' (nextUpdate %ld)",
+		   context->ocsp_stapling_response, (long) next_update);
+}
+
+
 static int ocsp_status_cb(SSL *s, void *arg)
 {
+	struct tls_context *context = tls_global;
+	struct os_time now;
 	char *tmp;
-	char *resp;
-	size_t len;
 
-	if (tls_global->ocsp_stapling_response == NULL) {
+	if (context->ocsp_stapling_response == NULL) {
 		wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - no response configured");
 		return SSL_TLSEXT_ERR_OK;
 	}
 
-	resp = os_readfile(tls_global->ocsp_stapling_response, &len);
-	if (resp == NULL) {
+	ocsp_staple_refresh(context);
+	if (context->ocsp_staple == NULL) {
 		wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - could not read response file");
+		context->ocsp_staples_missing++;
 		/* TODO: Build OCSPResponse with responseStatus = internalError
 		 */
 		return SSL_TLSEXT_ERR_OK;
 	}
+	if (context->ocsp_staple_next_update && os_get_time(&now) == 0 &&
+	    now.sec >= context->ocsp_staple_next_update) {
+		wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - cached response is past its nextUpdate; not sending it");
+		context->ocsp_staples_stale++;
+		return SSL_TLSEXT_ERR_OK;
+	}
 	wpa_printf(MSG_DEBUG, "OpenSSL: OCSP status callback - send cached response");
-	tmp = OPENSSL_malloc(len);
-	if (tmp == NULL) {
-		os_free(resp);
+	tmp = OPENSSL_malloc(context->ocsp_staple_len);
+	if (tmp == NULL)
 		return SSL_TLSEXT_ERR_ALERT_FATAL;
-	}
 
-	os_memcpy(tmp, resp, len);
-	os_free(resp);
-	SSL_set_tlsext_status_ocsp_resp(s, tmp, len);
+	os_memcpy(tmp, context->ocsp_staple, context->ocsp_staple_len);
+	SSL_set_tlsext_status_ocsp_resp(s, tmp, context->ocsp_staple_len);
+	context->ocsp_staples_served++;
 
 	return SSL_TLSEXT_ERR_OK;
 }
@@ -5071,6 +5397,11 @@ int tls_global_set_params(void *tls_ctx,
 			os_strdup(params->ocsp_stapling_response);
 	else
 		tls_global->ocsp_stapling_response = NULL;
+	os_free(tls_global->ocsp_staple);
+	tls_global->ocsp_staple = NULL;
+	tls_global->ocsp_staple_checked.sec = 0;
+	if (tls_global->ocsp_stapling_response)
+		ocsp_staple_refresh(tls_global);
 #endif /* HAVE_OCSP */
 
 	return 0;
@@ -5203,6 +5534,60 @@ int tls_get_library_version(char *buf, size_t buf_len)
 }
 
 
+int tls_global_get_mib(void *tls_ctx, char *buf, size_t buflen)
+{
+	struct tls_data *data = tls_ctx;
+	char *pos = buf, *end = buf + buflen;
+	int ret;
+
+	if (!data || !data->crl_reload_interval)
+		goto ocsp;
+
+	ret = os_snprintf(pos, end - pos,
+			  "tlsCrlReloadInterval=%u\n"
+			  "tlsCrlReloads=%u\n"
+			  "tlsCrlReloadFailures=%u\n"
+			  "tlsCrlReloadsSkipped=%u\n"
+			  "tlsCrlReloadInProgress=%d\n"
+			  "tlsCrlReloadLastDurationMs=%u\n"
+			  "tlsCrlReloadMaxDurationMs=%u\n",
+			  data->crl_reload_interval,
+			  data->crl_reloads,
+			  data->crl_reload_failures,
+			  data->crl_reload_skipped,
+			  data->crl_reload != NULL,
+			  data->crl_reload_last_ms,
+			  data->crl_reload_max_ms);
+	if (os_snprintf_error(end - pos, ret))
+		return pos - buf;
+	pos += ret;
+
+ocsp:
+#ifdef HAVE_OCSP
+	if (tls_global && tls_global->ocsp_stapling_response) {
+		ret = os_snprintf(pos, end - pos,
+				  "tlsOcspStapleLoads=%u\n"
+				  "tlsOcspStapleNextUpdate=%ld\n"
+				  "tlsOcspStaplesServed=%u\n"
+				  "tlsOcspStaplesStale=%u\n"
+				  "tlsOcspStaplesMissing=%u\n",
+				  tls_global->ocsp_staple_loads,
+				  tls_global->ocsp_staple ?
+				  (long) tls_global->ocsp_staple_next_update :
+				  0L,
+				  tls_global->ocsp_staples_served,
+				  tls_global->ocsp_staples_stale,
+				  tls_global->ocsp_staples_missing);
+		if (os_snprintf_error(end - pos, ret))
+			return pos - buf;
+		pos += ret;
+	}
+#endif /* HAVE_OCSP */
+
+	return pos - buf;
+}
+
+
 void tls_connection_set_success_data(struct tls_connection *conn,
 				     struct wpabuf *data)
 {
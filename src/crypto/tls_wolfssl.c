@@ -1946,6 +1946,13 @@ int tls_get_library_version(char *buf, size_t buf_len)
 			   WOLFSSL_VERSION, wolfSSL_lib_version());
 }
 
+
+int tls_global_get_mib(void *tls_ctx, char *buf, size_t buflen)
+{
+	return 0;
+}
+
+
 int tls_get_version(void *ssl_ctx, struct tls_connection *conn,
 		    char *buf, size_t buflen)
 {
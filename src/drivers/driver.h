@@ -3624,6 +3624,17 @@ struct wpa_driver_ops {
 	 */
 	int (*br_delete_ip_neigh)(void *priv, u8 version, const u8 *ipaddr);
 
+	/**
+	 * br_delete_fdb - Remove a station from the bridge forwarding database
+	 * @priv: Private driver interface data
+	 * @addr: MAC address of the station
+	 * Returns: 0 on success, negative (<0) on failure
+	 *
+	 * sta_remove() does this itself; flush() does not, so stations removed
+	 * with flush() need this call.
+	 */
+	int (*br_delete_fdb)(void *priv, const u8 *addr);
+
 	/**
 	 * br_port_set_attr - Set a bridge port attribute
 	 * @attr: Bridge port attribute to set
@@ -5175,14 +5186,6 @@ enum wpa_event_type {
 	EVENT_WDS_STA_INTERFACE_STATUS,
 };
 
-/**
- * get_radio_info - Get radio info
- * @priv: Private driver interface data
- * @radio_info: Pointer to radio_info structure (filled by the function)
- * Returns: 0 on success, -1 on failure
- */
-int (*get_radio_info)(void *priv, struct intel_vendor_radio_info *radio_info);
-
 /**
  * struct freq_survey - Channel survey info
  *
@@ -10294,6 +10294,17 @@ static int nl80211_block_tx(void *priv)
   return ret;
 }
 
+static int wpa_driver_br_delete_fdb(void *priv, const u8 *addr)
+{
+	struct i802_bss *bss = priv;
+
+	if (!bss->drv->rtnl_sk)
+		return -1;
+	rtnl_neigh_delete_fdb_entry(bss, addr);
+	return 0;
+}
+
+
 static int wpa_driver_br_delete_ip_neigh(void *priv, u8 version,
 					 const u8 *ipaddr)
 {
@@ -11597,6 +11608,7 @@ const struct wpa_driver_ops wpa_driver_nl80211_ops = {
 #endif /* CONFIG_MESH */
 	.br_add_ip_neigh = wpa_driver_br_add_ip_neigh,
 	.br_delete_ip_neigh = wpa_driver_br_delete_ip_neigh,
+	.br_delete_fdb = wpa_driver_br_delete_fdb,
 	.br_port_set_attr = wpa_driver_br_port_set_attr,
 	.br_set_net_param = wpa_driver_br_set_net_param,
 	.add_tx_ts = nl80211_add_ts,
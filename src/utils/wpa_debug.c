@@ -645,6 +645,14 @@ void wpa_msg_register_cb(wpa_msg_cb_func func)
 }
 
 
+static wpa_msg_filter_func wpa_msg_filter_cb = NULL;
+
+void wpa_msg_register_filter_cb(wpa_msg_filter_func func)
+{
+	wpa_msg_filter_cb = func;
+}
+
+
 static wpa_msg_get_ifname_func wpa_msg_ifname_cb = NULL;
 
 void wpa_msg_register_ifname_cb(wpa_msg_get_ifname_func func)
@@ -653,6 +661,27 @@ void wpa_msg_register_ifname_cb(wpa_msg_get_ifname_func func)
 }
 
 
+/* Whether wpa_printf() would write a message of this level anywhere */
+static int wpa_msg_printed(int level)
+{
+#if defined(CONFIG_NO_STDOUT_DEBUG) || defined(CONFIG_SILENT)
+	return 0;
+#else /* CONFIG_NO_STDOUT_DEBUG || CONFIG_SILENT */
+	if (level >= wpa_debug_level)
+		return 1;
+#ifdef CONFIG_DEBUG_LINUX_TRACING
+	if (wpa_debug_tracing_file)
+		return 1;
+#endif /* CONFIG_DEBUG_LINUX_TRACING */
+#if !defined CONFIG_NO_WPA_RTLOGGER && !defined CONFIG_WPA_RTLOGGER_RUN_DEMO
+	if (wpa_rtlogger_get_flags(level) & WPA_RTLOGGER_LOG_TARGET_REMOTE)
+		return 1;
+#endif /* !CONFIG_NO_WPA_RTLOGGER && !CONFIG_WPA_RTLOGGER_RUN_DEMO */
+	return 0;
+#endif /* CONFIG_NO_STDOUT_DEBUG || CONFIG_SILENT */
+}
+
+
 void wpa_msg(void *ctx, int level, const char *fmt, ...)
 {
 	va_list ap;
@@ -661,6 +690,10 @@ void wpa_msg(void *ctx, int level, const char *fmt, ...)
 	int len;
 	char prefix[130];
 
+	if (wpa_msg_filter_cb && !wpa_msg_printed(level) &&
+	    !wpa_msg_filter_cb(ctx, level, fmt))
+		return;
+
 	va_start(ap, fmt);
 	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
 	va_end(ap);
@@ -700,6 +733,8 @@ void wpa_msg_ctrl(void *ctx, int level, const char *fmt, ...)
 
 	if (!wpa_msg_cb)
 		return;
+	if (wpa_msg_filter_cb && !wpa_msg_filter_cb(ctx, level, fmt))
+		return;
 
 	va_start(ap, fmt);
 	buflen = vsnprintf(NULL, 0, fmt, ap) + 1;
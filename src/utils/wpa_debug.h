@@ -169,6 +169,7 @@ void wpa_hexdump_ascii_key(int level, const char *title, const void *buf,
 #define wpa_msg_no_global(args...) do { } while (0)
 #define wpa_msg_global_only(args...) do { } while (0)
 #define wpa_msg_register_cb(f) do { } while (0)
+#define wpa_msg_register_filter_cb(f) do { } while (0)
 #define wpa_msg_register_ifname_cb(f) do { } while (0)
 #else /* CONFIG_NO_WPA_MSG */
 /**
@@ -277,6 +278,18 @@ typedef void (*wpa_msg_cb_func)(void *ctx, int level, enum wpa_msg_type type,
  */
 void wpa_msg_register_cb(wpa_msg_cb_func func);
 
+typedef int (*wpa_msg_filter_func)(void *ctx, int level, const char *fmt);
+
+/**
+ * wpa_msg_register_filter_cb - Register event filter for wpa_msg() messages
+ * @func: Callback function (%NULL to unregister)
+ *
+ * The callback is given the format string of a per-interface message and
+ * returns 0 if no ctrl_iface monitor of ctx is interested in it. Such
+ * messages are dropped before formatting unless a debug target needs them.
+ */
+void wpa_msg_register_filter_cb(wpa_msg_filter_func func);
+
 typedef const char * (*wpa_msg_get_ifname_func)(void *ctx);
 void wpa_msg_register_ifname_cb(wpa_msg_get_ifname_func func);
 
@@ -0,0 +1,1287 @@
+/*
+ * hostapd - Offline ACS simulation and ranking benchmark
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+#include <time.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "common/ieee802_11_defs.h"
+#include "common/hw_features_common.h"
+#include "common/intel_vendor_shared.h"
+#include "drivers/driver.h"
+#include "ap/hostapd.h"
+#include "ap/ap_config.h"
+#include "ap/hw_features.h"
+#include "ap/acs.h"
+#include "ap/acs_log.h"
+#include "../bench_hist.h"
+
+
+const struct wpa_driver_ops *const wpa_drivers[] =
+{
+	NULL
+};
+
+
+/* Pipeline stages that are timed separately */
+enum sim_stage {
+	SIM_PIPELINE,
+	SIM_RECORD_BSSES,
+	SIM_UPDATE_RADAR,
+	SIM_RECALC,
+	SIM_CHANDATA,
+	NUM_SIM_STAGE
+};
+
+static const char * const sim_stage_txt[NUM_SIM_STAGE] = {
+	"pipeline", "record-bsses", "update-radar", "recalc", "chandata"
+};
+
+#define SIM_MAX_CHANNELS 64
+
+struct sim_chan {
+	int chan;
+	int flag;
+};
+
+struct arg_ctx {
+	struct hostapd_iface iface;
+	struct hostapd_data hapd;
+	struct wpa_driver_ops driver;
+	struct hapd_interfaces interfaces;
+	struct hostapd_data *bss[1];
+
+	enum hostapd_hw_mode hw_mode;
+	struct sim_chan chans[SIM_MAX_CHANNELS];
+	int num_chans;
+
+	struct wpa_scan_results scan;
+	struct freq_survey *surveys;
+	size_t num_surveys;
+	struct intel_vendor_channel_data *chdata;
+	size_t num_chdata;
+	int num_bss;
+
+	/* ACS overwrites these with its choice; restored for every run */
+	u8 channel;
+	int secondary_channel;
+	u8 vht_oper_chwidth;
+
+	unsigned int iterations;
+	int record;
+	char stage[32];
+
+	struct bench_hist stats[NUM_SIM_STAGE];
+	unsigned int completed;
+	unsigned int failed;
+	unsigned int switches;
+	unsigned int cac;
+};
+
+
+static u64 bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/*
+ * Stubs for the parts of hostapd that ACS calls out to. Channel decisions
+ * are reported from here instead of being applied to a driver.
+ */
+
+static struct arg_ctx * sim_ctx(struct hostapd_iface *iface)
+{
+	return iface->bss[0]->drv_priv;
+}
+
+
+static void sim_decision(struct hostapd_iface *iface, const char *event)
+{
+	struct arg_ctx *ctx = sim_ctx(iface);
+	struct hostapd_config *conf = iface->conf;
+	int rank = -1;
+
+	if (!ctx->record)
+		return;
+	if (iface->selected_candidate >= 0 &&
+	    iface->selected_candidate < (int) iface->num_candidates)
+		rank = iface->candidates[iface->selected_candidate].rank;
+	printf("decision stage=%s event=%s channel=%d secondary=%d chwidth=%d seg0=%d candidate=%d rank=%d\n",
+	       ctx->stage, event, conf->channel, conf->secondary_channel,
+	       conf->vht_oper_chwidth, conf->vht_oper_centr_freq_seg0_idx,
+	       iface->selected_candidate, rank);
+}
+
+
+int hostapd_acs_completed(struct hostapd_iface *iface, int err)
+{
+	struct arg_ctx *ctx = sim_ctx(iface);
+
+	if (err) {
+		ctx->failed++;
+		sim_decision(iface, "failed");
+		return -1;
+	}
+	ctx->completed++;
+	sim_decision(iface, "completed");
+	return 0;
+}
+
+
+int hostapd_csa_in_progress(struct hostapd_iface *iface)
+{
+	return 0;
+}
+
+
+int hostapd_setup_interface_complete(struct hostapd_iface *iface, int err)
+{
+	sim_ctx(iface)->cac++;
+	sim_decision(iface, "cac");
+	return 0;
+}
+
+
+int hostapd_switch_channel(struct hostapd_data *hapd,
+			   struct csa_settings *settings)
+{
+	sim_ctx(hapd->iface)->switches++;
+	sim_decision(hapd->iface, "csa");
+	return 0;
+}
+
+
+int hostapd_prepare_and_send_csa_deauth_cfg_to_driver(struct hostapd_data *hapd)
+{
+	return 0;
+}
+
+
+int hostapd_disable_iface(struct hostapd_iface *hapd_iface)
+{
+	sim_decision(hapd_iface, "disable");
+	return 0;
+}
+
+
+int hostapd_enable_iface(struct hostapd_iface *hapd_iface)
+{
+	return 0;
+}
+
+
+void hostapd_set_state(struct hostapd_iface *iface, enum hostapd_iface_state s)
+{
+	iface->state = s;
+}
+
+
+int hostapd_drv_do_acs(struct hostapd_data *hapd)
+{
+	return -1;
+}
+
+
+int hostapd_driver_scan(struct hostapd_data *hapd,
+			struct wpa_driver_scan_params *params)
+{
+	return 0;
+}
+
+
+struct wpa_scan_results * hostapd_driver_get_scan_results(
+	struct hostapd_data *hapd)
+{
+	struct arg_ctx *ctx = hapd->drv_priv;
+	struct wpa_scan_results *res;
+	size_t i;
+
+	res = os_zalloc(sizeof(*res));
+	if (!res)
+		return NULL;
+	res->res = os_calloc(ctx->scan.num + 1, sizeof(struct wpa_scan_res *));
+	if (!res->res) {
+		os_free(res);
+		return NULL;
+	}
+	for (i = 0; i < ctx->scan.num; i++) {
+		struct wpa_scan_res *r = ctx->scan.res[i];
+
+		res->res[i] = os_memdup(r, sizeof(*r) + r->ie_len +
+					r->beacon_ie_len);
+		if (!res->res[i]) {
+			wpa_scan_results_free(res);
+			return NULL;
+		}
+		res->num++;
+	}
+	return res;
+}
+
+
+int hostapd_handle_self_beacon_report_scan_results(struct hostapd_data *hapd)
+{
+	return 0;
+}
+
+
+void hostapd_handle_sta_beacon_report_scan_results(struct hostapd_iface *iface)
+{
+}
+
+
+struct hostapd_channel_data * hostapd_get_mode_channel(
+	struct hostapd_iface *iface, unsigned int freq)
+{
+	int i;
+	struct hostapd_channel_data *chan;
+
+	for (i = 0; i < iface->current_mode->num_channels; i++) {
+		chan = &iface->current_mode->channels[i];
+		if ((unsigned int) chan->freq == freq)
+			return chan;
+	}
+
+	return NULL;
+}
+
+
+void hostapd_atf_clean_config(struct atf_config *atf_cfg)
+{
+}
+
+
+/* Same bookkeeping as hostapd_event_get_survey() for a full survey dump */
+static int sim_get_survey(void *priv, unsigned int freq)
+{
+	struct arg_ctx *ctx = priv;
+	struct hostapd_iface *iface = &ctx->iface;
+	struct hostapd_channel_data *chan;
+	struct freq_survey *survey;
+	size_t i;
+
+	for (i = 0; i < ctx->num_surveys; i++) {
+		chan = hostapd_get_mode_channel(iface, ctx->surveys[i].freq);
+		if (!chan || (chan->flag & HOSTAPD_CHAN_DISABLED))
+			continue;
+
+		survey = os_memdup(&ctx->surveys[i], sizeof(*survey));
+		if (!survey)
+			return -1;
+
+		if (!iface->chans_surveyed) {
+			chan->min_nf = survey->nf;
+			iface->lowest_nf = survey->nf;
+		} else {
+			if (dl_list_empty(&chan->survey_list) ||
+			    survey->nf < chan->min_nf)
+				chan->min_nf = survey->nf;
+			if (survey->nf < iface->lowest_nf)
+				iface->lowest_nf = survey->nf;
+		}
+		dl_list_add_tail(&chan->survey_list, &survey->list);
+		iface->chans_surveyed++;
+	}
+
+	return 0;
+}
+
+
+static int sim_chan_to_freq(enum hostapd_hw_mode mode, int chan)
+{
+	if (mode == HOSTAPD_MODE_IEEE80211A)
+		return 5000 + 5 * chan;
+	if (chan == 14)
+		return 2484;
+	return 2407 + 5 * chan;
+}
+
+
+static int sim_add_chan(struct arg_ctx *ctx, int chan, int flag)
+{
+	int i;
+
+	for (i = 0; i < ctx->num_chans; i++) {
+		if (ctx->chans[i].chan == chan) {
+			ctx->chans[i].flag = flag;
+			return 0;
+		}
+	}
+	if (ctx->num_chans == SIM_MAX_CHANNELS)
+		return -1;
+	ctx->chans[ctx->num_chans].chan = chan;
+	ctx->chans[ctx->num_chans].flag = flag;
+	ctx->num_chans++;
+	return 0;
+}
+
+
+/* Full channel list for the band with the scenario's chan lines on top */
+static void sim_default_chans(struct arg_ctx *ctx)
+{
+	struct sim_chan over[SIM_MAX_CHANNELS];
+	int i, c, num_over = ctx->num_chans;
+
+	os_memcpy(over, ctx->chans, num_over * sizeof(over[0]));
+	ctx->num_chans = 0;
+
+	if (ctx->hw_mode != HOSTAPD_MODE_IEEE80211A) {
+		for (c = 1; c <= 13; c++)
+			sim_add_chan(ctx, c, 0);
+	} else {
+		for (c = 36; c <= 144; c += 4)
+			sim_add_chan(ctx, c, c >= 52 ? HOSTAPD_CHAN_RADAR |
+				     HOSTAPD_CHAN_DFS_USABLE : 0);
+		for (c = 149; c <= 165; c += 4)
+			sim_add_chan(ctx, c, 0);
+	}
+
+	for (i = 0; i < num_over; i++)
+		sim_add_chan(ctx, over[i].chan, over[i].flag);
+}
+
+
+static struct hostapd_hw_modes * gen_modes(struct arg_ctx *ctx)
+{
+	struct hostapd_hw_modes *mode;
+	int i;
+
+	mode = os_zalloc(sizeof(struct hostapd_hw_modes));
+	if (!mode)
+		return NULL;
+
+	mode->mode = ctx->hw_mode;
+	mode->channels = os_calloc(ctx->num_chans,
+				   sizeof(struct hostapd_channel_data));
+	if (!mode->channels) {
+		os_free(mode);
+		return NULL;
+	}
+	for (i = 0; i < ctx->num_chans; i++) {
+		struct hostapd_channel_data *chan = &mode->channels[i];
+
+		chan->chan = ctx->chans[i].chan;
+		chan->freq = sim_chan_to_freq(ctx->hw_mode, chan->chan);
+		chan->flag = ctx->chans[i].flag;
+		chan->max_tx_power = 20;
+		dl_list_init(&chan->survey_list);
+	}
+	mode->num_channels = ctx->num_chans;
+	mode->ht_capab = HT_CAP_INFO_SUPP_CHANNEL_WIDTH_SET;
+	mode->vht_capab = VHT_CAP_SUPP_CHAN_WIDTH_160MHZ;
+
+	mode->rates = os_zalloc(sizeof(int));
+	if (!mode->rates) {
+		os_free(mode->channels);
+		os_free(mode);
+		return NULL;
+	}
+	mode->rates[0] = ctx->hw_mode == HOSTAPD_MODE_IEEE80211A ? 60 : 10;
+	mode->num_rates = 1;
+
+	return mode;
+}
+
+
+static int init_hapd(struct arg_ctx *ctx)
+{
+	struct hostapd_data *hapd = &ctx->hapd;
+	struct hostapd_config *conf;
+
+	ctx->driver.get_survey = sim_get_survey;
+	hapd->driver = &ctx->driver;
+	hapd->drv_priv = ctx;
+	hapd->msg_ctx = hapd;
+	os_memcpy(hapd->own_addr, "\x02\x00\x00\x00\x03\x00", ETH_ALEN);
+	hapd->iface = &ctx->iface;
+	hapd->iface->interfaces = &ctx->interfaces;
+	ctx->bss[0] = hapd;
+	hapd->iface->bss = ctx->bss;
+	hapd->iface->num_bss = 1;
+	conf = hapd->iface->conf = hostapd_config_defaults();
+	if (!conf)
+		return -1;
+	hapd->iconf = conf;
+	hapd->conf = conf->bss[0];
+	hostapd_config_defaults_bss(hapd->conf);
+
+	/* Keep the ACS diagnostics in memory only */
+	conf->acs_log_to_file = 0;
+	conf->acs_num_scans = 1;
+	conf->ieee80211n = 1;
+	conf->channel = 0;
+
+	return 0;
+}
+
+
+static int sim_add_bss(struct arg_ctx *ctx, int freq, int level,
+		       const u8 *ies, size_t ies_len)
+{
+	struct wpa_scan_res *r, **n;
+
+	n = os_realloc_array(ctx->scan.res, ctx->scan.num + 1, sizeof(*n));
+	if (!n)
+		return -1;
+	ctx->scan.res = n;
+
+	r = os_zalloc(sizeof(*r) + ies_len);
+	if (!r)
+		return -1;
+	r->bssid[0] = 0x02;
+	WPA_PUT_BE32(&r->bssid[2], ctx->scan.num);
+	r->freq = freq;
+	r->level = level;
+	r->beacon_int = 100;
+	r->ie_len = ies_len;
+	os_memcpy(r + 1, ies, ies_len);
+	ctx->scan.res[ctx->scan.num++] = r;
+	return 0;
+}
+
+
+/* bss <freq> <rssi> <20|40+|40-|80|160> [ssid] [intolerant] */
+static int sim_parse_bss(struct arg_ctx *ctx, char *args)
+{
+	u8 ies[128], *pos = ies;
+	char width[8], ssid[33] = "", flags[16] = "";
+	int freq, level, chan, seg0 = 0, n;
+	struct ieee80211_ht_capabilities *ht_cap;
+	struct ieee80211_ht_operation *ht_oper;
+	struct ieee80211_vht_operation *vht_oper;
+	u16 capab = HT_CAP_INFO_SUPP_CHANNEL_WIDTH_SET;
+	u8 ht_param = 0;
+
+	n = sscanf(args, "%d %d %7s %32s %15s", &freq, &level, width, ssid,
+		   flags);
+	if (n < 3)
+		return -1;
+	if (n < 4)
+		os_snprintf(ssid, sizeof(ssid), "bss%u",
+			    (unsigned int) ctx->scan.num);
+	if (os_strcmp(flags, "intolerant") == 0)
+		capab |= HT_CAP_INFO_40MHZ_INTOLERANT;
+
+	chan = freq >= 5000 ? (freq - 5000) / 5 : (freq - 2407) / 5;
+	if (os_strcmp(width, "40+") == 0) {
+		ht_param = HT_INFO_HT_PARAM_STA_CHNL_WIDTH |
+			HT_INFO_HT_PARAM_SECONDARY_CHNL_ABOVE;
+	} else if (os_strcmp(width, "40-") == 0) {
+		ht_param = HT_INFO_HT_PARAM_STA_CHNL_WIDTH |
+			HT_INFO_HT_PARAM_SECONDARY_CHNL_BELOW;
+	} else if (os_strcmp(width, "80") == 0 ||
+		   os_strcmp(width, "160") == 0) {
+		int w = atoi(width), base;
+
+		if (freq < 5000)
+			return -1;
+		base = chan >= 149 ? 149 : 36;
+		base += (chan - base) / (w / 5) * (w / 5);
+		seg0 = base + (w / 10) - 2;
+		ht_param = HT_INFO_HT_PARAM_STA_CHNL_WIDTH |
+			(((chan - base) / 4) % 2 ?
+			 HT_INFO_HT_PARAM_SECONDARY_CHNL_BELOW :
+			 HT_INFO_HT_PARAM_SECONDARY_CHNL_ABOVE);
+	} else if (os_strcmp(width, "20") != 0) {
+		return -1;
+	}
+
+	*pos++ = WLAN_EID_SSID;
+	*pos++ = os_strlen(ssid);
+	os_memcpy(pos, ssid, os_strlen(ssid));
+	pos += os_strlen(ssid);
+
+	*pos++ = WLAN_EID_HT_CAP;
+	*pos++ = sizeof(*ht_cap);
+	ht_cap = (struct ieee80211_ht_capabilities *) pos;
+	os_memset(ht_cap, 0, sizeof(*ht_cap));
+	ht_cap->ht_capabilities_info = host_to_le16(capab);
+	pos += sizeof(*ht_cap);
+
+	*pos++ = WLAN_EID_HT_OPERATION;
+	*pos++ = sizeof(*ht_oper);
+	ht_oper = (struct ieee80211_ht_operation *) pos;
+	os_memset(ht_oper, 0, sizeof(*ht_oper));
+	ht_oper->primary_chan = chan;
+	ht_oper->ht_param = ht_param;
+	pos += sizeof(*ht_oper);
+
+	if (seg0) {
+		*pos++ = WLAN_EID_VHT_OPERATION;
+		*pos++ = sizeof(*vht_oper);
+		vht_oper = (struct ieee80211_vht_operation *) pos;
+		os_memset(vht_oper, 0, sizeof(*vht_oper));
+		vht_oper->vht_op_info_chwidth = atoi(width) == 80 ?
+			VHT_CHANWIDTH_80MHZ : VHT_CHANWIDTH_160MHZ;
+		vht_oper->vht_op_info_chan_center_freq_seg0_idx = seg0;
+		pos += sizeof(*vht_oper);
+	}
+
+	return sim_add_bss(ctx, freq, level, ies, pos - ies);
+}
+
+
+/* bss_ies <freq> <rssi> <hexdump of IEs> */
+static int sim_parse_bss_ies(struct arg_ctx *ctx, char *args)
+{
+	char hex[1024];
+	u8 *ies;
+	size_t len;
+	int freq, level, ret;
+
+	if (sscanf(args, "%d %d %1023s", &freq, &level, hex) != 3)
+		return -1;
+	len = os_strlen(hex) / 2;
+	ies = os_malloc(len);
+	if (!ies)
+		return -1;
+	ret = hexstr2bin(hex, ies, len);
+	if (ret == 0)
+		ret = sim_add_bss(ctx, freq, level, ies, len);
+	os_free(ies);
+	return ret;
+}
+
+
+/* survey <freq> <nf> <time> <busy> [rx] [tx] */
+static int sim_parse_survey(struct arg_ctx *ctx, char *args)
+{
+	struct freq_survey *s, *n;
+	unsigned long long t, busy, rx = 0, tx = 0;
+	int freq, nf, cnt;
+
+	cnt = sscanf(args, "%d %d %llu %llu %llu %llu", &freq, &nf, &t, &busy,
+		     &rx, &tx);
+	if (cnt < 4)
+		return -1;
+
+	n = os_realloc_array(ctx->surveys, ctx->num_surveys + 1, sizeof(*n));
+	if (!n)
+		return -1;
+	ctx->surveys = n;
+	s = &ctx->surveys[ctx->num_surveys++];
+	os_memset(s, 0, sizeof(*s));
+	s->freq = freq;
+	s->nf = nf;
+	s->channel_time = t;
+	s->channel_time_busy = busy;
+	s->channel_time_rx = rx;
+	s->channel_time_tx = tx;
+	s->filled = SURVEY_HAS_NF | SURVEY_HAS_CHAN_TIME |
+		SURVEY_HAS_CHAN_TIME_BUSY;
+	if (cnt > 4)
+		s->filled |= SURVEY_HAS_CHAN_TIME_RX;
+	if (cnt > 5)
+		s->filled |= SURVEY_HAS_CHAN_TIME_TX;
+	return 0;
+}
+
+
+static struct intel_vendor_channel_data * sim_new_chdata(struct arg_ctx *ctx)
+{
+	struct intel_vendor_channel_data *n;
+
+	n = os_realloc_array(ctx->chdata, ctx->num_chdata + 1, sizeof(*n));
+	if (!n)
+		return NULL;
+	ctx->chdata = n;
+	n = &ctx->chdata[ctx->num_chdata++];
+	os_memset(n, 0, sizeof(*n));
+	return n;
+}
+
+
+/*
+ * chandata <primary|all> [key=value ..] [scan] [bt]
+ * filled_mask is derived from the keys that are present.
+ */
+static int sim_parse_chandata(struct arg_ctx *ctx, char *args)
+{
+	static const struct {
+		const char *name;
+		size_t offset;
+		u32 mask;
+	} keys[] = {
+#define CHDATA_KEY(n, f, m) \
+		{ n, offsetof(struct intel_vendor_channel_data, f), m }
+		CHDATA_KEY("secondary", secondary, 0),
+		CHDATA_KEY("bw", BW, 0),
+		CHDATA_KEY("nf", noise_floor, CHDATA_NOISE_FLOOR),
+		CHDATA_KEY("busy", busy_time, CHDATA_BUSY_TIME),
+		CHDATA_KEY("total", total_time, CHDATA_TOTAL_TIME),
+		CHDATA_KEY("calib", calibration, CHDATA_CALIB),
+		CHDATA_KEY("num_bss", num_bss, CHDATA_NUM_BSS),
+		CHDATA_KEY("dyn20", dynBW20, CHDATA_DYNBW),
+		CHDATA_KEY("dyn40", dynBW40, CHDATA_DYNBW),
+		CHDATA_KEY("dyn80", dynBW80, CHDATA_DYNBW),
+		CHDATA_KEY("dyn160", dynBW160, CHDATA_DYNBW),
+		CHDATA_KEY("rssi", rssi, CHDATA_RSSI),
+		CHDATA_KEY("snr", snr, CHDATA_SNR),
+		CHDATA_KEY("cwi", cwi_noise, CHDATA_CWI_NOISE),
+		CHDATA_KEY("rxevt", not_80211_rx_evt, CHDATA_NOT_80211_EVT),
+		CHDATA_KEY("ext", ext_sta_rx, CHDATA_LOW_RSSI),
+		CHDATA_KEY("txp", tx_power, CHDATA_TX_POWER),
+		CHDATA_KEY("load", load, CHDATA_LOAD),
+#undef CHDATA_KEY
+	};
+	struct intel_vendor_channel_data *cd;
+	char *token, *context = NULL, *val;
+	unsigned int i;
+
+	cd = sim_new_chdata(ctx);
+	if (!cd)
+		return -1;
+
+	/* primary 0 ("all") and freq are resolved in sim_expand_chandata() */
+	token = str_token(args, " \t", &context);
+	if (!token)
+		return -1;
+	if (os_strcmp(token, "all") != 0)
+		cd->primary = cd->channel = atoi(token);
+	cd->BW = 20;
+
+	while ((token = str_token(args, " \t", &context))) {
+		if (os_strcmp(token, "scan") == 0) {
+			cd->filled_mask |= CHDATA_SCAN_MODE;
+			continue;
+		}
+		if (os_strcmp(token, "bt") == 0) {
+			cd->filled_mask |= CHDATA_BT_INTERF_MODE;
+			continue;
+		}
+		val = os_strchr(token, '=');
+		if (!val)
+			return -1;
+		*val++ = '\0';
+		for (i = 0; i < ARRAY_SIZE(keys); i++) {
+			if (os_strcmp(token, keys[i].name) == 0)
+				break;
+		}
+		if (i == ARRAY_SIZE(keys)) {
+			wpa_printf(MSG_ERROR, "Unknown chandata field '%s'",
+				   token);
+			return -1;
+		}
+		/* all fields are 32-bit and the struct is packed */
+		WPA_PUT_LE32((u8 *) cd + keys[i].offset, atoi(val));
+		cd->filled_mask |= keys[i].mask;
+	}
+
+	return 0;
+}
+
+
+/* chandata_hex <hexdump of struct intel_vendor_channel_data> */
+static int sim_parse_chandata_hex(struct arg_ctx *ctx, char *args)
+{
+	struct intel_vendor_channel_data *cd;
+
+	if (os_strlen(args) != 2 * sizeof(*cd))
+		return -1;
+	cd = sim_new_chdata(ctx);
+	if (!cd)
+		return -1;
+	return hexstr2bin(args, (u8 *) cd, sizeof(*cd));
+}
+
+
+/* Replicate "chandata all" lines for every enabled channel */
+static int sim_expand_chandata(struct arg_ctx *ctx)
+{
+	struct intel_vendor_channel_data *out, *cd;
+	size_t i, num = 0;
+	int j, per_line = 0;
+
+	for (j = 0; j < ctx->num_chans; j++) {
+		if (!(ctx->chans[j].flag & HOSTAPD_CHAN_DISABLED))
+			per_line++;
+	}
+
+	out = os_calloc(ctx->num_chdata * per_line + 1, sizeof(*out));
+	if (!out)
+		return -1;
+
+	for (i = 0; i < ctx->num_chdata; i++) {
+		cd = &ctx->chdata[i];
+		if (cd->primary) {
+			out[num] = *cd;
+			if (!out[num].freq)
+				out[num].freq = sim_chan_to_freq(ctx->hw_mode,
+								 cd->primary);
+			num++;
+			continue;
+		}
+		for (j = 0; j < ctx->num_chans; j++) {
+			if (ctx->chans[j].flag & HOSTAPD_CHAN_DISABLED)
+				continue;
+			out[num] = *cd;
+			out[num].primary = out[num].channel =
+				ctx->chans[j].chan;
+			out[num].freq = sim_chan_to_freq(ctx->hw_mode,
+							 ctx->chans[j].chan);
+			num++;
+		}
+	}
+
+	os_free(ctx->chdata);
+	ctx->chdata = out;
+	ctx->num_chdata = num;
+	return 0;
+}
+
+
+static int sim_parse_int_list(int *list, size_t max, char *args)
+{
+	char *token, *context = NULL;
+	size_t i = 0;
+
+	while ((token = str_token(args, " \t", &context))) {
+		if (i == max)
+			return -1;
+		list[i++] = atoi(token);
+	}
+	return i ? 0 : -1;
+}
+
+
+static int sim_parse_line(struct arg_ctx *ctx, char *cmd, char *args)
+{
+	struct hostapd_config *conf = ctx->iface.conf;
+	static const struct {
+		const char *name;
+		size_t offset;
+	} ints[] = {
+#define CONF_INT(n) { #n, offsetof(struct hostapd_config, n) }
+		CONF_INT(ieee80211n),
+		CONF_INT(ieee80211ac),
+		CONF_INT(ieee80211ax),
+		CONF_INT(secondary_channel),
+		CONF_INT(obss_interval),
+		CONF_INT(acs_policy),
+		CONF_INT(acs_switch_thresh),
+		CONF_INT(acs_bw_comparison),
+		CONF_INT(acs_vht_dynamic_bw),
+		CONF_INT(acs_use24overlapped),
+#undef CONF_INT
+	};
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(ints); i++) {
+		if (os_strcmp(cmd, ints[i].name) == 0) {
+			*(int *) ((u8 *) conf + ints[i].offset) = atoi(args);
+			return 0;
+		}
+	}
+
+	if (os_strcmp(cmd, "hw_mode") == 0) {
+		if (os_strcmp(args, "a") == 0)
+			ctx->hw_mode = HOSTAPD_MODE_IEEE80211A;
+		else if (os_strcmp(args, "g") == 0)
+			ctx->hw_mode = HOSTAPD_MODE_IEEE80211G;
+		else
+			return -1;
+		conf->hw_mode = ctx->hw_mode;
+	} else if (os_strcmp(cmd, "channel") == 0) {
+		conf->channel = atoi(args);
+	} else if (os_strcmp(cmd, "vht_oper_chwidth") == 0) {
+		conf->vht_oper_chwidth = atoi(args);
+	} else if (os_strcmp(cmd, "obss_beacon_rssi_threshold") == 0) {
+		conf->obss_beacon_rssi_threshold = atoi(args);
+	} else if (os_strcmp(cmd, "acs_numbss_coeflist") == 0) {
+		return sim_parse_int_list(conf->acs_numbss_coeflist,
+					  ACS_NUMBSS_NUM_COEFS, args);
+	} else if (os_strcmp(cmd, "acs_penalty_factors") == 0) {
+		return sim_parse_int_list(conf->acs_penalty_factors,
+					  ACS_NUM_PENALTY_FACTORS, args);
+	} else if (os_strcmp(cmd, "acs_to_degradation") == 0) {
+		return sim_parse_int_list(conf->acs_to_degradation,
+					  ACS_NUM_DEGRADATION_FACTORS, args);
+	} else if (os_strcmp(cmd, "acs_bw_threshold") == 0) {
+		return sim_parse_int_list(conf->acs_bw_threshold,
+					  ACS_BW_THRESH_NUM, args);
+	} else if (os_strcmp(cmd, "acs_fallback_chan") == 0) {
+		if (sscanf(args, "%d %d %d", &conf->acs_fallback_chan.primary,
+			   &conf->acs_fallback_chan.secondary,
+			   &conf->acs_fallback_chan.width) != 3)
+			return -1;
+	} else if (os_strcmp(cmd, "chan") == 0) {
+		char flag[24] = "";
+		int chan, f = 0;
+
+		if (sscanf(args, "%d %23s", &chan, flag) < 1)
+			return -1;
+		if (os_strcmp(flag, "radar") == 0)
+			f = HOSTAPD_CHAN_RADAR | HOSTAPD_CHAN_DFS_USABLE;
+		else if (os_strcmp(flag, "dfs_available") == 0)
+			f = HOSTAPD_CHAN_RADAR | HOSTAPD_CHAN_DFS_AVAILABLE;
+		else if (os_strcmp(flag, "dfs_unavailable") == 0)
+			f = HOSTAPD_CHAN_RADAR | HOSTAPD_CHAN_DFS_UNAVAILABLE;
+		else if (os_strcmp(flag, "disabled") == 0)
+			f = HOSTAPD_CHAN_DISABLED;
+		else if (flag[0])
+			return -1;
+		return sim_add_chan(ctx, chan, f);
+	} else if (os_strcmp(cmd, "bss") == 0) {
+		return sim_parse_bss(ctx, args);
+	} else if (os_strcmp(cmd, "bss_ies") == 0) {
+		return sim_parse_bss_ies(ctx, args);
+	} else if (os_strcmp(cmd, "survey") == 0) {
+		return sim_parse_survey(ctx, args);
+	} else if (os_strcmp(cmd, "chandata") == 0) {
+		return sim_parse_chandata(ctx, args);
+	} else if (os_strcmp(cmd, "chandata_hex") == 0) {
+		return sim_parse_chandata_hex(ctx, args);
+	} else if (os_strcmp(cmd, "num_bss") == 0) {
+		ctx->num_bss = atoi(args);
+	} else {
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int sim_load_scenario(struct arg_ctx *ctx, const char *fname)
+{
+	char buf[1024], *pos, *args;
+	int line = 0, errors = 0;
+	FILE *f;
+
+	f = fopen(fname, "r");
+	if (!f) {
+		wpa_printf(MSG_ERROR, "Could not open scenario '%s'", fname);
+		return -1;
+	}
+
+	while (fgets(buf, sizeof(buf), f)) {
+		line++;
+		pos = buf;
+		while (*pos == ' ' || *pos == '\t')
+			pos++;
+		if (*pos == '#' || *pos == '\n' || *pos == '\0')
+			continue;
+		args = pos + strcspn(pos, " \t\r\n");
+		if (*args)
+			*args++ = '\0';
+		while (*args == ' ' || *args == '\t')
+			args++;
+		args[strcspn(args, "\r\n")] = '\0';
+
+		if (sim_parse_line(ctx, pos, args) < 0) {
+			wpa_printf(MSG_ERROR, "%s:%d: invalid line '%s'",
+				   fname, line, pos);
+			errors++;
+		}
+	}
+
+	fclose(f);
+	return errors ? -1 : 0;
+}
+
+
+/*
+ * Run acs_init() and feed the scan/survey results until ACS completes.
+ * Channel data events flagged as scan mode arrive from the driver while the
+ * scan is running, so they are replayed before the scan completes.
+ */
+static void sim_run_pipeline(struct arg_ctx *ctx)
+{
+	struct hostapd_iface *iface = &ctx->iface;
+	size_t i;
+
+	iface->conf->channel = ctx->channel;
+	iface->conf->secondary_channel = ctx->secondary_channel;
+	iface->conf->vht_oper_chwidth = ctx->vht_oper_chwidth;
+	iface->conf->acs_init_done = 0;
+	if (acs_init(iface) != HOSTAPD_CHAN_ACS) {
+		wpa_printf(MSG_ERROR, "ACS: acs_init() failed");
+		ctx->failed++;
+		return;
+	}
+
+	for (i = 0; i < ctx->num_chdata; i++) {
+		if (ctx->chdata[i].filled_mask & CHDATA_SCAN_MODE)
+			hostapd_ltq_update_channel_data(
+				iface, (const u8 *) &ctx->chdata[i],
+				sizeof(ctx->chdata[i]));
+	}
+
+	while (iface->in_scan && iface->scan_cb)
+		iface->scan_cb(iface);
+}
+
+
+/*
+ * Load a candidate table in the format written by acs_print_cand_no_file(),
+ * e.g. a captured acs_smart_info_file, for offline replay of the ranking.
+ * Lines that are not candidate table entries are skipped.
+ */
+static int sim_load_candidate_table(struct hostapd_iface *iface,
+				    const char *fname)
+{
+	struct acs_candidate_table *cand;
+	struct os_reltime now;
+	char line[512];
+	int v[27];
+	char cal;
+	u8 chan;
+	FILE *f;
+
+	f = fopen(fname, "r");
+	if (!f) {
+		wpa_printf(MSG_ERROR, "cannot open candidate table '%s': %s",
+			   fname, strerror(errno));
+		return -1;
+	}
+
+	os_memset(iface->candidates, 0, sizeof(iface->candidates));
+	iface->num_candidates = 0;
+	iface->selected_candidate = -1;
+	os_get_reltime(&now);
+
+	while (fgets(line, sizeof(line), f)) {
+		/* the trailing exclusion reason may be blank */
+		if (sscanf(line, "%d %d %d %d %d %d %d %d %d %d %c %d %d %d %d "
+			   "%d %d %d %d %d %d %d %d %d %d %d %d %d",
+			   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6],
+			   &v[7], &v[8], &v[9], &cal, &v[10], &v[11], &v[12],
+			   &v[13], &v[14], &v[15], &v[16], &v[17], &v[18],
+			   &v[19], &v[20], &v[21], &v[22], &v[23], &v[24],
+			   &v[25], &v[26]) != 28)
+			continue;
+
+		if (iface->num_candidates >= MAX_CANDIDATES) {
+			wpa_printf(MSG_ERROR, "too many candidates in '%s'",
+				   fname);
+			break;
+		}
+
+		cand = &iface->candidates[iface->num_candidates++];
+		cand->primary = v[1];
+		cand->secondary = v[2];
+		cand->freq = v[3];
+		cand->width = v[4];
+		cand->rank = v[5];
+		cand->noise_floor = v[6];
+		cand->channel_load = v[7];
+		cand->num_bss = v[8];
+		cand->num_bss_pri = v[9];
+		cand->calibrated = cal == 'y';
+		cand->radar_affected = v[10] ? TRUE : FALSE;
+		cand->radar_detected = v[11] ? TRUE : FALSE;
+		cand->overlap40 = v[12] ? TRUE : FALSE;
+		cand->overlap80 = v[13] ? TRUE : FALSE;
+		cand->overlap160 = v[14] ? TRUE : FALSE;
+		cand->primary_on_overlap_4080160 = v[15];
+		cand->intolerant40 = v[16];
+		cand->cwi_noise = v[17];
+		cand->dynBW20 = v[18];
+		cand->dynBW40 = v[19];
+		cand->dynBW80 = v[20];
+		cand->dynBW160 = v[21];
+		cand->rssi = v[22];
+		cand->snr = v[23];
+		cand->not_80211_rx_evt = v[24];
+		cand->not_my_sta_low_rssi = v[25];
+		cand->tx_power = v[26];
+		cand->num_adjacent = cand->num_bss - cand->num_bss_pri;
+		if (cand->width == 20) {
+			cand->chan = cand->primary;
+		} else {
+			/* center channel of the bonded range */
+			ieee80211_freq_to_chan(cand->freq +
+					       (cand->width >> 1) - 10, &chan);
+			cand->chan = chan;
+		}
+		cand->entry_init_done = TRUE;
+		cand->ts_scan = cand->ts_update = now;
+		cand->ts_overlap40 = cand->ts_overlap80 = now;
+		cand->ts_overlap160 = now;
+		cand->ts_intolerant40 = now;
+
+		if (cand->tx_power > iface->max_tx_power)
+			iface->max_tx_power = cand->tx_power;
+	}
+
+	fclose(f);
+	wpa_printf(MSG_DEBUG, "loaded %u candidates from '%s'",
+		   iface->num_candidates, fname);
+	return iface->num_candidates ? 0 : -1;
+}
+
+
+static void sim_run(struct arg_ctx *ctx, const char *table)
+{
+	struct hostapd_iface *iface = &ctx->iface;
+	struct wpa_scan_results *scan_res;
+	unsigned int iter;
+	size_t i;
+	u64 t0;
+	FILE *fp;
+
+	if (table) {
+		if (sim_load_candidate_table(iface, table) < 0) {
+			ctx->failed++;
+			return;
+		}
+		iface->conf->acs_init_done = 1;
+		iface->acs_num_bss = ctx->num_bss;
+	} else {
+		os_strlcpy(ctx->stage, "initial", sizeof(ctx->stage));
+		for (iter = 0; iter < ctx->iterations; iter++) {
+			ctx->record = iter == 0;
+			t0 = bench_now_ns();
+			sim_run_pipeline(ctx);
+			bench_hist_add(&ctx->stats[SIM_PIPELINE],
+				       bench_now_ns() - t0);
+			if (ctx->failed)
+				return;
+		}
+		if (iface->conf->acs_algo != ACS_ALGO_SMART)
+			return;
+	}
+
+	/* Time the Smart ACS stages individually on the same input */
+	scan_res = hostapd_driver_get_scan_results(&ctx->hapd);
+	fp = fopen("/dev/null", "w");
+	if (!scan_res || !fp)
+		goto out;
+	os_strlcpy(ctx->stage, table ? "table" : "rerank",
+		   sizeof(ctx->stage));
+	for (iter = 0; iter < ctx->iterations; iter++) {
+		ctx->record = table && iter == 0;
+		if (!table) {
+			t0 = bench_now_ns();
+			acs_smart_record_bsses(iface, scan_res, fp);
+			bench_hist_add(&ctx->stats[SIM_RECORD_BSSES],
+				       bench_now_ns() - t0);
+		}
+
+		t0 = bench_now_ns();
+		acs_update_radar(iface);
+		bench_hist_add(&ctx->stats[SIM_UPDATE_RADAR],
+			       bench_now_ns() - t0);
+
+		t0 = bench_now_ns();
+		acs_recalc_ranks_and_set_chan(iface, SWR_INITIAL);
+		bench_hist_add(&ctx->stats[SIM_RECALC], bench_now_ns() - t0);
+	}
+	if (table) {
+		ctx->record = 1;
+		sim_decision(iface, "selected");
+	}
+
+	/* Replay the channel data events against the selected channel */
+	for (iter = 0; iter < ctx->iterations; iter++) {
+		ctx->record = iter == 0;
+		for (i = 0; i < ctx->num_chdata; i++) {
+			if (ctx->chdata[i].filled_mask & CHDATA_SCAN_MODE)
+				continue;
+			os_snprintf(ctx->stage, sizeof(ctx->stage),
+				    "chandata#%u", (unsigned int) i);
+			t0 = bench_now_ns();
+			hostapd_ltq_update_channel_data(
+				iface, (const u8 *) &ctx->chdata[i],
+				sizeof(ctx->chdata[i]));
+			bench_hist_add(&ctx->stats[SIM_CHANDATA],
+				       bench_now_ns() - t0);
+		}
+	}
+
+out:
+	if (fp)
+		fclose(fp);
+	wpa_scan_results_free(scan_res);
+}
+
+
+static void sim_report(struct arg_ctx *ctx)
+{
+	struct hostapd_iface *iface = &ctx->iface;
+	unsigned int i;
+
+	printf("%-14s %8s %10s %10s %10s %10s %10s\n",
+	       "stage", "runs", "mean_ns", "p50_ns", "p90_ns", "p99_ns",
+	       "max_ns");
+	for (i = 0; i < NUM_SIM_STAGE; i++) {
+		struct bench_hist *st = &ctx->stats[i];
+
+		if (!st->count)
+			continue;
+		printf("%-14s %8lu %10llu %10llu %10llu %10llu %10llu\n",
+		       sim_stage_txt[i], st->count,
+		       (unsigned long long) (st->total_ns / st->count),
+		       (unsigned long long) bench_hist_percentile(st, 50),
+		       (unsigned long long) bench_hist_percentile(st, 90),
+		       (unsigned long long) bench_hist_percentile(st, 99),
+		       (unsigned long long) st->max_ns);
+	}
+
+	printf("channels=%d bss=%u surveys=%u chandata=%u candidates=%u\n",
+	       ctx->num_chans, (unsigned int) ctx->scan.num,
+	       (unsigned int) ctx->num_surveys, (unsigned int) ctx->num_chdata,
+	       iface->num_candidates);
+	printf("completed=%u failed=%u csa=%u cac=%u\n",
+	       ctx->completed, ctx->failed, ctx->switches, ctx->cac);
+	printf("final channel=%d secondary=%d chwidth=%d seg0=%d\n",
+	       iface->conf->channel, iface->conf->secondary_channel,
+	       iface->conf->vht_oper_chwidth,
+	       iface->conf->vht_oper_centr_freq_seg0_idx);
+}
+
+
+static void sim_dump_log(struct arg_ctx *ctx)
+{
+	size_t len = ctx->iface.conf->acs_log_ring_size + 4096;
+	char *buf;
+	int ret;
+
+	buf = os_malloc(len);
+	if (!buf)
+		return;
+	ret = acs_log_dump(&ctx->iface, NULL, buf, len);
+	if (ret > 0)
+		fwrite(buf, 1, ret, stdout);
+	os_free(buf);
+}
+
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-hv] [-d] [-a<algo>] [-i<iterations>] "
+	       "[-t <table>] -c <scenario>\n"
+	       "  -c <file>  scenario (config, channels, scan, survey and "
+	       "channel data)\n"
+	       "  -a <algo>  smart (default), numbss or survey\n"
+	       "  -t <file>  skip the scan and rank a captured Smart ACS "
+	       "candidate table\n"
+	       "  -i <num>   number of iterations per stage (default 1)\n"
+	       "  -v         dump the in-memory ACS log\n"
+	       "  -d         show debug messages (repeat for more)\n",
+	       prog);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct arg_ctx ctx;
+	const char *scenario = NULL, *table = NULL, *algo = "smart";
+	int verbose = 0, ret = -1, c;
+	size_t i;
+
+	os_memset(&ctx, 0, sizeof(ctx));
+	ctx.iterations = 1;
+	ctx.hw_mode = HOSTAPD_MODE_IEEE80211A;
+	/* ACS reports expected conditions at MSG_ERROR; keep runs quiet */
+	wpa_debug_level = MSG_ERROR + 1;
+
+	for (;;) {
+		c = getopt(argc, argv, "a:c:dhi:t:v");
+		if (c < 0)
+			break;
+		switch (c) {
+		case 'a':
+			algo = optarg;
+			break;
+		case 'c':
+			scenario = optarg;
+			break;
+		case 'd':
+			if (wpa_debug_level > 0)
+				wpa_debug_level--;
+			break;
+		case 'i':
+			ctx.iterations = atoi(optarg);
+			break;
+		case 't':
+			table = optarg;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (!scenario || ctx.iterations == 0) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	if (os_program_init())
+		return -1;
+
+	if (eloop_init()) {
+		wpa_printf(MSG_ERROR, "Failed to initialize event loop");
+		return -1;
+	}
+
+	if (init_hapd(&ctx))
+		goto fail;
+
+	if (os_strcmp(algo, "smart") == 0) {
+		ctx.iface.conf->acs_algo = ACS_ALGO_SMART;
+	} else if (os_strcmp(algo, "numbss") == 0) {
+		ctx.iface.conf->acs_algo = ACS_ALGO_NUMBSS;
+	} else if (os_strcmp(algo, "survey") == 0) {
+		ctx.iface.conf->acs_algo = ACS_ALGO_SURVEY;
+	} else {
+		usage(argv[0]);
+		goto fail;
+	}
+
+	ctx.iface.conf->hw_mode = ctx.hw_mode;
+	if (sim_load_scenario(&ctx, scenario) < 0)
+		goto fail;
+	sim_default_chans(&ctx);
+	if (sim_expand_chandata(&ctx) < 0)
+		goto fail;
+	if (!ctx.num_bss)
+		ctx.num_bss = ctx.scan.num;
+	if (ctx.iface.conf->ieee80211ac)
+		ctx.iface.conf->ieee80211n = 1;
+	ctx.channel = ctx.iface.conf->channel;
+	ctx.secondary_channel = ctx.iface.conf->secondary_channel;
+	ctx.vht_oper_chwidth = ctx.iface.conf->vht_oper_chwidth;
+
+	ctx.iface.hw_features = gen_modes(&ctx);
+	if (!ctx.iface.hw_features)
+		goto fail;
+	ctx.iface.num_hw_features = 1;
+	ctx.iface.current_mode = ctx.iface.hw_features;
+
+	sim_run(&ctx, table);
+	sim_report(&ctx);
+	if (verbose)
+		sim_dump_log(&ctx);
+
+	acs_cleanup(&ctx.iface);
+	acs_log_deinit(&ctx.iface);
+	os_free(ctx.iface.hw_features->channels);
+	os_free(ctx.iface.hw_features->rates);
+	os_free(ctx.iface.hw_features);
+
+	ret = 0;
+fail:
+	for (i = 0; i < ctx.scan.num; i++)
+		os_free(ctx.scan.res[i]);
+	os_free(ctx.scan.res);
+	os_free(ctx.surveys);
+	os_free(ctx.chdata);
+	hostapd_config_free(ctx.iface.conf);
+	eloop_destroy();
+	os_program_deinit();
+
+	return ret;
+}
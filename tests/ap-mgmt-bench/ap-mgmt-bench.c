@@ -0,0 +1,883 @@
+/*
+ * hostapd - Management frame replay benchmark
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+#include <time.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "common/ieee802_11_defs.h"
+#include "common/sae.h"
+#include "ap/hostapd.h"
+#include "ap/hw_features.h"
+#include "ap/ieee802_11.h"
+#include "ap/sta_info.h"
+#include "../bench_hist.h"
+
+
+#define BENCH_SAE_PASSWORD "benchmark-password"
+#define BENCH_SAE_GROUP 19
+
+
+const struct wpa_driver_ops *const wpa_drivers[] =
+{
+	NULL
+};
+
+
+/* hostapd/ctrl_iface.c helpers referenced from src/ap; not reached here */
+struct hostapd_data * get_bss_index(const char *cmd, struct hostapd_iface *iface)
+{
+	return NULL;
+}
+
+
+void set_iface_conf(struct hostapd_iface *iface,
+		    const struct hostapd_freq_params *freq_params)
+{
+}
+
+
+/* Frame classes that are reported separately */
+enum bench_class {
+	BENCH_PROBE_REQ,
+	BENCH_AUTH,
+	BENCH_AUTH_SAE,
+	BENCH_ASSOC_REQ,
+	BENCH_REASSOC_REQ,
+	BENCH_DEAUTH,
+	BENCH_DISASSOC,
+	BENCH_ACTION,
+	BENCH_OTHER,
+	NUM_BENCH_CLASS
+};
+
+static const char * const bench_class_txt[NUM_BENCH_CLASS] = {
+	"probe-req", "auth", "auth-sae", "assoc-req", "reassoc-req",
+	"deauth", "disassoc", "action", "other"
+};
+
+struct bench_frame {
+	u8 *data;
+	size_t len;
+};
+
+struct arg_ctx {
+	struct hostapd_iface iface;
+	struct hostapd_data hapd;
+	struct wpa_driver_ops driver;
+	struct hapd_interfaces interfaces;
+	struct hostapd_data *bss[1];
+
+	struct bench_frame *frames;
+	size_t num_frames;
+	size_t alloc_frames;
+
+	unsigned int num_sta;
+	unsigned int iterations;
+
+	int sae;
+	int sae_anti_clogging_threshold;
+	struct wpabuf **sae_commit; /* per station, built on first use */
+
+	struct bench_hist stats[NUM_BENCH_CLASS];
+	unsigned long tx_frames;
+	unsigned long tx_bytes;
+	u64 elapsed_ns;
+
+	int no_flush;
+	unsigned long drv_sta_remove;
+	unsigned long drv_flush;
+};
+
+
+static u64 bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static enum bench_class bench_classify(const u8 *buf, size_t len)
+{
+	const struct ieee80211_mgmt *mgmt = (const struct ieee80211_mgmt *) buf;
+	u16 fc;
+
+	if (len < IEEE80211_HDRLEN)
+		return BENCH_OTHER;
+	fc = le_to_host16(mgmt->frame_control);
+	if (WLAN_FC_GET_TYPE(fc) != WLAN_FC_TYPE_MGMT)
+		return BENCH_OTHER;
+
+	switch (WLAN_FC_GET_STYPE(fc)) {
+	case WLAN_FC_STYPE_PROBE_REQ:
+		return BENCH_PROBE_REQ;
+	case WLAN_FC_STYPE_AUTH:
+		if (len >= IEEE80211_HDRLEN + sizeof(mgmt->u.auth) &&
+		    le_to_host16(mgmt->u.auth.auth_alg) == WLAN_AUTH_SAE)
+			return BENCH_AUTH_SAE;
+		return BENCH_AUTH;
+	case WLAN_FC_STYPE_ASSOC_REQ:
+		return BENCH_ASSOC_REQ;
+	case WLAN_FC_STYPE_REASSOC_REQ:
+		return BENCH_REASSOC_REQ;
+	case WLAN_FC_STYPE_DEAUTH:
+		return BENCH_DEAUTH;
+	case WLAN_FC_STYPE_DISASSOC:
+		return BENCH_DISASSOC;
+	case WLAN_FC_STYPE_ACTION:
+		return BENCH_ACTION;
+	default:
+		return BENCH_OTHER;
+	}
+}
+
+
+static int bench_add_frame(struct arg_ctx *ctx, const u8 *data, size_t len)
+{
+	struct bench_frame *f;
+
+	if (len < IEEE80211_HDRLEN)
+		return 0;
+
+	if (ctx->num_frames == ctx->alloc_frames) {
+		size_t n = ctx->alloc_frames ? ctx->alloc_frames * 2 : 1024;
+
+		f = os_realloc_array(ctx->frames, n, sizeof(*f));
+		if (!f)
+			return -1;
+		ctx->frames = f;
+		ctx->alloc_frames = n;
+	}
+
+	f = &ctx->frames[ctx->num_frames];
+	f->data = os_memdup(data, len);
+	if (!f->data)
+		return -1;
+	f->len = len;
+	ctx->num_frames++;
+	return 0;
+}
+
+
+/* Same format as ap-mgmt-fuzzer -m: sequence of BE16 length + frame */
+static int bench_load_multi(struct arg_ctx *ctx, const char *fname)
+{
+	char *data;
+	size_t len;
+	u8 *pos, *end;
+	int ret = 0;
+
+	data = os_readfile(fname, &len);
+	if (!data) {
+		wpa_printf(MSG_ERROR, "Could not read '%s'", fname);
+		return -1;
+	}
+
+	pos = (u8 *) data;
+	end = pos + len;
+	while (end - pos > 2) {
+		u16 flen;
+
+		flen = WPA_GET_BE16(pos);
+		pos += 2;
+		if (end - pos < flen)
+			break;
+		if (bench_add_frame(ctx, pos, flen) < 0) {
+			ret = -1;
+			break;
+		}
+		pos += flen;
+	}
+
+	os_free(data);
+	return ret;
+}
+
+
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_MAGIC_NS 0xa1b23c4d
+#define LINKTYPE_IEEE802_11 105
+#define LINKTYPE_IEEE802_11_RADIOTAP 127
+
+static int bench_load_pcap(struct arg_ctx *ctx, const char *fname)
+{
+	char *data;
+	size_t len;
+	u8 *pos, *end;
+	u32 magic, linktype;
+	int swap, ret = 0;
+
+	data = os_readfile(fname, &len);
+	if (!data) {
+		wpa_printf(MSG_ERROR, "Could not read '%s'", fname);
+		return -1;
+	}
+	if (len < 24)
+		goto invalid;
+
+	pos = (u8 *) data;
+	end = pos + len;
+	magic = WPA_GET_LE32(pos);
+	if (magic == PCAP_MAGIC || magic == PCAP_MAGIC_NS)
+		swap = 0;
+	else if (WPA_GET_BE32(pos) == PCAP_MAGIC ||
+		 WPA_GET_BE32(pos) == PCAP_MAGIC_NS)
+		swap = 1;
+	else
+		goto invalid;
+	linktype = swap ? WPA_GET_BE32(pos + 20) : WPA_GET_LE32(pos + 20);
+	if (linktype != LINKTYPE_IEEE802_11 &&
+	    linktype != LINKTYPE_IEEE802_11_RADIOTAP) {
+		wpa_printf(MSG_ERROR, "%s: unsupported link type %u",
+			   fname, linktype);
+		os_free(data);
+		return -1;
+	}
+	pos += 24;
+
+	while (end - pos >= 16) {
+		u32 caplen;
+		u8 *frame;
+		size_t flen;
+
+		caplen = swap ? WPA_GET_BE32(pos + 8) : WPA_GET_LE32(pos + 8);
+		pos += 16;
+		if ((size_t) (end - pos) < caplen)
+			break;
+		frame = pos;
+		flen = caplen;
+		pos += caplen;
+
+		if (linktype == LINKTYPE_IEEE802_11_RADIOTAP) {
+			u16 rt_len;
+
+			if (flen < 4)
+				continue;
+			rt_len = WPA_GET_LE16(frame + 2);
+			if (rt_len > flen)
+				continue;
+			frame += rt_len;
+			flen -= rt_len;
+		}
+
+		/* Only management frames are replayed */
+		if (flen < IEEE80211_HDRLEN ||
+		    WLAN_FC_GET_TYPE(WPA_GET_LE16(frame)) != WLAN_FC_TYPE_MGMT)
+			continue;
+		if (bench_add_frame(ctx, frame, flen) < 0) {
+			ret = -1;
+			break;
+		}
+	}
+
+	os_free(data);
+	return ret;
+
+invalid:
+	wpa_printf(MSG_ERROR, "%s: not a pcap file", fname);
+	os_free(data);
+	return -1;
+}
+
+
+static void bench_sta_addr(u8 *addr, unsigned int idx)
+{
+	addr[0] = 0x02;
+	addr[1] = 0x10;
+	WPA_PUT_BE32(&addr[2], idx);
+}
+
+
+static size_t bench_hdr(struct arg_ctx *ctx, u8 *buf, u16 stype,
+			unsigned int sta)
+{
+	struct ieee80211_mgmt *mgmt = (struct ieee80211_mgmt *) buf;
+
+	os_memset(buf, 0, IEEE80211_HDRLEN);
+	mgmt->frame_control = IEEE80211_FC(WLAN_FC_TYPE_MGMT, stype);
+	if (stype == WLAN_FC_STYPE_PROBE_REQ)
+		os_memset(mgmt->da, 0xff, ETH_ALEN);
+	else
+		os_memcpy(mgmt->da, ctx->hapd.own_addr, ETH_ALEN);
+	bench_sta_addr(mgmt->sa, sta);
+	if (stype == WLAN_FC_STYPE_PROBE_REQ)
+		os_memset(mgmt->bssid, 0xff, ETH_ALEN);
+	else
+		os_memcpy(mgmt->bssid, ctx->hapd.own_addr, ETH_ALEN);
+	return IEEE80211_HDRLEN;
+}
+
+
+static u8 * bench_add_ssid_rates(struct arg_ctx *ctx, u8 *pos)
+{
+	struct hostapd_ssid *ssid = &ctx->hapd.conf->ssid;
+
+	*pos++ = WLAN_EID_SSID;
+	*pos++ = ssid->ssid_len;
+	os_memcpy(pos, ssid->ssid, ssid->ssid_len);
+	pos += ssid->ssid_len;
+	*pos++ = WLAN_EID_SUPP_RATES;
+	*pos++ = 4;
+	*pos++ = 0x82;
+	*pos++ = 0x84;
+	*pos++ = 0x8b;
+	*pos++ = 0x96;
+	return pos;
+}
+
+
+static int bench_gen_probe(struct arg_ctx *ctx, unsigned int sta)
+{
+	u8 buf[128], *pos;
+
+	pos = buf + bench_hdr(ctx, buf, WLAN_FC_STYPE_PROBE_REQ, sta);
+	pos = bench_add_ssid_rates(ctx, pos);
+	return bench_add_frame(ctx, buf, pos - buf);
+}
+
+
+static int bench_gen_auth(struct arg_ctx *ctx, unsigned int sta)
+{
+	u8 buf[64];
+	struct ieee80211_mgmt *mgmt = (struct ieee80211_mgmt *) buf;
+
+	bench_hdr(ctx, buf, WLAN_FC_STYPE_AUTH, sta);
+	mgmt->u.auth.auth_alg = host_to_le16(WLAN_AUTH_OPEN);
+	mgmt->u.auth.auth_transaction = host_to_le16(1);
+	mgmt->u.auth.status_code = host_to_le16(WLAN_STATUS_SUCCESS);
+	return bench_add_frame(ctx, buf,
+			       IEEE80211_HDRLEN + sizeof(mgmt->u.auth));
+}
+
+
+static struct wpabuf * bench_sae_commit(struct arg_ctx *ctx,
+					 unsigned int sta)
+{
+	struct sae_data sae;
+	struct wpabuf *buf = NULL;
+	u8 addr[ETH_ALEN];
+
+	if (ctx->sae_commit[sta])
+		return ctx->sae_commit[sta];
+
+	/* Station side commit for the AP password; deriving the PWE is the
+	 * expensive part, so do it once per station outside the timing. */
+	os_memset(&sae, 0, sizeof(sae));
+	bench_sta_addr(addr, sta);
+	if (sae_set_group(&sae, BENCH_SAE_GROUP) < 0 ||
+	    sae_prepare_commit(addr, ctx->hapd.own_addr,
+			       (const u8 *) BENCH_SAE_PASSWORD,
+			       os_strlen(BENCH_SAE_PASSWORD), NULL, &sae) < 0)
+		goto out;
+	buf = wpabuf_alloc(SAE_COMMIT_MAX_LEN);
+	if (!buf)
+		goto out;
+	sae_write_commit(&sae, buf, NULL, NULL);
+	ctx->sae_commit[sta] = buf;
+out:
+	sae_clear_data(&sae);
+	return buf;
+}
+
+
+static int bench_gen_sae_commit(struct arg_ctx *ctx, unsigned int sta)
+{
+	u8 buf[IEEE80211_HDRLEN + 6 + SAE_COMMIT_MAX_LEN], *pos;
+	struct ieee80211_mgmt *mgmt = (struct ieee80211_mgmt *) buf;
+	struct wpabuf *commit;
+
+	commit = bench_sae_commit(ctx, sta);
+	if (!commit) {
+		wpa_printf(MSG_ERROR, "Failed to build SAE commit");
+		return -1;
+	}
+
+	bench_hdr(ctx, buf, WLAN_FC_STYPE_AUTH, sta);
+	mgmt->u.auth.auth_alg = host_to_le16(WLAN_AUTH_SAE);
+	mgmt->u.auth.auth_transaction = host_to_le16(1);
+	mgmt->u.auth.status_code = host_to_le16(WLAN_STATUS_SUCCESS);
+	pos = mgmt->u.auth.variable;
+	os_memcpy(pos, wpabuf_head(commit), wpabuf_len(commit));
+	pos += wpabuf_len(commit);
+	return bench_add_frame(ctx, buf, pos - buf);
+}
+
+
+static int bench_gen_assoc(struct arg_ctx *ctx, unsigned int sta)
+{
+	u8 buf[128], *pos;
+	struct ieee80211_mgmt *mgmt = (struct ieee80211_mgmt *) buf;
+
+	bench_hdr(ctx, buf, WLAN_FC_STYPE_ASSOC_REQ, sta);
+	mgmt->u.assoc_req.capab_info = host_to_le16(WLAN_CAPABILITY_ESS);
+	mgmt->u.assoc_req.listen_interval = host_to_le16(10);
+	pos = bench_add_ssid_rates(ctx, mgmt->u.assoc_req.variable);
+	return bench_add_frame(ctx, buf, pos - buf);
+}
+
+
+static int bench_gen_action(struct arg_ctx *ctx, unsigned int sta,
+			    unsigned int variant)
+{
+	u8 buf[128], *pos;
+	struct ieee80211_mgmt *mgmt = (struct ieee80211_mgmt *) buf;
+
+	bench_hdr(ctx, buf, WLAN_FC_STYPE_ACTION, sta);
+	pos = &mgmt->u.action.category;
+
+	switch (variant % 3) {
+	case 0:
+		/* GAS Initial Request with ANQP Query List (Venue Name) */
+		*pos++ = WLAN_ACTION_PUBLIC;
+		*pos++ = WLAN_PA_GAS_INITIAL_REQ;
+		*pos++ = sta & 0xff; /* Dialog Token */
+		*pos++ = WLAN_EID_ADV_PROTO;
+		*pos++ = 2;
+		*pos++ = 0x7f;
+		*pos++ = ACCESS_NETWORK_QUERY_PROTOCOL;
+		WPA_PUT_LE16(pos, 6); /* Query Request length */
+		pos += 2;
+		WPA_PUT_LE16(pos, ANQP_QUERY_LIST);
+		pos += 2;
+		WPA_PUT_LE16(pos, 2);
+		pos += 2;
+		WPA_PUT_LE16(pos, ANQP_VENUE_NAME);
+		pos += 2;
+		break;
+	case 1:
+		/* SA Query Request */
+		*pos++ = WLAN_ACTION_SA_QUERY;
+		*pos++ = WLAN_SA_QUERY_REQUEST;
+		WPA_PUT_LE16(pos, sta & 0xffff);
+		pos += 2;
+		break;
+	default:
+		/* BSS Transition Management Query */
+		*pos++ = WLAN_ACTION_WNM;
+		*pos++ = WNM_BSS_TRANS_MGMT_QUERY;
+		*pos++ = sta & 0xff; /* Dialog Token */
+		*pos++ = 0; /* Query Reason */
+		break;
+	}
+
+	return bench_add_frame(ctx, buf, pos - buf);
+}
+
+
+static int bench_generate(struct arg_ctx *ctx, const char *scenario,
+			  unsigned int count)
+{
+	unsigned int i, sta;
+	int ret = 0;
+
+	for (i = 0; i < count && ret == 0; i++) {
+		sta = i % ctx->num_sta;
+		if (os_strcmp(scenario, "probe") == 0) {
+			ret = bench_gen_probe(ctx, sta);
+		} else if (os_strcmp(scenario, "auth") == 0) {
+			ret = bench_gen_auth(ctx, sta);
+		} else if (os_strcmp(scenario, "assoc") == 0) {
+			ret = bench_gen_auth(ctx, sta);
+			if (ret == 0)
+				ret = bench_gen_assoc(ctx, sta);
+		} else if (os_strcmp(scenario, "sae") == 0) {
+			ret = bench_gen_sae_commit(ctx, sta);
+		} else if (os_strcmp(scenario, "action") == 0) {
+			ret = bench_gen_action(ctx, sta, i);
+		} else if (os_strcmp(scenario, "mixed") == 0) {
+			switch (i % 8) {
+			case 0:
+			case 1:
+			case 2:
+			case 3:
+				ret = bench_gen_probe(ctx, sta);
+				break;
+			case 4:
+				ret = bench_gen_auth(ctx, sta);
+				break;
+			case 5:
+				/* Associate the STA authenticated above */
+				ret = bench_gen_assoc(ctx,
+						      (i - 1) % ctx->num_sta);
+				break;
+			default:
+				ret = bench_gen_action(ctx, sta,
+						       i / 8 * 2 + (i & 1));
+				break;
+			}
+		} else {
+			wpa_printf(MSG_ERROR, "Unknown scenario '%s'",
+				   scenario);
+			return -1;
+		}
+	}
+
+	return ret;
+}
+
+
+/* Spread replayed frames over num_sta distinct transmitter addresses */
+static void bench_remap_sa(struct arg_ctx *ctx)
+{
+	size_t i;
+
+	for (i = 0; i < ctx->num_frames; i++) {
+		struct ieee80211_mgmt *mgmt =
+			(struct ieee80211_mgmt *) ctx->frames[i].data;
+
+		bench_sta_addr(mgmt->sa, i % ctx->num_sta);
+	}
+}
+
+
+static int bench_send_mlme(void *priv, const u8 *data, size_t data_len,
+			   int noack, unsigned int freq, const u16 *csa_offs,
+			   size_t csa_offs_len)
+{
+	struct arg_ctx *ctx = priv;
+
+	ctx->tx_frames++;
+	ctx->tx_bytes += data_len;
+	return 0;
+}
+
+
+static int bench_sta_remove(void *priv, const u8 *addr)
+{
+	struct arg_ctx *ctx = priv;
+
+	ctx->drv_sta_remove++;
+	return 0;
+}
+
+
+static int bench_flush(void *priv)
+{
+	struct arg_ctx *ctx = priv;
+
+	ctx->drv_flush++;
+	return 0;
+}
+
+
+static void bench_run(void *eloop_data, void *user_ctx)
+{
+	struct arg_ctx *ctx = eloop_data;
+	struct hostapd_frame_info fi;
+	unsigned int iter;
+	size_t i;
+	u64 start, t0, t1;
+
+	os_memset(&fi, 0, sizeof(fi));
+	fi.freq = 2412;
+	fi.ssi_signal = -40;
+
+	start = bench_now_ns();
+	for (iter = 0; iter < ctx->iterations; iter++) {
+		for (i = 0; i < ctx->num_frames; i++) {
+			struct bench_frame *f = &ctx->frames[i];
+			struct bench_hist *st;
+
+			st = &ctx->stats[bench_classify(f->data, f->len)];
+			t0 = bench_now_ns();
+			ieee802_11_mgmt(&ctx->hapd, f->data, f->len, &fi);
+#ifdef CONFIG_SAE
+			/* SAE commits go through the processing queue; handle
+			 * them now instead of from the eloop timeout. */
+			while (!dl_list_empty(&ctx->hapd.sae_commit_queue))
+				auth_sae_process_commit(&ctx->hapd, NULL);
+#endif /* CONFIG_SAE */
+			t1 = bench_now_ns();
+			bench_hist_add(st, t1 - t0);
+		}
+	}
+	ctx->elapsed_ns = bench_now_ns() - start;
+
+#ifdef CONFIG_SAE
+	eloop_cancel_timeout(auth_sae_process_commit, &ctx->hapd, NULL);
+#endif /* CONFIG_SAE */
+	eloop_terminate();
+}
+
+
+static void bench_report(struct arg_ctx *ctx)
+{
+	unsigned long total = 0;
+	unsigned int i;
+	double secs = ctx->elapsed_ns / 1e9;
+
+	printf("%-12s %10s %10s %10s %10s %10s %10s\n",
+	       "type", "frames", "mean_ns", "p50_ns", "p90_ns", "p99_ns",
+	       "max_ns");
+	for (i = 0; i < NUM_BENCH_CLASS; i++) {
+		struct bench_hist *st = &ctx->stats[i];
+
+		if (!st->count)
+			continue;
+		total += st->count;
+		printf("%-12s %10lu %10llu %10llu %10llu %10llu %10llu\n",
+		       bench_class_txt[i], st->count,
+		       (unsigned long long) (st->total_ns / st->count),
+		       (unsigned long long) bench_hist_percentile(st, 50),
+		       (unsigned long long) bench_hist_percentile(st, 90),
+		       (unsigned long long) bench_hist_percentile(st, 99),
+		       (unsigned long long) st->max_ns);
+	}
+
+	printf("frames=%lu elapsed_ms=%.3f frames_per_sec=%.0f\n",
+	       total, secs * 1000, secs > 0 ? total / secs : 0);
+	printf("stations=%u sta_table=%d tx_frames=%lu tx_bytes=%lu\n",
+	       ctx->num_sta, ctx->hapd.num_sta, ctx->tx_frames, ctx->tx_bytes);
+}
+
+
+static void bench_teardown(struct arg_ctx *ctx)
+{
+	u64 start, ns;
+	int num = ctx->hapd.num_sta;
+
+	start = bench_now_ns();
+	hostapd_free_stas(&ctx->hapd);
+	ns = bench_now_ns() - start;
+
+	printf("teardown stations=%d elapsed_us=%.1f sta_remove=%lu "
+	       "flush=%lu\n",
+	       num, ns / 1e3, ctx->drv_sta_remove, ctx->drv_flush);
+}
+
+
+static struct hostapd_hw_modes * gen_modes(void)
+{
+	struct hostapd_hw_modes *mode;
+	struct hostapd_channel_data *chan;
+
+	mode = os_zalloc(sizeof(struct hostapd_hw_modes));
+	if (!mode)
+		return NULL;
+
+	mode->mode = HOSTAPD_MODE_IEEE80211G;
+	chan = os_zalloc(sizeof(struct hostapd_channel_data));
+	if (!chan) {
+		os_free(mode);
+		return NULL;
+	}
+	chan->chan = 1;
+	chan->freq = 2412;
+	mode->channels = chan;
+	mode->num_channels = 1;
+
+	mode->rates = os_zalloc(sizeof(int));
+	if (!mode->rates) {
+		os_free(chan);
+		os_free(mode);
+		return NULL;
+	}
+	mode->rates[0] = 10;
+	mode->num_rates = 1;
+
+	return mode;
+}
+
+
+static int init_hapd(struct arg_ctx *ctx)
+{
+	static u8 ext_capa[10];
+	struct hostapd_data *hapd = &ctx->hapd;
+	struct hostapd_bss_config *bss;
+
+	ctx->driver.send_mlme = bench_send_mlme;
+	ctx->driver.sta_remove = bench_sta_remove;
+	if (!ctx->no_flush)
+		ctx->driver.flush = bench_flush;
+	hapd->driver = &ctx->driver;
+	hapd->drv_priv = ctx;
+	dl_list_init(&hapd->ctrl_dst);
+	dl_list_init(&hapd->nr_db);
+	dl_list_init(&hapd->multi_ap_blacklist);
+	dl_list_init(&hapd->auth_fail_list);
+#ifdef CONFIG_SAE
+	dl_list_init(&hapd->sae_commit_queue);
+#endif /* CONFIG_SAE */
+	os_memcpy(hapd->own_addr, "\x02\x00\x00\x00\x03\x00", ETH_ALEN);
+	hapd->iface = &ctx->iface;
+	hapd->iface->interfaces = &ctx->interfaces;
+	ctx->bss[0] = hapd;
+	hapd->iface->bss = ctx->bss;
+	hapd->iface->num_bss = 1;
+	hapd->iface->conf = hostapd_config_defaults();
+	if (!hapd->iface->conf)
+		return -1;
+	hapd->iface->hw_features = gen_modes();
+	hapd->iface->num_hw_features = 1;
+	hapd->iface->current_mode = hapd->iface->hw_features;
+	hapd->iface->freq = 2412;
+	hapd->iface->extended_capa = ext_capa;
+	hapd->iface->extended_capa_mask = ext_capa;
+	hapd->iface->extended_capa_len = sizeof(ext_capa);
+	hapd->iconf = hapd->iface->conf;
+	hapd->iconf->hw_mode = HOSTAPD_MODE_IEEE80211G;
+	hapd->iconf->channel = 1;
+	bss = hapd->conf = hapd->iconf->bss[0];
+	hostapd_config_defaults_bss(hapd->conf);
+	os_memcpy(bss->ssid.ssid, "test", 4);
+	bss->ssid.ssid_len = 4;
+	bss->ssid.ssid_set = 1;
+	bss->max_num_sta = MAX_STA_COUNT;
+	hapd->iconf->ap_max_num_sta = MAX_STA_COUNT;
+
+	if (ctx->sae) {
+		bss->wpa = WPA_PROTO_RSN;
+		bss->wpa_key_mgmt = WPA_KEY_MGMT_SAE;
+		bss->rsn_pairwise = WPA_CIPHER_CCMP;
+		bss->ssid.wpa_passphrase = os_strdup(BENCH_SAE_PASSWORD);
+		if (!bss->ssid.wpa_passphrase)
+			return -1;
+		if (ctx->sae_anti_clogging_threshold >= 0)
+			bss->sae_anti_clogging_threshold =
+				ctx->sae_anti_clogging_threshold;
+	}
+
+	return 0;
+}
+
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-i<iterations>] [-s<stations>] [-n<frames>] [-r] "
+	       "[-S] [-c<threshold>] <-m <file> | -p <pcap> | -g <scenario>>\n"
+	       "  -m <file>  frames in ap-mgmt-fuzzer -m format\n"
+	       "  -p <pcap>  802.11 or radiotap pcap trace\n"
+	       "  -g <name>  generated: probe, auth, assoc, sae, action, "
+	       "mixed\n"
+	       "  -n <num>   number of generated frames (default 10000)\n"
+	       "  -s <num>   number of distinct stations (default 100)\n"
+	       "  -i <num>   number of replay iterations (default 1)\n"
+	       "  -r         tear stations down one by one instead of with a "
+	       "driver flush\n"
+	       "  -S         configure the BSS for SAE (implied by -g sae)\n"
+	       "  -c <num>   SAE anti-clogging threshold (default 5)\n",
+	       prog);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct arg_ctx ctx;
+	const char *multi = NULL, *pcap = NULL, *scenario = NULL;
+	unsigned int count = 10000;
+	int remap = 0, ret = -1, c;
+	size_t i;
+
+	os_memset(&ctx, 0, sizeof(ctx));
+	ctx.num_sta = 100;
+	ctx.iterations = 1;
+	ctx.sae_anti_clogging_threshold = -1;
+
+	for (;;) {
+		c = getopt(argc, argv, "c:g:hi:m:n:p:rSs:");
+		if (c < 0)
+			break;
+		switch (c) {
+		case 'c':
+			ctx.sae_anti_clogging_threshold = atoi(optarg);
+			break;
+		case 'g':
+			scenario = optarg;
+			break;
+		case 'i':
+			ctx.iterations = atoi(optarg);
+			break;
+		case 'm':
+			multi = optarg;
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'p':
+			pcap = optarg;
+			break;
+		case 'r':
+			ctx.no_flush = 1;
+			break;
+		case 'S':
+			ctx.sae = 1;
+			break;
+		case 's':
+			ctx.num_sta = atoi(optarg);
+			remap = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if ((!multi && !pcap && !scenario) || ctx.num_sta == 0 ||
+	    ctx.iterations == 0) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	if (os_program_init())
+		return -1;
+
+	wpa_debug_level = MSG_ERROR;
+
+	if (eloop_init()) {
+		wpa_printf(MSG_ERROR, "Failed to initialize event loop");
+		return -1;
+	}
+
+	if (scenario && os_strcmp(scenario, "sae") == 0)
+		ctx.sae = 1;
+	ctx.sae_commit = os_calloc(ctx.num_sta, sizeof(struct wpabuf *));
+	if (!ctx.sae_commit || init_hapd(&ctx))
+		goto fail;
+
+	if ((multi && bench_load_multi(&ctx, multi) < 0) ||
+	    (pcap && bench_load_pcap(&ctx, pcap) < 0) ||
+	    (scenario && bench_generate(&ctx, scenario, count) < 0))
+		goto fail;
+	if (remap && (multi || pcap))
+		bench_remap_sa(&ctx);
+	if (ctx.num_frames == 0) {
+		wpa_printf(MSG_ERROR, "No management frames to replay");
+		goto fail;
+	}
+
+	eloop_register_timeout(0, 0, bench_run, &ctx, NULL);
+
+	wpa_printf(MSG_DEBUG, "Starting eloop");
+	eloop_run();
+	wpa_printf(MSG_DEBUG, "eloop done");
+
+	bench_report(&ctx);
+	bench_teardown(&ctx);
+	ap_sta_pool_deinit(ctx.hapd.iface);
+
+	hostapd_free_hw_features(ctx.hapd.iface->hw_features,
+				 ctx.hapd.iface->num_hw_features);
+
+	ret = 0;
+fail:
+	for (i = 0; i < ctx.num_frames; i++)
+		os_free(ctx.frames[i].data);
+	os_free(ctx.frames);
+	if (ctx.sae_commit) {
+		for (i = 0; i < ctx.num_sta; i++)
+			wpabuf_free(ctx.sae_commit[i]);
+		os_free(ctx.sae_commit);
+	}
+	hostapd_config_free(ctx.hapd.iconf);
+	eloop_destroy();
+	os_program_deinit();
+
+	return ret;
+}
@@ -0,0 +1,84 @@
+/*
+ * Latency histogram shared by the benchmark tools
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#ifndef BENCH_HIST_H
+#define BENCH_HIST_H
+
+/*
+ * Log-linear latency histogram: BENCH_HIST_SUB bins per power of two
+ * nanoseconds, covering 1 ns .. ~2^40 ns.
+ */
+#define BENCH_HIST_SUB_BITS 3
+#define BENCH_HIST_SUB (1 << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_BINS (40 * BENCH_HIST_SUB)
+
+struct bench_hist {
+	unsigned long count;
+	u64 total_ns;
+	u64 max_ns;
+	unsigned long bin[BENCH_HIST_BINS];
+};
+
+
+static inline unsigned int bench_hist_bin(u64 ns)
+{
+	unsigned int msb = 0, sub;
+	u64 v = ns;
+
+	if (ns < BENCH_HIST_SUB)
+		return ns;
+	while (v >>= 1)
+		msb++;
+	sub = (ns >> (msb - BENCH_HIST_SUB_BITS)) & (BENCH_HIST_SUB - 1);
+	if (msb - BENCH_HIST_SUB_BITS + 1 >= 40)
+		return BENCH_HIST_BINS - 1;
+	return (msb - BENCH_HIST_SUB_BITS + 1) * BENCH_HIST_SUB + sub;
+}
+
+
+static inline u64 bench_hist_value(unsigned int bin)
+{
+	unsigned int shift, sub;
+
+	if (bin < BENCH_HIST_SUB)
+		return bin;
+	shift = bin / BENCH_HIST_SUB - 1;
+	sub = bin % BENCH_HIST_SUB;
+	/* upper bound of the bin */
+	return ((u64) (BENCH_HIST_SUB + sub + 1) << shift) - 1;
+}
+
+
+static inline void bench_hist_add(struct bench_hist *h, u64 ns)
+{
+	h->count++;
+	h->total_ns += ns;
+	if (ns > h->max_ns)
+		h->max_ns = ns;
+	h->bin[bench_hist_bin(ns)]++;
+}
+
+
+/* Upper bound of the bin holding the pct percentile, at most max_ns */
+static inline u64 bench_hist_percentile(const struct bench_hist *h,
+					unsigned int pct)
+{
+	unsigned long target, seen = 0;
+	unsigned int i;
+
+	if (!h->count)
+		return 0;
+	target = (h->count * pct + 99) / 100;
+	for (i = 0; i < BENCH_HIST_BINS; i++) {
+		seen += h->bin[i];
+		if (seen >= target)
+			return MIN(bench_hist_value(i), h->max_ns);
+	}
+	return h->max_ns;
+}
+
+#endif /* BENCH_HIST_H */
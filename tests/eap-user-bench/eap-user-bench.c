@@ -0,0 +1,301 @@
+/*
+ * hostapd - EAP user database lookup benchmark
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+#include <time.h>
+
+#include "utils/common.h"
+#include "crypto/sha1.h"
+#include "common/wpa_common.h"
+#include "eap_server/eap_methods.h"
+#include "ap/hostapd.h"
+#include "ap/ap_config.h"
+
+
+/* ap_config.o references these, the benchmark does not use them */
+
+int pbkdf2_sha1(const char *passphrase, const u8 *ssid, size_t ssid_len,
+		int iterations, u8 *buf, size_t buflen)
+{
+	return -1;
+}
+
+
+int wpa_select_ap_group_cipher(int wpa, int wpa_pairwise, int rsn_pairwise)
+{
+	return WPA_CIPHER_CCMP;
+}
+
+
+void hostapd_atf_clean_config(struct atf_config *atf_cfg)
+{
+}
+
+
+/* Kinds of generated lookups, in the order they are reported */
+enum bench_query {
+	BENCH_QUERY_EXACT,
+	BENCH_QUERY_PHASE2,
+	BENCH_QUERY_PREFIX,
+	BENCH_QUERY_MISS,
+	NUM_BENCH_QUERY
+};
+
+static const char * const bench_query_txt[NUM_BENCH_QUERY] = {
+	"exact", "phase2", "prefix", "miss"
+};
+
+struct bench_ctx {
+	unsigned int num_users;
+	unsigned int num_prefix;
+	unsigned int num_lookups;
+	struct hostapd_eap_user *users;
+	char (*ids)[64];
+	enum bench_query *kinds;
+	const struct hostapd_eap_user **expect;
+};
+
+
+static u64 bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static struct hostapd_eap_user * bench_user(const char *identity, int prefix,
+					    int phase2)
+{
+	struct hostapd_eap_user *user;
+
+	user = os_zalloc(sizeof(*user));
+	if (!user)
+		return NULL;
+	user->force_version = -1;
+	user->phase2 = phase2;
+	user->wildcard_prefix = prefix;
+	user->methods[0].vendor = EAP_VENDOR_IETF;
+	user->methods[0].method = phase2 ? EAP_TYPE_MSCHAPV2 : EAP_TYPE_PEAP;
+	if (identity) {
+		user->identity = (u8 *) os_strdup(identity);
+		if (!user->identity) {
+			os_free(user);
+			return NULL;
+		}
+		user->identity_len = os_strlen(identity);
+	}
+	return user;
+}
+
+
+/*
+ * Build a user list in the layout of a typical eap_user file: realm
+ * wildcards for Phase 1 first, then per-user Phase 2 entries, and a final
+ * "*" catch-all.
+ */
+static int bench_build_users(struct bench_ctx *ctx)
+{
+	struct hostapd_eap_user **tail = &ctx->users;
+	char id[64];
+	unsigned int i;
+
+	for (i = 0; i < ctx->num_prefix; i++) {
+		os_snprintf(id, sizeof(id), "realm%05u/", i);
+		*tail = bench_user(id, 1, 0);
+		if (!*tail)
+			return -1;
+		tail = &(*tail)->next;
+	}
+
+	for (i = 0; i < ctx->num_users; i++) {
+		os_snprintf(id, sizeof(id), "user%07u@example.com", i);
+		*tail = bench_user(id, 0, 1);
+		if (!*tail)
+			return -1;
+		tail = &(*tail)->next;
+	}
+
+	*tail = bench_user(NULL, 0, 0);
+	return *tail ? 0 : -1;
+}
+
+
+static void bench_build_lookups(struct bench_ctx *ctx)
+{
+	unsigned int i, r;
+
+	for (i = 0; i < ctx->num_lookups; i++) {
+		r = os_random();
+		ctx->kinds[i] = r % NUM_BENCH_QUERY;
+		r /= NUM_BENCH_QUERY;
+		switch (ctx->kinds[i]) {
+		case BENCH_QUERY_EXACT:
+		case BENCH_QUERY_PHASE2:
+			os_snprintf(ctx->ids[i], sizeof(ctx->ids[i]),
+				    "user%07u@example.com",
+				    r % ctx->num_users);
+			break;
+		case BENCH_QUERY_PREFIX:
+			os_snprintf(ctx->ids[i], sizeof(ctx->ids[i]),
+				    "realm%05u/host%u",
+				    r % (ctx->num_prefix ? ctx->num_prefix : 1),
+				    r);
+			break;
+		default:
+			os_snprintf(ctx->ids[i], sizeof(ctx->ids[i]),
+				    "unknown%u@example.org", r);
+			break;
+		}
+	}
+}
+
+
+static int bench_phase2(enum bench_query kind)
+{
+	return kind == BENCH_QUERY_PHASE2 || kind == BENCH_QUERY_MISS;
+}
+
+
+static int bench_run(struct bench_ctx *ctx, struct hostapd_data *hapd,
+		     const char *name, int verify)
+{
+	u64 total[NUM_BENCH_QUERY], start;
+	unsigned int count[NUM_BENCH_QUERY];
+	const struct hostapd_eap_user *user;
+	unsigned int i;
+	enum bench_query kind;
+
+	os_memset(total, 0, sizeof(total));
+	os_memset(count, 0, sizeof(count));
+
+	for (i = 0; i < ctx->num_lookups; i++) {
+		kind = ctx->kinds[i];
+		start = bench_now_ns();
+		user = hostapd_get_eap_user(hapd, (const u8 *) ctx->ids[i],
+					    os_strlen(ctx->ids[i]),
+					    bench_phase2(kind));
+		total[kind] += bench_now_ns() - start;
+		count[kind]++;
+
+		if (!verify) {
+			ctx->expect[i] = user;
+		} else if (user != ctx->expect[i]) {
+			printf("MISMATCH for '%s' (phase2=%d)\n", ctx->ids[i],
+			       bench_phase2(kind));
+			return -1;
+		}
+	}
+
+	for (kind = 0; kind < NUM_BENCH_QUERY; kind++)
+		printf("%-6s %-7s %9u lookups %10.1f ns/lookup\n",
+		       name, bench_query_txt[kind], count[kind],
+		       count[kind] ? (double) total[kind] / count[kind] : 0.0);
+
+	return 0;
+}
+
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-u<users>] [-w<wildcards>] [-n<lookups>] [-d]\n"
+	       "  -u <num>   number of Phase 2 user entries (default 10000)\n"
+	       "  -w <num>   number of Phase 1 wildcard prefix entries "
+	       "(default 1000)\n"
+	       "  -n <num>   number of lookups (default 1000000)\n"
+	       "  -d         increase debug verbosity\n",
+	       prog);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct bench_ctx ctx;
+	struct hostapd_data hapd;
+	struct hostapd_bss_config conf;
+	u64 start;
+	int ret = -1, c;
+
+	os_memset(&ctx, 0, sizeof(ctx));
+	ctx.num_users = 10000;
+	ctx.num_prefix = 1000;
+	ctx.num_lookups = 1000000;
+	wpa_debug_level = MSG_ERROR;
+
+	for (;;) {
+		c = getopt(argc, argv, "dhn:u:w:");
+		if (c < 0)
+			break;
+		switch (c) {
+		case 'd':
+			if (wpa_debug_level > 0)
+				wpa_debug_level--;
+			break;
+		case 'n':
+			ctx.num_lookups = atoi(optarg);
+			break;
+		case 'u':
+			ctx.num_users = atoi(optarg);
+			break;
+		case 'w':
+			ctx.num_prefix = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (ctx.num_users == 0 || ctx.num_lookups == 0) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	if (os_program_init())
+		return -1;
+
+	ctx.ids = os_calloc(ctx.num_lookups, sizeof(ctx.ids[0]));
+	ctx.kinds = os_calloc(ctx.num_lookups, sizeof(ctx.kinds[0]));
+	ctx.expect = os_calloc(ctx.num_lookups, sizeof(ctx.expect[0]));
+	if (!ctx.ids || !ctx.kinds || !ctx.expect ||
+	    bench_build_users(&ctx) < 0)
+		goto fail;
+	bench_build_lookups(&ctx);
+
+	os_memset(&hapd, 0, sizeof(hapd));
+	os_memset(&conf, 0, sizeof(conf));
+	hapd.conf = &conf;
+	conf.eap_user = ctx.users;
+
+	printf("users=%u wildcards=%u lookups=%u\n",
+	       ctx.num_users, ctx.num_prefix, ctx.num_lookups);
+
+	if (bench_run(&ctx, &hapd, "list", 0) < 0)
+		goto fail;
+
+	start = bench_now_ns();
+	conf.eap_user_index = hostapd_eap_user_index_build(ctx.users);
+	if (!conf.eap_user_index)
+		goto fail;
+	printf("index build %.3f ms\n", (bench_now_ns() - start) / 1e6);
+
+	/* The index must return the same entry as the list walk */
+	if (bench_run(&ctx, &hapd, "index", 1) < 0)
+		goto fail;
+
+	ret = 0;
+fail:
+	hostapd_eap_user_index_free(conf.eap_user_index);
+	hostapd_config_free_eap_users(ctx.users);
+	os_free(ctx.ids);
+	os_free(ctx.kinds);
+	os_free(ctx.expect);
+	os_program_deinit();
+
+	return ret;
+}
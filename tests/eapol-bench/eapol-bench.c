@@ -0,0 +1,884 @@
+/*
+ * hostapd - EAPOL-Key 4-way handshake benchmark
+ *
+ * This software may be distributed under the terms of the BSD license.
+ * See README for more details.
+ */
+
+#include "utils/includes.h"
+#include <time.h>
+
+#include "utils/common.h"
+#include "utils/eloop.h"
+#include "common/ieee802_11_defs.h"
+#include "common/wpa_common.h"
+#include "rsn_supp/wpa.h"
+#include "rsn_supp/pmksa_cache.h"
+#include "ap/vlan.h"
+#include "ap/wpa_auth.h"
+#include "../bench_hist.h"
+
+
+const struct wpa_driver_ops *const wpa_drivers[] = { NULL };
+
+
+struct hostapd_iface;
+struct hostapd_freq_params;
+
+/* hostapd/ctrl_iface.c helpers referenced from src/ap; not reached here */
+struct hostapd_data * get_bss_index(const char *cmd, struct hostapd_iface *iface)
+{
+	return NULL;
+}
+
+
+void set_iface_conf(struct hostapd_iface *iface,
+		    const struct hostapd_freq_params *freq_params)
+{
+}
+
+
+enum bench_mode {
+	BENCH_MODE_PSK,
+	BENCH_MODE_MULTI_PSK,
+	BENCH_MODE_SAE,
+	BENCH_MODE_FT
+};
+
+/*
+ * Handshake stages that are timed separately. The auth-* stages are the
+ * authenticator work that limits AP capacity; the supp-* stages are the
+ * simulated stations.
+ */
+enum bench_stage {
+	BENCH_ASSOC,
+	BENCH_AUTH_M1,
+	BENCH_SUPP_M2,
+	BENCH_AUTH_M3,
+	BENCH_SUPP_M4,
+	BENCH_AUTH_M4,
+	BENCH_DEINIT,
+	NUM_BENCH_STAGE
+};
+
+static const char * const bench_stage_txt[NUM_BENCH_STAGE] = {
+	"assoc", "auth-m1", "supp-m2", "auth-m3", "supp-m4", "auth-m4",
+	"deinit"
+};
+
+static const int bench_stage_auth[NUM_BENCH_STAGE] = {
+	1, 1, 0, 1, 0, 1, 1
+};
+
+struct bench_stats {
+	struct bench_hist lat;
+	u64 cpu_ns;
+	unsigned long allocs;
+	unsigned long alloc_bytes;
+};
+
+#define BENCH_EAPOL_MAX 1024
+
+struct bench_ctx;
+
+struct bench_sta {
+	struct bench_ctx *ctx;
+	u8 addr[ETH_ALEN];
+	struct wpa_sm *supp;
+	struct wpa_state_machine *auth;
+
+	u8 supp_ie[80];
+	size_t supp_ie_len;
+
+	/* last frame in each direction; only one is ever in flight */
+	u8 to_supp[BENCH_EAPOL_MAX];
+	size_t to_supp_len;
+	u8 to_auth[BENCH_EAPOL_MAX];
+	size_t to_auth_len;
+
+	unsigned int supp_done:1;
+	unsigned int auth_done:1;
+};
+
+struct bench_ctx {
+	enum bench_mode mode;
+	unsigned int num_sta;
+	unsigned int num_psk;
+	unsigned int iterations;
+
+	u8 auth_addr[ETH_ALEN];
+	u8 *psk; /* num_psk * PMK_LEN; stations use the last one */
+	u8 sae_pmk[PMK_LEN];
+	u8 mdid[MOBILITY_DOMAIN_ID_LEN];
+
+	struct wpa_authenticator *auth_group;
+	struct bench_sta *sta;
+
+	struct bench_stats stats[NUM_BENCH_STAGE];
+	unsigned long handshakes;
+	unsigned long failures;
+	unsigned long dropped;
+	unsigned long psk_lookups;
+	u64 elapsed_ns;
+};
+
+
+#ifdef __GLIBC__
+/*
+ * Count heap allocations made while a stage is being timed. glibc allows the
+ * allocator entry points to be replaced by the main program; everything is
+ * passed through to the real implementation.
+ */
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t nmemb, size_t size);
+extern void * __libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static unsigned long bench_allocs;
+static unsigned long bench_alloc_bytes;
+
+void * malloc(size_t size)
+{
+	bench_allocs++;
+	bench_alloc_bytes += size;
+	return __libc_malloc(size);
+}
+
+
+void * calloc(size_t nmemb, size_t size)
+{
+	bench_allocs++;
+	bench_alloc_bytes += nmemb * size;
+	return __libc_calloc(nmemb, size);
+}
+
+
+void * realloc(void *ptr, size_t size)
+{
+	bench_allocs++;
+	bench_alloc_bytes += size;
+	return __libc_realloc(ptr, size);
+}
+
+
+void free(void *ptr)
+{
+	__libc_free(ptr);
+}
+#else /* __GLIBC__ */
+static unsigned long bench_allocs;
+static unsigned long bench_alloc_bytes;
+#endif /* __GLIBC__ */
+
+
+static u64 bench_clock_ns(clockid_t clk)
+{
+	struct timespec ts;
+
+	clock_gettime(clk, &ts);
+	return (u64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static u64 bench_now_ns(void)
+{
+	return bench_clock_ns(CLOCK_MONOTONIC);
+}
+
+
+static struct bench_sta * bench_get_sta(struct bench_ctx *ctx, const u8 *addr)
+{
+	unsigned int idx;
+
+	idx = (addr[3] << 16) | (addr[4] << 8) | addr[5];
+	if (idx >= ctx->num_sta || os_memcmp(ctx->sta[idx].addr, addr,
+					     ETH_ALEN) != 0)
+		return NULL;
+	return &ctx->sta[idx];
+}
+
+
+static void bench_sta_addr(u8 *addr, unsigned int idx)
+{
+	addr[0] = 0x02;
+	addr[1] = 0x00;
+	addr[2] = 0x00;
+	addr[3] = (idx >> 16) & 0xff;
+	addr[4] = (idx >> 8) & 0xff;
+	addr[5] = idx & 0xff;
+}
+
+
+/* Supplicant callbacks */
+
+static void supp_set_state(void *ctx, enum wpa_states state)
+{
+	struct bench_sta *sta = ctx;
+
+	if (state == WPA_COMPLETED)
+		sta->supp_done = 1;
+}
+
+
+static enum wpa_states supp_get_state(void *ctx)
+{
+	struct bench_sta *sta = ctx;
+
+	return sta->supp_done ? WPA_COMPLETED : WPA_4WAY_HANDSHAKE;
+}
+
+
+static int supp_get_bssid(void *ctx, u8 *bssid)
+{
+	struct bench_sta *sta = ctx;
+
+	os_memcpy(bssid, sta->ctx->auth_addr, ETH_ALEN);
+	return 0;
+}
+
+
+static int supp_ether_send(void *ctx, const u8 *dest, u16 proto, const u8 *buf,
+			   size_t len)
+{
+	struct bench_sta *sta = ctx;
+
+	if (len > sizeof(sta->to_auth)) {
+		sta->ctx->dropped++;
+		return -1;
+	}
+	os_memcpy(sta->to_auth, buf, len);
+	sta->to_auth_len = len;
+	return 0;
+}
+
+
+static u8 * supp_alloc_eapol(void *ctx, u8 type, const void *data,
+			     u16 data_len, size_t *msg_len, void **data_pos)
+{
+	struct ieee802_1x_hdr *hdr;
+
+	*msg_len = sizeof(*hdr) + data_len;
+	hdr = os_malloc(*msg_len);
+	if (hdr == NULL)
+		return NULL;
+
+	hdr->version = 2;
+	hdr->type = type;
+	hdr->length = host_to_be16(data_len);
+
+	if (data)
+		os_memcpy(hdr + 1, data, data_len);
+	else
+		os_memset(hdr + 1, 0, data_len);
+
+	if (data_pos)
+		*data_pos = hdr + 1;
+
+	return (u8 *) hdr;
+}
+
+
+static int supp_get_beacon_ie(void *ctx)
+{
+	struct bench_sta *sta = ctx;
+	const u8 *ie;
+	size_t ielen;
+
+	ie = wpa_auth_get_wpa_ie(sta->ctx->auth_group, &ielen);
+	if (ie == NULL || ielen < 1)
+		return -1;
+	return wpa_sm_set_ap_rsn_ie(sta->supp, ie, 2 + ie[1]);
+}
+
+
+static int supp_set_key(void *ctx, enum wpa_alg alg,
+			const u8 *addr, int key_idx, int set_tx,
+			const u8 *seq, size_t seq_len,
+			const u8 *key, size_t key_len)
+{
+	return 0;
+}
+
+
+static int supp_mlme_setprotection(void *ctx, const u8 *addr,
+				   int protection_type, int key_type)
+{
+	return 0;
+}
+
+
+static void supp_cancel_auth_timeout(void *ctx)
+{
+}
+
+
+static void * supp_get_network_ctx(void *ctx)
+{
+	return ctx;
+}
+
+
+static int supp_add_pmkid(void *ctx, void *network_ctx, const u8 *bssid,
+			  const u8 *pmkid, const u8 *fils_cache_id,
+			  const u8 *pmk, size_t pmk_len)
+{
+	return 0;
+}
+
+
+static int supp_remove_pmkid(void *ctx, void *network_ctx, const u8 *bssid,
+			     const u8 *pmkid, const u8 *fils_cache_id)
+{
+	return 0;
+}
+
+
+static void supp_deauthenticate(void *ctx, int reason_code)
+{
+	struct bench_sta *sta = ctx;
+
+	wpa_printf(MSG_DEBUG, "SUPP: " MACSTR " deauthenticate(%d)",
+		   MAC2STR(sta->addr), reason_code);
+}
+
+
+/* Authenticator callbacks */
+
+static void auth_logger(void *ctx, const u8 *addr, logger_level level,
+			const char *txt)
+{
+	if (addr)
+		wpa_printf(MSG_DEBUG, "AUTH: " MACSTR " - %s",
+			   MAC2STR(addr), txt);
+	else
+		wpa_printf(MSG_DEBUG, "AUTH: %s", txt);
+}
+
+
+static int auth_send_eapol(void *ctx, const u8 *addr, const u8 *data,
+			   size_t data_len, int encrypt)
+{
+	struct bench_ctx *bctx = ctx;
+	struct bench_sta *sta;
+
+	sta = bench_get_sta(bctx, addr);
+	if (!sta || data_len > sizeof(sta->to_supp)) {
+		bctx->dropped++;
+		return -1;
+	}
+	os_memcpy(sta->to_supp, data, data_len);
+	sta->to_supp_len = data_len;
+	return 0;
+}
+
+
+static const u8 * auth_get_psk(void *ctx, const u8 *addr,
+			       const u8 *p2p_dev_addr, const u8 *prev_psk,
+			       size_t *psk_len, int *vlan_id)
+{
+	struct bench_ctx *bctx = ctx;
+	unsigned int idx = 0;
+
+	bctx->psk_lookups++;
+	if (psk_len)
+		*psk_len = PMK_LEN;
+	if (vlan_id)
+		*vlan_id = 0;
+	if (prev_psk)
+		idx = (prev_psk - bctx->psk) / PMK_LEN + 1;
+	if (idx >= bctx->num_psk)
+		return NULL;
+	return &bctx->psk[idx * PMK_LEN];
+}
+
+
+static int auth_set_key(void *ctx, int vlan_id, enum wpa_alg alg,
+			const u8 *addr, int idx, u8 *key, size_t key_len)
+{
+	struct bench_ctx *bctx = ctx;
+	struct bench_sta *sta;
+
+	if (!addr || idx != 0 || alg == WPA_ALG_NONE || is_zero_ether_addr(addr))
+		return 0;
+	sta = bench_get_sta(bctx, addr);
+	if (sta)
+		sta->auth_done = 1;
+	return 0;
+}
+
+
+#ifdef CONFIG_IEEE80211R_AP
+static int auth_get_vlan(void *ctx, const u8 *sta_addr,
+			 struct vlan_description *vlan)
+{
+	os_memset(vlan, 0, sizeof(*vlan));
+	return 0;
+}
+#endif /* CONFIG_IEEE80211R_AP */
+
+
+static int auth_init_group(struct bench_ctx *ctx)
+{
+	struct wpa_auth_config conf;
+	struct wpa_auth_callbacks cb;
+
+	os_memset(&conf, 0, sizeof(conf));
+	conf.wpa = 2;
+	conf.wpa_pairwise = WPA_CIPHER_CCMP;
+	conf.rsn_pairwise = WPA_CIPHER_CCMP;
+	conf.wpa_group = WPA_CIPHER_CCMP;
+	conf.ieee80211w = 1;
+	conf.group_mgmt_cipher = WPA_CIPHER_AES_128_CMAC;
+	conf.eapol_version = 2;
+	conf.wpa_group_update_count = 4;
+	conf.wpa_pairwise_update_count = 4;
+
+	switch (ctx->mode) {
+	case BENCH_MODE_PSK:
+	case BENCH_MODE_MULTI_PSK:
+		conf.wpa_key_mgmt = WPA_KEY_MGMT_PSK;
+		break;
+	case BENCH_MODE_SAE:
+		conf.wpa_key_mgmt = WPA_KEY_MGMT_SAE;
+		conf.ieee80211w = 2;
+		break;
+	case BENCH_MODE_FT:
+		conf.wpa_key_mgmt = WPA_KEY_MGMT_FT_PSK;
+		os_memcpy(conf.mobility_domain, ctx->mdid,
+			  MOBILITY_DOMAIN_ID_LEN);
+		os_memcpy(conf.r0_key_holder, "eapol-bench.r0kh", 16);
+		conf.r0_key_holder_len = 16;
+		os_memcpy(conf.r1_key_holder, ctx->auth_addr, FT_R1KH_ID_LEN);
+		conf.r0_key_lifetime = 10000;
+		conf.reassociation_deadline = 1000;
+		break;
+	}
+
+	os_memset(&cb, 0, sizeof(cb));
+	cb.logger = auth_logger;
+	cb.send_eapol = auth_send_eapol;
+	cb.get_psk = auth_get_psk;
+	cb.set_key = auth_set_key;
+#ifdef CONFIG_IEEE80211R_AP
+	cb.get_vlan = auth_get_vlan;
+#endif /* CONFIG_IEEE80211R_AP */
+
+	ctx->auth_group = wpa_init(ctx->auth_addr, &conf, &cb, ctx);
+	if (!ctx->auth_group) {
+		wpa_printf(MSG_ERROR, "AUTH: wpa_init() failed");
+		return -1;
+	}
+
+	if (wpa_init_keys(ctx->auth_group) < 0) {
+		wpa_printf(MSG_ERROR, "AUTH: wpa_init_keys() failed");
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static int supp_init(struct bench_ctx *ctx, struct bench_sta *sta)
+{
+	struct wpa_sm_ctx *sctx = os_zalloc(sizeof(*sctx));
+	int key_mgmt = WPA_KEY_MGMT_PSK;
+	int mfp = MGMT_FRAME_PROTECTION_OPTIONAL;
+	const u8 *pmk = &ctx->psk[(ctx->num_psk - 1) * PMK_LEN];
+
+	if (!sctx)
+		return -1;
+
+	sctx->ctx = sta;
+	sctx->msg_ctx = sta;
+	sctx->set_state = supp_set_state;
+	sctx->get_state = supp_get_state;
+	sctx->get_bssid = supp_get_bssid;
+	sctx->ether_send = supp_ether_send;
+	sctx->get_beacon_ie = supp_get_beacon_ie;
+	sctx->alloc_eapol = supp_alloc_eapol;
+	sctx->set_key = supp_set_key;
+	sctx->mlme_setprotection = supp_mlme_setprotection;
+	sctx->cancel_auth_timeout = supp_cancel_auth_timeout;
+	sctx->get_network_ctx = supp_get_network_ctx;
+	sctx->deauthenticate = supp_deauthenticate;
+	sctx->add_pmkid = supp_add_pmkid;
+	sctx->remove_pmkid = supp_remove_pmkid;
+	sta->supp = wpa_sm_init(sctx);
+	if (!sta->supp) {
+		wpa_printf(MSG_ERROR, "SUPP: wpa_sm_init() failed");
+		os_free(sctx);
+		return -1;
+	}
+
+	if (ctx->mode == BENCH_MODE_SAE) {
+		key_mgmt = WPA_KEY_MGMT_SAE;
+		mfp = MGMT_FRAME_PROTECTION_REQUIRED;
+	} else if (ctx->mode == BENCH_MODE_FT) {
+		key_mgmt = WPA_KEY_MGMT_FT_PSK;
+	}
+
+	wpa_sm_set_own_addr(sta->supp, sta->addr);
+	wpa_sm_set_param(sta->supp, WPA_PARAM_RSN_ENABLED, 1);
+	wpa_sm_set_param(sta->supp, WPA_PARAM_PROTO, WPA_PROTO_RSN);
+	wpa_sm_set_param(sta->supp, WPA_PARAM_PAIRWISE, WPA_CIPHER_CCMP);
+	wpa_sm_set_param(sta->supp, WPA_PARAM_GROUP, WPA_CIPHER_CCMP);
+	wpa_sm_set_param(sta->supp, WPA_PARAM_KEY_MGMT, key_mgmt);
+	wpa_sm_set_param(sta->supp, WPA_PARAM_MFP, mfp);
+
+	if (ctx->mode == BENCH_MODE_SAE) {
+		u8 pmkid[PMKID_LEN];
+
+		/* Per-station PMKID as SAE would have derived it */
+		os_memset(pmkid, 0x5a, PMKID_LEN);
+		os_memcpy(pmkid, sta->addr, ETH_ALEN);
+		wpa_sm_set_pmk(sta->supp, ctx->sae_pmk, PMK_LEN, pmkid,
+			       ctx->auth_addr);
+		pmksa_cache_set_current(sta->supp, pmkid, ctx->auth_addr, NULL,
+					0, NULL, WPA_KEY_MGMT_SAE);
+		if (wpa_auth_pmksa_add_sae(ctx->auth_group, sta->addr,
+					   ctx->sae_pmk, pmkid) < 0)
+			return -1;
+	} else {
+		wpa_sm_set_pmk(sta->supp, pmk, PMK_LEN, NULL, NULL);
+	}
+
+	sta->supp_ie_len = sizeof(sta->supp_ie);
+	if (wpa_sm_set_assoc_wpa_ie_default(sta->supp, sta->supp_ie,
+					    &sta->supp_ie_len) < 0) {
+		wpa_printf(MSG_ERROR,
+			   "SUPP: wpa_sm_set_assoc_wpa_ie_default() failed");
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/* Association as seen by the authenticator, up to sending message 1/4 */
+static int auth_sta_assoc(struct bench_ctx *ctx, struct bench_sta *sta,
+			  u8 *resp_ies, size_t *resp_ies_len)
+{
+	u8 mdie[MOBILITY_DOMAIN_ID_LEN + 1];
+	const u8 *md = NULL;
+	size_t md_len = 0;
+
+	*resp_ies_len = 0;
+	sta->auth = wpa_auth_sta_init(ctx->auth_group, sta->addr, NULL);
+	if (!sta->auth)
+		return -1;
+
+	if (ctx->mode == BENCH_MODE_FT) {
+		os_memcpy(mdie, ctx->mdid, MOBILITY_DOMAIN_ID_LEN);
+		mdie[MOBILITY_DOMAIN_ID_LEN] = 0;
+		md = mdie;
+		md_len = sizeof(mdie);
+	}
+
+	if (wpa_validate_wpa_ie(ctx->auth_group, sta->auth, 2412,
+				sta->supp_ie, sta->supp_ie_len, md, md_len,
+				NULL, 0) != WPA_IE_OK)
+		return -1;
+
+	if (ctx->mode == BENCH_MODE_FT) {
+		u8 *end;
+
+		end = wpa_sm_write_assoc_resp_ies(sta->auth, resp_ies, 256,
+						  WLAN_AUTH_OPEN, sta->supp_ie,
+						  sta->supp_ie_len);
+		if (!end)
+			return -1;
+		*resp_ies_len = end - resp_ies;
+	}
+
+	return 0;
+}
+
+
+static void bench_sta_deinit(struct bench_sta *sta)
+{
+	wpa_auth_sta_deinit(sta->auth);
+	sta->auth = NULL;
+	wpa_sm_deinit(sta->supp);
+	sta->supp = NULL;
+}
+
+
+/*
+ * Run one stage for all stations. Each step is timed individually for the
+ * latency histogram; CPU time and allocations are taken over the whole pass
+ * so that the clock reads do not dominate the numbers.
+ */
+static void bench_stage(struct bench_ctx *ctx, enum bench_stage stage)
+{
+	struct bench_stats *st = &ctx->stats[stage];
+	unsigned long allocs = bench_allocs, alloc_bytes = bench_alloc_bytes;
+	u64 cpu_start, start, ns;
+	u8 resp_ies[256];
+	size_t resp_ies_len = 0;
+	unsigned int i;
+	int ret;
+
+	cpu_start = bench_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+	for (i = 0; i < ctx->num_sta; i++) {
+		struct bench_sta *sta = &ctx->sta[i];
+		size_t len;
+
+		ret = 0;
+		start = bench_now_ns();
+		switch (stage) {
+		case BENCH_ASSOC:
+			ret = auth_sta_assoc(ctx, sta, resp_ies,
+					     &resp_ies_len);
+			break;
+		case BENCH_AUTH_M1:
+			if (!sta->auth)
+				continue;
+			wpa_auth_sm_event(sta->auth, WPA_ASSOC);
+			ret = wpa_auth_sta_associated(ctx->auth_group,
+						      sta->auth);
+			break;
+		case BENCH_SUPP_M2:
+		case BENCH_SUPP_M4:
+			if (!sta->to_supp_len)
+				continue;
+			len = sta->to_supp_len;
+			sta->to_supp_len = 0;
+			ret = wpa_sm_rx_eapol(sta->supp, ctx->auth_addr,
+					      sta->to_supp, len);
+			ret = ret < 0 ? -1 : 0;
+			break;
+		case BENCH_AUTH_M3:
+		case BENCH_AUTH_M4:
+			if (!sta->to_auth_len)
+				continue;
+			len = sta->to_auth_len;
+			sta->to_auth_len = 0;
+			wpa_receive(ctx->auth_group, sta->auth, sta->to_auth,
+				    len);
+			break;
+		case BENCH_DEINIT:
+			bench_sta_deinit(sta);
+			break;
+		case NUM_BENCH_STAGE:
+			break;
+		}
+		ns = bench_now_ns() - start;
+		bench_hist_add(&st->lat, ns);
+
+		if (ret < 0) {
+			wpa_printf(MSG_DEBUG, "Stage %s failed for " MACSTR,
+				   bench_stage_txt[stage], MAC2STR(sta->addr));
+			continue;
+		}
+		if (stage != BENCH_ASSOC)
+			continue;
+		/* Association response as seen by the station */
+		wpa_sm_notify_assoc(sta->supp, ctx->auth_addr);
+		if (resp_ies_len &&
+		    wpa_sm_set_ft_params(sta->supp, resp_ies,
+					 resp_ies_len) < 0)
+			wpa_printf(MSG_DEBUG, "FT parameters rejected for "
+				   MACSTR, MAC2STR(sta->addr));
+	}
+	st->cpu_ns += bench_clock_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+	st->allocs += bench_allocs - allocs;
+	st->alloc_bytes += bench_alloc_bytes - alloc_bytes;
+}
+
+
+static int bench_iteration(struct bench_ctx *ctx)
+{
+	unsigned int i;
+	enum bench_stage stage;
+	u64 start;
+
+	for (i = 0; i < ctx->num_sta; i++) {
+		struct bench_sta *sta = &ctx->sta[i];
+
+		os_memset(sta, 0, sizeof(*sta));
+		sta->ctx = ctx;
+		bench_sta_addr(sta->addr, i);
+		if (supp_init(ctx, sta) < 0)
+			return -1;
+	}
+
+	start = bench_now_ns();
+	for (stage = BENCH_ASSOC; stage < BENCH_DEINIT; stage++)
+		bench_stage(ctx, stage);
+	ctx->elapsed_ns += bench_now_ns() - start;
+
+	for (i = 0; i < ctx->num_sta; i++) {
+		if (ctx->sta[i].supp_done && ctx->sta[i].auth_done)
+			ctx->handshakes++;
+		else
+			ctx->failures++;
+	}
+
+	bench_stage(ctx, BENCH_DEINIT);
+
+	return 0;
+}
+
+
+static void bench_report(struct bench_ctx *ctx)
+{
+	unsigned int i;
+	u64 auth_cpu_ns = 0;
+	double secs = ctx->elapsed_ns / 1e9;
+
+	printf("%-8s %10s %10s %10s %10s %10s %10s %10s %8s %8s\n",
+	       "stage", "count", "mean_ns", "p50_ns", "p90_ns", "p99_ns",
+	       "max_ns", "cpu_ns", "allocs", "bytes");
+	for (i = 0; i < NUM_BENCH_STAGE; i++) {
+		struct bench_stats *st = &ctx->stats[i];
+
+		if (!st->lat.count)
+			continue;
+		if (bench_stage_auth[i] && i != BENCH_DEINIT)
+			auth_cpu_ns += st->cpu_ns;
+		printf("%-8s %10lu %10llu %10llu %10llu %10llu %10llu %10llu "
+		       "%8.1f %8.0f\n",
+		       bench_stage_txt[i], st->lat.count,
+		       (unsigned long long) (st->lat.total_ns / st->lat.count),
+		       (unsigned long long) bench_hist_percentile(&st->lat, 50),
+		       (unsigned long long) bench_hist_percentile(&st->lat, 90),
+		       (unsigned long long) bench_hist_percentile(&st->lat, 99),
+		       (unsigned long long) st->lat.max_ns,
+		       (unsigned long long) (st->cpu_ns / st->lat.count),
+		       (double) st->allocs / st->lat.count,
+		       (double) st->alloc_bytes / st->lat.count);
+	}
+
+	printf("handshakes=%lu failures=%lu dropped=%lu elapsed_ms=%.3f "
+	       "handshakes_per_sec=%.0f\n",
+	       ctx->handshakes, ctx->failures, ctx->dropped, secs * 1000,
+	       secs > 0 ? ctx->handshakes / secs : 0);
+	printf("authenticator: cpu_us_per_handshake=%.2f "
+	       "handshakes_per_cpu_sec=%.0f psk_lookups=%lu\n",
+	       ctx->handshakes ? auth_cpu_ns / 1e3 / ctx->handshakes : 0,
+	       auth_cpu_ns ? ctx->handshakes / (auth_cpu_ns / 1e9) : 0,
+	       ctx->psk_lookups);
+}
+
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [-m<mode>] [-s<stations>] [-i<iterations>] "
+	       "[-k<psks>] [-d]\n"
+	       "  -m <mode>  psk, multi-psk, sae or ft (default psk)\n"
+	       "  -s <num>   number of simulated stations (default 100)\n"
+	       "  -i <num>   number of handshake rounds (default 10)\n"
+	       "  -k <num>   number of PSKs for multi-psk; the stations use "
+	       "the last one (default 16)\n"
+	       "  -d         increase debug verbosity\n",
+	       prog);
+}
+
+
+int main(int argc, char *argv[])
+{
+	struct bench_ctx ctx;
+	const char *mode = "psk";
+	unsigned int i;
+	int ret = -1, c;
+
+	os_memset(&ctx, 0, sizeof(ctx));
+	ctx.num_sta = 100;
+	ctx.iterations = 10;
+	ctx.num_psk = 16;
+	wpa_debug_level = MSG_ERROR;
+
+	for (;;) {
+		c = getopt(argc, argv, "dhi:k:m:s:");
+		if (c < 0)
+			break;
+		switch (c) {
+		case 'd':
+			if (wpa_debug_level > 0)
+				wpa_debug_level--;
+			break;
+		case 'i':
+			ctx.iterations = atoi(optarg);
+			break;
+		case 'k':
+			ctx.num_psk = atoi(optarg);
+			break;
+		case 'm':
+			mode = optarg;
+			break;
+		case 's':
+			ctx.num_sta = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (os_strcmp(mode, "psk") == 0) {
+		ctx.mode = BENCH_MODE_PSK;
+		ctx.num_psk = 1;
+	} else if (os_strcmp(mode, "multi-psk") == 0) {
+		ctx.mode = BENCH_MODE_MULTI_PSK;
+	} else if (os_strcmp(mode, "sae") == 0) {
+		ctx.mode = BENCH_MODE_SAE;
+		ctx.num_psk = 1;
+	} else if (os_strcmp(mode, "ft") == 0) {
+		ctx.mode = BENCH_MODE_FT;
+		ctx.num_psk = 1;
+	} else {
+		usage(argv[0]);
+		return -1;
+	}
+
+	if (ctx.num_sta == 0 || ctx.num_sta > 0xffffff ||
+	    ctx.iterations == 0 || ctx.num_psk == 0) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	if (os_program_init())
+		return -1;
+
+	if (eloop_init()) {
+		wpa_printf(MSG_ERROR, "Failed to initialize event loop");
+		return -1;
+	}
+
+	os_memset(ctx.auth_addr, 0x12, ETH_ALEN);
+	os_memset(ctx.sae_pmk, 0x66, PMK_LEN);
+	ctx.mdid[0] = 0x34;
+	ctx.mdid[1] = 0x12;
+	ctx.psk = os_malloc(ctx.num_psk * PMK_LEN);
+	ctx.sta = os_calloc(ctx.num_sta, sizeof(struct bench_sta));
+	if (!ctx.psk || !ctx.sta)
+		goto fail;
+	for (i = 0; i < ctx.num_psk; i++)
+		os_memset(&ctx.psk[i * PMK_LEN], 0x40 + (i & 0x3f), PMK_LEN);
+
+	if (auth_init_group(&ctx) < 0)
+		goto fail;
+
+	for (i = 0; i < ctx.iterations; i++) {
+		if (bench_iteration(&ctx) < 0) {
+			for (c = 0; c < (int) ctx.num_sta; c++)
+				bench_sta_deinit(&ctx.sta[c]);
+			goto fail;
+		}
+	}
+
+	printf("mode=%s stations=%u iterations=%u psks=%u\n",
+	       mode, ctx.num_sta, ctx.iterations, ctx.num_psk);
+	bench_report(&ctx);
+
+	ret = 0;
+fail:
+	if (ctx.auth_group)
+		wpa_deinit(ctx.auth_group);
+	os_free(ctx.sta);
+	os_free(ctx.psk);
+	eloop_destroy();
+	os_program_deinit();
+
+	return ret;
+}
@@ -7,6 +7,7 @@
 import binascii
 import logging
 logger = logging.getLogger()
+import os
 import socket
 import struct
 import subprocess
@@ -1161,3 +1162,48 @@ def test_rsn_preauth_local_errors(dev, apdev):
         raise Exception("ENABLE failed")
     sock.send(_bssid + foreign + proto + struct.pack('>BBH', 2, 1, 0))
     sock.send(_bssid + foreign2 + proto + struct.pack('>BBH', 2, 1, 0))
+
+def test_pmksa_cache_file(dev, apdev, params):
+    """PMKSA cache snapshot saved and restored over AP restart"""
+    fname = os.path.join(params['logdir'], 'pmksa_cache_file.snapshot')
+    key = "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    ap_params = hostapd.wpa2_eap_params(ssid="test-pmksa-cache")
+    ap_params['pmksa_cache_file'] = fname
+    ap_params['pmksa_cache_save_interval'] = "0"
+    hapd = hostapd.add_ap(apdev[0], ap_params, no_enable=True)
+    if "FAIL" not in hapd.request("ENABLE"):
+        raise Exception("ENABLE succeeded without pmksa_cache_file_key")
+    if "FAIL" not in hapd.request("SET pmksa_cache_file_key " + key + "0"):
+        raise Exception("Odd length pmksa_cache_file_key accepted")
+    hapd.set("pmksa_cache_file_key", key)
+    hapd.enable()
+
+    bssid = apdev[0]['bssid']
+    dev[0].connect("test-pmksa-cache", proto="RSN", key_mgmt="WPA-EAP",
+                   eap="GPSK", identity="gpsk user",
+                   password="abcdefghijklmnop0123456789abcdef",
+                   scan_freq="2412")
+    pmksa = dev[0].get_pmksa(bssid)
+    if pmksa is None:
+        raise Exception("No PMKSA cache entry created")
+    dev[0].request("DISCONNECT")
+    dev[0].wait_disconnected()
+
+    hapd.disable()
+    if not os.path.exists(fname):
+        raise Exception("PMKSA cache snapshot not written")
+    hapd.enable()
+    if pmksa['pmkid'] not in hapd.request("PMKSA"):
+        raise Exception("PMKSA cache entry not restored")
+
+    dev[0].dump_monitor()
+    dev[0].request("RECONNECT")
+    ev = dev[0].wait_event(["CTRL-EVENT-EAP-STARTED",
+                            "CTRL-EVENT-CONNECTED"], timeout=10)
+    if ev is None:
+        raise Exception("Reconnection timed out")
+    if "CTRL-EVENT-EAP-STARTED" in ev:
+        raise Exception("Unexpected EAP exchange after AP restart")
+    pmksa2 = dev[0].get_pmksa(bssid)
+    if pmksa2 is None or pmksa2['pmkid'] != pmksa['pmkid']:
+        raise Exception("Unexpected PMKID change after AP restart")
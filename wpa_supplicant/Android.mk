@@ -833,6 +833,8 @@ endif
 ifdef CONFIG_AP
 NEED_EAP_COMMON=y
 NEED_RSN_AUTHENTICATOR=y
+# PMKSA/FT cache snapshot (pmksa_cache_file)
+NEED_AES_SIV=y
 L_CFLAGS += -DCONFIG_AP
 OBJS += ap.c
 L_CFLAGS += -DCONFIG_NO_RADIUS
@@ -845,6 +847,8 @@ OBJS += src/ap/authsrv.c
 OBJS += src/ap/ap_config.c
 OBJS += src/utils/ip_addr.c
 OBJS += src/ap/sta_info.c
+OBJS += src/ap/sta_admit.c
+OBJS += src/ap/sta_latency.c
 OBJS += src/ap/tkip_countermeasures.c
 OBJS += src/ap/ap_mlme.c
 OBJS += src/ap/ieee802_1x.c
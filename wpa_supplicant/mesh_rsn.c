@@ -366,7 +366,7 @@ int mesh_rsn_auth_sae_sta(struct wpa_supplicant *wpa_s,
 	}
 
 	if (!sta->sae) {
-		sta->sae = os_zalloc(sizeof(*sta->sae));
+		sta->sae = ap_sta_sae_alloc(sta);
 		if (sta->sae == NULL)
 			return -1;
 	}